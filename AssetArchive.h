@@ -0,0 +1,631 @@
+﻿#pragma once
+#include "includy.h"
+#include "Lz4.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <algorithm>
+
+/**
+* @struct AssetArchiveHeader
+* @brief Nagłówek pliku .jpak. Za nim dane plików (co 64 bajty), na końcu spis treści i tablica nazw
+*/
+struct AssetArchiveHeader
+{
+	char magic[4];        // "JPAK"
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t chunkSize;   // rozmiar kawałka przed kompresją
+	uint64_t tocOffset;   // AssetEntry[entryCount] posortowane wg skrótu nazwy
+	uint64_t namesOffset;
+	uint64_t namesBytes;
+	uint64_t fileSize;
+	uint64_t reserved[2];
+};
+
+/**
+* @struct AssetEntry
+* @brief Pozycja spisu treści. Plik skompresowany zaczyna się tablicą rozmiarów kawałków (uint32,
+* najwyższy bit - kawałek zapisany bez kompresji), za nią kawałki jeden po drugim
+*/
+struct AssetEntry
+{
+	uint64_t hash;        // AssetArchive::hash(nazwa)
+	uint64_t offset;      // od początku archiwum
+	uint64_t size;        // po rozpakowaniu
+	uint64_t storedSize;  // w archiwum
+	uint32_t nameOffset;
+	uint32_t nameLength;
+	uint32_t flags;       // AssetEntry::Compressed
+	uint32_t chunkCount;
+
+	enum Flags : uint32_t
+	{
+		Compressed = 1
+	};
+};
+
+static_assert(sizeof(AssetArchiveHeader) == 64, "AssetArchiveHeader layout");
+static_assert(sizeof(AssetEntry) == 48, "AssetEntry layout");
+
+/**
+* @struct AssetPackOptions
+* @brief Ustawienia budowania archiwum
+*/
+struct AssetPackOptions
+{
+	uint32_t chunkSize = 64 * 1024;
+	bool compress = true;
+	float minSavings = 0.1f; // plik zostaje nieskompresowany (dostępny bez kopiowania), jeśli zysk jest mniejszy
+};
+
+/**
+* @class AssetArchive
+* @brief Archiwum zasobów (.jpak) - jeden zmapowany plik zamiast tysięcy małych plików obok programu.
+* Wyszukiwanie to wyszukiwanie binarne po 64-bitowym skrócie nazwy (bez rozróżniania wielkości liter i '/' '\\').
+* Pliki nieskompresowane są dostępne bezpośrednio w mapowaniu, skompresowane (LZ4) rozpakowywane kawałkami
+* - całe na wątku wywołującym albo strumieniowo na wątku I/O
+*/
+class AssetArchive
+{
+public:
+	static const uint32_t Version = 1;
+
+	// Wywoływane na wątku I/O dla kolejnych kawałków pliku
+	typedef function<void(const uint8_t* data, size_t offset, size_t size)> ChunkCallback;
+
+	static const char* extension()
+	{
+		return ".jpak";
+	}
+
+	AssetArchive() {}
+
+	AssetArchive(const AssetArchive&) = delete;
+	AssetArchive& operator=(const AssetArchive&) = delete;
+
+	bool open(const string& path)
+	{
+		close();
+		if (!file.open(path))
+		{
+			return false;
+		}
+		if (!validate())
+		{
+			cout << "Niepoprawne archiwum " << path << "\n";
+			close();
+			return false;
+		}
+		archivePath = path;
+		return true;
+	}
+
+	void close()
+	{
+		file.close();
+		entries = nullptr;
+		count = 0;
+		names = nullptr;
+		archivePath.clear();
+	}
+
+	bool isOpen() const
+	{
+		return file.isOpen();
+	}
+
+	const string& path() const
+	{
+		return archivePath;
+	}
+
+	size_t entryCount() const
+	{
+		return count;
+	}
+
+	const AssetEntry& entry(size_t i) const
+	{
+		return entries[i];
+	}
+
+	string name(const AssetEntry& entry) const
+	{
+		return string(names + entry.nameOffset, entry.nameLength);
+	}
+
+	const AssetEntry* find(const string& name) const
+	{
+		if (count == 0)
+		{
+			return nullptr;
+		}
+
+		uint64_t key = hash(name);
+		const AssetEntry* it = lower_bound(entries, entries + count, key, [](const AssetEntry& entry, uint64_t value)
+		{
+			return entry.hash < value;
+		});
+		for (; it != entries + count && it->hash == key; ++it)
+		{
+			if (sameName(names + it->nameOffset, it->nameLength, name))
+			{
+				return it;
+			}
+		}
+		return nullptr;
+	}
+
+	bool contains(const string& name) const
+	{
+		return find(name) != nullptr;
+	}
+
+	// Dane pliku bez kopiowania - tylko dla plików zapisanych bez kompresji
+	const uint8_t* view(const AssetEntry& entry) const
+	{
+		return (entry.flags & AssetEntry::Compressed) ? nullptr : file.data() + entry.offset;
+	}
+
+	// Dane pliku: bezpośrednio z mapowania albo rozpakowane do storage
+	bool access(const string& name, const uint8_t*& data, size_t& size, vector<uint8_t>& storage) const
+	{
+		const AssetEntry* entry = find(name);
+		if (!entry)
+		{
+			return false;
+		}
+
+		size = (size_t)entry->size;
+		data = view(*entry);
+		if (data)
+		{
+			return true;
+		}
+		if (!read(*entry, storage))
+		{
+			return false;
+		}
+		data = storage.data();
+		return true;
+	}
+
+	bool read(const string& name, vector<uint8_t>& out) const
+	{
+		const AssetEntry* entry = find(name);
+		return entry && read(*entry, out);
+	}
+
+	// Rozpakowanie całego pliku, duże pliki kawałkami na puli wątków
+	bool read(const AssetEntry& entry, vector<uint8_t>& out) const
+	{
+		out.resize((size_t)entry.size);
+		if (!(entry.flags & AssetEntry::Compressed))
+		{
+			if (entry.size) memcpy(out.data(), file.data() + entry.offset, (size_t)entry.size);
+			return true;
+		}
+
+		vector<uint64_t> offsets;
+		if (!chunkOffsets(entry, offsets))
+		{
+			return false;
+		}
+
+		atomic<bool> ok{ true };
+		ThreadPool::shared().parallelFor(entry.chunkCount, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end && ok; i++)
+			{
+				if (!decodeChunk(entry, offsets, i, out.data() + i * header().chunkSize))
+				{
+					ok = false;
+				}
+			}
+		}, 4);
+		return ok;
+	}
+
+	// Wczytanie całego pliku na wątku I/O (archiwum musi istnieć do końca odczytu)
+	future<vector<uint8_t>> readAsync(const string& name) const
+	{
+		return io().submit([this, name]()
+		{
+			vector<uint8_t> data;
+			const AssetEntry* entry = find(name);
+			if (!entry || !stream(*entry, [&](const uint8_t* chunk, size_t offset, size_t size)
+			{
+				if (offset == 0) data.resize((size_t)entry->size);
+				memcpy(data.data() + offset, chunk, size);
+			}))
+			{
+				data.clear();
+			}
+			return data;
+		});
+	}
+
+	// Odczyt strumieniowy na wątku I/O: strony kawałka są wczytywane z dysku, rozpakowywane
+	// i przekazywane do onChunk, więc duży plik nie musi być w całości w pamięci
+	future<bool> streamAsync(const string& name, ChunkCallback onChunk) const
+	{
+		return io().submit([this, name, onChunk]()
+		{
+			const AssetEntry* entry = find(name);
+			return entry && stream(*entry, onChunk);
+		});
+	}
+
+	// Dodatkowe archiwa - pliki z archiwów zamontowanych później przesłaniają wcześniejsze
+	static bool mount(const string& path)
+	{
+		unique_ptr<AssetArchive> archive(new AssetArchive());
+		if (!archive->open(path))
+		{
+			return false;
+		}
+		cout << "Archiwum " << path << ": " << archive->entryCount() << " plikow\n";
+		lock_guard<mutex> lock(mountMutex);
+		mounted.push_back(std::move(archive));
+		return true;
+	}
+
+	static void unmountAll()
+	{
+		lock_guard<mutex> lock(mountMutex);
+		mounted.clear();
+	}
+
+	// Archiwum zawierające plik (nullptr - plik trzeba czytać z dysku)
+	static const AssetArchive* locate(const string& name)
+	{
+		lock_guard<mutex> lock(mountMutex);
+		for (auto it = mounted.rbegin(); it != mounted.rend(); ++it)
+		{
+			if ((*it)->contains(name))
+			{
+				return it->get();
+			}
+		}
+		return nullptr;
+	}
+
+	// Zbudowanie archiwum z listy plików (nazwy w archiwum = ścieżki z listy)
+	static bool pack(const vector<string>& files, const string& target, const AssetPackOptions& options = AssetPackOptions())
+	{
+		ofstream out(target, ios::binary);
+		if (!out)
+		{
+			return false;
+		}
+
+		AssetArchiveHeader h = {};
+		memcpy(h.magic, "JPAK", 4);
+		h.version = Version;
+		h.chunkSize = options.chunkSize;
+		out.write((const char*)&h, sizeof(h));
+
+		vector<AssetEntry> toc;
+		string nameTable;
+		uint64_t position = sizeof(h), totalSize = 0;
+		for (const string& path : files)
+		{
+			ifstream in(path, ios::binary | ios::ate);
+			if (!in)
+			{
+				cout << "Nie udalo sie otworzyc " << path << "\n";
+				return false;
+			}
+			vector<uint8_t> data((size_t)in.tellg());
+			in.seekg(0);
+			in.read((char*)data.data(), data.size());
+
+			string name = normalize(path);
+			AssetEntry entry = {};
+			entry.hash = hash(name);
+			entry.size = data.size();
+			entry.nameOffset = (uint32_t)nameTable.size();
+			entry.nameLength = (uint32_t)name.size();
+			nameTable += name;
+
+			vector<uint8_t> stored;
+			if (options.compress && compressEntry(data, options.chunkSize, stored) &&
+				stored.size() <= data.size() * (1.0f - options.minSavings))
+			{
+				entry.flags = AssetEntry::Compressed;
+				entry.chunkCount = (uint32_t)((data.size() + options.chunkSize - 1) / options.chunkSize);
+			}
+			else
+			{
+				stored.swap(data);
+			}
+
+			entry.offset = align(position);
+			entry.storedSize = stored.size();
+			pad(out, position, entry.offset);
+			out.write((const char*)stored.data(), stored.size());
+			position += stored.size();
+			totalSize += entry.size;
+			toc.push_back(entry);
+		}
+
+		stable_sort(toc.begin(), toc.end(), [](const AssetEntry& a, const AssetEntry& b) { return a.hash < b.hash; });
+
+		h.entryCount = (uint32_t)toc.size();
+		h.tocOffset = align(position);
+		pad(out, position, h.tocOffset);
+		out.write((const char*)toc.data(), toc.size() * sizeof(AssetEntry));
+		position += toc.size() * sizeof(AssetEntry);
+
+		h.namesOffset = position;
+		h.namesBytes = nameTable.size();
+		out.write(nameTable.data(), nameTable.size());
+		h.fileSize = position + nameTable.size();
+
+		out.seekp(0);
+		out.write((const char*)&h, sizeof(h));
+		if (!out)
+		{
+			return false;
+		}
+
+		cout << target << ": " << toc.size() << " plikow, " << totalSize / 1024 << " KB -> " << h.fileSize / 1024 << " KB\n";
+		return true;
+	}
+
+	// Nazwa w archiwum: ukośniki '/', bez początkowego "./"
+	static string normalize(string name)
+	{
+		replace(name.begin(), name.end(), '\\', '/');
+		while (name.compare(0, 2, "./") == 0)
+		{
+			name.erase(0, 2);
+		}
+		return name;
+	}
+
+	// FNV-1a 64 znormalizowanej nazwy małymi literami
+	static uint64_t hash(const string& name)
+	{
+		uint64_t value = 0xCBF29CE484222325ull;
+		for (size_t i = nameStart(name); i < name.size(); i++)
+		{
+			value = (value ^ (uint8_t)fold(name[i])) * 0x100000001B3ull;
+		}
+		return value;
+	}
+
+private:
+	MappedFile file;
+	string archivePath;
+	const AssetEntry* entries = nullptr;
+	size_t count = 0;
+	const char* names = nullptr;
+
+	static vector<unique_ptr<AssetArchive>> mounted;
+	static mutex mountMutex;
+
+	// Jeden wątek I/O - odczyty z dysku i tak się szeregują
+	static ThreadPool& io()
+	{
+		static ThreadPool pool(1);
+		return pool;
+	}
+
+	const AssetArchiveHeader& header() const
+	{
+		return *(const AssetArchiveHeader*)file.data();
+	}
+
+	bool validate()
+	{
+		if (file.size() < sizeof(AssetArchiveHeader))
+		{
+			return false;
+		}
+		const AssetArchiveHeader& h = header();
+		if (memcmp(h.magic, "JPAK", 4) != 0 || h.version != Version || h.chunkSize == 0 || h.fileSize != file.size())
+		{
+			return false;
+		}
+		if (h.tocOffset % alignof(AssetEntry) != 0 || h.tocOffset > h.fileSize ||
+			h.entryCount > (h.fileSize - h.tocOffset) / sizeof(AssetEntry) ||
+			h.namesOffset > h.fileSize || h.namesBytes > h.fileSize - h.namesOffset)
+		{
+			return false;
+		}
+
+		entries = (const AssetEntry*)(file.data() + h.tocOffset);
+		count = h.entryCount;
+		names = (const char*)file.data() + h.namesOffset;
+		for (size_t i = 0; i < count; i++)
+		{
+			const AssetEntry& e = entries[i];
+			if (e.offset > h.fileSize || e.storedSize > h.fileSize - e.offset ||
+				(uint64_t)e.nameOffset + e.nameLength > h.namesBytes || (i > 0 && entries[i - 1].hash > e.hash))
+			{
+				return false;
+			}
+			bool compressed = (e.flags & AssetEntry::Compressed) != 0;
+			if (compressed && (e.chunkCount != (e.size + h.chunkSize - 1) / h.chunkSize || (uint64_t)e.chunkCount * 4 > e.storedSize))
+			{
+				return false;
+			}
+			if (!compressed && e.size != e.storedSize)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Początki kawałków w archiwum, na końcu koniec danych pliku
+	bool chunkOffsets(const AssetEntry& entry, vector<uint64_t>& offsets) const
+	{
+		const uint8_t* table = file.data() + entry.offset;
+		offsets.resize(entry.chunkCount + 1);
+		offsets[0] = entry.offset + (uint64_t)entry.chunkCount * 4;
+		for (uint32_t i = 0; i < entry.chunkCount; i++)
+		{
+			uint32_t stored;
+			memcpy(&stored, table + i * 4, 4);
+			offsets[i + 1] = offsets[i] + (stored & ~RawChunk);
+		}
+		return offsets.back() <= entry.offset + entry.storedSize;
+	}
+
+	size_t chunkBytes(const AssetEntry& entry, size_t chunk) const
+	{
+		size_t chunkSize = header().chunkSize;
+		return std::min<size_t>(chunkSize, (size_t)entry.size - chunk * chunkSize);
+	}
+
+	bool decodeChunk(const AssetEntry& entry, const vector<uint64_t>& offsets, size_t chunk, uint8_t* dst) const
+	{
+		uint32_t stored;
+		memcpy(&stored, file.data() + entry.offset + chunk * 4, 4);
+		const uint8_t* src = file.data() + offsets[chunk];
+		size_t srcBytes = (size_t)(offsets[chunk + 1] - offsets[chunk]);
+		size_t dstBytes = chunkBytes(entry, chunk);
+
+		if (stored & RawChunk)
+		{
+			if (srcBytes != dstBytes)
+			{
+				return false;
+			}
+			memcpy(dst, src, dstBytes);
+			return true;
+		}
+		return Lz4::decompress(src, srcBytes, dst, dstBytes);
+	}
+
+	bool stream(const AssetEntry& entry, const ChunkCallback& onChunk) const
+	{
+		if (!(entry.flags & AssetEntry::Compressed))
+		{
+			size_t chunkSize = header().chunkSize;
+			for (size_t offset = 0; offset < entry.size; offset += chunkSize)
+			{
+				size_t size = std::min<size_t>(chunkSize, (size_t)entry.size - offset);
+				file.prefetch((size_t)entry.offset + offset, size);
+				onChunk(file.data() + entry.offset + offset, offset, size);
+			}
+			return true;
+		}
+
+		vector<uint64_t> offsets;
+		if (!chunkOffsets(entry, offsets))
+		{
+			return false;
+		}
+
+		vector<uint8_t> buffer(header().chunkSize);
+		for (size_t i = 0; i < entry.chunkCount; i++)
+		{
+			file.prefetch((size_t)offsets[i], (size_t)(offsets[i + 1] - offsets[i]));
+			if (!decodeChunk(entry, offsets, i, buffer.data()))
+			{
+				return false;
+			}
+			onChunk(buffer.data(), i * header().chunkSize, chunkBytes(entry, i));
+		}
+		return true;
+	}
+
+	static const uint32_t RawChunk = 0x80000000u;
+
+	static bool compressEntry(const vector<uint8_t>& data, uint32_t chunkSize, vector<uint8_t>& stored)
+	{
+		size_t chunks = (data.size() + chunkSize - 1) / chunkSize;
+		if (chunks == 0)
+		{
+			return false;
+		}
+
+		vector<vector<uint8_t>> compressed(chunks);
+		vector<char> raw(chunks, 0);
+		ThreadPool::shared().parallelFor(chunks, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				size_t size = std::min<size_t>(chunkSize, data.size() - i * chunkSize);
+				compressed[i].resize(Lz4::bound(size));
+				compressed[i].resize(Lz4::compress(data.data() + i * chunkSize, size, compressed[i].data()));
+				if (compressed[i].size() >= size)
+				{
+					compressed[i].assign(data.begin() + i * chunkSize, data.begin() + i * chunkSize + size);
+					raw[i] = 1;
+				}
+			}
+		});
+
+		stored.assign(chunks * 4, 0);
+		for (size_t i = 0; i < chunks; i++)
+		{
+			uint32_t word = (uint32_t)compressed[i].size();
+			if (raw[i])
+			{
+				word |= RawChunk;
+			}
+			memcpy(&stored[i * 4], &word, 4);
+			stored.insert(stored.end(), compressed[i].begin(), compressed[i].end());
+		}
+		return true;
+	}
+
+	static uint64_t align(uint64_t offset)
+	{
+		return (offset + 63) & ~(uint64_t)63;
+	}
+
+	static void pad(ofstream& out, uint64_t& position, uint64_t target)
+	{
+		static const char zeros[64] = {};
+		out.write(zeros, (streamsize)(target - position));
+		position = target;
+	}
+
+	static char fold(char c)
+	{
+		return c == '\\' ? '/' : (char)tolower((unsigned char)c);
+	}
+
+	// Pominięcie początkowych "./" - ta sama nazwa co po normalize()
+	static size_t nameStart(const string& name)
+	{
+		size_t start = 0;
+		while (start + 1 < name.size() && name[start] == '.' && (name[start + 1] == '/' || name[start + 1] == '\\'))
+		{
+			start += 2;
+		}
+		return start;
+	}
+
+	static bool sameName(const char* stored, size_t length, const string& name)
+	{
+		size_t start = nameStart(name);
+		if (name.size() - start != length)
+		{
+			return false;
+		}
+		for (size_t i = 0; i < length; i++)
+		{
+			if (fold(stored[i]) != fold(name[start + i]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+vector<unique_ptr<AssetArchive>> AssetArchive::mounted;
+mutex AssetArchive::mountMutex;
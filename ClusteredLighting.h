@@ -0,0 +1,530 @@
+﻿#pragma once
+#include "includy.h"
+#include "LightManager.h"
+#include "ThreadPool.h"
+#include "GLExt.h"
+#include "Shader.h"
+#include <cstring>
+
+#ifndef GL_RGBA32F_ARB
+#define GL_RGBA32F_ARB 0x8814
+#endif
+#ifndef GL_LUMINANCE32F_ARB
+#define GL_LUMINANCE32F_ARB 0x8818
+#endif
+#ifndef GL_LUMINANCE_ALPHA32F_ARB
+#define GL_LUMINANCE_ALPHA32F_ARB 0x8819
+#endif
+
+/**
+* @struct ClusterStats
+* @brief Statystyki ostatniego budowania siatki klastrów
+*/
+struct ClusterStats
+{
+	size_t lights = 0;          // widoczne światła w danych
+	size_t globalLights = 0;    // kierunkowe - wspólne dla wszystkich pikseli
+	size_t indices = 0;         // długość listy indeksów (bez globalnych)
+	size_t maxPerCluster = 0;
+	size_t occupiedClusters = 0;
+	float buildMs = 0.0f;
+	size_t uploadBytes = 0;
+};
+
+/**
+* @class ClusteredLighting
+* @brief Oświetlenie klastrowe dla renderowania shaderami. Ostrosłup widzenia dzielony jest na kafelki
+* ekranu i wykładnicze przedziały głębokości; widoczne światła z LightManager przypisywane są do klastrów
+* na wątkach roboczych (test sfera - prostopadłościan dla 4 świateł naraz), a zwarte listy indeksów
+* wysyłane raz na klatkę do tekstur float. Shader liczy klaster piksela z gl_FragCoord i głębokości
+* w przestrzeni widoku i przechodzi tylko po jego światłach (permutacja ShaderCache::Clustered):
+*   slice = int(log(-z) * sliceScale() + sliceBias()), cluster = (slice * TilesY + y) * TilesX + x
+* Lista indeksów zaczyna się od globalCount() świateł kierunkowych, wspólnych dla wszystkich pikseli
+*/
+class ClusteredLighting
+{
+public:
+	static const int TilesX = 16;
+	static const int TilesY = 9;
+	static const int Slices = 24;
+	static const int ClusterCount = TilesX * TilesY * Slices;
+	static const int TextureWidth = 1024;  // wiersze tekstur danych
+
+	enum Buffer
+	{
+		LightData,      // RGBA32F, 4 teksele na światło (LightManager::packUniforms)
+		ClusterRanges,  // LUMINANCE_ALPHA32F, (początek, liczba) na klaster
+		LightIndices,   // LUMINANCE32F, indeksy świateł w LightData
+		BufferCount
+	};
+
+	static bool enabled;
+
+	// Przypisanie widocznych świateł (po LightManager::beginFrame) do klastrów
+	static void build(const glm::mat4& view, const glm::mat4& projection)
+	{
+		PROFILE_ZONE("ClusteredLighting::build");
+		auto start = chrono::steady_clock::now();
+		frame = ClusterStats();
+		viewMatrix = view;
+		if (memcmp(&projection, &clusterProjection, sizeof(glm::mat4)) != 0)
+		{
+			buildClusterBounds(projection);
+		}
+
+		const vector<uint32_t>& visible = LightManager::visibleLights();
+		LightManager::packUniforms(visible.data(), visible.size(), lights);
+		frame.lights = visible.size();
+
+		// położenie i zasięg w przestrzeni widoku, kierunkowe osobno
+		indices.clear();
+		lightX.clear(); lightY.clear(); lightZ.clear(); lightRadiusSquared.clear(); lightIndex.clear();
+		for (uint32_t i = 0; i < (uint32_t)visible.size(); i++)
+		{
+			const glm::vec4& position = lights[i * 4];
+			if (lights[i * 4 + 1].w == (float)LightType::Directional)
+			{
+				indices.push_back(i);
+				continue;
+			}
+			glm::vec4 viewPosition = view * glm::vec4(glm::vec3(position), 1.0f);
+			lightX.push_back(viewPosition.x);
+			lightY.push_back(viewPosition.y);
+			lightZ.push_back(viewPosition.z);
+			lightRadiusSquared.push_back(position.w * position.w);
+			lightIndex.push_back(i);
+		}
+		frame.globalLights = indices.size();
+
+		// dopełnienie do 4 - promień^2 = -1 nigdy nie przechodzi testu
+		size_t padded = (lightX.size() + 3) & ~(size_t)3;
+		lightX.resize(padded, 0.0f); lightY.resize(padded, 0.0f); lightZ.resize(padded, 0.0f);
+		lightRadiusSquared.resize(padded, -1.0f);
+
+		ThreadPool::shared().parallelFor(Slices, [](size_t begin, size_t end)
+		{
+			PROFILE_ZONE("ClusteredLighting::assignSlices");
+			for (size_t slice = begin; slice < end; slice++)
+			{
+				assignSlice((int)slice);
+			}
+		});
+
+		// sklejenie list przedziałów - zakresy klastrów w jednej tablicy
+		ranges.resize(ClusterCount * 2);
+		for (int slice = 0; slice < Slices; slice++)
+		{
+			const SliceLists& lists = slices[slice];
+			uint32_t base = (uint32_t)indices.size();
+			for (int tile = 0; tile < TilesX * TilesY; tile++)
+			{
+				int cluster = slice * TilesX * TilesY + tile;
+				uint32_t count = lists.counts[tile];
+				ranges[cluster * 2] = base + lists.offsets[tile];
+				ranges[cluster * 2 + 1] = count;
+				frame.maxPerCluster = std::max<size_t>(frame.maxPerCluster, count);
+				frame.occupiedClusters += count > 0;
+			}
+			indices.insert(indices.end(), lists.indices.begin(), lists.indices.end());
+		}
+		frame.indices = indices.size() - frame.globalLights;
+		frame.buildMs = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+	}
+
+	// Wysłanie danych do tekstur (wymaga GL_ARB_texture_float), false - dane zostają tylko po stronie CPU.
+	// Tekstury zostają dowiązane w jednostkach ShaderCache::ClusterTextureUnit + Buffer i czyta je
+	// permutacja ShaderCache::Clustered (kafelki względem bieżącego viewportu)
+	static bool upload()
+	{
+		PROFILE_ZONE("ClusteredLighting::upload");
+		if (!supported())
+		{
+			return false;
+		}
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		ShaderCache::addFrameUniforms(&setUniforms);
+
+		staging.clear();
+		for (const glm::vec4& value : lights)
+		{
+			staging.insert(staging.end(), { value.x, value.y, value.z, value.w });
+		}
+		uploadBuffer(LightData, GL_RGBA32F_ARB, GL_RGBA, 4);
+
+		staging.assign(ranges.begin(), ranges.end());
+		uploadBuffer(ClusterRanges, GL_LUMINANCE_ALPHA32F_ARB, GL_LUMINANCE_ALPHA, 2);
+
+		staging.assign(indices.begin(), indices.end());
+		uploadBuffer(LightIndices, GL_LUMINANCE32F_ARB, GL_LUMINANCE, 1);
+		GLExt::ActiveTexture(GL_TEXTURE0);
+		return true;
+	}
+
+	static bool supported()
+	{
+		if (supportChecked == 0)
+		{
+			GLExt::load();
+			supportChecked = GLExt::hasExtension("GL_ARB_texture_float") && GLExt::ActiveTexture ? 1 : -1;
+		}
+		return supportChecked > 0;
+	}
+
+	static GLuint texture(Buffer buffer)
+	{
+		return textures[buffer].name;
+	}
+
+	// Rozmiar tekstury w tekselach (szerokość TextureWidth)
+	static int textureHeight(Buffer buffer)
+	{
+		return textures[buffer].height;
+	}
+
+	static const vector<glm::vec4>& lightData()
+	{
+		return lights;
+	}
+
+	static const vector<uint32_t>& clusterRanges()
+	{
+		return ranges;
+	}
+
+	static const vector<uint32_t>& lightIndices()
+	{
+		return indices;
+	}
+
+	static uint32_t globalCount()
+	{
+		return (uint32_t)frame.globalLights;
+	}
+
+	static float sliceScale()
+	{
+		return Slices / log(farPlane / nearPlane);
+	}
+
+	static float sliceBias()
+	{
+		return -log(nearPlane) * sliceScale();
+	}
+
+	// Klaster punktu w przestrzeni widoku (-1 poza ostrosłupem)
+	static int clusterOf(const glm::vec3& viewPosition)
+	{
+		float depth = -viewPosition.z;
+		if (depth < nearPlane || depth > farPlane)
+		{
+			return -1;
+		}
+		glm::vec4 clip = clusterProjection * glm::vec4(viewPosition, 1.0f);
+		int x = (int)floor((clip.x / clip.w * 0.5f + 0.5f) * TilesX);
+		int y = (int)floor((clip.y / clip.w * 0.5f + 0.5f) * TilesY);
+		int slice = (int)floor(log(depth) * sliceScale() + sliceBias());
+		if (x < 0 || x >= TilesX || y < 0 || y >= TilesY)
+		{
+			return -1;
+		}
+		slice = std::min(std::max(slice, 0), Slices - 1);
+		return (slice * TilesY + y) * TilesX + x;
+	}
+
+	static ClusterStats stats()
+	{
+		return frame;
+	}
+
+	static void release()
+	{
+		for (GpuTexture& gpu : textures)
+		{
+			if (gpu.name)
+			{
+				glDeleteTextures(1, &gpu.name);
+			}
+			gpu = GpuTexture();
+		}
+	}
+
+private:
+	// Wynik jednego przedziału głębokości - wątki nie współdzielą danych
+	struct SliceLists
+	{
+		vector<uint32_t> offsets = vector<uint32_t>(TilesX * TilesY);
+		vector<uint32_t> counts = vector<uint32_t>(TilesX * TilesY);
+		vector<uint32_t> indices;
+		vector<float> x, y, z, radiusSquared; // kandydaci przedziału / wiersza, dopełnieni do 4
+		vector<uint32_t> light;
+		vector<float> rowX, rowY, rowZ, rowRadiusSquared;
+		vector<uint32_t> rowLight;
+	};
+
+	struct GpuTexture
+	{
+		GLuint name = 0;
+		int height = 0;
+	};
+
+	static vector<glm::vec4> lights;
+	static vector<uint32_t> ranges;
+	static vector<uint32_t> indices;
+	static vector<float> lightX, lightY, lightZ, lightRadiusSquared; // przestrzeń widoku, dopełnione do 4
+	static vector<uint32_t> lightIndex;
+	static SliceLists slices[Slices];
+
+	// granice klastrów w przestrzeni widoku, zależne tylko od projekcji
+	static glm::mat4 clusterProjection;
+	static float nearPlane, farPlane;
+	static vector<glm::vec3> clusterMin, clusterMax;
+
+	static ClusterStats frame;
+	static glm::mat4 viewMatrix;
+	static GLint viewport[4];
+	static GpuTexture textures[BufferCount];
+	static vector<float> staging;
+	static int supportChecked;
+
+	static void buildClusterBounds(const glm::mat4& projection)
+	{
+		clusterProjection = projection;
+		// near/far z macierzy perspektywy (gluPerspective / glm::perspective)
+		nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+		farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+
+		// kierunki krawędzi kafelków na głębokości 1
+		glm::mat4 inverse = glm::inverse(projection);
+		vector<glm::vec3> corners((TilesX + 1) * (TilesY + 1));
+		for (int y = 0; y <= TilesY; y++)
+		{
+			for (int x = 0; x <= TilesX; x++)
+			{
+				glm::vec4 point = inverse * glm::vec4(-1.0f + 2.0f * x / TilesX, -1.0f + 2.0f * y / TilesY, -1.0f, 1.0f);
+				glm::vec3 view = glm::vec3(point) / point.w;
+				corners[y * (TilesX + 1) + x] = view / -view.z;
+			}
+		}
+
+		clusterMin.resize(ClusterCount);
+		clusterMax.resize(ClusterCount);
+		for (int slice = 0; slice < Slices; slice++)
+		{
+			float depths[2] = { sliceDepth(slice), sliceDepth(slice + 1) };
+			for (int y = 0; y < TilesY; y++)
+			{
+				for (int x = 0; x < TilesX; x++)
+				{
+					int cluster = (slice * TilesY + y) * TilesX + x;
+					glm::vec3 low(1e30f), high(-1e30f);
+					for (int corner = 0; corner < 4; corner++)
+					{
+						const glm::vec3& direction = corners[(y + corner / 2) * (TilesX + 1) + x + corner % 2];
+						for (float depth : depths)
+						{
+							glm::vec3 point = direction * depth;
+							low = glm::vec3(std::min(low.x, point.x), std::min(low.y, point.y), std::min(low.z, point.z));
+							high = glm::vec3(std::max(high.x, point.x), std::max(high.y, point.y), std::max(high.z, point.z));
+						}
+					}
+					clusterMin[cluster] = low;
+					clusterMax[cluster] = high;
+				}
+			}
+		}
+	}
+
+	// Granica przedziału: near * (far / near)^(slice / Slices)
+	static float sliceDepth(int slice)
+	{
+		return nearPlane * pow(farPlane / nearPlane, (float)slice / Slices);
+	}
+
+	// Odległość sfery od prostopadłościanu, wynik w masce bitowej (bit k - światło k z czwórki)
+	static int testFour(const float* x, const float* y, const float* z, const float* radiusSquared, const glm::vec3& low, const glm::vec3& high)
+	{
+#ifdef LIGHTS_SSE2
+		__m128 zero = _mm_setzero_ps();
+		__m128 px = _mm_loadu_ps(x), py = _mm_loadu_ps(y), pz = _mm_loadu_ps(z);
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(low.x), px), _mm_sub_ps(px, _mm_set1_ps(high.x))), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(low.y), py), _mm_sub_ps(py, _mm_set1_ps(high.y))), zero);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(low.z), pz), _mm_sub_ps(pz, _mm_set1_ps(high.z))), zero);
+		__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		return _mm_movemask_ps(_mm_cmple_ps(distance, _mm_loadu_ps(radiusSquared)));
+#else
+		int mask = 0;
+		for (int k = 0; k < 4; k++)
+		{
+			float dx = std::max(std::max(low.x - x[k], x[k] - high.x), 0.0f);
+			float dy = std::max(std::max(low.y - y[k], y[k] - high.y), 0.0f);
+			float dz = std::max(std::max(low.z - z[k], z[k] - high.z), 0.0f);
+			mask |= (dx * dx + dy * dy + dz * dz <= radiusSquared[k]) << k;
+		}
+		return mask;
+#endif
+	}
+
+	// Odfiltrowanie świateł do prostopadłościanu (przedział, wiersz), wynik dopełniony do wielokrotności 4
+	static void filter(const float* x, const float* y, const float* z, const float* radiusSquared, const uint32_t* light, size_t count,
+		const glm::vec3& low, const glm::vec3& high,
+		vector<float>& outX, vector<float>& outY, vector<float>& outZ, vector<float>& outRadiusSquared, vector<uint32_t>& outLight)
+	{
+		outX.clear(); outY.clear(); outZ.clear(); outRadiusSquared.clear(); outLight.clear();
+		for (size_t i = 0; i < count; i += 4)
+		{
+			int mask = testFour(x + i, y + i, z + i, radiusSquared + i, low, high);
+			for (int k = 0; k < 4; k++)
+			{
+				if ((mask >> k) & 1)
+				{
+					outX.push_back(x[i + k]); outY.push_back(y[i + k]); outZ.push_back(z[i + k]);
+					outRadiusSquared.push_back(radiusSquared[i + k]);
+					outLight.push_back(light[i + k]);
+				}
+			}
+		}
+		size_t padded = (outLight.size() + 3) & ~(size_t)3;
+		outX.resize(padded, 0.0f); outY.resize(padded, 0.0f); outZ.resize(padded, 0.0f);
+		outRadiusSquared.resize(padded, -1.0f);
+	}
+
+	static void assignSlice(int slice)
+	{
+		SliceLists& lists = slices[slice];
+		lists.indices.clear();
+		int tiles = TilesX * TilesY;
+		int first = slice * tiles;
+
+		// wszystkie światła -> przedział głębokości -> wiersz kafelków -> klaster
+		glm::vec3 low(1e30f), high(-1e30f);
+		for (int tile = 0; tile < tiles; tile++)
+		{
+			low = glm::vec3(std::min(low.x, clusterMin[first + tile].x), std::min(low.y, clusterMin[first + tile].y), std::min(low.z, clusterMin[first + tile].z));
+			high = glm::vec3(std::max(high.x, clusterMax[first + tile].x), std::max(high.y, clusterMax[first + tile].y), std::max(high.z, clusterMax[first + tile].z));
+		}
+		filter(lightX.data(), lightY.data(), lightZ.data(), lightRadiusSquared.data(), lightIndex.data(), lightX.size(), low, high,
+			lists.x, lists.y, lists.z, lists.radiusSquared, lists.light);
+
+		for (int row = 0; row < TilesY; row++)
+		{
+			int rowFirst = first + row * TilesX;
+			glm::vec3 rowLow = clusterMin[rowFirst], rowHigh = clusterMax[rowFirst];
+			for (int tile = 1; tile < TilesX; tile++)
+			{
+				const glm::vec3& a = clusterMin[rowFirst + tile];
+				const glm::vec3& b = clusterMax[rowFirst + tile];
+				rowLow = glm::vec3(std::min(rowLow.x, a.x), std::min(rowLow.y, a.y), std::min(rowLow.z, a.z));
+				rowHigh = glm::vec3(std::max(rowHigh.x, b.x), std::max(rowHigh.y, b.y), std::max(rowHigh.z, b.z));
+			}
+			filter(lists.x.data(), lists.y.data(), lists.z.data(), lists.radiusSquared.data(), lists.light.data(), lists.x.size(), rowLow, rowHigh,
+				lists.rowX, lists.rowY, lists.rowZ, lists.rowRadiusSquared, lists.rowLight);
+
+			for (int tile = 0; tile < TilesX; tile++)
+			{
+				int local = row * TilesX + tile;
+				lists.offsets[local] = (uint32_t)lists.indices.size();
+				for (size_t i = 0; i < lists.rowX.size(); i += 4)
+				{
+					int mask = testFour(&lists.rowX[i], &lists.rowY[i], &lists.rowZ[i], &lists.rowRadiusSquared[i],
+						clusterMin[rowFirst + tile], clusterMax[rowFirst + tile]);
+					for (int k = 0; k < 4; k++)
+					{
+						if ((mask >> k) & 1)
+						{
+							lists.indices.push_back(lists.rowLight[i + k]);
+						}
+					}
+				}
+				lists.counts[local] = (uint32_t)lists.indices.size() - lists.offsets[local];
+			}
+		}
+	}
+
+	// Uniformy permutacji Clustered (raz na klatkę dla programu)
+	static void setUniforms(ShaderProgram& program)
+	{
+		if (!(program.features & ShaderCache::Clustered))
+		{
+			return;
+		}
+		glm::vec4 grid((float)TilesX, (float)TilesY, (float)Slices, (float)frame.globalLights);
+		glm::vec4 depth(sliceScale(), sliceBias(), (float)TilesX / std::max(viewport[2], 1), (float)TilesY / std::max(viewport[3], 1));
+		glm::vec4 texels(1.0f / std::max(textures[LightData].height, 1), 1.0f / std::max(textures[ClusterRanges].height, 1),
+			1.0f / std::max(textures[LightIndices].height, 1), 1.0f / TextureWidth);
+		program.setMatrices("clusterView", &viewMatrix, 1);
+		program.setVectors("clusterGrid", &grid, 1);
+		program.setVectors("clusterDepth", &depth, 1);
+		program.setVectors("clusterTexels", &texels, 1);
+
+		if (program.features & ShaderCache::ShadowMaps)
+		{
+			// indeksy świateł z cieniem w danych klatki (kolejność LightManager::visibleLights)
+			int shadowed[1 + ShaderCache::MaxPointShadows];
+			const vector<uint32_t>& visible = LightManager::visibleLights();
+			for (int n = 0; n <= ShaderCache::MaxPointShadows; n++)
+			{
+				shadowed[n] = -1;
+				LightId light = ShaderCache::shadowLight(n);
+				for (size_t i = 0; light != LightManager::InvalidLight && i < visible.size(); i++)
+				{
+					if (LightManager::idOf(visible[i]) == light)
+					{
+						shadowed[n] = (int)i;
+						break;
+					}
+				}
+			}
+			program.setInts("clusterShadowLights", shadowed, 1 + ShaderCache::MaxPointShadows);
+		}
+	}
+
+	// Tekstura TextureWidth x 2^n, rozszerzana tylko gdy dane przestaną się mieścić. Poza jednostką 0 -
+	// dowiązanie materiałów w TextureHandler zostaje aktualne (jak mapy w Shadows)
+	static void uploadBuffer(Buffer buffer, GLenum internalFormat, GLenum format, int channels)
+	{
+		size_t texels = staging.size() / channels;
+		int rows = std::max(1, (int)((texels + TextureWidth - 1) / TextureWidth));
+		staging.resize((size_t)rows * TextureWidth * channels, 0.0f);
+
+		GpuTexture& gpu = textures[buffer];
+		if (!gpu.name)
+		{
+			glGenTextures(1, &gpu.name);
+		}
+		GLExt::ActiveTexture(GL_TEXTURE0 + ShaderCache::ClusterTextureUnit + buffer);
+		glBindTexture(GL_TEXTURE_2D, gpu.name);
+		if (gpu.height < rows)
+		{
+			int height = 1;
+			while (height < rows)
+			{
+				height *= 2;
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, TextureWidth, height, 0, format, GL_FLOAT, nullptr);
+			gpu.height = height;
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, TextureWidth, rows, format, GL_FLOAT, staging.data());
+		frame.uploadBytes += staging.size() * sizeof(float);
+	}
+};
+
+bool ClusteredLighting::enabled = false;
+vector<glm::vec4> ClusteredLighting::lights;
+vector<uint32_t> ClusteredLighting::ranges;
+vector<uint32_t> ClusteredLighting::indices;
+vector<float> ClusteredLighting::lightX, ClusteredLighting::lightY, ClusteredLighting::lightZ, ClusteredLighting::lightRadiusSquared;
+vector<uint32_t> ClusteredLighting::lightIndex;
+ClusteredLighting::SliceLists ClusteredLighting::slices[ClusteredLighting::Slices];
+glm::mat4 ClusteredLighting::clusterProjection = glm::mat4(0.0f);
+float ClusteredLighting::nearPlane = 0.1f;
+float ClusteredLighting::farPlane = 100.0f;
+vector<glm::vec3> ClusteredLighting::clusterMin, ClusteredLighting::clusterMax;
+ClusterStats ClusteredLighting::frame;
+glm::mat4 ClusteredLighting::viewMatrix = glm::mat4(1.0f);
+GLint ClusteredLighting::viewport[4] = {};
+ClusteredLighting::GpuTexture ClusteredLighting::textures[ClusteredLighting::BufferCount];
+vector<float> ClusteredLighting::staging;
+int ClusteredLighting::supportChecked = 0;
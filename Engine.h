@@ -5,6 +5,20 @@
 #include "Observer.h"
 #include "light.h"
 #include "prim.h"
+#include "MeshGenerator.h"
+#include "LOD.h"
+#include "TextureCache.h"
+#include "WorldStreaming.h"
+#include "HotReload.h"
+#include "ClusteredLighting.h"
+#include "RenderQueue.h"
+#include "Shader.h"
+#include "UniformRing.h"
+#include "Shadows.h"
+#include "TextRenderer.h"
+#include "PerfHud.h"
+#include "Profiler.h"
+#include "GpuTimer.h"
 
 /**
 * @class Engine
@@ -27,9 +41,15 @@ public:
 	//oświetlenie globalne- jako wskaźnik
 	static Light* light;
 
+	//projekcja ustawiana w reshape (potrzebna m.in. do wyboru LOD)
+	static glm::mat4 projection;
+	static int viewportWidth;
+	static int viewportHeight;
+
 	//funkcja inicjalizująca elementy niesbędne do uruchomienia programu
 	static void initialize(int argc, char** argv)
 	{
+		PROFILE_THREAD("Main");
 		glutInit(&argc, argv);
 		glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
 		glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -55,6 +75,24 @@ public:
 
 		//inicjalizacja światła przez konstrunktor
 		light = new Light(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.2f, 0.2f, 0.2f), glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f));
+		sceneLight = LightManager::add(light->toDesc(50.0f));
+
+		//materiały obiektów sceny: MatE - kolor wierzchołków z odbiciem, bez MatE - domyślny materiał GL
+		MaterialDesc lit;
+		lit.specular = glm::vec3(1.0f);
+		lit.shininess = 32.0f;
+		lit.vertexColor = true;
+		sceneMaterial = MaterialRegistry::get(lit);
+		defaultMaterial = MaterialRegistry::get(MaterialDesc());
+
+		//programy z pamięci podręcznej (lub kompilacja) od razu, a nie przy pierwszej klatce
+		if (ShaderCache::enabled)
+		{
+			ShaderCache::warmUp();
+		}
+
+		//poziomy szczegółowości czajnika (siatki liczone raz)
+		teapotLevels = MeshGenerator::teapotLod(0.5f);
 	}
 
 	//uruchomienie pęli głównej
@@ -66,13 +104,50 @@ public:
 	//dynamiczne alokowanie światła
 	static void cleanup()
 	{
+		LightManager::remove(sceneLight);
+		ClusteredLighting::release();
+		sceneMaterial = MaterialRef();
+		defaultMaterial = MaterialRef();
+		Shadows::release();
+		TextRenderer::release();
+		GpuTimer::release();
+		ShaderCache::release();
+		UniformRing::release();
 		delete light;
 	}
 
 private:
+	//światło globalne w LightManager
+	static LightId sceneLight;
+
+	//materiały obiektów wbudowanych (przełączane F2)
+	static MaterialRef sceneMaterial;
+	static MaterialRef defaultMaterial;
+
+	//LOD czajnika i stan wyboru poziomu
+	static LODMesh teapotLevels;
+	static LODState teapotLOD;
+
 	//funkcja odpowiadajaca za rendoerowanie sceny
 	static void renderScene()
 	{
+		PROFILE_ZONE("Engine::renderScene");
+		//czas CPU klatki mierzony w fazach (nakładka F9), czas GPU przebiegów dla nakładki i profilera
+		PerfCounters::beginFrame();
+		GpuTimer::enabled = PerfHud::enabled || Profiler::capturing();
+		GpuTimer::beginFrame();
+
+		// podmiana zmienionych na dysku zasobów, wysłanie do GL porcji wczytanych w tle tekstur, potem budżet
+		// pamięci podręcznej tekstur - zdekodowane i wysłane dane zwiększają jej rozmiar bez get() i zwolnień;
+		// listy wyświetlania siatek zwolnione poza wątkiem renderowania usuwane są tutaj
+		HotReload::update();
+		TextureHandler::update();
+		TextureCache::trim();
+		Mesh::deleteReleased();
+
+		//atlas czcionki rysowany raz, w buforze ramki przed jego wyczyszczeniem
+		TextRenderer::load();
+
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		glLoadIdentity();
 
@@ -80,33 +155,78 @@ private:
 		glm::mat4 view = observer.getViewMatrix();
 		glMultMatrixf(glm::value_ptr(view));
 
-		//on/off światło
+		//świat wczytywany komórkami wokół kamery - przed LightManager::beginFrame, bo zwolnienie komórki usuwa
+		//jej światła i przesuwa indeksy, na których opierają się listy widocznych świateł klatki
+		if (WorldStreamer::isOpen())
+		{
+			PerfCounters::phase(PerfCounters::Update);
+			WorldStreamer::update(cameraPos, cameraFront);
+		}
+
+		//on/off światło - LightManager odrzuca światła poza widokiem i przydziela obiektom sloty GL_LIGHTn
+		PerfCounters::phase(PerfCounters::Lighting);
+		bool clustered = false;
 		if (LightE)
 		{
 			glEnable(GL_LIGHTING); // Enable lighting
-			glEnable(GL_LIGHT0);   // Enable light source 0
-			light->setupLight(GL_LIGHT0); // Set up light properties
+			LightManager::beginFrame(view, projection);
+			if (ClusteredLighting::enabled && ShaderCache::active())
+			{
+				// listy świateł klastrów czyta tylko ścieżka z shaderami - stały potok zostaje przy slotach GL_LIGHTn
+				ClusteredLighting::build(view, projection);
+				clustered = ClusteredLighting::upload();
+			}
 		}
 		else
 		{
 			glDisable(GL_LIGHTING); // Disable lighting
-			glDisable(GL_LIGHT0);   // Disable light source 0
 		}
 
-		//wyświetlanie materiału
-		if (MatE)
+		//materiały ustawiane tylko przy zmianie, rysowania pogrupowane wg materiału
+		PerfCounters::phase(PerfCounters::Scene);
+		MaterialRegistry::beginFrame();
+
+		//ścieżka z shaderami (F8): oświetlenie na piksel z tych samych świateł i materiałów, cienie (F11)
+		bool shadows = LightE && Shadows::active();
+		uint32_t features = 0;
+		if (LightE)
 		{
-			//ustawienie materiału dla obiektów
-			glEnable(GL_COLOR_MATERIAL);
-			glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
-			setMaterial(glm::vec3(0.2f, 0.2f, 0.2f), glm::vec3(0.8f, 0.8f, 0.8f), glm::vec3(1.0f, 1.0f, 1.0f), 32.0f);
+			features = ShaderCache::Lighting | ShaderCache::Material | (shadows ? (uint32_t)ShaderCache::ShadowMaps : 0u) |
+				(clustered ? (uint32_t)ShaderCache::Clustered : 0u);
 		}
-		else
+		ShaderCache::setFrameFeatures(features);
+		if (ShaderCache::active())
 		{
-			// Reset material properties to default
-			resetMaterial();
+			UniformRing::beginFrame();
 		}
 
+		//mapy cieni przed rysowaniem sceny - obiekty świata z WorldStreamer, obracane obiekty jako dynamiczne
+		if (shadows)
+		{
+			PerfCounters::phase(PerfCounters::ShadowMaps);
+			GpuTimer::Scope pass("Shadows");
+			addDynamicCasters();
+			Shadows::render(view, projection);
+		}
+
+		//do kolejki tylko obiekty świata w ostrosłupie kamery
+		PerfCounters::phase(PerfCounters::Scene);
+		GpuTimer::begin("Scene");
+		if (WorldStreamer::isOpen())
+		{
+			WorldStreamer::submit(cameraPos, Frustum::fromMatrix(projection * view));
+		}
+		glColor3f(1.0f, 1.0f, 1.0f);
+		RenderQueue::flush();
+
+		//wyświetlanie materiału
+		const MaterialRef& shown = MatE ? sceneMaterial : defaultMaterial;
+		MaterialRegistry::bind(shown);
+		ShaderCache::use(ShaderCache::getFrameFeatures() | RenderQueue::materialFeatures(shown.get()));
+
+		//obiekty wokół początku układu
+		ShaderCache::bindLights(glm::vec3(0.0f), 1.8f);
+
 		//wyświetlanie prymitywów
 		if (PrimE)
 		{
@@ -152,43 +272,83 @@ private:
 			glTranslatef(0.0f, -0.5f, -3.0f);
 			glMultMatrixf(glm::value_ptr(cubeRotation));
 			glColor3f(1.0f, 0.5f, 0.0f);
-			glutSolidTeapot(0.5);
+			ShaderCache::bindLights(glm::vec3(0.0f, -0.5f, -3.0f), 1.0f);
+			int level = LODSelector::select(teapotLevels, glm::vec3(0.0f, -0.5f, -3.0f), cameraPos, 1.0f, teapotLOD);
+			teapotLevels.draw(level); // siatki liczone raz i trzymane w listach wyświetlania
 			glPopMatrix();
 		}
 
+		if (LightE)
+		{
+			LightManager::endFrame();
+		}
+		ShaderCache::stop();
+		UniformRing::endFrame();
+
+		GpuTimer::end();
+
+		PerfCounters::phase(PerfCounters::Overlay);
+		GpuTimer::begin("Overlay");
 		renderText();
+		GpuTimer::end();
+		GpuTimer::endFrame();
 
+		PerfCounters::phase(PerfCounters::Present);
 		glutSwapBuffers();
+		PerfCounters::endFrame();
 	}
 
-	// ustawienie materiałów na domyślne
-	static void resetMaterial() 
+	//obiekty wokół początku układu rzucające cień (ta sama macierz i sfera co przy rysowaniu)
+	static void addDynamicCasters()
 	{
-		glDisable(GL_COLOR_MATERIAL);
-		glMaterialfv(GL_FRONT, GL_AMBIENT, glm::value_ptr(glm::vec3(0.2f, 0.2f, 0.2f)));
-		glMaterialfv(GL_FRONT, GL_DIFFUSE, glm::value_ptr(glm::vec3(0.8f, 0.8f, 0.8f)));
-		glMaterialfv(GL_FRONT, GL_SPECULAR, glm::value_ptr(glm::vec3(0.0f, 0.0f, 0.0f)));
-		glMaterialf(GL_FRONT, GL_SHININESS, 0.0f);
+		DrawItem item;
+		item.transform = cubeRotation;
+		item.radius = 1.8f;
+		if (CubE)
+		{
+			item.draw = &drawCube;
+			Shadows::addDynamicCaster(item);
+		}
+		if (PyramidE)
+		{
+			item.draw = &drawPyramid;
+			Shadows::addDynamicCaster(item);
+		}
+		if (TeapotE)
+		{
+			item.transform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.5f, -3.0f)) * cubeRotation;
+			item.center = glm::vec3(0.0f, -0.5f, -3.0f);
+			item.radius = 1.0f;
+			item.draw = &drawTeapot;
+			item.object = &teapotLevels;
+			item.level = (size_t)LODSelector::select(teapotLevels, item.center, cameraPos, 1.0f, teapotLOD);
+			Shadows::addDynamicCaster(item);
+		}
 	}
 
-	//renderowanie tekstu informującego w lewym górnym rogu
-	static void renderText()
+	static void drawCube(const void*, size_t)
 	{
-		//projekcja tkstu jako 2D
-		glMatrixMode(GL_PROJECTION);
-		glPushMatrix();
-		glLoadIdentity();
-		gluOrtho2D(0, WINDOW_WIDTH, 0, WINDOW_HEIGHT);
-		glMatrixMode(GL_MODELVIEW);
-		glPushMatrix();
-		glLoadIdentity();
+		CUBE cube;
+		cube.draw();
+	}
 
-		glDisable(GL_DEPTH_TEST);
+	static void drawPyramid(const void*, size_t)
+	{
+		PYRAMID pyramid;
+		pyramid.draw();
+	}
 
-		glColor3f(1.0f, 1.0f, 1.0f);
+	static void drawTeapot(const void* object, size_t level)
+	{
+		((const LODMesh*)object)->draw((int)level);
+	}
 
+	//renderowanie tekstu informującego w lewym górnym rogu - wszystkie napisy jednym wywołaniem z atlasu glifów
+	static void renderText()
+	{
+		PROFILE_ZONE("Engine::renderText");
 		int x = 10;
-		int y = WINDOW_HEIGHT - 20;
+		int y = viewportHeight - 20;
 
 		//Teksty
 		string lightStatus = "LightE: " + string(LightE ? "ON" : "OFF");
@@ -198,6 +358,9 @@ private:
 		string solidEStatus = "SolidE: " + string(SolidE ? "ON" : "OFF");
 		string teapotStatus = "TeapotE: " + string(TeapotE ? "ON" : "OFF");
 		string materialStatus = "MatE: " + string(MatE ? "ON" : "OFF");
+		string shaderStatus = "Shaders: " + string(ShaderCache::active() ? "ON" : "OFF");
+		string shadowStatus = "Shadows: " + string(Shadows::active() ? "ON" : "OFF");
+		string perfStatus = "PerfHud: " + string(PerfHud::enabled ? "ON" : "OFF");
 
 		renderString(x, y, solidEStatus);
 		renderString(x, y - 20, materialStatus);
@@ -206,35 +369,37 @@ private:
 		renderString(x, y - 80, cubeStatus);
 		renderString(x, y - 100, pyramideStatus);
 		renderString(x, y - 120, teapotStatus);
+		renderString(x, y - 140, shaderStatus);
+		renderString(x, y - 160, shadowStatus);
+		renderString(x, y - 180, perfStatus);
 
-		glMatrixMode(GL_PROJECTION);
-		glPopMatrix();
-		glMatrixMode(GL_MODELVIEW);
-		glPopMatrix();
-
-		glEnable(GL_DEPTH_TEST);
+		PerfHud::draw(viewportWidth, viewportHeight);
+		TextRenderer::draw(viewportWidth, viewportHeight);
 	}
 
 	static void renderString(int x, int y, const string & text) 
 	{
-		glRasterPos2i(x, y); //ustawienie tekstu
-		for (char c : text) 
-		{
-			glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, c); //wyrenderowanie tekstu
-		}
+		TextRenderer::add(x, y, text); //napis trafia do wspólnego bufora klatki
 	}
 
 	static void reshape(int w, int h) 
 	{
+		if (h == 0) h = 1;
+		viewportWidth = w;
+		viewportHeight = h;
+		projection = glm::perspective(glm::radians(FIELD_OF_VIEW), (float)w / (float)h, NEAR_PLANE, FAR_PLANE);
+		LODSelector::setProjection(FIELD_OF_VIEW, h);
+
 		glViewport(0, 0, w, h);
 		glMatrixMode(GL_PROJECTION);
 		glLoadIdentity();
-		gluPerspective(45.0f, (float)w / (float)h, 0.1f, 100.0f);
+		gluPerspective(FIELD_OF_VIEW, (float)w / (float)h, NEAR_PLANE, FAR_PLANE);
 		glMatrixMode(GL_MODELVIEW);
 	}
 
 	static void keyboard(unsigned char key, int x, int y) 
 	{
+		PROFILE_ZONE("Engine::keyboard"); // ruch kamery
 		Observer observer;
 		observer.processKeyboard(key);
 		glutPostRedisplay();
@@ -242,6 +407,7 @@ private:
 
 	static void specialKeys(int key, int x, int y) 
 	{
+		PROFILE_ZONE("Engine::specialKeys"); // obrót sześcianu (cubeRotation) i przełączniki
 		switch (key) {
 		case GLUT_KEY_LEFT: cubeRotation = glm::rotate(cubeRotation, glm::radians(CUBE_ROTATION_SPEED), glm::vec3(0.0f, 1.0f, 0.0f)); break;
 		case GLUT_KEY_RIGHT: cubeRotation = glm::rotate(cubeRotation, glm::radians(-CUBE_ROTATION_SPEED), glm::vec3(0.0f, 1.0f, 0.0f)); break;
@@ -262,6 +428,22 @@ private:
 		case GLUT_KEY_F5: CubE = !CubE; break;
 		case GLUT_KEY_F6: PyramidE = !PyramidE; break;
 		case GLUT_KEY_F7: TeapotE = !TeapotE; break;
+		case GLUT_KEY_F8:
+			ShaderCache::enabled = !ShaderCache::enabled;
+			if (ShaderCache::enabled && !ShaderCache::supported())
+			{
+				cout << "Shadery GLSL nie sa obslugiwane - zostaje staly potok\n";
+			}
+			break;
+		case GLUT_KEY_F9: PerfHud::enabled = !PerfHud::enabled; break;
+		case GLUT_KEY_F10: Profiler::toggle(); break; // zapis stref do Profiler::outputPath przy drugim naciśnięciu
+		case GLUT_KEY_F11:
+			Shadows::enabled = !Shadows::enabled;
+			if (Shadows::enabled && !ShaderCache::active())
+			{
+				cout << "Cienie dzialaja tylko na sciezce z shaderami (F8)\n";
+			}
+			break;
 		default: cout << "Nacisnieto klawisz " << (char)key << " kod " << (int)key << "\n"; break;
 		}
 		glutPostRedisplay();
@@ -299,4 +481,12 @@ bool Engine::SolidE;
 bool Engine::PyramidE;
 bool Engine::TeapotE;
 bool Engine::MatE;
-Light* Engine::light = nullptr;
\ No newline at end of file
+Light* Engine::light = nullptr;
+glm::mat4 Engine::projection = glm::mat4(1.0f);
+int Engine::viewportWidth = WINDOW_WIDTH;
+int Engine::viewportHeight = WINDOW_HEIGHT;
+LightId Engine::sceneLight = LightManager::InvalidLight;
+MaterialRef Engine::sceneMaterial;
+MaterialRef Engine::defaultMaterial;
+LODMesh Engine::teapotLevels;
+LODState Engine::teapotLOD;
\ No newline at end of file
@@ -0,0 +1,72 @@
+﻿#pragma once
+#include "includy.h"
+
+/**
+* @struct Frustum
+* @brief Ostrosłup widzenia jako 6 płaszczyzn (normalne do wewnątrz) wyciągniętych z macierzy projekcja * widok.
+* Punkt jest wewnątrz, gdy dot(plane.xyz, p) + plane.w >= 0 dla wszystkich płaszczyzn
+*/
+struct Frustum
+{
+	enum Plane
+	{
+		Left,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far,
+		PlaneCount
+	};
+
+	glm::vec4 planes[PlaneCount];
+
+	// Metoda Gribba-Hartmanna, płaszczyzny znormalizowane (odległości w jednostkach świata)
+	static Frustum fromMatrix(const glm::mat4& viewProjection)
+	{
+		const glm::mat4& m = viewProjection;
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		Frustum frustum;
+		frustum.planes[Left] = row3 + row0;
+		frustum.planes[Right] = row3 - row0;
+		frustum.planes[Bottom] = row3 + row1;
+		frustum.planes[Top] = row3 - row1;
+		frustum.planes[Near] = row3 + row2;
+		frustum.planes[Far] = row3 - row2;
+		for (glm::vec4& plane : frustum.planes)
+		{
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return frustum;
+	}
+
+	bool intersectsSphere(const glm::vec3& center, float radius) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Test prostopadłościanu: wierzchołek najdalej po stronie normalnej
+	bool intersectsBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			glm::vec3 positive(plane.x >= 0.0f ? boxMax.x : boxMin.x, plane.y >= 0.0f ? boxMax.y : boxMin.y, plane.z >= 0.0f ? boxMax.z : boxMin.z);
+			if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
@@ -0,0 +1,491 @@
+﻿#pragma once
+#include "includy.h"
+#include <cstring>
+#include <cstdint>
+
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#define GL_VERTEX_SHADER 0x8B31
+#define GL_COMPILE_STATUS 0x8B81
+#define GL_LINK_STATUS 0x8B82
+#define GL_INFO_LOG_LENGTH 0x8B84
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_UNIFORM_BUFFER
+#define GL_UNIFORM_BUFFER 0x8A11
+#define GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT 0x8A34
+#define GL_INVALID_INDEX 0xFFFFFFFFu
+#endif
+#ifndef GL_DYNAMIC_DRAW
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_DYNAMIC_DRAW 0x88E8
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#define GL_MAP_INVALIDATE_RANGE_BIT 0x0004
+#define GL_MAP_UNSYNCHRONIZED_BIT 0x0020
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#define GL_TIMEOUT_EXPIRED 0x911B
+#define GL_WAIT_FAILED 0x911D
+typedef struct __GLsync* GLsync;
+#endif
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+#ifndef GL_TEXTURE_WRAP_R
+#define GL_TEXTURE_WRAP_R 0x8072
+#endif
+#ifndef GL_DEPTH_COMPONENT24
+#define GL_DEPTH_COMPONENT24 0x81A6
+#endif
+#ifndef GL_TEXTURE_COMPARE_MODE
+#define GL_DEPTH_TEXTURE_MODE 0x884B
+#define GL_TEXTURE_COMPARE_MODE 0x884C
+#define GL_TEXTURE_COMPARE_FUNC 0x884D
+#define GL_COMPARE_R_TO_TEXTURE 0x884E
+#endif
+#ifndef GL_TEXTURE_CUBE_MAP
+#define GL_TEXTURE_CUBE_MAP 0x8513
+#define GL_TEXTURE_CUBE_MAP_POSITIVE_X 0x8515
+#endif
+#ifndef GL_TIMESTAMP
+#define GL_QUERY_RESULT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#define GL_TIME_ELAPSED 0x88BF
+#define GL_TIMESTAMP 0x8E28
+#endif
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER 0x8D40
+#define GL_FRAMEBUFFER_BINDING 0x8CA6
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#define GL_DEPTH_ATTACHMENT 0x8D00
+#endif
+
+/**
+* @class GLExt
+* @brief Wczytywanie funkcji OpenGL spoza wersji 1.1 (na Windows opengl32.dll udostępnia tylko 1.1).
+* load() wywoływane po utworzeniu okna, brakująca funkcja zostaje nullptr
+*/
+class GLExt
+{
+public:
+	typedef void (APIENTRY* CompressedTexImage2DProc)(GLenum target, GLint level, GLenum internalFormat,
+		GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void* data);
+
+	static CompressedTexImage2DProc CompressedTexImage2D;
+
+	// GLSL (OpenGL 2.0)
+	typedef GLuint (APIENTRY* CreateShaderProc)(GLenum type);
+	typedef void (APIENTRY* ShaderSourceProc)(GLuint shader, GLsizei count, const char* const* strings, const GLint* lengths);
+	typedef void (APIENTRY* CompileShaderProc)(GLuint shader);
+	typedef void (APIENTRY* GetShaderivProc)(GLuint shader, GLenum name, GLint* value);
+	typedef void (APIENTRY* GetShaderInfoLogProc)(GLuint shader, GLsizei size, GLsizei* length, char* log);
+	typedef void (APIENTRY* DeleteShaderProc)(GLuint shader);
+	typedef GLuint (APIENTRY* CreateProgramProc)();
+	typedef void (APIENTRY* AttachShaderProc)(GLuint program, GLuint shader);
+	typedef void (APIENTRY* DetachShaderProc)(GLuint program, GLuint shader);
+	typedef void (APIENTRY* LinkProgramProc)(GLuint program);
+	typedef void (APIENTRY* GetProgramivProc)(GLuint program, GLenum name, GLint* value);
+	typedef void (APIENTRY* GetProgramInfoLogProc)(GLuint program, GLsizei size, GLsizei* length, char* log);
+	typedef void (APIENTRY* DeleteProgramProc)(GLuint program);
+	typedef void (APIENTRY* UseProgramProc)(GLuint program);
+	typedef GLint (APIENTRY* GetUniformLocationProc)(GLuint program, const char* name);
+	typedef void (APIENTRY* Uniform1iProc)(GLint location, GLint value);
+	typedef void (APIENTRY* Uniform1fProc)(GLint location, GLfloat value);
+	typedef void (APIENTRY* Uniform4fvProc)(GLint location, GLsizei count, const GLfloat* value);
+	typedef void (APIENTRY* UniformMatrix4fvProc)(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+
+	static CreateShaderProc CreateShader;
+	static ShaderSourceProc ShaderSource;
+	static CompileShaderProc CompileShader;
+	static GetShaderivProc GetShaderiv;
+	static GetShaderInfoLogProc GetShaderInfoLog;
+	static DeleteShaderProc DeleteShader;
+	static CreateProgramProc CreateProgram;
+	static AttachShaderProc AttachShader;
+	static DetachShaderProc DetachShader;
+	static LinkProgramProc LinkProgram;
+	static GetProgramivProc GetProgramiv;
+	static GetProgramInfoLogProc GetProgramInfoLog;
+	static DeleteProgramProc DeleteProgram;
+	static UseProgramProc UseProgram;
+	static GetUniformLocationProc GetUniformLocation;
+	static Uniform1iProc Uniform1i;
+	static Uniform1fProc Uniform1f;
+	static Uniform4fvProc Uniform4fv;
+	static UniformMatrix4fvProc UniformMatrix4fv;
+
+	// wiele jednostek tekstur (OpenGL 1.3), tablice samplerów
+	typedef void (APIENTRY* ActiveTextureProc)(GLenum unit);
+	typedef void (APIENTRY* Uniform1ivProc)(GLint location, GLsizei count, const GLint* value);
+
+	static ActiveTextureProc ActiveTexture;
+	static Uniform1ivProc Uniform1iv;
+
+	// GL_ARB_framebuffer_object / GL_EXT_framebuffer_object - rysowanie do tekstury
+	typedef void (APIENTRY* GenFramebuffersProc)(GLsizei count, GLuint* framebuffers);
+	typedef void (APIENTRY* DeleteFramebuffersProc)(GLsizei count, const GLuint* framebuffers);
+	typedef void (APIENTRY* BindFramebufferProc)(GLenum target, GLuint framebuffer);
+	typedef void (APIENTRY* FramebufferTexture2DProc)(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level);
+	typedef GLenum (APIENTRY* CheckFramebufferStatusProc)(GLenum target);
+
+	static GenFramebuffersProc GenFramebuffers;
+	static DeleteFramebuffersProc DeleteFramebuffers;
+	static BindFramebufferProc BindFramebuffer;
+	static FramebufferTexture2DProc FramebufferTexture2D;
+	static CheckFramebufferStatusProc CheckFramebufferStatus;
+
+	// GL_ARB_get_program_binary (OpenGL 4.1)
+	typedef void (APIENTRY* GetProgramBinaryProc)(GLuint program, GLsizei size, GLsizei* length, GLenum* format, void* binary);
+	typedef void (APIENTRY* ProgramBinaryProc)(GLuint program, GLenum format, const void* binary, GLsizei length);
+	typedef void (APIENTRY* ProgramParameteriProc)(GLuint program, GLenum name, GLint value);
+
+	static GetProgramBinaryProc GetProgramBinary;
+	static ProgramBinaryProc ProgramBinary;
+	static ProgramParameteriProc ProgramParameteri;
+
+	// GL_ARB_draw_instanced
+	typedef void (APIENTRY* DrawElementsInstancedProc)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances);
+
+	static DrawElementsInstancedProc DrawElementsInstanced;
+
+	// bufory, GL_ARB_map_buffer_range, GL_ARB_uniform_buffer_object, GL_ARB_sync, GL_ARB_buffer_storage
+	typedef void (APIENTRY* GenBuffersProc)(GLsizei count, GLuint* buffers);
+	typedef void (APIENTRY* DeleteBuffersProc)(GLsizei count, const GLuint* buffers);
+	typedef void (APIENTRY* BindBufferProc)(GLenum target, GLuint buffer);
+	typedef void (APIENTRY* BufferDataProc)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+	typedef void (APIENTRY* BufferSubDataProc)(GLenum target, ptrdiff_t offset, ptrdiff_t size, const void* data);
+	typedef void (APIENTRY* BufferStorageProc)(GLenum target, ptrdiff_t size, const void* data, GLbitfield flags);
+	typedef void* (APIENTRY* MapBufferRangeProc)(GLenum target, ptrdiff_t offset, ptrdiff_t length, GLbitfield access);
+	typedef GLboolean (APIENTRY* UnmapBufferProc)(GLenum target);
+	typedef void (APIENTRY* BindBufferRangeProc)(GLenum target, GLuint index, GLuint buffer, ptrdiff_t offset, ptrdiff_t size);
+	typedef GLuint (APIENTRY* GetUniformBlockIndexProc)(GLuint program, const char* name);
+	typedef void (APIENTRY* UniformBlockBindingProc)(GLuint program, GLuint block, GLuint binding);
+	typedef GLsync (APIENTRY* FenceSyncProc)(GLenum condition, GLbitfield flags);
+	typedef GLenum (APIENTRY* ClientWaitSyncProc)(GLsync sync, GLbitfield flags, uint64_t timeout);
+	typedef void (APIENTRY* DeleteSyncProc)(GLsync sync);
+	typedef void (APIENTRY* BindAttribLocationProc)(GLuint program, GLuint index, const char* name);
+	typedef void (APIENTRY* VertexAttrib1fProc)(GLuint index, GLfloat value);
+
+	static GenBuffersProc GenBuffers;
+	static DeleteBuffersProc DeleteBuffers;
+	static BindBufferProc BindBuffer;
+	static BufferDataProc BufferData;
+	static BufferSubDataProc BufferSubData;
+	static BufferStorageProc BufferStorage;
+	static MapBufferRangeProc MapBufferRange;
+	static UnmapBufferProc UnmapBuffer;
+	static BindBufferRangeProc BindBufferRange;
+	static GetUniformBlockIndexProc GetUniformBlockIndex;
+	static UniformBlockBindingProc UniformBlockBinding;
+	static FenceSyncProc FenceSync;
+	static ClientWaitSyncProc ClientWaitSync;
+	static DeleteSyncProc DeleteSync;
+	static BindAttribLocationProc BindAttribLocation;
+	static VertexAttrib1fProc VertexAttrib1f;
+
+	// zapytania (OpenGL 1.5), GL_ARB_timer_query (OpenGL 3.3)
+	typedef void (APIENTRY* GenQueriesProc)(GLsizei count, GLuint* queries);
+	typedef void (APIENTRY* DeleteQueriesProc)(GLsizei count, const GLuint* queries);
+	typedef void (APIENTRY* GetQueryObjectivProc)(GLuint query, GLenum name, GLint* value);
+	typedef void (APIENTRY* GetQueryObjectui64vProc)(GLuint query, GLenum name, uint64_t* value);
+	typedef void (APIENTRY* QueryCounterProc)(GLuint query, GLenum target);
+	typedef void (APIENTRY* GetInteger64vProc)(GLenum name, int64_t* value);
+
+	static GenQueriesProc GenQueries;
+	static DeleteQueriesProc DeleteQueries;
+	static GetQueryObjectivProc GetQueryObjectiv;
+	static GetQueryObjectui64vProc GetQueryObjectui64v;
+	static QueryCounterProc QueryCounter;
+	static GetInteger64vProc GetInteger64v;
+
+	static void load()
+	{
+		if (loaded)
+		{
+			return;
+		}
+		loaded = true;
+
+		CompressedTexImage2D = (CompressedTexImage2DProc)proc("glCompressedTexImage2D");
+		if (!CompressedTexImage2D)
+		{
+			CompressedTexImage2D = (CompressedTexImage2DProc)proc("glCompressedTexImage2DARB");
+		}
+
+		CreateShader = (CreateShaderProc)proc("glCreateShader");
+		ShaderSource = (ShaderSourceProc)proc("glShaderSource");
+		CompileShader = (CompileShaderProc)proc("glCompileShader");
+		GetShaderiv = (GetShaderivProc)proc("glGetShaderiv");
+		GetShaderInfoLog = (GetShaderInfoLogProc)proc("glGetShaderInfoLog");
+		DeleteShader = (DeleteShaderProc)proc("glDeleteShader");
+		CreateProgram = (CreateProgramProc)proc("glCreateProgram");
+		AttachShader = (AttachShaderProc)proc("glAttachShader");
+		DetachShader = (DetachShaderProc)proc("glDetachShader");
+		LinkProgram = (LinkProgramProc)proc("glLinkProgram");
+		GetProgramiv = (GetProgramivProc)proc("glGetProgramiv");
+		GetProgramInfoLog = (GetProgramInfoLogProc)proc("glGetProgramInfoLog");
+		DeleteProgram = (DeleteProgramProc)proc("glDeleteProgram");
+		UseProgram = (UseProgramProc)proc("glUseProgram");
+		GetUniformLocation = (GetUniformLocationProc)proc("glGetUniformLocation");
+		Uniform1i = (Uniform1iProc)proc("glUniform1i");
+		Uniform1f = (Uniform1fProc)proc("glUniform1f");
+		Uniform4fv = (Uniform4fvProc)proc("glUniform4fv");
+		UniformMatrix4fv = (UniformMatrix4fvProc)proc("glUniformMatrix4fv");
+
+		ActiveTexture = (ActiveTextureProc)proc("glActiveTexture");
+		Uniform1iv = (Uniform1ivProc)proc("glUniform1iv");
+
+		GenFramebuffers = (GenFramebuffersProc)proc("glGenFramebuffers");
+		DeleteFramebuffers = (DeleteFramebuffersProc)proc("glDeleteFramebuffers");
+		BindFramebuffer = (BindFramebufferProc)proc("glBindFramebuffer");
+		FramebufferTexture2D = (FramebufferTexture2DProc)proc("glFramebufferTexture2D");
+		CheckFramebufferStatus = (CheckFramebufferStatusProc)proc("glCheckFramebufferStatus");
+		if (!GenFramebuffers || !BindFramebuffer)
+		{
+			GenFramebuffers = (GenFramebuffersProc)proc("glGenFramebuffersEXT");
+			DeleteFramebuffers = (DeleteFramebuffersProc)proc("glDeleteFramebuffersEXT");
+			BindFramebuffer = (BindFramebufferProc)proc("glBindFramebufferEXT");
+			FramebufferTexture2D = (FramebufferTexture2DProc)proc("glFramebufferTexture2DEXT");
+			CheckFramebufferStatus = (CheckFramebufferStatusProc)proc("glCheckFramebufferStatusEXT");
+		}
+
+		GetProgramBinary = (GetProgramBinaryProc)proc("glGetProgramBinary");
+		ProgramBinary = (ProgramBinaryProc)proc("glProgramBinary");
+		ProgramParameteri = (ProgramParameteriProc)proc("glProgramParameteri");
+
+		DrawElementsInstanced = (DrawElementsInstancedProc)proc("glDrawElementsInstanced");
+		if (!DrawElementsInstanced)
+		{
+			DrawElementsInstanced = (DrawElementsInstancedProc)proc("glDrawElementsInstancedARB");
+		}
+
+		GenBuffers = (GenBuffersProc)proc("glGenBuffers");
+		DeleteBuffers = (DeleteBuffersProc)proc("glDeleteBuffers");
+		BindBuffer = (BindBufferProc)proc("glBindBuffer");
+		BufferData = (BufferDataProc)proc("glBufferData");
+		BufferSubData = (BufferSubDataProc)proc("glBufferSubData");
+		BufferStorage = (BufferStorageProc)proc("glBufferStorage");
+		MapBufferRange = (MapBufferRangeProc)proc("glMapBufferRange");
+		UnmapBuffer = (UnmapBufferProc)proc("glUnmapBuffer");
+		BindBufferRange = (BindBufferRangeProc)proc("glBindBufferRange");
+		GetUniformBlockIndex = (GetUniformBlockIndexProc)proc("glGetUniformBlockIndex");
+		UniformBlockBinding = (UniformBlockBindingProc)proc("glUniformBlockBinding");
+		FenceSync = (FenceSyncProc)proc("glFenceSync");
+		ClientWaitSync = (ClientWaitSyncProc)proc("glClientWaitSync");
+		DeleteSync = (DeleteSyncProc)proc("glDeleteSync");
+		BindAttribLocation = (BindAttribLocationProc)proc("glBindAttribLocation");
+		VertexAttrib1f = (VertexAttrib1fProc)proc("glVertexAttrib1f");
+
+		GenQueries = (GenQueriesProc)proc("glGenQueries");
+		DeleteQueries = (DeleteQueriesProc)proc("glDeleteQueries");
+		GetQueryObjectiv = (GetQueryObjectivProc)proc("glGetQueryObjectiv");
+		GetQueryObjectui64v = (GetQueryObjectui64vProc)proc("glGetQueryObjectui64v");
+		QueryCounter = (QueryCounterProc)proc("glQueryCounter");
+		GetInteger64v = (GetInteger64vProc)proc("glGetInteger64v");
+	}
+
+	static bool isLoaded()
+	{
+		return loaded;
+	}
+
+	static bool hasExtension(const char* name)
+	{
+		const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+		if (!extensions)
+		{
+			return false;
+		}
+
+		size_t length = strlen(name);
+		for (const char* found = strstr(extensions, name); found; found = strstr(found + length, name))
+		{
+			bool start = found == extensions || found[-1] == ' ';
+			bool end = found[length] == ' ' || found[length] == '\0';
+			if (start && end)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Tekstury BC1 (DXT1) wysyłane bez rozpakowywania
+	static bool supportsS3TC()
+	{
+		load();
+		return CompressedTexImage2D && hasExtension("GL_EXT_texture_compression_s3tc");
+	}
+
+	static bool supportsShaders()
+	{
+		load();
+		return CreateShader && ShaderSource && CompileShader && GetShaderiv && GetShaderInfoLog && DeleteShader &&
+			CreateProgram && AttachShader && DetachShader && LinkProgram && GetProgramiv && GetProgramInfoLog &&
+			DeleteProgram && UseProgram && GetUniformLocation && Uniform1i && Uniform1f && Uniform4fv && UniformMatrix4fv;
+	}
+
+	// Zapis skompilowanych programów - sterownik musi zgłaszać co najmniej jeden format
+	static bool supportsProgramBinary()
+	{
+		load();
+		if (!GetProgramBinary || !ProgramBinary || !ProgramParameteri)
+		{
+			return false;
+		}
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		return formats > 0;
+	}
+
+	// Bufory wierzchołków (OpenGL 1.5)
+	static bool supportsVertexBuffers()
+	{
+		load();
+		return GenBuffers && DeleteBuffers && BindBuffer && BufferData && BufferSubData;
+	}
+
+	// Bufor uniformów zapisywany przez mapowanie, z synchronizacją przez fence
+	static bool supportsUniformBuffers()
+	{
+		load();
+		return GenBuffers && DeleteBuffers && BindBuffer && BufferData && MapBufferRange && UnmapBuffer && BindBufferRange &&
+			GetUniformBlockIndex && UniformBlockBinding && FenceSync && ClientWaitSync && DeleteSync &&
+			BindAttribLocation && VertexAttrib1f &&
+			hasExtension("GL_ARB_uniform_buffer_object") && hasExtension("GL_ARB_sync") && hasExtension("GL_ARB_map_buffer_range");
+	}
+
+	// Trwałe mapowanie - bufor zmapowany raz na cały czas działania
+	static bool supportsBufferStorage()
+	{
+		return supportsUniformBuffers() && BufferStorage && hasExtension("GL_ARB_buffer_storage");
+	}
+
+	static bool supportsInstancing()
+	{
+		load();
+		return DrawElementsInstanced && (hasExtension("GL_ARB_draw_instanced") || hasExtension("GL_EXT_draw_instanced"));
+	}
+
+	// Znaczniki czasu GPU (glQueryCounter z GL_TIMESTAMP)
+	static bool supportsTimerQueries()
+	{
+		load();
+		if (!GenQueries || !DeleteQueries || !GetQueryObjectiv || !GetQueryObjectui64v || !QueryCounter)
+		{
+			return false;
+		}
+		const char* version = (const char*)glGetString(GL_VERSION);
+		bool core = version && (version[0] > '3' || (version[0] == '3' && version[2] >= '3')) && version[0] <= '9';
+		return core || hasExtension("GL_ARB_timer_query");
+	}
+
+	// Mapy cieni: rysowanie głębi do tekstury (także sześciennej) i porównanie w shaderze
+	static bool supportsShadowMaps()
+	{
+		load();
+		if (!supportsShaders() || !ActiveTexture || !Uniform1iv || !GenFramebuffers || !DeleteFramebuffers ||
+			!BindFramebuffer || !FramebufferTexture2D || !CheckFramebufferStatus)
+		{
+			return false;
+		}
+		// tekstury głębi sześcienne dopiero od OpenGL 3.0
+		const char* version = (const char*)glGetString(GL_VERSION);
+		return version && version[0] >= '3' && version[0] <= '9';
+	}
+
+private:
+	static bool loaded;
+
+	static void* proc(const char* name)
+	{
+#ifdef _WIN32
+		void* address = (void*)wglGetProcAddress(name);
+		intptr_t value = (intptr_t)address;
+		return (value >= -1 && value <= 3) ? nullptr : address; // niektóre sterowniki zwracają 1-3 lub -1 zamiast NULL
+#else
+		return (void*)glXGetProcAddress((const GLubyte*)name);
+#endif
+	}
+};
+
+bool GLExt::loaded = false;
+GLExt::CompressedTexImage2DProc GLExt::CompressedTexImage2D = nullptr;
+GLExt::CreateShaderProc GLExt::CreateShader = nullptr;
+GLExt::ShaderSourceProc GLExt::ShaderSource = nullptr;
+GLExt::CompileShaderProc GLExt::CompileShader = nullptr;
+GLExt::GetShaderivProc GLExt::GetShaderiv = nullptr;
+GLExt::GetShaderInfoLogProc GLExt::GetShaderInfoLog = nullptr;
+GLExt::DeleteShaderProc GLExt::DeleteShader = nullptr;
+GLExt::CreateProgramProc GLExt::CreateProgram = nullptr;
+GLExt::AttachShaderProc GLExt::AttachShader = nullptr;
+GLExt::DetachShaderProc GLExt::DetachShader = nullptr;
+GLExt::LinkProgramProc GLExt::LinkProgram = nullptr;
+GLExt::GetProgramivProc GLExt::GetProgramiv = nullptr;
+GLExt::GetProgramInfoLogProc GLExt::GetProgramInfoLog = nullptr;
+GLExt::DeleteProgramProc GLExt::DeleteProgram = nullptr;
+GLExt::UseProgramProc GLExt::UseProgram = nullptr;
+GLExt::GetUniformLocationProc GLExt::GetUniformLocation = nullptr;
+GLExt::Uniform1iProc GLExt::Uniform1i = nullptr;
+GLExt::Uniform1fProc GLExt::Uniform1f = nullptr;
+GLExt::Uniform4fvProc GLExt::Uniform4fv = nullptr;
+GLExt::UniformMatrix4fvProc GLExt::UniformMatrix4fv = nullptr;
+GLExt::ActiveTextureProc GLExt::ActiveTexture = nullptr;
+GLExt::Uniform1ivProc GLExt::Uniform1iv = nullptr;
+GLExt::GenFramebuffersProc GLExt::GenFramebuffers = nullptr;
+GLExt::DeleteFramebuffersProc GLExt::DeleteFramebuffers = nullptr;
+GLExt::BindFramebufferProc GLExt::BindFramebuffer = nullptr;
+GLExt::FramebufferTexture2DProc GLExt::FramebufferTexture2D = nullptr;
+GLExt::CheckFramebufferStatusProc GLExt::CheckFramebufferStatus = nullptr;
+GLExt::GetProgramBinaryProc GLExt::GetProgramBinary = nullptr;
+GLExt::ProgramBinaryProc GLExt::ProgramBinary = nullptr;
+GLExt::ProgramParameteriProc GLExt::ProgramParameteri = nullptr;
+GLExt::DrawElementsInstancedProc GLExt::DrawElementsInstanced = nullptr;
+GLExt::GenBuffersProc GLExt::GenBuffers = nullptr;
+GLExt::DeleteBuffersProc GLExt::DeleteBuffers = nullptr;
+GLExt::BindBufferProc GLExt::BindBuffer = nullptr;
+GLExt::BufferDataProc GLExt::BufferData = nullptr;
+GLExt::BufferSubDataProc GLExt::BufferSubData = nullptr;
+GLExt::BufferStorageProc GLExt::BufferStorage = nullptr;
+GLExt::MapBufferRangeProc GLExt::MapBufferRange = nullptr;
+GLExt::UnmapBufferProc GLExt::UnmapBuffer = nullptr;
+GLExt::BindBufferRangeProc GLExt::BindBufferRange = nullptr;
+GLExt::GetUniformBlockIndexProc GLExt::GetUniformBlockIndex = nullptr;
+GLExt::UniformBlockBindingProc GLExt::UniformBlockBinding = nullptr;
+GLExt::FenceSyncProc GLExt::FenceSync = nullptr;
+GLExt::ClientWaitSyncProc GLExt::ClientWaitSync = nullptr;
+GLExt::DeleteSyncProc GLExt::DeleteSync = nullptr;
+GLExt::BindAttribLocationProc GLExt::BindAttribLocation = nullptr;
+GLExt::VertexAttrib1fProc GLExt::VertexAttrib1f = nullptr;
+GLExt::GenQueriesProc GLExt::GenQueries = nullptr;
+GLExt::DeleteQueriesProc GLExt::DeleteQueries = nullptr;
+GLExt::GetQueryObjectivProc GLExt::GetQueryObjectiv = nullptr;
+GLExt::GetQueryObjectui64vProc GLExt::GetQueryObjectui64v = nullptr;
+GLExt::QueryCounterProc GLExt::QueryCounter = nullptr;
+GLExt::GetInteger64vProc GLExt::GetInteger64v = nullptr;
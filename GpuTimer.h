@@ -0,0 +1,308 @@
+﻿#pragma once
+#include "includy.h"
+#include "GLExt.h"
+#include "Profiler.h"
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+/**
+* @class GpuTimer
+* @brief Czas GPU przebiegów renderowania ze znaczników czasu (glQueryCounter z GL_TIMESTAMP) - przebiegi mogą
+* się zagnieżdżać (cała klatka obejmuje pozostałe). Zapytania każdej klatki mają własny zestaw w puli
+* FramesInFlight klatek i czytane są dopiero, gdy ten zestaw wraca do użycia - bez czekania na GPU; jeśli
+* wyniki nadal nie są gotowe, klatka jest pomijana. Wyniki trafiają do PerfHud i, przy przechwytywaniu
+* profilera, na oś "GPU" w pliku trace
+*/
+class GpuTimer
+{
+public:
+	static const int FramesInFlight = 4;
+	static const int MaxPasses = 16;     // różne nazwy przebiegów
+	static const int MaxQueries = 64;    // znaczniki na klatkę (dwa na przebieg)
+	static bool enabled;
+
+	static bool supported()
+	{
+		return GLExt::supportsTimerQueries();
+	}
+
+	// Początek klatki - odczyt klatki sprzed FramesInFlight i otwarcie przebiegu "Frame"
+	static void beginFrame()
+	{
+		running = enabled && create();
+		if (!running)
+		{
+			return;
+		}
+
+		frameIndex++;
+		Frame& frame = frames[frameIndex % FramesInFlight];
+		if (frame.queryCount > 0)
+		{
+			resolve(frame);
+		}
+		frame.queryCount = 0;
+		frame.passCount = 0;
+		frame.calibrated = false;
+		depth = 0;
+		overflow = 0;
+
+		// zegar GPU względem CPU - tylko do osi czasu profilera
+		if (Profiler::capturing() && GLExt::GetInteger64v)
+		{
+			GLExt::GetInteger64v(GL_TIMESTAMP, &frame.gpuReference);
+			frame.cpuReference = chrono::steady_clock::now();
+			frame.calibrated = true;
+		}
+		begin("Frame");
+	}
+
+	static void endFrame()
+	{
+		if (!running)
+		{
+			return;
+		}
+		while (depth > 0)
+		{
+			end();
+		}
+		running = false;
+	}
+
+	// Nazwa musi żyć do końca programu (literał)
+	static void begin(const char* name)
+	{
+		if (!running)
+		{
+			return;
+		}
+		if (depth == MaxDepth)
+		{
+			overflow++;
+			return;
+		}
+		Frame& frame = frames[frameIndex % FramesInFlight];
+		int pass = passId(name);
+		// miejsce na własne znaczniki i końce przebiegów już otwartych
+		if (pass < 0 || frame.queryCount + depth + 2 > MaxQueries)
+		{
+			stack[depth++] = -1; // bez miejsca - end() i tak zdejmie przebieg
+			return;
+		}
+
+		Pass& record = frame.passes[frame.passCount];
+		record.id = pass;
+		record.begin = frame.queryCount;
+		record.end = -1;
+		GLExt::QueryCounter(frame.queries[frame.queryCount++], GL_TIMESTAMP);
+		stack[depth++] = frame.passCount++;
+	}
+
+	static void end()
+	{
+		if (!running || depth == 0)
+		{
+			return;
+		}
+		if (overflow > 0)
+		{
+			overflow--;
+			return;
+		}
+		int index = stack[--depth];
+		if (index < 0)
+		{
+			return;
+		}
+		Frame& frame = frames[frameIndex % FramesInFlight];
+		frame.passes[index].end = frame.queryCount;
+		GLExt::QueryCounter(frame.queries[frame.queryCount++], GL_TIMESTAMP);
+	}
+
+	/**
+	* @class Scope
+	* @brief Przebieg od konstrukcji do końca bloku
+	*/
+	class Scope
+	{
+	public:
+		explicit Scope(const char* name)
+		{
+			begin(name);
+		}
+
+		~Scope()
+		{
+			end();
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+
+	// Wyniki ostatniej odczytanej klatki (FramesInFlight - 1 klatek wstecz)
+	static int passCount()
+	{
+		return names;
+	}
+
+	static const char* passName(int pass)
+	{
+		return passNames[pass];
+	}
+
+	static float passMs(int pass)
+	{
+		return resultMs[pass];
+	}
+
+	// Licznik odczytanych klatek - nowe wyniki, gdy się zmienia
+	static uint64_t resolvedFrames()
+	{
+		return resolved;
+	}
+
+	// Klatki, których wyniki nie były gotowe przy ponownym użyciu zapytań
+	static uint64_t droppedFrames()
+	{
+		return dropped;
+	}
+
+	static void release()
+	{
+		if (created && GLExt::DeleteQueries)
+		{
+			for (Frame& frame : frames)
+			{
+				GLExt::DeleteQueries(MaxQueries, frame.queries);
+				frame.queryCount = 0;
+			}
+		}
+		created = false;
+		running = false;
+	}
+
+private:
+	static const int MaxDepth = 8;
+
+	struct Pass
+	{
+		int id;      // indeks nazwy
+		int begin;   // indeksy zapytań
+		int end;
+	};
+
+	struct Frame
+	{
+		GLuint queries[MaxQueries];
+		int queryCount = 0;
+		Pass passes[MaxQueries / 2];
+		int passCount = 0;
+		bool calibrated = false;
+		int64_t gpuReference = 0;
+		chrono::steady_clock::time_point cpuReference;
+	};
+
+	static Frame frames[FramesInFlight];
+	static bool created;
+	static bool running;
+	static uint64_t frameIndex;
+	static int stack[MaxDepth];
+	static int depth;
+	static int overflow;         // przebiegi zagnieżdżone głębiej niż MaxDepth
+	static const char* passNames[MaxPasses];
+	static int names;
+	static float resultMs[MaxPasses];
+	static uint64_t resolved;
+	static uint64_t dropped;
+
+	static bool create()
+	{
+		if (created)
+		{
+			return true;
+		}
+		if (!supported())
+		{
+			return false;
+		}
+		for (Frame& frame : frames)
+		{
+			GLExt::GenQueries(MaxQueries, frame.queries);
+			frame.queryCount = 0;
+		}
+		created = true;
+		return true;
+	}
+
+	static int passId(const char* name)
+	{
+		for (int i = 0; i < names; i++)
+		{
+			if (passNames[i] == name || strcmp(passNames[i], name) == 0)
+			{
+				return i;
+			}
+		}
+		if (names == MaxPasses)
+		{
+			return -1;
+		}
+		passNames[names] = name;
+		return names++;
+	}
+
+	static void resolve(Frame& frame)
+	{
+		// znaczniki wykonują się po kolei - gotowy ostatni oznacza gotowe wszystkie
+		GLint available = 0;
+		GLExt::GetQueryObjectiv(frame.queries[frame.queryCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+		{
+			dropped++;
+			return;
+		}
+
+		uint64_t times[MaxQueries];
+		for (int i = 0; i < frame.queryCount; i++)
+		{
+			GLExt::GetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &times[i]);
+		}
+
+		fill(resultMs, resultMs + MaxPasses, 0.0f);
+		for (int i = 0; i < frame.passCount; i++)
+		{
+			const Pass& pass = frame.passes[i];
+			if (pass.end < 0)
+			{
+				continue;
+			}
+			uint64_t start = times[pass.begin], finish = times[pass.end];
+			resultMs[pass.id] += (finish - start) / 1000000.0f;
+			if (frame.calibrated)
+			{
+				chrono::nanoseconds offset((int64_t)start - frame.gpuReference);
+				chrono::nanoseconds length((int64_t)(finish - start));
+				Profiler::recordGpu(passNames[pass.id], frame.cpuReference + offset, frame.cpuReference + offset + length);
+			}
+		}
+		resolved++;
+	}
+};
+
+bool GpuTimer::enabled = false;
+GpuTimer::Frame GpuTimer::frames[GpuTimer::FramesInFlight];
+bool GpuTimer::created = false;
+bool GpuTimer::running = false;
+uint64_t GpuTimer::frameIndex = 0;
+int GpuTimer::stack[GpuTimer::MaxDepth];
+int GpuTimer::depth = 0;
+int GpuTimer::overflow = 0;
+const char* GpuTimer::passNames[GpuTimer::MaxPasses];
+int GpuTimer::names = 0;
+float GpuTimer::resultMs[GpuTimer::MaxPasses] = {};
+uint64_t GpuTimer::resolved = 0;
+uint64_t GpuTimer::dropped = 0;
@@ -0,0 +1,289 @@
+﻿#pragma once
+#include "includy.h"
+#include "TextureHandler.h"
+#include "WorldStreaming.h"
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+/**
+* @class FileWatcher
+* @brief Obserwowanie zmian plików. Na Linuksie inotify na katalogach obserwowanych plików
+* (odczyt nieblokujący w poll), gdzie indziej wątek porównujący co chwilę czas modyfikacji i rozmiar.
+* Zmiana zgłaszana jest dopiero, gdy plik przez chwilę się nie zmienia - edytory zapisują w kilku krokach
+*/
+class FileWatcher
+{
+public:
+	static const int DebounceMs = 150;
+	static const int PollIntervalMs = 250;
+
+	FileWatcher()
+	{
+#ifdef __linux__
+		descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (descriptor >= 0)
+		{
+			return;
+		}
+#endif
+		poller = thread([this]() { pollLoop(); });
+	}
+
+	~FileWatcher()
+	{
+		{
+			lock_guard<mutex> lock(filesMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		if (poller.joinable())
+		{
+			poller.join();
+		}
+#ifdef __linux__
+		if (descriptor >= 0)
+		{
+			::close(descriptor);
+		}
+#endif
+	}
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	void watch(const string& path)
+	{
+		lock_guard<mutex> lock(filesMutex);
+		if (files.count(path))
+		{
+			return;
+		}
+		files[path] = fileStamp(path);
+
+#ifdef __linux__
+		if (descriptor >= 0)
+		{
+			size_t slash = path.find_last_of('/');
+			string directory = slash == string::npos ? string() : path.substr(0, slash + 1);
+			int watch = inotify_add_watch(descriptor, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+			if (watch >= 0)
+			{
+				// ten sam katalog zapisany różnie (np. "a/" i "a/b/../") ma jeden deskryptor
+				directories[watch].insert(directory);
+			}
+		}
+#endif
+	}
+
+	// Zmienione pliki, których zapis się zakończył (wątek renderowania, bez blokowania)
+	void poll(vector<string>& changed)
+	{
+		auto now = chrono::steady_clock::now();
+		{
+			lock_guard<mutex> lock(filesMutex);
+#ifdef __linux__
+			readEvents(now);
+#endif
+			for (auto it = pending.begin(); it != pending.end();)
+			{
+				if (now - it->second < chrono::milliseconds(DebounceMs))
+				{
+					++it;
+					continue;
+				}
+				changed.push_back(it->first);
+				it = pending.erase(it);
+			}
+		}
+	}
+
+private:
+	// Czas modyfikacji i rozmiar - zmiana którejkolwiek wartości to zmiana pliku
+	struct Stamp
+	{
+		long long time = 0;
+		long long size = -1;
+
+		bool operator!=(const Stamp& other) const
+		{
+			return time != other.time || size != other.size;
+		}
+	};
+
+	map<string, Stamp> files;
+	map<string, chrono::steady_clock::time_point> pending; // ostatnia zmiana pliku
+	mutex filesMutex;
+	condition_variable wake;
+	bool stopping = false;
+	thread poller;
+
+#ifdef __linux__
+	int descriptor = -1;
+	map<int, set<string>> directories;
+
+	void readEvents(chrono::steady_clock::time_point now)
+	{
+		if (descriptor < 0)
+		{
+			return;
+		}
+
+		alignas(inotify_event) char buffer[4096];
+		ssize_t length;
+		while ((length = ::read(descriptor, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* p = buffer; p < buffer + length;)
+			{
+				const inotify_event* event = (const inotify_event*)p;
+				p += sizeof(inotify_event) + event->len;
+
+				auto directory = directories.find(event->wd);
+				if (event->len == 0 || directory == directories.end())
+				{
+					continue;
+				}
+				for (const string& prefix : directory->second)
+				{
+					string path = prefix + event->name;
+					if (files.count(path))
+					{
+						pending[path] = now;
+					}
+				}
+			}
+		}
+	}
+#endif
+
+	static Stamp fileStamp(const string& path)
+	{
+		Stamp stamp;
+#ifdef _WIN32
+		struct _stat64 info;
+		if (_stat64(path.c_str(), &info) == 0)
+#else
+		struct stat info;
+		if (stat(path.c_str(), &info) == 0)
+#endif
+		{
+			stamp.time = (long long)info.st_mtime;
+			stamp.size = (long long)info.st_size;
+		}
+		return stamp;
+	}
+
+	void pollLoop()
+	{
+		unique_lock<mutex> lock(filesMutex);
+		while (!wake.wait_for(lock, chrono::milliseconds(PollIntervalMs), [this]() { return stopping; }))
+		{
+			vector<string> paths;
+			for (const auto& entry : files)
+			{
+				paths.push_back(entry.first);
+			}
+
+			// stat bez blokady - watch() i poll() z wątku renderowania nie czekają na dysk
+			lock.unlock();
+			vector<Stamp> stamps;
+			for (const string& path : paths)
+			{
+				stamps.push_back(fileStamp(path));
+			}
+			lock.lock();
+
+			auto now = chrono::steady_clock::now();
+			for (size_t i = 0; i < paths.size(); i++)
+			{
+				Stamp& known = files[paths[i]];
+				if (stamps[i] != known)
+				{
+					known = stamps[i];
+					pending[paths[i]] = now;
+				}
+			}
+		}
+	}
+};
+
+/**
+* @class HotReload
+* @brief Przeładowanie zmienionych tekstur, siatek i plików komórek świata bez restartu.
+* Pliki do obserwowania zbierane są z TextureHandler i WorldStreamer, nowa zawartość wczytywana jest
+* na wątkach roboczych i podmieniana między klatkami pod tymi samymi uchwytami (nazwa tekstury,
+* siatka obiektu). Praca na wątku renderowania ograniczona jest do sliceMs na klatkę, a wysyłanie
+* tekstur do TextureHandler::uploadBudget
+*/
+class HotReload
+{
+public:
+	static bool enabled;
+	static float sliceMs;       // czas na klatkę na podmiany siatek
+	static float syncSeconds;   // co ile aktualizowana jest lista obserwowanych plików
+
+	// Wywoływane raz na klatkę na wątku renderowania, przed TextureHandler::update()
+	static void update()
+	{
+		PROFILE_ZONE("HotReload::update");
+		if (!enabled)
+		{
+			return;
+		}
+
+		auto start = chrono::steady_clock::now();
+		auto deadline = start + chrono::microseconds((long long)(sliceMs * 1000.0f));
+		FileWatcher& files = watcher();
+
+		if (start - lastSync >= chrono::duration<float>(syncSeconds))
+		{
+			vector<string> paths;
+			TextureHandler::paths(paths);
+			WorldStreamer::files(paths);
+			for (const string& path : paths)
+			{
+				files.watch(path);
+			}
+			lastSync = start;
+		}
+
+		vector<string> changed;
+		files.poll(changed);
+		for (const string& path : changed)
+		{
+			size_t textures = TextureHandler::reload(path);
+			bool world = WorldStreamer::reloadFile(path);
+			if (textures || world)
+			{
+				cout << "Zmiana pliku " << path << " - przeladowanie\n";
+			}
+		}
+
+		WorldStreamer::applyReloads(deadline);
+	}
+
+private:
+	static chrono::steady_clock::time_point lastSync;
+
+	static FileWatcher& watcher()
+	{
+		static FileWatcher instance;
+		return instance;
+	}
+};
+
+bool HotReload::enabled = false;
+float HotReload::sliceMs = 2.0f;
+float HotReload::syncSeconds = 1.0f;
+chrono::steady_clock::time_point HotReload::lastSync;
@@ -0,0 +1,153 @@
+﻿#pragma once
+#include "includy.h"
+#include "Mesh.h"
+#include "const.h"
+#include <cmath>
+
+/**
+* @struct LODLevel
+* @brief Jeden poziom szczegółowości - siatka, zakres jej indeksów i błąd geometryczny
+*/
+struct LODLevel
+{
+	const Mesh* mesh;
+	size_t lod;   // poziom wewnątrz siatki (Mesh::lods)
+	float error;  // maksymalne odchylenie od pełnej siatki w jednostkach siatki
+};
+
+/**
+* @class LODMesh
+* @brief Zestaw poziomów szczegółowości jednego obiektu, od najdokładniejszego do najprostszego
+*/
+class LODMesh
+{
+public:
+	vector<LODLevel> levels;
+
+	void addLevel(const Mesh& mesh, float error, size_t lod = 0)
+	{
+		levels.push_back({ &mesh, lod, error });
+	}
+
+	// Poziomy zapisane w samej siatce (np. indeksy wygenerowane przez uproszczenie)
+	static LODMesh fromMesh(const Mesh& mesh)
+	{
+		LODMesh result;
+		for (size_t i = 0; i < mesh.lodCount(); i++)
+		{
+			result.addLevel(mesh, mesh.lod(i).error, i);
+		}
+		return result;
+	}
+
+	bool empty() const
+	{
+		return levels.empty();
+	}
+
+	void draw(int level) const
+	{
+		if (levels.empty())
+		{
+			return;
+		}
+		const LODLevel& l = levels[std::min((size_t)std::max(level, 0), levels.size() - 1)];
+		l.mesh->draw(l.lod);
+	}
+};
+
+/**
+* @struct LODState
+* @brief Stan wyboru poziomu dla jednej instancji obiektu (potrzebny do histerezy)
+*/
+struct LODState
+{
+	int level = -1;
+};
+
+/**
+* @class LODSelector
+* @brief Wybór poziomu szczegółowości na podstawie błędu rzutowanego na ekran
+* Błąd poziomu (w jednostkach świata) przeliczany jest na piksele według projekcji z Engine::reshape().
+* Wybierany jest najprostszy poziom, którego błąd mieści się w progu; przejście na prostszy
+* poziom wymaga zapasu (histereza), żeby obiekt nie przeskakiwał między poziomami na granicy progu
+*/
+class LODSelector
+{
+public:
+	static float maxPixelError; // dopuszczalny błąd w pikselach
+	static float hysteresis;    // względny zapas przy przejściu na prostszy poziom
+
+	// Wywoływane z reshape - ta sama projekcja co gluPerspective
+	static void setProjection(float fovY, int viewportHeight)
+	{
+		projectionScale = (float)viewportHeight / (2.0f * tan(glm::radians(fovY) * 0.5f));
+	}
+
+	// Błąd w pikselach dla błędu geometrycznego w danej odległości od kamery
+	static float pixelError(float error, float distance)
+	{
+		return error * projectionScale / std::max(distance, 1e-3f);
+	}
+
+	// Promień sfery otaczającej w pikselach
+	static float projectedSize(float radius, float distance)
+	{
+		return pixelError(radius, distance);
+	}
+
+	// scale - skala obiektu w świecie (błędy poziomów są w jednostkach siatki)
+	static int select(const LODMesh& mesh, const glm::vec3& worldCenter, const glm::vec3& eye, float scale, LODState& state)
+	{
+		if (mesh.levels.empty())
+		{
+			return 0;
+		}
+
+		float distance = glm::length(worldCenter - eye);
+		int last = (int)mesh.levels.size() - 1;
+
+		// najprostszy poziom mieszczący się w progu
+		int target = 0;
+		for (int i = last; i >= 0; i--)
+		{
+			if (pixelError(mesh.levels[i].error * scale, distance) <= maxPixelError)
+			{
+				target = i;
+				break;
+			}
+		}
+
+		if (state.level < 0 || state.level > last)
+		{
+			state.level = target;
+		}
+		else if (target < state.level)
+		{
+			// aktualny poziom przekracza próg - od razu dokładniejszy
+			state.level = target;
+		}
+		else if (target > state.level)
+		{
+			// prostszy poziom tylko z zapasem
+			float threshold = maxPixelError * (1.0f - hysteresis);
+			for (int i = target; i > state.level; i--)
+			{
+				if (pixelError(mesh.levels[i].error * scale, distance) <= threshold)
+				{
+					state.level = i;
+					break;
+				}
+			}
+		}
+
+		return state.level;
+	}
+
+private:
+	static float projectionScale;
+};
+
+float LODSelector::maxPixelError = 1.0f;
+float LODSelector::hysteresis = 0.25f;
+float LODSelector::projectionScale = WINDOW_HEIGHT / (2.0f * tan(glm::radians(FIELD_OF_VIEW) * 0.5f));
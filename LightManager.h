@@ -0,0 +1,704 @@
+﻿#pragma once
+#include "includy.h"
+#include "Frustum.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIGHTS_SSE2
+#include <emmintrin.h>
+#endif
+
+enum class LightType : uint8_t
+{
+	Point,
+	Spot,
+	Directional
+};
+
+/**
+* @struct LightDesc
+* @brief Opis światła przekazywany do LightManager (kąty stożka w stopniach)
+*/
+struct LightDesc
+{
+	LightType type = LightType::Point;
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f); // reflektor i światło kierunkowe
+	glm::vec3 color = glm::vec3(1.0f);                 // rozproszone i odbite
+	glm::vec3 ambient = glm::vec3(0.0f);
+	float intensity = 1.0f;
+	float range = 10.0f;       // poza zasięgiem światło nie jest przypisywane
+	float innerAngle = 20.0f;
+	float outerAngle = 30.0f;
+
+	static LightDesc point(const glm::vec3& position, const glm::vec3& color, float range)
+	{
+		LightDesc desc;
+		desc.position = position;
+		desc.color = color;
+		desc.range = range;
+		return desc;
+	}
+
+	static LightDesc spot(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color, float range, float outerAngle)
+	{
+		LightDesc desc = point(position, color, range);
+		desc.type = LightType::Spot;
+		desc.direction = glm::normalize(direction);
+		desc.outerAngle = outerAngle;
+		desc.innerAngle = outerAngle * 0.75f;
+		return desc;
+	}
+
+	static LightDesc directional(const glm::vec3& direction, const glm::vec3& color)
+	{
+		LightDesc desc;
+		desc.type = LightType::Directional;
+		desc.direction = glm::normalize(direction);
+		desc.color = color;
+		return desc;
+	}
+};
+
+typedef uint32_t LightId;
+
+/**
+* @struct LightingStats
+* @brief Liczniki ostatniej klatki
+*/
+struct LightingStats
+{
+	size_t lights = 0;
+	size_t visible = 0;
+	size_t binds = 0;        // wywołania bind()
+	size_t slotChanges = 0;  // zmiany świateł w slotach GL
+	float cullMs = 0.0f;
+};
+
+/**
+* @class LightManager
+* @brief Tysiące świateł trzymane jako struktura tablic (pozycje i zasięgi obok siebie dla testu SSE2).
+* Co klatkę światła są odrzucane względem ostrosłupa widzenia i wkładane do siatki przestrzennej,
+* a każdy obiekt dostaje kilka najważniejszych świateł (jasność po osłabieniu z odległością)
+* w slotach GL_LIGHT0..GL_LIGHTn. Sloty, w których światło się nie zmieniło, nie są ustawiane ponownie
+*/
+class LightManager
+{
+public:
+	static const LightId InvalidLight = 0xFFFFFFFFu;
+	static constexpr float AttenuationScale = 25.0f; // osłabienie 1 / (1 + 25 (d / zasięg)^2)
+	static int maxLightsPerObject; // 0 - wszystkie sloty GL_MAX_LIGHTS
+
+	static LightId add(const LightDesc& desc)
+	{
+		LightId id;
+		if (!freeIds.empty())
+		{
+			id = freeIds.back();
+			freeIds.pop_back();
+		}
+		else
+		{
+			id = (LightId)slotOf.size();
+			slotOf.push_back(InvalidLight);
+		}
+
+		slotOf[id] = (uint32_t)ids.size();
+		ids.push_back(id);
+		posX.push_back(0.0f); posY.push_back(0.0f); posZ.push_back(0.0f); range.push_back(0.0f);
+		dirX.push_back(0.0f); dirY.push_back(0.0f); dirZ.push_back(0.0f);
+		cosInner.push_back(0.0f); cosOuter.push_back(0.0f);
+		colorR.push_back(0.0f); colorG.push_back(0.0f); colorB.push_back(0.0f); intensity.push_back(0.0f);
+		ambient.push_back(glm::vec3(0.0f));
+		types.push_back(LightType::Point);
+		enabled.push_back(1);
+		store(slotOf[id], desc);
+		return id;
+	}
+
+	// Usunięcie przez przeniesienie ostatniego światła na zwolnione miejsce
+	static void remove(LightId id)
+	{
+		if (!valid(id))
+		{
+			return;
+		}
+
+		uint32_t index = slotOf[id];
+		uint32_t last = (uint32_t)ids.size() - 1;
+		if (index != last)
+		{
+			moveLight(last, index);
+			slotOf[ids[index]] = index;
+		}
+		popLight();
+		slotOf[id] = InvalidLight;
+		freeIds.push_back(id);
+		invalidateSlots();
+	}
+
+	static void update(LightId id, const LightDesc& desc)
+	{
+		if (valid(id))
+		{
+			store(slotOf[id], desc);
+			invalidateSlots();
+		}
+	}
+
+	static void setPosition(LightId id, const glm::vec3& position)
+	{
+		if (valid(id))
+		{
+			uint32_t i = slotOf[id];
+			posX[i] = position.x;
+			posY[i] = position.y;
+			posZ[i] = position.z;
+			invalidateSlots();
+		}
+	}
+
+	static void setEnabled(LightId id, bool on)
+	{
+		if (valid(id))
+		{
+			enabled[slotOf[id]] = on ? 1 : 0;
+		}
+	}
+
+	static LightDesc desc(LightId id)
+	{
+		LightDesc result;
+		if (!valid(id))
+		{
+			return result;
+		}
+
+		uint32_t i = slotOf[id];
+		result.type = types[i];
+		result.position = glm::vec3(posX[i], posY[i], posZ[i]);
+		result.direction = glm::vec3(dirX[i], dirY[i], dirZ[i]);
+		result.color = glm::vec3(colorR[i], colorG[i], colorB[i]);
+		result.ambient = ambient[i];
+		result.intensity = intensity[i];
+		result.range = types[i] == LightType::Directional ? 0.0f : range[i];
+		result.innerAngle = glm::degrees(acos(cosInner[i]));
+		result.outerAngle = glm::degrees(acos(cosOuter[i]));
+		return result;
+	}
+
+	static bool valid(LightId id)
+	{
+		return id < slotOf.size() && slotOf[id] != InvalidLight;
+	}
+
+	static size_t count()
+	{
+		return ids.size();
+	}
+
+	static void clear()
+	{
+		while (!ids.empty())
+		{
+			remove(ids.back());
+		}
+	}
+
+	// Początek klatki: odrzucenie świateł poza widokiem i zbudowanie siatki widocznych
+	static void beginFrame(const glm::mat4& viewMatrix, const glm::mat4& projection)
+	{
+		PROFILE_ZONE("LightManager::beginFrame");
+		auto start = chrono::steady_clock::now();
+		view = viewMatrix;
+		frame = LightingStats();
+		frame.lights = ids.size();
+		framing = true;
+
+		if (slotCount == 0)
+		{
+			GLint lights = 8;
+			glGetIntegerv(GL_MAX_LIGHTS, &lights);
+			slotCount = std::max(1, (int)lights);
+			slotLights.assign(slotCount, InvalidLight);
+		}
+		invalidateSlots();
+
+		cull(Frustum::fromMatrix(projection * viewMatrix));
+		buildGrid();
+		frame.visible = visible.size();
+		frame.cullMs = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+	}
+
+	// Wyłączenie slotów po narysowaniu sceny
+	static void endFrame()
+	{
+		invalidateSlots();
+		framing = false;
+	}
+
+	static bool active()
+	{
+		return framing;
+	}
+
+	// Liczba świateł ustawionych ostatnim bind - zajmują sloty od GL_LIGHT0 bez przerw (dla shaderów)
+	static int boundCount()
+	{
+		int count = 0;
+		while (framing && count < slotCount && slotLights[count] != InvalidLight)
+		{
+			count++;
+		}
+		return count;
+	}
+
+	// Światło ustawione ostatnim bind w slocie GL_LIGHT0 + slot (InvalidLight - slot wolny)
+	static LightId slotLight(int slot)
+	{
+		return framing && slot >= 0 && slot < slotCount ? slotLights[slot] : InvalidLight;
+	}
+
+	// Indeksy (w tablicach) świateł widocznych w tej klatce
+	static const vector<uint32_t>& visibleLights()
+	{
+		return visible;
+	}
+
+	// Identyfikator światła pod indeksem z visibleLights()
+	static LightId idOf(uint32_t index)
+	{
+		return index < ids.size() ? ids[index] : InvalidLight;
+	}
+
+	// Najważniejsze światła dla sfery obiektu, od najjaśniejszego; zwraca ich liczbę
+	static size_t select(const glm::vec3& center, float radius, uint32_t* out, size_t maxCount)
+	{
+		candidates.clear();
+		stampValue++;
+		if (stamp.size() < ids.size())
+		{
+			stamp.resize(ids.size(), 0);
+		}
+
+		for (uint32_t i : unbounded)
+		{
+			consider(i, center, radius);
+		}
+
+		glm::ivec3 low = cellOf(center - glm::vec3(radius)), high = cellOf(center + glm::vec3(radius));
+		long long cells = (long long)(high.x - low.x + 1) * (high.y - low.y + 1) * (high.z - low.z + 1);
+		if (cells > (long long)visible.size())
+		{
+			// obiekt większy od siatki - prościej sprawdzić wszystkie widoczne
+			for (uint32_t i : visible)
+			{
+				consider(i, center, radius);
+			}
+		}
+		else if (!grid.empty())
+		{
+			for (int z = low.z; z <= high.z; z++)
+			{
+				for (int y = low.y; y <= high.y; y++)
+				{
+					for (int x = low.x; x <= high.x; x++)
+					{
+						uint64_t key = cellKey(x, y, z);
+						auto it = lower_bound(grid.begin(), grid.end(), make_pair(key, 0u));
+						for (; it != grid.end() && it->first == key; ++it)
+						{
+							consider(it->second, center, radius);
+						}
+					}
+				}
+			}
+		}
+
+		size_t result = std::min(maxCount, candidates.size());
+		partial_sort(candidates.begin(), candidates.begin() + result, candidates.end(),
+			[](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+		for (size_t i = 0; i < result; i++)
+		{
+			out[i] = candidates[i].light;
+		}
+		return result;
+	}
+
+	// Przypisanie świateł obiektowi - wywoływane przed jego rysowaniem
+	static void bind(const glm::vec3& center, float radius)
+	{
+		if (!framing)
+		{
+			return;
+		}
+		frame.binds++;
+
+		int slots = maxLightsPerObject > 0 ? std::min(maxLightsPerObject, slotCount) : slotCount;
+		uint32_t chosen[32];
+		size_t count = select(center, radius, chosen, std::min(slots, 32));
+
+		bool pushed = false;
+		for (int slot = 0; slot < slotCount; slot++)
+		{
+			LightId id = slot < (int)count ? ids[chosen[slot]] : InvalidLight;
+			if (id == slotLights[slot])
+			{
+				continue;
+			}
+
+			slotLights[slot] = id;
+			frame.slotChanges++;
+			PerfCounters::add(PerfCounters::StateChanges);
+			if (id == InvalidLight)
+			{
+				glDisable(GL_LIGHT0 + slot);
+				continue;
+			}
+
+			if (!pushed)
+			{
+				// pozycje świateł przekształcane są przez aktualną macierz - tylko macierz widoku
+				glMatrixMode(GL_MODELVIEW);
+				glPushMatrix();
+				glLoadMatrixf(glm::value_ptr(view));
+				pushed = true;
+			}
+			setupSlot(GL_LIGHT0 + slot, chosen[slot]);
+			glEnable(GL_LIGHT0 + slot);
+		}
+
+		if (pushed)
+		{
+			glPopMatrix();
+		}
+	}
+
+	// Dane świateł dla shadera: 4 x vec4 na światło (pozycja + zasięg, kolor * natężenie + typ,
+	// kierunek + cos zewnętrzny, otoczenie + cos wewnętrzny), pozycje w przestrzeni świata
+	static void packUniforms(const uint32_t* lights, size_t count, vector<glm::vec4>& out)
+	{
+		out.clear();
+		out.reserve(count * 4);
+		for (size_t n = 0; n < count; n++)
+		{
+			uint32_t i = lights[n];
+			out.push_back(glm::vec4(posX[i], posY[i], posZ[i], types[i] == LightType::Directional ? 0.0f : range[i]));
+			out.push_back(glm::vec4(colorR[i] * intensity[i], colorG[i] * intensity[i], colorB[i] * intensity[i], (float)types[i]));
+			out.push_back(glm::vec4(dirX[i], dirY[i], dirZ[i], cosOuter[i]));
+			out.push_back(glm::vec4(ambient[i], cosInner[i]));
+		}
+	}
+
+	static LightingStats stats()
+	{
+		return frame;
+	}
+
+private:
+	struct Candidate
+	{
+		uint32_t light;
+		float score;
+	};
+
+	// dane gorące (odrzucanie, wybór) - osobne tablice
+	static vector<float> posX, posY, posZ, range;
+	static vector<float> dirX, dirY, dirZ, cosInner, cosOuter;
+	static vector<float> colorR, colorG, colorB, intensity;
+	static vector<glm::vec3> ambient;
+	static vector<LightType> types;
+	static vector<uint8_t> enabled;
+
+	static vector<LightId> ids;       // indeks -> identyfikator
+	static vector<uint32_t> slotOf;   // identyfikator -> indeks
+	static vector<LightId> freeIds;
+
+	static vector<uint32_t> visible;
+	static vector<uint32_t> unbounded;             // kierunkowe i bardzo duże - sprawdzane dla każdego obiektu
+	static vector<pair<uint64_t, uint32_t>> grid;  // (komórka, światło) posortowane wg komórki
+	static float cellSize;
+	static vector<uint32_t> stamp;
+	static uint32_t stampValue;
+	static vector<Candidate> candidates;
+
+	static glm::mat4 view;
+	static int slotCount;
+	static vector<LightId> slotLights; // światło ustawione w slocie GL
+	static bool framing;
+	static LightingStats frame;
+
+	static const int MaxCellsPerLight = 64;
+	static constexpr float DirectionalRange = 1e30f;
+
+	static void store(uint32_t i, const LightDesc& desc)
+	{
+		types[i] = desc.type;
+		posX[i] = desc.position.x;
+		posY[i] = desc.position.y;
+		posZ[i] = desc.position.z;
+		range[i] = desc.type == LightType::Directional ? DirectionalRange : std::max(desc.range, 1e-3f);
+		glm::vec3 direction = glm::normalize(desc.direction);
+		dirX[i] = direction.x;
+		dirY[i] = direction.y;
+		dirZ[i] = direction.z;
+		cosInner[i] = cos(glm::radians(std::min(desc.innerAngle, desc.outerAngle)));
+		cosOuter[i] = cos(glm::radians(std::min(desc.outerAngle, 90.0f)));
+		colorR[i] = desc.color.x;
+		colorG[i] = desc.color.y;
+		colorB[i] = desc.color.z;
+		intensity[i] = desc.intensity;
+		ambient[i] = desc.ambient;
+	}
+
+	static void moveLight(uint32_t from, uint32_t to)
+	{
+		ids[to] = ids[from];
+		posX[to] = posX[from]; posY[to] = posY[from]; posZ[to] = posZ[from]; range[to] = range[from];
+		dirX[to] = dirX[from]; dirY[to] = dirY[from]; dirZ[to] = dirZ[from];
+		cosInner[to] = cosInner[from]; cosOuter[to] = cosOuter[from];
+		colorR[to] = colorR[from]; colorG[to] = colorG[from]; colorB[to] = colorB[from]; intensity[to] = intensity[from];
+		ambient[to] = ambient[from];
+		types[to] = types[from];
+		enabled[to] = enabled[from];
+	}
+
+	static void popLight()
+	{
+		ids.pop_back();
+		posX.pop_back(); posY.pop_back(); posZ.pop_back(); range.pop_back();
+		dirX.pop_back(); dirY.pop_back(); dirZ.pop_back();
+		cosInner.pop_back(); cosOuter.pop_back();
+		colorR.pop_back(); colorG.pop_back(); colorB.pop_back(); intensity.pop_back();
+		ambient.pop_back();
+		types.pop_back();
+		enabled.pop_back();
+	}
+
+	// Zmiana świateł (usunięcie, przesunięcie) - sloty trzeba ustawić od nowa. Zajęte sloty są od razu
+	// wyłączane, bo bind() traktuje InvalidLight jako slot już wyłączony
+	static void invalidateSlots()
+	{
+		for (int slot = 0; slot < slotCount; slot++)
+		{
+			if (slotLights[slot] != InvalidLight)
+			{
+				glDisable(GL_LIGHT0 + slot);
+				slotLights[slot] = InvalidLight;
+			}
+		}
+	}
+
+	// Sfera światła a 6 płaszczyzn, 4 światła naraz
+	static void cull(const Frustum& frustum)
+	{
+		visible.clear();
+		size_t n = ids.size();
+		size_t i = 0;
+#ifdef LIGHTS_SSE2
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(&posX[i]), y = _mm_loadu_ps(&posY[i]), z = _mm_loadu_ps(&posZ[i]);
+			__m128 negativeRange = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&range[i]));
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRange));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			for (int k = 0; k < 4; k++)
+			{
+				if ((mask >> k) & 1 && enabled[i + k])
+				{
+					visible.push_back((uint32_t)(i + k));
+				}
+			}
+		}
+#endif
+		for (; i < n; i++)
+		{
+			if (enabled[i] && frustum.intersectsSphere(glm::vec3(posX[i], posY[i], posZ[i]), range[i]))
+			{
+				visible.push_back((uint32_t)i);
+			}
+		}
+	}
+
+	// Siatka widocznych świateł o boku ~ średnicy typowego światła - obiekt sprawdza tylko swoje komórki
+	static void buildGrid()
+	{
+		grid.clear();
+		unbounded.clear();
+
+		float total = 0.0f;
+		size_t bounded = 0;
+		for (uint32_t i : visible)
+		{
+			if (types[i] != LightType::Directional)
+			{
+				total += range[i];
+				bounded++;
+			}
+		}
+		if (bounded == 0)
+		{
+			unbounded = visible;
+			return;
+		}
+		cellSize = std::max(2.0f * total / bounded, 1e-2f);
+
+		for (uint32_t i : visible)
+		{
+			glm::vec3 position(posX[i], posY[i], posZ[i]);
+			if (types[i] == LightType::Directional)
+			{
+				unbounded.push_back(i);
+				continue;
+			}
+
+			glm::ivec3 low = cellOf(position - glm::vec3(range[i])), high = cellOf(position + glm::vec3(range[i]));
+			long long cells = (long long)(high.x - low.x + 1) * (high.y - low.y + 1) * (high.z - low.z + 1);
+			if (cells > MaxCellsPerLight)
+			{
+				unbounded.push_back(i);
+				continue;
+			}
+
+			for (int z = low.z; z <= high.z; z++)
+			{
+				for (int y = low.y; y <= high.y; y++)
+				{
+					for (int x = low.x; x <= high.x; x++)
+					{
+						grid.push_back(make_pair(cellKey(x, y, z), i));
+					}
+				}
+			}
+		}
+		sort(grid.begin(), grid.end());
+	}
+
+	static glm::ivec3 cellOf(const glm::vec3& p)
+	{
+		return glm::ivec3((int)floor(p.x / cellSize), (int)floor(p.y / cellSize), (int)floor(p.z / cellSize));
+	}
+
+	static uint64_t cellKey(int x, int y, int z)
+	{
+		const uint64_t mask = (1u << 21) - 1;
+		return (((uint64_t)x & mask) << 42) | (((uint64_t)y & mask) << 21) | ((uint64_t)z & mask);
+	}
+
+	// Ocena światła dla sfery obiektu (pomijane, jeśli do niej nie sięga)
+	static void consider(uint32_t i, const glm::vec3& center, float radius)
+	{
+		if (stamp[i] == stampValue)
+		{
+			return;
+		}
+		stamp[i] = stampValue;
+
+		float brightness = intensity[i] * (0.2126f * colorR[i] + 0.7152f * colorG[i] + 0.0722f * colorB[i]);
+		if (types[i] == LightType::Directional)
+		{
+			candidates.push_back({ i, brightness });
+			return;
+		}
+
+		glm::vec3 toObject = center - glm::vec3(posX[i], posY[i], posZ[i]);
+		float distance = glm::length(toObject);
+		float surface = std::max(distance - radius, 0.0f);
+		if (surface > range[i])
+		{
+			return;
+		}
+
+		if (types[i] == LightType::Spot && distance > radius)
+		{
+			// kąt do środka obiektu pomniejszony o kątowy promień sfery
+			float cosAngle = glm::dot(toObject / distance, glm::vec3(dirX[i], dirY[i], dirZ[i]));
+			float angle = acos(glm::clamp(cosAngle, -1.0f, 1.0f)) - asin(std::min(radius / distance, 1.0f));
+			if (angle > acos(cosOuter[i]))
+			{
+				return;
+			}
+		}
+
+		float ratio = surface / range[i];
+		float attenuation = (1.0f - ratio * ratio) / (1.0f + AttenuationScale * ratio * ratio);
+		candidates.push_back({ i, brightness * attenuation });
+	}
+
+	static void setupSlot(GLenum slot, uint32_t i)
+	{
+		GLfloat diffuse[] = { colorR[i] * intensity[i], colorG[i] * intensity[i], colorB[i] * intensity[i], 1.0f };
+		GLfloat ambientColor[] = { ambient[i].x, ambient[i].y, ambient[i].z, 1.0f };
+		glLightfv(slot, GL_AMBIENT, ambientColor);
+		glLightfv(slot, GL_DIFFUSE, diffuse);
+		glLightfv(slot, GL_SPECULAR, diffuse);
+
+		if (types[i] == LightType::Directional)
+		{
+			GLfloat direction[] = { -dirX[i], -dirY[i], -dirZ[i], 0.0f };
+			glLightfv(slot, GL_POSITION, direction);
+			glLightf(slot, GL_SPOT_CUTOFF, 180.0f);
+			glLightf(slot, GL_CONSTANT_ATTENUATION, 1.0f);
+			glLightf(slot, GL_QUADRATIC_ATTENUATION, 0.0f);
+			return;
+		}
+
+		GLfloat position[] = { posX[i], posY[i], posZ[i], 1.0f };
+		glLightfv(slot, GL_POSITION, position);
+		glLightf(slot, GL_CONSTANT_ATTENUATION, 1.0f);
+		glLightf(slot, GL_LINEAR_ATTENUATION, 0.0f);
+		glLightf(slot, GL_QUADRATIC_ATTENUATION, AttenuationScale / (range[i] * range[i]));
+
+		if (types[i] == LightType::Spot)
+		{
+			// wykładnik tak, żeby na krawędzi stożka zostało ~10% światła
+			GLfloat direction[] = { dirX[i], dirY[i], dirZ[i] };
+			float exponent = cosOuter[i] < 0.999f ? log(0.1f) / log(std::max(cosOuter[i], 1e-3f)) : 0.0f;
+			glLightfv(slot, GL_SPOT_DIRECTION, direction);
+			glLightf(slot, GL_SPOT_CUTOFF, glm::degrees(acos(cosOuter[i])));
+			glLightf(slot, GL_SPOT_EXPONENT, std::min(exponent, 128.0f));
+		}
+		else
+		{
+			glLightf(slot, GL_SPOT_CUTOFF, 180.0f);
+		}
+	}
+};
+
+const LightId LightManager::InvalidLight;
+int LightManager::maxLightsPerObject = 0;
+vector<float> LightManager::posX, LightManager::posY, LightManager::posZ, LightManager::range;
+vector<float> LightManager::dirX, LightManager::dirY, LightManager::dirZ, LightManager::cosInner, LightManager::cosOuter;
+vector<float> LightManager::colorR, LightManager::colorG, LightManager::colorB, LightManager::intensity;
+vector<glm::vec3> LightManager::ambient;
+vector<LightType> LightManager::types;
+vector<uint8_t> LightManager::enabled;
+vector<LightId> LightManager::ids;
+vector<uint32_t> LightManager::slotOf;
+vector<LightId> LightManager::freeIds;
+vector<uint32_t> LightManager::visible;
+vector<uint32_t> LightManager::unbounded;
+vector<pair<uint64_t, uint32_t>> LightManager::grid;
+float LightManager::cellSize = 1.0f;
+vector<uint32_t> LightManager::stamp;
+uint32_t LightManager::stampValue = 0;
+vector<LightManager::Candidate> LightManager::candidates;
+glm::mat4 LightManager::view = glm::mat4(1.0f);
+int LightManager::slotCount = 0;
+vector<LightId> LightManager::slotLights;
+bool LightManager::framing = false;
+LightingStats LightManager::frame;
+constexpr float LightManager::DirectionalRange;
+constexpr float LightManager::AttenuationScale;
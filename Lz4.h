@@ -0,0 +1,233 @@
+﻿#pragma once
+#include "includy.h"
+#include <cstdint>
+#include <cstring>
+
+/**
+* @class Lz4
+* @brief Kompresja blokowa w formacie LZ4 (token, literały, przesunięcie 16-bit, długość dopasowania).
+* Kompresor zachłanny z tablicą skrótów, dekompresor sprawdza wszystkie zakresy - uszkodzone dane
+* dają false, a nie zapis poza bufor
+*/
+class Lz4
+{
+public:
+	// Największy możliwy rozmiar wyniku kompresji
+	static size_t bound(size_t size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	// Kompresja do dst (co najmniej bound(size) bajtów), zwraca rozmiar wyniku
+	static size_t compress(const uint8_t* src, size_t size, uint8_t* dst)
+	{
+		const uint8_t* ip = src;
+		const uint8_t* anchor = src;
+		const uint8_t* end = src + size;
+		uint8_t* op = dst;
+
+		if (size >= MinInput)
+		{
+			const uint8_t* matchLimit = end - LastLiterals;
+			const uint8_t* inputLimit = end - MinInput + 1;
+			vector<uint32_t> table(1 << HashLog, 0);
+
+			table[hash(read32(ip))] = 0;
+			ip++;
+			while (ip < inputLimit)
+			{
+				uint32_t sequence = read32(ip);
+				uint32_t& slot = table[hash(sequence)];
+				const uint8_t* ref = src + slot;
+				slot = (uint32_t)(ip - src);
+
+				if (ref >= ip || ip - ref > MaxOffset || read32(ref) != sequence)
+				{
+					// przyspieszenie na danych nieściśliwych
+					ip += 1 + ((ip - anchor) >> SkipShift);
+					continue;
+				}
+
+				while (ip > anchor && ref > src && ip[-1] == ref[-1])
+				{
+					ip--;
+					ref--;
+				}
+
+				const uint8_t* matchEnd = ip + MinMatch;
+				const uint8_t* refEnd = ref + MinMatch;
+				while (matchEnd < matchLimit && *matchEnd == *refEnd)
+				{
+					matchEnd++;
+					refEnd++;
+				}
+
+				op = emit(op, anchor, (size_t)(ip - anchor), (uint32_t)(ip - ref), (size_t)(matchEnd - ip));
+				ip = matchEnd;
+				anchor = ip;
+				if (ip < inputLimit)
+				{
+					table[hash(read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+				}
+			}
+		}
+
+		return (size_t)(emit(op, anchor, (size_t)(end - anchor), 0, 0) - dst);
+	}
+
+	// Dekompresja bloku o znanym rozmiarze wyniku
+	static bool decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dstSize)
+	{
+		const uint8_t* ip = src;
+		const uint8_t* ipEnd = src + size;
+		uint8_t* op = dst;
+		uint8_t* opEnd = dst + dstSize;
+
+		while (ip < ipEnd)
+		{
+			uint8_t token = *ip++;
+			size_t literals = token >> 4;
+			if (literals == 15 && !readLength(ip, ipEnd, literals))
+			{
+				return false;
+			}
+			if (literals > (size_t)(ipEnd - ip) || literals > (size_t)(opEnd - op))
+			{
+				return false;
+			}
+			if (literals > 0)
+			{
+				memcpy(op, ip, literals); // pusty wynik może mieć dst == nullptr
+			}
+			op += literals;
+			ip += literals;
+
+			if (ip == ipEnd)
+			{
+				break; // ostatnia sekwencja ma same literały
+			}
+			if (ipEnd - ip < 2)
+			{
+				return false;
+			}
+
+			size_t offset = ip[0] | (ip[1] << 8);
+			ip += 2;
+			if (offset == 0 || offset > (size_t)(op - dst))
+			{
+				return false;
+			}
+
+			size_t length = token & 15;
+			if (length == 15 && !readLength(ip, ipEnd, length))
+			{
+				return false;
+			}
+			length += MinMatch;
+			if (length > (size_t)(opEnd - op))
+			{
+				return false;
+			}
+
+			const uint8_t* ref = op - offset;
+			if (offset >= 8 && length + 8 <= (size_t)(opEnd - op))
+			{
+				// kopiowanie po 8 bajtów, nadmiar zostanie nadpisany kolejnymi danymi
+				uint8_t* copyEnd = op + length;
+				while (op < copyEnd)
+				{
+					memcpy(op, ref, 8);
+					op += 8;
+					ref += 8;
+				}
+				op = copyEnd;
+			}
+			else
+			{
+				// nakładające się dopasowanie (np. powtórzenia) - bajt po bajcie
+				for (size_t i = 0; i < length; i++)
+				{
+					op[i] = ref[i];
+				}
+				op += length;
+			}
+		}
+		return op == opEnd;
+	}
+
+private:
+	static const int HashLog = 14;
+	static const int SkipShift = 6;
+	static const size_t MinMatch = 4;
+	static const size_t LastLiterals = 5; // wymagania formatu: ostatnie 5 bajtów to literały,
+	static const size_t MinInput = 13;    // a ostatnie dopasowanie zaczyna się co najmniej 12 bajtów przed końcem
+	static const ptrdiff_t MaxOffset = 65535;
+
+	static uint32_t read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, 4);
+		return value;
+	}
+
+	static uint32_t hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashLog);
+	}
+
+	static uint8_t* writeLength(uint8_t* op, size_t length)
+	{
+		for (; length >= 255; length -= 255)
+		{
+			*op++ = 255;
+		}
+		*op++ = (uint8_t)length;
+		return op;
+	}
+
+	static bool readLength(const uint8_t*& ip, const uint8_t* ipEnd, size_t& length)
+	{
+		uint8_t byte;
+		do
+		{
+			if (ip >= ipEnd)
+			{
+				return false;
+			}
+			byte = *ip++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	// Sekwencja: literały i dopasowanie (matchLength == 0 - tylko literały, koniec bloku)
+	static uint8_t* emit(uint8_t* op, const uint8_t* literals, size_t literalLength, uint32_t offset, size_t matchLength)
+	{
+		uint8_t* token = op++;
+		*token = (uint8_t)(std::min<size_t>(literalLength, 15) << 4);
+		if (literalLength >= 15)
+		{
+			op = writeLength(op, literalLength - 15);
+		}
+		if (literalLength > 0)
+		{
+			memcpy(op, literals, literalLength); // pusty blok wejściowy może mieć literals == nullptr
+		}
+		op += literalLength;
+
+		if (matchLength == 0)
+		{
+			return op;
+		}
+
+		*op++ = (uint8_t)offset;
+		*op++ = (uint8_t)(offset >> 8);
+		size_t length = matchLength - MinMatch;
+		*token |= (uint8_t)std::min<size_t>(length, 15);
+		if (length >= 15)
+		{
+			op = writeLength(op, length - 15);
+		}
+		return op;
+	}
+};
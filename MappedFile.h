@@ -0,0 +1,167 @@
+﻿#pragma once
+#include "includy.h"
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+* @class MappedFile
+* @brief Plik zmapowany w pamięci tylko do odczytu (MapViewOfFile / mmap).
+* Dane czytane są bezpośrednio ze stron pliku, bez kopiowania do bufora
+*/
+class MappedFile
+{
+public:
+	MappedFile() {}
+
+	explicit MappedFile(const string& path)
+	{
+		open(path);
+	}
+
+	~MappedFile()
+	{
+		close();
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other)
+	{
+		*this = std::move(other);
+	}
+
+	MappedFile& operator=(MappedFile&& other)
+	{
+		if (this != &other)
+		{
+			close();
+			std::swap(bytes, other.bytes);
+			std::swap(length, other.length);
+#ifdef _WIN32
+			std::swap(file, other.file);
+			std::swap(mapping, other.mapping);
+#endif
+		}
+		return *this;
+	}
+
+	bool open(const string& path)
+	{
+		close();
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			close();
+			return false;
+		}
+		length = (size_t)fileSize.QuadPart;
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+		{
+			close();
+			return false;
+		}
+
+		bytes = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			::close(fd);
+			return false;
+		}
+		length = (size_t)info.st_size;
+
+		void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd); // mapowanie pozostaje ważne po zamknięciu deskryptora
+		bytes = view == MAP_FAILED ? nullptr : (const uint8_t*)view;
+#endif
+		if (!bytes)
+		{
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (bytes) UnmapViewOfFile(bytes);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (bytes) munmap((void*)bytes, length);
+#endif
+		bytes = nullptr;
+		length = 0;
+	}
+
+	// Wczytanie stron zakresu z dysku, żeby późniejszy odczyt (np. na wątku renderowania) nie czekał na I/O
+	void prefetch(size_t offset, size_t count) const
+	{
+		if (!bytes || offset >= length)
+		{
+			return;
+		}
+		count = std::min(count, length - offset);
+
+		volatile uint8_t sink = 0;
+		for (size_t i = 0; i < count; i += 4096)
+		{
+			sink ^= bytes[offset + i];
+		}
+		if (count > 0)
+		{
+			sink ^= bytes[offset + count - 1];
+		}
+	}
+
+	bool isOpen() const
+	{
+		return bytes != nullptr;
+	}
+
+	const uint8_t* data() const
+	{
+		return bytes;
+	}
+
+	size_t size() const
+	{
+		return length;
+	}
+
+private:
+	const uint8_t* bytes = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#endif
+};
@@ -0,0 +1,351 @@
+﻿#pragma once
+#include "includy.h"
+#include "TextureCache.h"
+#include "PerfCounters.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+/**
+* @struct MaterialDesc
+* @brief Opis materiału: parametry glMaterial, śledzenie koloru wierzchołków (GL_COLOR_MATERIAL
+* dla otoczenia i rozproszenia) i tekstura (pełna ścieżka, pusta - bez tekstury).
+* Wartości domyślne to domyślny materiał OpenGL
+*/
+struct MaterialDesc
+{
+	glm::vec3 ambient = glm::vec3(0.2f);
+	glm::vec3 diffuse = glm::vec3(0.8f);
+	glm::vec3 specular = glm::vec3(0.0f);
+	float shininess = 0.0f;
+	bool vertexColor = false;
+	string texture;
+
+	bool operator==(const MaterialDesc& other) const
+	{
+		return ambient == other.ambient && diffuse == other.diffuse && specular == other.specular &&
+			shininess == other.shininess && vertexColor == other.vertexColor && texture == other.texture;
+	}
+
+	// FNV-1a po bitach parametrów i ścieżce tekstury
+	size_t hash() const
+	{
+		uint64_t value = 14695981039346656037ull;
+		auto mix = [&value](const void* data, size_t size)
+		{
+			const uint8_t* bytes = (const uint8_t*)data;
+			for (size_t i = 0; i < size; i++)
+			{
+				value = (value ^ bytes[i]) * 1099511628211ull;
+			}
+		};
+		float values[] = { ambient.x, ambient.y, ambient.z, diffuse.x, diffuse.y, diffuse.z,
+			specular.x, specular.y, specular.z, shininess, vertexColor ? 1.0f : 0.0f };
+		for (float& v : values)
+		{
+			v += 0.0f; // -0 i +0 dają ten sam skrót
+		}
+		mix(values, sizeof(values));
+		mix(texture.data(), texture.size());
+		return (size_t)value;
+	}
+};
+
+/**
+* @struct Material
+* @brief Niezmienny blok materiału w rejestrze - identyczne opisy współdzielą jeden blok
+*/
+struct Material
+{
+	const MaterialDesc desc;
+	const size_t hash;
+	const uint32_t id;      // kolejność rejestracji, klucz sortowania
+	TextureRef texture;
+	unsigned int refs = 0;
+
+	Material(const MaterialDesc& desc, size_t hash, uint32_t id) : desc(desc), hash(hash), id(id) {}
+};
+
+/**
+* @class MaterialRef
+* @brief Uchwyt do materiału z rejestru, zlicza referencje. Materiał bez uchwytów jest usuwany z rejestru
+* (razem z referencją do tekstury, która może wtedy trafić na listę LRU TextureCache)
+*/
+class MaterialRef
+{
+public:
+	MaterialRef() : material(nullptr) {}
+
+	MaterialRef(const MaterialRef& other) : material(other.material)
+	{
+		acquire();
+	}
+
+	MaterialRef(MaterialRef&& other) : material(other.material)
+	{
+		other.material = nullptr;
+	}
+
+	MaterialRef& operator=(MaterialRef other)
+	{
+		std::swap(material, other.material);
+		return *this;
+	}
+
+	~MaterialRef()
+	{
+		release();
+	}
+
+	const Material* get() const
+	{
+		return material;
+	}
+
+	explicit operator bool() const
+	{
+		return material != nullptr;
+	}
+
+	bool operator==(const MaterialRef& other) const
+	{
+		return material == other.material;
+	}
+
+	bool operator!=(const MaterialRef& other) const
+	{
+		return material != other.material;
+	}
+
+private:
+	friend class MaterialRegistry;
+
+	explicit MaterialRef(Material* material) : material(material)
+	{
+		acquire();
+	}
+
+	void acquire()
+	{
+		if (material)
+		{
+			material->refs++;
+		}
+	}
+
+	void release();
+
+	Material* material;
+};
+
+/**
+* @struct MaterialStats
+* @brief Liczniki ustawień materiału od ostatniego MaterialRegistry::beginFrame()
+*/
+struct MaterialStats
+{
+	size_t materials = 0;   // bloki w rejestrze
+	size_t binds = 0;       // wywołania bind
+	size_t changes = 0;     // bind, który zmienił stan GL
+	size_t glCalls = 0;     // glMaterial / glEnable / glBindTexture
+};
+
+/**
+* @class MaterialRegistry
+* @brief Rejestr materiałów - opis zamieniany jest na blok szukany po skrócie, więc obiekty o tym samym
+* materiale trzymają ten sam blok. bind() pamięta stan GL i wysyła tylko parametry, które się różnią,
+* a ponowne ustawienie tego samego materiału nie wywołuje GL wcale
+*/
+class MaterialRegistry
+{
+public:
+	// Wywoływane na wątku renderowania (tekstura przez TextureCache)
+	static MaterialRef get(const MaterialDesc& desc)
+	{
+		size_t hash = desc.hash();
+		vector<Material*>& bucket = blocks[hash];
+		for (Material* material : bucket)
+		{
+			if (material->desc == desc)
+			{
+				return MaterialRef(material);
+			}
+		}
+
+		Material* material = new Material(desc, hash, nextId++);
+		if (!desc.texture.empty())
+		{
+			material->texture = TextureCache::get(desc.texture);
+		}
+		bucket.push_back(material);
+		return MaterialRef(material);
+	}
+
+	// Początek klatki - stan GL mógł zostać zmieniony poza rejestrem
+	static void beginFrame()
+	{
+		counters = MaterialStats();
+		invalidate();
+	}
+
+	static void invalidate()
+	{
+		bound = nullptr;
+		stateValid = false;
+	}
+
+	static void bind(const MaterialRef& material)
+	{
+		bind(material.get());
+	}
+
+	static void bind(const Material* material)
+	{
+		counters.binds++;
+		if (!material)
+		{
+			return;
+		}
+
+		// tekstura wczytywana w tle jest pomijana do czasu, aż będzie gotowa
+		GLuint texture = material->texture.ready() ? material->texture.id() : 0;
+		if (material == bound && texture == boundTexture)
+		{
+			return;
+		}
+		counters.changes++;
+		PerfCounters::add(PerfCounters::StateChanges);
+
+		const MaterialDesc& desc = material->desc;
+		// GL_COLOR_MATERIAL nadpisuje otoczenie i rozproszenie kolorami wierzchołków - po jego wyłączeniu
+		// current ich nie opisuje i trzeba je wysłać ponownie (po glDisable, żeby nie zostały nadpisane)
+		bool vertexColorChanged = !stateValid || desc.vertexColor != current.vertexColor;
+		bool colorsDirty = !stateValid || (current.vertexColor && !desc.vertexColor);
+		if (vertexColorChanged)
+		{
+			if (desc.vertexColor)
+			{
+				glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+				glEnable(GL_COLOR_MATERIAL);
+			}
+			else
+			{
+				glDisable(GL_COLOR_MATERIAL);
+			}
+			counters.glCalls++;
+		}
+		if (colorsDirty || desc.ambient != current.ambient)
+		{
+			setColor(GL_AMBIENT, desc.ambient);
+		}
+		if (colorsDirty || desc.diffuse != current.diffuse)
+		{
+			setColor(GL_DIFFUSE, desc.diffuse);
+		}
+		if (!stateValid || desc.specular != current.specular)
+		{
+			setColor(GL_SPECULAR, desc.specular);
+		}
+		if (!stateValid || desc.shininess != current.shininess)
+		{
+			glMaterialf(GL_FRONT, GL_SHININESS, desc.shininess);
+			counters.glCalls++;
+		}
+		if (!stateValid || texture != boundTexture)
+		{
+			if (texture)
+			{
+				glEnable(GL_TEXTURE_2D);
+				TextureHandler::bind(texture);
+			}
+			else
+			{
+				glDisable(GL_TEXTURE_2D);
+			}
+			counters.glCalls++;
+		}
+
+		current.ambient = desc.ambient;
+		current.diffuse = desc.diffuse;
+		current.specular = desc.specular;
+		current.shininess = desc.shininess;
+		current.vertexColor = desc.vertexColor;
+		boundTexture = texture;
+		bound = material;
+		stateValid = true;
+	}
+
+	static size_t count()
+	{
+		size_t result = 0;
+		for (const auto& bucket : blocks)
+		{
+			result += bucket.second.size();
+		}
+		return result;
+	}
+
+	static MaterialStats stats()
+	{
+		MaterialStats result = counters;
+		result.materials = count();
+		return result;
+	}
+
+private:
+	friend class MaterialRef;
+
+	static unordered_map<size_t, vector<Material*>> blocks;
+	static uint32_t nextId;
+	static MaterialStats counters;
+
+	// stan GL ustawiony ostatnim bind (bez tekstury - ta w boundTexture)
+	static const Material* bound;
+	static MaterialDesc current;
+	static GLuint boundTexture;
+	static bool stateValid;
+
+	static void setColor(GLenum parameter, const glm::vec3& color)
+	{
+		GLfloat value[] = { color.x, color.y, color.z, 1.0f };
+		glMaterialfv(GL_FRONT, parameter, value);
+		counters.glCalls++;
+	}
+
+	static void destroy(Material* material)
+	{
+		auto it = blocks.find(material->hash);
+		if (it != blocks.end())
+		{
+			vector<Material*>& bucket = it->second;
+			bucket.erase(remove(bucket.begin(), bucket.end(), material), bucket.end());
+			if (bucket.empty())
+			{
+				blocks.erase(it);
+			}
+		}
+		if (bound == material)
+		{
+			bound = nullptr; // stan GL zostaje w current, kolejny blok pod tym adresem ustawi się od nowa
+		}
+		delete material;
+	}
+};
+
+inline void MaterialRef::release()
+{
+	if (material && --material->refs == 0)
+	{
+		MaterialRegistry::destroy(material);
+	}
+	material = nullptr;
+}
+
+unordered_map<size_t, vector<Material*>> MaterialRegistry::blocks;
+uint32_t MaterialRegistry::nextId = 0;
+MaterialStats MaterialRegistry::counters;
+const Material* MaterialRegistry::bound = nullptr;
+MaterialDesc MaterialRegistry::current;
+GLuint MaterialRegistry::boundTexture = 0;
+bool MaterialRegistry::stateValid = false;
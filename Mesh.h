@@ -0,0 +1,252 @@
+﻿#pragma once
+#include "includy.h"
+#include "PerfCounters.h"
+#include <algorithm>
+#include <mutex>
+
+/**
+* @struct Vertex
+* @brief Wierzchołek siatki - pozycja, normalna, kolor i współrzędne tekstury
+* Dane są przeplatane (jeden strumień), więc wystarczy jeden wskaźnik z odpowiednim krokiem
+*/
+struct Vertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec3 color;
+	glm::vec2 texCoord;
+};
+
+/**
+* @struct MeshLod
+* @brief Zakres indeksów jednego poziomu szczegółowości siatki
+* error - błąd geometryczny poziomu w jednostkach siatki (0 dla pełnej siatki)
+*/
+struct MeshLod
+{
+	unsigned int indexOffset;
+	unsigned int indexCount;
+	float error;
+};
+
+/**
+* @class Mesh
+* @brief Siatka indeksowana trzymana w pamięci - "retained" odpowiednik glBegin/glEnd
+* Przy pierwszym rysowaniu wierzchołki i indeksy są kompilowane do listy wyświetlania (osobnej dla każdego poziomu LOD),
+* kolejne klatki wywołują już tylko glCallList bez ponownego przesyłania geometrii
+*/
+class Mesh
+{
+public:
+	vector<Vertex> vertices;
+	vector<unsigned int> indices;
+
+	// Poziomy szczegółowości dzielące wspólne wierzchołki, puste - jeden poziom ze wszystkimi indeksami
+	vector<MeshLod> lods;
+
+	// false - siatka nie ma własnych kolorów i używa aktualnego glColor (jak bryły GLUT)
+	bool hasColors = true;
+
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+
+	Mesh() = default;
+
+	// Kopia dostaje własną listę wyświetlania przy pierwszym rysowaniu
+	Mesh(const Mesh& other)
+		: vertices(other.vertices), indices(other.indices), lods(other.lods), hasColors(other.hasColors),
+		boundsMin(other.boundsMin), boundsMax(other.boundsMax) {}
+
+	Mesh(Mesh&& other)
+		: vertices(std::move(other.vertices)), indices(std::move(other.indices)), lods(std::move(other.lods)), hasColors(other.hasColors),
+		boundsMin(other.boundsMin), boundsMax(other.boundsMax), displayLists(std::move(other.displayLists))
+	{
+		other.displayLists.clear();
+	}
+
+	Mesh& operator=(Mesh other)
+	{
+		release();
+		vertices.swap(other.vertices);
+		indices.swap(other.indices);
+		lods.swap(other.lods);
+		hasColors = other.hasColors;
+		boundsMin = other.boundsMin;
+		boundsMax = other.boundsMax;
+		displayLists.swap(other.displayLists);
+		return *this;
+	}
+
+	~Mesh()
+	{
+		release();
+	}
+
+	size_t triangleCount() const
+	{
+		return indices.size() / 3;
+	}
+
+	size_t lodCount() const
+	{
+		return lods.empty() ? 1 : lods.size();
+	}
+
+	// Zakres indeksów danego poziomu szczegółowości
+	MeshLod lod(size_t level) const
+	{
+		if (lods.empty())
+		{
+			return { 0, (unsigned int)indices.size(), 0.0f };
+		}
+		return lods[std::min(level, lods.size() - 1)];
+	}
+
+	// Przeliczenie prostopadłościanu otaczającego
+	void computeBounds()
+	{
+		if (vertices.empty())
+		{
+			boundsMin = boundsMax = glm::vec3(0.0f);
+			return;
+		}
+
+		boundsMin = boundsMax = vertices[0].position;
+		for (const Vertex& v : vertices)
+		{
+			boundsMin = glm::min(boundsMin, v.position);
+			boundsMax = glm::max(boundsMax, v.position);
+		}
+	}
+
+	glm::vec3 center() const
+	{
+		return (boundsMin + boundsMax) * 0.5f;
+	}
+
+	// Promień sfery otaczającej (względem środka prostopadłościanu)
+	float radius() const
+	{
+		return glm::length(boundsMax - boundsMin) * 0.5f;
+	}
+
+	// Po zmianie wierzchołków lub indeksów lista musi zostać zbudowana od nowa
+	void invalidate()
+	{
+		release();
+	}
+
+	// Rysowanie siatki (wybranego poziomu), pierwsze wywołanie kompiluje listę wyświetlania
+	void draw(size_t level = 0) const
+	{
+		MeshLod range = lod(level);
+		if (range.indexCount == 0)
+		{
+			return;
+		}
+		PerfCounters::add(PerfCounters::DrawCalls);
+		PerfCounters::add(PerfCounters::Triangles, range.indexCount / 3);
+
+		level = std::min(level, lodCount() - 1);
+		if (displayLists.size() < lodCount())
+		{
+			displayLists.resize(lodCount(), 0);
+		}
+
+		GLuint& list = displayLists[level];
+		if (list != 0)
+		{
+			glCallList(list);
+			return;
+		}
+
+		list = glGenLists(1);
+		if (list == 0)
+		{
+			submit(range); // brak wolnych list - rysujemy bezpośrednio z tablic
+			return;
+		}
+
+		glNewList(list, GL_COMPILE_AND_EXECUTE);
+		submit(range);
+		glEndList();
+	}
+
+	// Zwolnienie list wyświetlania (dane w pamięci zostają)
+	void release() const
+	{
+		for (GLuint& list : displayLists)
+		{
+			if (list != 0)
+			{
+				glDeleteLists(list, 1);
+			}
+		}
+		displayLists.clear();
+	}
+
+	// Zwolnienie list z dowolnego wątku (np. przed przebudową w tle) - usuwa je dopiero deleteReleased()
+	void releaseDeferred() const
+	{
+		lock_guard<mutex> lock(releasedMutex);
+		for (GLuint list : displayLists)
+		{
+			if (list != 0)
+			{
+				releasedLists.push_back(list);
+			}
+		}
+		displayLists.clear();
+	}
+
+	// Usunięcie list zwolnionych przez releaseDeferred - raz na klatkę na wątku renderowania
+	static void deleteReleased()
+	{
+		vector<GLuint> lists;
+		{
+			lock_guard<mutex> lock(releasedMutex);
+			lists.swap(releasedLists);
+		}
+		for (GLuint list : lists)
+		{
+			glDeleteLists(list, 1);
+		}
+	}
+
+private:
+	mutable vector<GLuint> displayLists;
+	static vector<GLuint> releasedLists;
+	static mutex releasedMutex;
+
+	// Przesłanie geometrii przez tablice wierzchołków i glDrawElements
+	void submit(const MeshLod& range) const
+	{
+		const GLsizei stride = sizeof(Vertex);
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glVertexPointer(3, GL_FLOAT, stride, &vertices[0].position);
+		glNormalPointer(GL_FLOAT, stride, &vertices[0].normal);
+		glTexCoordPointer(2, GL_FLOAT, stride, &vertices[0].texCoord);
+
+		if (hasColors)
+		{
+			glEnableClientState(GL_COLOR_ARRAY);
+			glColorPointer(3, GL_FLOAT, stride, &vertices[0].color);
+		}
+
+		glDrawElements(GL_TRIANGLES, (GLsizei)range.indexCount, GL_UNSIGNED_INT, indices.data() + range.indexOffset);
+
+		if (hasColors)
+		{
+			glDisableClientState(GL_COLOR_ARRAY);
+		}
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glDisableClientState(GL_NORMAL_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+	}
+};
+
+vector<GLuint> Mesh::releasedLists;
+mutex Mesh::releasedMutex;
@@ -0,0 +1,396 @@
+﻿#pragma once
+#include "includy.h"
+#include "Mesh.h"
+#include "VertexFormat.h"
+#include "MappedFile.h"
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+/**
+* @struct MeshFileHeader
+* @brief Nagłówek pliku .jmesh. Za nim (co 64 bajty): tablica LOD, wierzchołki, indeksy
+*/
+struct MeshFileHeader
+{
+	char magic[4];         // "JMSH"
+	uint32_t version;
+	uint32_t layout;       // VertexLayout
+	uint32_t flags;        // MeshFileHeader::HasColors | ShortIndices
+	uint64_t vertexCount;
+	uint64_t indexCount;
+	uint32_t lodCount;
+	uint32_t vertexStride;
+	float boundsMin[3];
+	float boundsMax[3];
+	float center[3];       // dekwantyzacja pozycji (układy Quantized)
+	float scale[3];
+	float uvOffset[2];
+	float uvScale[2];
+	uint64_t lodOffset;
+	uint64_t vertexOffset;
+	uint64_t vertexBytes;
+	uint64_t indexOffset;
+	uint64_t indexBytes;
+	uint64_t checksum;     // wszystko za nagłówkiem
+	uint64_t fileSize;
+
+	enum Flags : uint32_t
+	{
+		HasColors = 1,
+		ShortIndices = 2
+	};
+};
+
+static_assert(sizeof(MeshFileHeader) == 160, "MeshFileHeader layout");
+static_assert(sizeof(MeshLod) == 12, "MeshLod layout");
+
+/**
+* @class MeshFile
+* @brief Własny format siatek (.jmesh) - bloki wierzchołków i indeksów zapisane dokładnie tak,
+* jak są rysowane, wyrównane do 64 bajtów. open() mapuje plik i sprawdza tylko nagłówek i zakresy,
+* więc czas wczytania zależy od dysku, a nie od parsowania. Suma kontrolna i zakres indeksów
+* sprawdzane są dopiero w verify() (np. na wątku roboczym albo w narzędziach)
+*/
+class MeshFile
+{
+public:
+	static const uint32_t Version = 1;
+
+	static const char* extension()
+	{
+		return ".jmesh";
+	}
+
+	MeshFile() {}
+
+	MeshFile(const MeshFile&) = delete;
+	MeshFile& operator=(const MeshFile&) = delete;
+
+	~MeshFile()
+	{
+		release();
+	}
+
+	static bool save(const Mesh& mesh, const string& path, VertexLayout layout = VertexLayout::Float)
+	{
+		CompactMesh compact = CompactMesh::encode(mesh, layout);
+		return write(compact.view(), mesh.boundsMin, mesh.boundsMax, path);
+	}
+
+	static bool save(const CompactMesh& mesh, const string& path)
+	{
+		return write(mesh.view(), mesh.boundsMin, mesh.boundsMax, path);
+	}
+
+	// Zmapowanie pliku i sprawdzenie nagłówka (bez czytania danych)
+	bool open(const string& path)
+	{
+		release();
+		verified = false;
+		fallback.reset();
+		if (!file.open(path))
+		{
+			return false;
+		}
+
+		if (!validHeader())
+		{
+			cout << "Niepoprawny plik siatki " << path << "\n";
+			file.close();
+			return false;
+		}
+		return true;
+	}
+
+	// Pełne sprawdzenie: suma kontrolna i indeksy w zakresie wierzchołków
+	bool verify() const
+	{
+		if (verified)
+		{
+			return true;
+		}
+		if (!file.isOpen())
+		{
+			return false;
+		}
+
+		const MeshFileHeader& h = header();
+		if (checksum(file.data() + sizeof(MeshFileHeader), file.size() - sizeof(MeshFileHeader)) != h.checksum)
+		{
+			return false;
+		}
+
+		MeshView v = view();
+		for (size_t i = 0; i < v.indexCount; i++)
+		{
+			if (v.index(i) >= v.vertexCount)
+			{
+				return false;
+			}
+		}
+		verified = true;
+		return true;
+	}
+
+	bool isOpen() const
+	{
+		return file.isOpen();
+	}
+
+	const MeshFileHeader& header() const
+	{
+		return *(const MeshFileHeader*)file.data();
+	}
+
+	// Dane siatki wskazujące bezpośrednio do zmapowanego pliku
+	MeshView view() const
+	{
+		const MeshFileHeader& h = header();
+		MeshView result;
+		result.layout = (VertexLayout)h.layout;
+		result.vertexData = file.data() + h.vertexOffset;
+		result.indexData = file.data() + h.indexOffset;
+		result.lods = (const MeshLod*)(file.data() + h.lodOffset);
+		result.lodCount = h.lodCount;
+		result.vertexCount = (size_t)h.vertexCount;
+		result.indexCount = (size_t)h.indexCount;
+		result.shortIndices = (h.flags & MeshFileHeader::ShortIndices) != 0;
+		result.hasColors = (h.flags & MeshFileHeader::HasColors) != 0;
+		result.center = glm::vec3(h.center[0], h.center[1], h.center[2]);
+		result.scale = glm::vec3(h.scale[0], h.scale[1], h.scale[2]);
+		result.uvOffset = glm::vec2(h.uvOffset[0], h.uvOffset[1]);
+		result.uvScale = glm::vec2(h.uvScale[0], h.uvScale[1]);
+		return result;
+	}
+
+	glm::vec3 boundsMin() const
+	{
+		return glm::vec3(header().boundsMin[0], header().boundsMin[1], header().boundsMin[2]);
+	}
+
+	glm::vec3 boundsMax() const
+	{
+		return glm::vec3(header().boundsMax[0], header().boundsMax[1], header().boundsMax[2]);
+	}
+
+	size_t lodCount() const
+	{
+		return std::max<size_t>(1, header().lodCount);
+	}
+
+	// Kopia do edytowalnej siatki
+	Mesh toMesh() const
+	{
+		MeshView v = view();
+		Mesh mesh;
+		mesh.vertices.resize(v.vertexCount);
+		if (v.layout == VertexLayout::Float)
+		{
+			memcpy(mesh.vertices.data(), v.vertexData, v.vertexCount * sizeof(Vertex));
+		}
+		else
+		{
+			for (size_t i = 0; i < v.vertexCount; i++) mesh.vertices[i] = v.vertex(i);
+		}
+		mesh.indices.resize(v.indexCount);
+		for (size_t i = 0; i < v.indexCount; i++) mesh.indices[i] = v.index(i);
+		mesh.lods.assign(v.lods, v.lods + v.lodCount);
+		mesh.hasColors = v.hasColors;
+		mesh.boundsMin = boundsMin();
+		mesh.boundsMax = boundsMax();
+		return mesh;
+	}
+
+	// Rysowanie prosto z mapowania, pierwsze wywołanie kompiluje listę wyświetlania poziomu
+	void draw(size_t level = 0) const
+	{
+		if (!file.isOpen())
+		{
+			return;
+		}
+		if (header().layout == (uint32_t)VertexLayout::QuantizedOct)
+		{
+			// fixed-function nie zdekoduje normalnej oktaedrycznej
+			if (!fallback)
+			{
+				fallback.reset(new Mesh(toMesh()));
+			}
+			fallback->draw(level);
+			return;
+		}
+
+		level = std::min(level, lodCount() - 1);
+		if (displayLists.size() < lodCount())
+		{
+			displayLists.resize(lodCount(), 0);
+		}
+
+		GLuint& list = displayLists[level];
+		if (list != 0)
+		{
+			PerfCounters::add(PerfCounters::DrawCalls);
+			PerfCounters::add(PerfCounters::Triangles, view().lod(level).indexCount / 3);
+			glCallList(list);
+			return;
+		}
+
+		list = glGenLists(1);
+		if (list == 0)
+		{
+			view().draw(level);
+			return;
+		}
+		glNewList(list, GL_COMPILE_AND_EXECUTE);
+		view().draw(level);
+		glEndList();
+	}
+
+	// Zwolnienie list wyświetlania (mapowanie zostaje)
+	void release() const
+	{
+		for (GLuint list : displayLists)
+		{
+			if (list != 0)
+			{
+				glDeleteLists(list, 1);
+			}
+		}
+		displayLists.clear();
+	}
+
+	// Suma kontrolna: 4 niezależne tory po 8 bajtów, mieszane mnożeniem
+	static uint64_t checksum(const uint8_t* data, size_t size)
+	{
+		const uint64_t prime1 = 0x9E3779B185EBCA87ull, prime2 = 0xC2B2AE3D27D4EB4Full;
+		uint64_t lanes[4] = { prime1, prime2, 0, ~prime1 };
+		size_t i = 0;
+		for (; i + 32 <= size; i += 32)
+		{
+			for (int k = 0; k < 4; k++)
+			{
+				uint64_t word;
+				memcpy(&word, data + i + k * 8, 8);
+				lanes[k] += word * prime2;
+				lanes[k] = ((lanes[k] << 31) | (lanes[k] >> 33)) * prime1;
+			}
+		}
+
+		uint64_t hash = size;
+		for (int k = 0; k < 4; k++)
+		{
+			hash = (hash ^ lanes[k]) * prime1 + prime2;
+		}
+		for (; i < size; i++)
+		{
+			hash = (hash ^ data[i]) * prime1;
+		}
+		hash ^= hash >> 29;
+		return hash * prime2 ^ (hash >> 32);
+	}
+
+private:
+	MappedFile file;
+	mutable bool verified = false;
+	mutable vector<GLuint> displayLists;
+	mutable unique_ptr<Mesh> fallback;
+
+	static uint64_t align(uint64_t offset)
+	{
+		return (offset + 63) & ~(uint64_t)63;
+	}
+
+	bool validHeader() const
+	{
+		if (file.size() < sizeof(MeshFileHeader))
+		{
+			return false;
+		}
+
+		const MeshFileHeader& h = header();
+		uint64_t size = file.size();
+		if (memcmp(h.magic, "JMSH", 4) != 0 || h.version != Version || h.layout > (uint32_t)VertexLayout::QuantizedOct || h.fileSize != size)
+		{
+			return false;
+		}
+
+		MeshView v = view();
+		uint64_t indexSize = (h.flags & MeshFileHeader::ShortIndices) ? 2 : 4;
+		bool blocks = h.vertexStride == v.stride()
+			&& h.vertexCount <= size / std::max<uint64_t>(h.vertexStride, 1)
+			&& h.indexCount <= size / indexSize
+			&& h.vertexBytes == h.vertexCount * h.vertexStride && h.indexBytes == h.indexCount * indexSize
+			&& inside(h.lodOffset, (uint64_t)h.lodCount * sizeof(MeshLod), size)
+			&& inside(h.vertexOffset, h.vertexBytes, size) && inside(h.indexOffset, h.indexBytes, size)
+			&& h.vertexOffset % 16 == 0 && h.indexOffset % 16 == 0 && h.lodOffset % 4 == 0;
+		if (!blocks)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < v.lodCount; i++)
+		{
+			if ((uint64_t)v.lods[i].indexOffset + v.lods[i].indexCount > h.indexCount)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static bool inside(uint64_t offset, uint64_t bytes, uint64_t size)
+	{
+		return offset <= size && bytes <= size - offset;
+	}
+
+	static bool write(const MeshView& mesh, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const string& path)
+	{
+		MeshFileHeader h;
+		memset(&h, 0, sizeof(h));
+		memcpy(h.magic, "JMSH", 4);
+		h.version = Version;
+		h.layout = (uint32_t)mesh.layout;
+		h.flags = (mesh.hasColors ? (uint32_t)MeshFileHeader::HasColors : 0) | (mesh.shortIndices ? (uint32_t)MeshFileHeader::ShortIndices : 0);
+		h.vertexCount = mesh.vertexCount;
+		h.indexCount = mesh.indexCount;
+		h.lodCount = (uint32_t)mesh.lodCount;
+		h.vertexStride = (uint32_t)mesh.stride();
+		for (int k = 0; k < 3; k++)
+		{
+			h.boundsMin[k] = boundsMin[k];
+			h.boundsMax[k] = boundsMax[k];
+			h.center[k] = mesh.center[k];
+			h.scale[k] = mesh.scale[k];
+		}
+		for (int k = 0; k < 2; k++)
+		{
+			h.uvOffset[k] = mesh.uvOffset[k];
+			h.uvScale[k] = mesh.uvScale[k];
+		}
+
+		h.lodOffset = align(sizeof(MeshFileHeader));
+		h.vertexOffset = align(h.lodOffset + h.lodCount * sizeof(MeshLod));
+		h.vertexBytes = h.vertexCount * h.vertexStride;
+		h.indexOffset = align(h.vertexOffset + h.vertexBytes);
+		h.indexBytes = h.indexCount * (mesh.shortIndices ? 2 : 4);
+		h.fileSize = align(h.indexOffset + h.indexBytes);
+
+		// cały plik składany w pamięci - suma kontrolna liczona z tego, co trafi na dysk
+		vector<uint8_t> data((size_t)h.fileSize, 0);
+		if (h.lodCount) memcpy(data.data() + h.lodOffset, mesh.lods, h.lodCount * sizeof(MeshLod));
+		if (h.vertexBytes) memcpy(data.data() + h.vertexOffset, mesh.vertexData, (size_t)h.vertexBytes);
+		if (h.indexBytes) memcpy(data.data() + h.indexOffset, mesh.indexData, (size_t)h.indexBytes);
+		h.checksum = checksum(data.data() + sizeof(MeshFileHeader), data.size() - sizeof(MeshFileHeader));
+		memcpy(data.data(), &h, sizeof(h));
+
+		ofstream out(path, ios::binary);
+		out.write((const char*)data.data(), data.size());
+		if (!out)
+		{
+			cout << "Nie udalo sie zapisac " << path << "\n";
+			return false;
+		}
+		return true;
+	}
+};
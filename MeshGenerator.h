@@ -0,0 +1,435 @@
+﻿#pragma once
+#include "includy.h"
+#include "Mesh.h"
+#include "LOD.h"
+#include "MeshOptimizer.h"
+#include <map>
+#include <memory>
+#include <cmath>
+
+/**
+* @enum MeshShape
+* @brief Rodzaje brył generowanych przez MeshGenerator (odpowiedniki brył GLUT)
+*/
+enum class MeshShape
+{
+	Teapot,
+	Sphere,
+	Torus,
+	Cone
+};
+
+/**
+* @struct MeshKey
+* @brief Klucz pamięci podręcznej - kształt, wymiary i poziom szczegółowości
+*/
+struct MeshKey
+{
+	MeshShape shape;
+	float a, b;         // wymiary (np. promień, wysokość)
+	int detailU, detailV; // podział siatki
+
+	bool operator<(const MeshKey& other) const
+	{
+		if (shape != other.shape) return shape < other.shape;
+		if (a != other.a) return a < other.a;
+		if (b != other.b) return b < other.b;
+		if (detailU != other.detailU) return detailU < other.detailU;
+		return detailV < other.detailV;
+	}
+};
+
+/**
+* @class MeshGenerator
+* @brief Teseluje bryły GLUT (czajnik, sfera, torus, stożek) jednorazowo do siatek indeksowanych
+* Wynik jest zapamiętywany według parametrów, więc kolejne klatki korzystają z gotowej siatki
+* zamiast ponownie liczyć płaty Beziera jak glutSolidTeapot
+*/
+class MeshGenerator
+{
+public:
+	// Czajnik z Utah - odpowiednik glutSolidTeapot(size), grid = podział jednego płata
+	static const Mesh& teapot(float size, int grid = 14)
+	{
+		return cached({ MeshShape::Teapot, size, 0.0f, grid, grid }, [&]() { return buildTeapot(size, grid); });
+	}
+
+	// Odpowiednik glutSolidSphere(radius, slices, stacks)
+	static const Mesh& sphere(float radius, int slices, int stacks)
+	{
+		return cached({ MeshShape::Sphere, radius, 0.0f, slices, stacks }, [&]() { return buildSphere(radius, slices, stacks); });
+	}
+
+	// Odpowiednik glutSolidTorus(innerRadius, outerRadius, sides, rings)
+	static const Mesh& torus(float innerRadius, float outerRadius, int sides, int rings)
+	{
+		return cached({ MeshShape::Torus, innerRadius, outerRadius, sides, rings }, [&]() { return buildTorus(innerRadius, outerRadius, sides, rings); });
+	}
+
+	// Odpowiednik glutSolidCone(base, height, slices, stacks)
+	static const Mesh& cone(float base, float height, int slices, int stacks)
+	{
+		return cached({ MeshShape::Cone, base, height, slices, stacks }, [&]() { return buildCone(base, height, slices, stacks); });
+	}
+
+	// Poziomy szczegółowości - kolejne teselacje z coraz mniejszym podziałem.
+	// Błąd poziomu to strzałka cięciwy łuku, którym podział przybliża powierzchnię
+	static LODMesh teapotLod(float size, int grid = 14)
+	{
+		LODMesh result;
+		for (int g : detailLadder(grid, 2))
+		{
+			// największy promień korpusu to size, jeden płat obejmuje ćwierć obwodu
+			result.addLevel(teapot(size, g), chordError(size, glm::radians(90.0f) / g));
+		}
+		return result;
+	}
+
+	static LODMesh sphereLod(float radius, int slices = 32, int stacks = 16)
+	{
+		LODMesh result;
+		vector<int> ladder = detailLadder(slices, 6);
+		for (int s : ladder)
+		{
+			int st = std::max(3, stacks * s / slices);
+			float error = std::max(chordError(radius, glm::radians(360.0f) / s), chordError(radius, glm::radians(180.0f) / st));
+			result.addLevel(sphere(radius, s, st), error);
+		}
+		return result;
+	}
+
+	static LODMesh torusLod(float innerRadius, float outerRadius, int sides = 16, int rings = 32)
+	{
+		LODMesh result;
+		for (int r : detailLadder(rings, 6))
+		{
+			int s = std::max(3, sides * r / rings);
+			float error = std::max(chordError(outerRadius + innerRadius, glm::radians(360.0f) / r), chordError(innerRadius, glm::radians(360.0f) / s));
+			result.addLevel(torus(innerRadius, outerRadius, s, r), error);
+		}
+		return result;
+	}
+
+	static LODMesh coneLod(float base, float height, int slices = 32, int stacks = 4)
+	{
+		LODMesh result;
+		for (int s : detailLadder(slices, 6))
+		{
+			result.addLevel(cone(base, height, s, std::max(1, stacks * s / slices)), chordError(base, glm::radians(360.0f) / s));
+		}
+		return result;
+	}
+
+	// Usunięcie wszystkich zapamiętanych siatek
+	static void clearCache()
+	{
+		cache.clear();
+	}
+
+private:
+	static map<MeshKey, unique_ptr<Mesh>> cache;
+
+	static const Mesh& cached(const MeshKey& key, const function<Mesh()>& build)
+	{
+		auto it = cache.find(key);
+		if (it != cache.end())
+		{
+			return *it->second;
+		}
+
+		unique_ptr<Mesh> mesh(new Mesh(build()));
+		mesh->hasColors = false;
+		mesh->computeBounds();
+
+		// szwy siatek (bieguny, zamknięcie obwodu) mają zdublowane wierzchołki, a kolejność
+		// trójkątów wiersz po wierszu źle wykorzystuje bufor wierzchołków
+		MeshOptimizer::optimize(*mesh);
+		const Mesh& result = *mesh;
+		cache[key] = std::move(mesh);
+		return result;
+	}
+
+	// Strzałka cięciwy łuku o kącie angle na okręgu o promieniu radius
+	static float chordError(float radius, float angle)
+	{
+		return radius * (1.0f - cos(angle * 0.5f));
+	}
+
+	// Kolejne podziały od najdokładniejszego, każdy ok. 30% mniejszy
+	static vector<int> detailLadder(int finest, int minimum)
+	{
+		vector<int> ladder;
+		for (int d = finest; d >= minimum; d = std::min(d - 1, d * 7 / 10))
+		{
+			ladder.push_back(d);
+		}
+		if (ladder.empty() || ladder.back() != minimum)
+		{
+			ladder.push_back(minimum);
+		}
+		return ladder;
+	}
+
+	static Vertex makeVertex(const glm::vec3& position, const glm::vec3& normal, float u, float v)
+	{
+		Vertex vertex;
+		vertex.position = position;
+		vertex.normal = normal;
+		vertex.color = glm::vec3(1.0f);
+		vertex.texCoord = glm::vec2(u, v);
+		return vertex;
+	}
+
+	// Dodanie indeksów siatki (rows+1) x (cols+1) wierzchołków zaczynającej się od base
+	static void addGridIndices(Mesh& mesh, unsigned int base, int rows, int cols)
+	{
+		for (int i = 0; i < rows; i++)
+		{
+			for (int j = 0; j < cols; j++)
+			{
+				unsigned int i0 = base + i * (cols + 1) + j;
+				unsigned int i1 = i0 + 1;
+				unsigned int i2 = i0 + (cols + 1);
+				unsigned int i3 = i2 + 1;
+
+				mesh.indices.insert(mesh.indices.end(), { i0, i1, i3, i0, i3, i2 });
+			}
+		}
+	}
+
+	// Wielomiany Bernsteina 3 stopnia i ich pochodne
+	static void bernstein(float t, float b[4], float d[4])
+	{
+		float s = 1.0f - t;
+		b[0] = s * s * s;
+		b[1] = 3.0f * t * s * s;
+		b[2] = 3.0f * t * t * s;
+		b[3] = t * t * t;
+		d[0] = -3.0f * s * s;
+		d[1] = 3.0f * s * s - 6.0f * t * s;
+		d[2] = 6.0f * t * s - 3.0f * t * t;
+		d[3] = 3.0f * t * t;
+	}
+
+	// Punkt płata Beziera 4x4 wraz z pochodnymi cząstkowymi
+	static glm::vec3 evalPatch(const glm::vec3 p[4][4], float u, float v, glm::vec3& du, glm::vec3& dv)
+	{
+		float bu[4], du4[4], bv[4], dv4[4];
+		bernstein(u, bu, du4);
+		bernstein(v, bv, dv4);
+
+		glm::vec3 point(0.0f);
+		du = dv = glm::vec3(0.0f);
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				point += p[i][j] * (bv[i] * bu[j]);
+				du += p[i][j] * (bv[i] * du4[j]);
+				dv += p[i][j] * (dv4[i] * bu[j]);
+			}
+		}
+		return point;
+	}
+
+	// Normalna płata, przy zdegenerowanych krawędziach (biegun pokrywki i dna) liczona tuż obok
+	static glm::vec3 patchNormal(const glm::vec3 p[4][4], float u, float v)
+	{
+		glm::vec3 du, dv;
+		evalPatch(p, u, v, du, dv);
+		glm::vec3 n = glm::cross(du, dv);
+		if (glm::length(n) < 1e-6f)
+		{
+			const float eps = 1e-3f;
+			evalPatch(p, glm::clamp(u, eps, 1.0f - eps), glm::clamp(v, eps, 1.0f - eps), du, dv);
+			n = glm::cross(du, dv);
+		}
+		return glm::normalize(n);
+	}
+
+	static Mesh buildTeapot(float size, int grid)
+	{
+		// Dane płatów i punktów kontrolnych czajnika (te same co w GLUT)
+		static const int patchData[10][16] =
+		{
+			// brzeg
+			{ 102, 103, 104, 105, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+			// korpus
+			{ 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27 },
+			{ 24, 25, 26, 27, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40 },
+			// pokrywka
+			{ 96, 96, 96, 96, 97, 98, 99, 100, 101, 101, 101, 101, 0, 1, 2, 3 },
+			{ 0, 1, 2, 3, 106, 107, 108, 109, 110, 111, 112, 113, 114, 115, 116, 117 },
+			// dno
+			{ 118, 118, 118, 118, 124, 122, 119, 121, 123, 126, 125, 120, 40, 39, 38, 37 },
+			// ucho
+			{ 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56 },
+			{ 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 28, 65, 66, 67 },
+			// dzióbek
+			{ 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83 },
+			{ 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95 }
+		};
+
+		static const float cpData[127][3] =
+		{
+			{ 0.2f, 0.0f, 2.7f }, { 0.2f, -0.112f, 2.7f }, { 0.112f, -0.2f, 2.7f }, { 0.0f, -0.2f, 2.7f },
+			{ 1.3375f, 0.0f, 2.53125f }, { 1.3375f, -0.749f, 2.53125f }, { 0.749f, -1.3375f, 2.53125f }, { 0.0f, -1.3375f, 2.53125f },
+			{ 1.4375f, 0.0f, 2.53125f }, { 1.4375f, -0.805f, 2.53125f }, { 0.805f, -1.4375f, 2.53125f }, { 0.0f, -1.4375f, 2.53125f },
+			{ 1.5f, 0.0f, 2.4f }, { 1.5f, -0.84f, 2.4f }, { 0.84f, -1.5f, 2.4f }, { 0.0f, -1.5f, 2.4f },
+			{ 1.75f, 0.0f, 1.875f }, { 1.75f, -0.98f, 1.875f }, { 0.98f, -1.75f, 1.875f }, { 0.0f, -1.75f, 1.875f },
+			{ 2.0f, 0.0f, 1.35f }, { 2.0f, -1.12f, 1.35f }, { 1.12f, -2.0f, 1.35f }, { 0.0f, -2.0f, 1.35f },
+			{ 2.0f, 0.0f, 0.9f }, { 2.0f, -1.12f, 0.9f }, { 1.12f, -2.0f, 0.9f }, { 0.0f, -2.0f, 0.9f },
+			{ -2.0f, 0.0f, 0.9f },
+			{ 2.0f, 0.0f, 0.45f }, { 2.0f, -1.12f, 0.45f }, { 1.12f, -2.0f, 0.45f }, { 0.0f, -2.0f, 0.45f },
+			{ 1.5f, 0.0f, 0.225f }, { 1.5f, -0.84f, 0.225f }, { 0.84f, -1.5f, 0.225f }, { 0.0f, -1.5f, 0.225f },
+			{ 1.5f, 0.0f, 0.15f }, { 1.5f, -0.84f, 0.15f }, { 0.84f, -1.5f, 0.15f }, { 0.0f, -1.5f, 0.15f },
+			{ -1.6f, 0.0f, 2.025f }, { -1.6f, -0.3f, 2.025f }, { -1.5f, -0.3f, 2.25f }, { -1.5f, 0.0f, 2.25f },
+			{ -2.3f, 0.0f, 2.025f }, { -2.3f, -0.3f, 2.025f }, { -2.5f, -0.3f, 2.25f }, { -2.5f, 0.0f, 2.25f },
+			{ -2.7f, 0.0f, 2.025f }, { -2.7f, -0.3f, 2.025f }, { -3.0f, -0.3f, 2.25f }, { -3.0f, 0.0f, 2.25f },
+			{ -2.7f, 0.0f, 1.8f }, { -2.7f, -0.3f, 1.8f }, { -3.0f, -0.3f, 1.8f }, { -3.0f, 0.0f, 1.8f },
+			{ -2.7f, 0.0f, 1.575f }, { -2.7f, -0.3f, 1.575f }, { -3.0f, -0.3f, 1.35f }, { -3.0f, 0.0f, 1.35f },
+			{ -2.5f, 0.0f, 1.125f }, { -2.5f, -0.3f, 1.125f }, { -2.65f, -0.3f, 0.9375f }, { -2.65f, 0.0f, 0.9375f },
+			{ -2.0f, -0.3f, 0.9f }, { -1.9f, -0.3f, 0.6f }, { -1.9f, 0.0f, 0.6f },
+			{ 1.7f, 0.0f, 1.425f }, { 1.7f, -0.66f, 1.425f }, { 1.7f, -0.66f, 0.6f }, { 1.7f, 0.0f, 0.6f },
+			{ 2.6f, 0.0f, 1.425f }, { 2.6f, -0.66f, 1.425f }, { 3.1f, -0.66f, 0.825f }, { 3.1f, 0.0f, 0.825f },
+			{ 2.3f, 0.0f, 2.1f }, { 2.3f, -0.25f, 2.1f }, { 2.4f, -0.25f, 2.025f }, { 2.4f, 0.0f, 2.025f },
+			{ 2.7f, 0.0f, 2.4f }, { 2.7f, -0.25f, 2.4f }, { 3.3f, -0.25f, 2.4f }, { 3.3f, 0.0f, 2.4f },
+			{ 2.8f, 0.0f, 2.475f }, { 2.8f, -0.25f, 2.475f }, { 3.525f, -0.25f, 2.49375f }, { 3.525f, 0.0f, 2.49375f },
+			{ 2.9f, 0.0f, 2.475f }, { 2.9f, -0.15f, 2.475f }, { 3.45f, -0.15f, 2.5125f }, { 3.45f, 0.0f, 2.5125f },
+			{ 2.8f, 0.0f, 2.4f }, { 2.8f, -0.15f, 2.4f }, { 3.2f, -0.15f, 2.4f }, { 3.2f, 0.0f, 2.4f },
+			{ 0.0f, 0.0f, 3.15f }, { 0.8f, 0.0f, 3.15f }, { 0.8f, -0.45f, 3.15f }, { 0.45f, -0.8f, 3.15f }, { 0.0f, -0.8f, 3.15f },
+			{ 0.0f, 0.0f, 2.85f },
+			{ 1.4f, 0.0f, 2.4f }, { 1.4f, -0.784f, 2.4f }, { 0.784f, -1.4f, 2.4f }, { 0.0f, -1.4f, 2.4f },
+			{ 0.4f, 0.0f, 2.55f }, { 0.4f, -0.224f, 2.55f }, { 0.224f, -0.4f, 2.55f }, { 0.0f, -0.4f, 2.55f },
+			{ 1.3f, 0.0f, 2.55f }, { 1.3f, -0.728f, 2.55f }, { 0.728f, -1.3f, 2.55f }, { 0.0f, -1.3f, 2.55f },
+			{ 1.3f, 0.0f, 2.4f }, { 1.3f, -0.728f, 2.4f }, { 0.728f, -1.3f, 2.4f }, { 0.0f, -1.3f, 2.4f },
+			{ 0.0f, 0.0f, 0.0f }, { 1.425f, -0.798f, 0.0f }, { 1.5f, 0.0f, 0.075f }, { 1.425f, 0.0f, 0.0f },
+			{ 0.798f, -1.425f, 0.0f }, { 0.0f, -1.5f, 0.075f }, { 0.0f, -1.425f, 0.0f }, { 1.5f, -0.84f, 0.075f },
+			{ 0.84f, -1.5f, 0.075f }
+		};
+
+		// Jak w GLUT: przesunięcie o -1.5 w osi z, skala 0.5*size i obrót o 270 stopni wokół osi x
+		const float scale = 0.5f * size;
+		auto toWorld = [scale](const glm::vec3& p) { return glm::vec3(p.x, p.z - 1.5f, -p.y) * scale; };
+		auto toWorldNormal = [](const glm::vec3& n) { return glm::vec3(n.x, n.z, -n.y); };
+
+		Mesh mesh;
+		glm::vec3 patch[4][4];
+
+		for (int i = 0; i < 10; i++)
+		{
+			// Płaty są zapisane dla jednej ćwiartki, reszta powstaje przez odbicia.
+			// Przy pojedynczym odbiciu kolumny idą w odwrotnej kolejności, żeby zachować kierunek obiegu
+			int copies = (i < 6) ? 4 : 2;
+			for (int copy = 0; copy < copies; copy++)
+			{
+				bool reverse = (copy == 1 || copy == 2);
+				float sx = (copy >= 2) ? -1.0f : 1.0f;
+				float sy = (copy == 1 || copy == 3) ? -1.0f : 1.0f;
+
+				for (int r = 0; r < 4; r++)
+				{
+					for (int c = 0; c < 4; c++)
+					{
+						const float* cp = cpData[patchData[i][r * 4 + (reverse ? 3 - c : c)]];
+						patch[r][c] = glm::vec3(cp[0] * sx, cp[1] * sy, cp[2]);
+					}
+				}
+
+				unsigned int base = (unsigned int)mesh.vertices.size();
+				for (int r = 0; r <= grid; r++)
+				{
+					float v = (float)r / grid;
+					for (int c = 0; c <= grid; c++)
+					{
+						float u = (float)c / grid;
+						glm::vec3 du, dv;
+						glm::vec3 point = evalPatch(patch, u, v, du, dv);
+						glm::vec3 normal = patchNormal(patch, u, v);
+						mesh.vertices.push_back(makeVertex(toWorld(point), toWorldNormal(normal), u, v));
+					}
+				}
+				addGridIndices(mesh, base, grid, grid);
+			}
+		}
+
+		return mesh;
+	}
+
+	static Mesh buildSphere(float radius, int slices, int stacks)
+	{
+		Mesh mesh;
+		for (int i = 0; i <= stacks; i++)
+		{
+			// od bieguna -z do +z, tak jak glutSolidSphere
+			float phi = glm::radians(180.0f) * (float)i / stacks - glm::radians(90.0f);
+			for (int j = 0; j <= slices; j++)
+			{
+				float theta = glm::radians(360.0f) * (float)j / slices;
+				glm::vec3 normal(cos(phi) * cos(theta), cos(phi) * sin(theta), sin(phi));
+				mesh.vertices.push_back(makeVertex(normal * radius, normal, (float)j / slices, (float)i / stacks));
+			}
+		}
+		addGridIndices(mesh, 0, stacks, slices);
+		return mesh;
+	}
+
+	static Mesh buildTorus(float innerRadius, float outerRadius, int sides, int rings)
+	{
+		Mesh mesh;
+		for (int j = 0; j <= sides; j++)
+		{
+			float phi = glm::radians(360.0f) * (float)j / sides;
+			for (int i = 0; i <= rings; i++)
+			{
+				float theta = glm::radians(360.0f) * (float)i / rings;
+				glm::vec3 normal(cos(theta) * cos(phi), sin(theta) * cos(phi), sin(phi));
+				glm::vec3 position(cos(theta) * (outerRadius + innerRadius * cos(phi)),
+					sin(theta) * (outerRadius + innerRadius * cos(phi)),
+					innerRadius * sin(phi));
+				mesh.vertices.push_back(makeVertex(position, normal, (float)i / rings, (float)j / sides));
+			}
+		}
+		addGridIndices(mesh, 0, sides, rings);
+		return mesh;
+	}
+
+	static Mesh buildCone(float base, float height, int slices, int stacks)
+	{
+		Mesh mesh;
+
+		// pobocznica - podstawa w z = 0, wierzchołek w z = height
+		float slant = sqrt(base * base + height * height);
+		for (int i = 0; i <= stacks; i++)
+		{
+			float t = (float)i / stacks;
+			float r = base * (1.0f - t);
+			for (int j = 0; j <= slices; j++)
+			{
+				float theta = glm::radians(360.0f) * (float)j / slices;
+				glm::vec3 normal(cos(theta) * height / slant, sin(theta) * height / slant, base / slant);
+				glm::vec3 position(cos(theta) * r, sin(theta) * r, t * height);
+				mesh.vertices.push_back(makeVertex(position, normal, (float)j / slices, t));
+			}
+		}
+		addGridIndices(mesh, 0, stacks, slices);
+
+		// podstawa jako wachlarz wokół środka
+		unsigned int center = (unsigned int)mesh.vertices.size();
+		mesh.vertices.push_back(makeVertex(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), 0.5f, 0.5f));
+		for (int j = 0; j <= slices; j++)
+		{
+			float theta = glm::radians(360.0f) * (float)j / slices;
+			glm::vec3 position(cos(theta) * base, sin(theta) * base, 0.0f);
+			mesh.vertices.push_back(makeVertex(position, glm::vec3(0.0f, 0.0f, -1.0f), 0.5f + 0.5f * cos(theta), 0.5f + 0.5f * sin(theta)));
+		}
+		for (int j = 0; j < slices; j++)
+		{
+			mesh.indices.insert(mesh.indices.end(), { center, center + 2 + j, center + 1 + j });
+		}
+
+		return mesh;
+	}
+};
+
+map<MeshKey, unique_ptr<Mesh>> MeshGenerator::cache;
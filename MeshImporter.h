@@ -0,0 +1,987 @@
+﻿#pragma once
+#include "includy.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <climits>
+#include <sstream>
+#include <atomic>
+
+/**
+* @struct MeshImportOptions
+* @brief Ustawienia wczytywania siatek
+*/
+struct MeshImportOptions
+{
+	bool optimize = true;            // MeshOptimizer::optimize po wczytaniu
+	bool generateNormals = true;     // normalne z trójkątów, gdy plik ich nie ma
+	size_t chunkSize = 4 << 20;      // bajty OBJ na jedno zadanie
+};
+
+/**
+* @struct MeshImportStats
+* @brief Statystyki wczytania siatki
+*/
+struct MeshImportStats
+{
+	size_t bytes = 0;
+	size_t vertices = 0;
+	size_t triangles = 0;
+	double parseSeconds = 0.0;  // parsowanie i budowa siatki, bez optymalizacji
+	double totalSeconds = 0.0;
+
+	double megabytesPerSecond() const
+	{
+		return parseSeconds > 0.0 ? bytes / (1024.0 * 1024.0) / parseSeconds : 0.0;
+	}
+};
+
+/**
+* @class MeshImporter
+* @brief Wczytywanie siatek z plików Wavefront OBJ i binarnych PLY do Mesh.
+* Plik jest mapowany w pamięci i dzielony na kawałki (na granicach linii dla OBJ) parsowane równolegle
+* na ThreadPool::shared(). Wierzchołki OBJ o tych samych indeksach v/vt/vn są scalane tablicą mieszającą
+*/
+class MeshImporter
+{
+public:
+	static bool load(const string& path, Mesh& mesh, const MeshImportOptions& options = MeshImportOptions(), MeshImportStats* stats = nullptr)
+	{
+		auto start = chrono::steady_clock::now();
+
+		MappedFile file;
+		if (!file.open(path))
+		{
+			cout << "Nie udalo sie otworzyc " << path << "\n";
+			return false;
+		}
+
+		Mesh result;
+		string error;
+		bool hasNormals = false;
+		bool ply = file.size() >= 4 && memcmp(file.data(), "ply", 3) == 0 && (file.data()[3] == '\n' || file.data()[3] == '\r');
+		bool loaded = ply ? parsePly(file, result, hasNormals, error) : parseObj(file, options, result, hasNormals, error);
+		if (!loaded)
+		{
+			cout << "Nie udalo sie wczytac " << path << ": " << error << "\n";
+			return false;
+		}
+
+		if (options.generateNormals && !hasNormals)
+		{
+			generateNormals(result);
+		}
+		result.computeBounds();
+		double parseSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		if (options.optimize)
+		{
+			MeshOptimizer::optimize(result);
+		}
+
+		if (stats)
+		{
+			stats->bytes = file.size();
+			stats->vertices = result.vertices.size();
+			stats->triangles = result.triangleCount();
+			stats->parseSeconds = parseSeconds;
+			stats->totalSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		}
+
+		mesh = std::move(result);
+		return true;
+	}
+
+	// Szybkie parsowanie liczby zmiennoprzecinkowej (bez locale), zwraca wskaźnik za liczbą lub nullptr
+	static const char* parseFloat(const char* p, const char* end, float& out)
+	{
+		while (p < end && (*p == ' ' || *p == '\t')) p++;
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+
+		uint64_t mantissa = 0;
+		int exponent = 0, digits = 0;
+		const char* first = p;
+		for (; p < end && (unsigned)(*p - '0') < 10; p++)
+		{
+			if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; }
+			else exponent++;
+		}
+		if (p < end && *p == '.')
+		{
+			for (p++; p < end && (unsigned)(*p - '0') < 10; p++)
+			{
+				if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; exponent--; }
+			}
+		}
+		if (p == first || (p == first + 1 && *first == '.'))
+		{
+			return nullptr;
+		}
+
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* q = p + 1;
+			bool negativeExponent = false;
+			if (q < end && (*q == '-' || *q == '+'))
+			{
+				negativeExponent = *q == '-';
+				q++;
+			}
+			if (q < end && (unsigned)(*q - '0') < 10)
+			{
+				int e = 0;
+				for (; q < end && (unsigned)(*q - '0') < 10; q++)
+				{
+					e = std::min(e * 10 + (*q - '0'), 10000);
+				}
+				exponent += negativeExponent ? -e : e;
+				p = q;
+			}
+		}
+
+		static const double powers[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+		double value = (double)mantissa;
+		if (exponent < 0)
+		{
+			value = exponent >= -22 ? value / powers[-exponent] : value * pow(10.0, exponent);
+		}
+		else if (exponent > 0)
+		{
+			value = exponent <= 22 ? value * powers[exponent] : value * pow(10.0, exponent);
+		}
+		out = (float)(negative ? -value : value);
+		return p;
+	}
+
+private:
+	static const int32_t Missing = INT32_MIN;
+
+	// Indeksy narożnika OBJ; po parsowaniu kawałka indeks ujemny w pliku jest zapisany względem
+	// początku kawałka (bit w relative) i zamieniany na globalny po zliczeniu wszystkich kawałków
+	struct ObjCorner
+	{
+		int32_t position, texCoord, normal;
+		uint8_t relative;
+	};
+
+	struct ObjChunk
+	{
+		vector<float> positions; // xyz
+		vector<float> colors;    // rgb, równoległe do positions gdy hasColors
+		vector<float> texCoords; // uv
+		vector<float> normals;   // xyz
+		vector<ObjCorner> corners; // po 3 na trójkąt
+		bool hasColors = false;
+		bool usesTexCoords = false;
+		bool usesNormals = false;
+		string error;
+	};
+
+	// --- OBJ ---
+
+	static bool parseObj(const MappedFile& file, const MeshImportOptions& options, Mesh& mesh, bool& hasNormals, string& error)
+	{
+		const char* data = (const char*)file.data();
+		size_t size = file.size();
+
+		// kawałki kończą się na końcu linii
+		vector<size_t> bounds(1, 0);
+		while (bounds.back() < size)
+		{
+			size_t next = std::min(bounds.back() + std::max<size_t>(options.chunkSize, 1024), size);
+			while (next < size && data[next - 1] != '\n') next++;
+			bounds.push_back(next);
+		}
+
+		size_t chunkCount = bounds.size() - 1;
+		vector<ObjChunk> chunks(chunkCount);
+		ThreadPool::shared().parallelFor(chunkCount, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				parseObjChunk(data + bounds[i], data + bounds[i + 1], chunks[i]);
+			}
+		});
+
+		// początki kawałków w globalnych tablicach
+		vector<size_t> positionBase(chunkCount + 1, 0), texCoordBase(chunkCount + 1, 0), normalBase(chunkCount + 1, 0), cornerBase(chunkCount + 1, 0);
+		bool hasColors = false, usesTexCoords = false, usesNormals = false;
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			if (!chunks[i].error.empty())
+			{
+				error = chunks[i].error;
+				return false;
+			}
+			positionBase[i + 1] = positionBase[i] + chunks[i].positions.size() / 3;
+			texCoordBase[i + 1] = texCoordBase[i] + chunks[i].texCoords.size() / 2;
+			normalBase[i + 1] = normalBase[i] + chunks[i].normals.size() / 3;
+			cornerBase[i + 1] = cornerBase[i] + chunks[i].corners.size();
+			hasColors |= chunks[i].hasColors;
+			usesTexCoords |= chunks[i].usesTexCoords;
+			usesNormals |= chunks[i].usesNormals;
+		}
+
+		size_t positionCount = positionBase[chunkCount], texCoordCount = texCoordBase[chunkCount], normalCount = normalBase[chunkCount];
+		if (positionCount > (size_t)INT32_MAX || cornerBase[chunkCount] > (size_t)UINT_MAX)
+		{
+			error = "siatka za duza";
+			return false;
+		}
+
+		// scalenie tablic atrybutów i zamiana indeksów względnych na globalne
+		vector<glm::vec3> positions(positionCount), colors(hasColors ? positionCount : 0), normals(normalCount);
+		vector<glm::vec2> texCoords(texCoordCount);
+		vector<ObjCorner> corners(cornerBase[chunkCount]);
+		vector<char> invalid(chunkCount, 0);
+
+		ThreadPool::shared().parallelFor(chunkCount, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const ObjChunk& chunk = chunks[i];
+				copyFloats(positions.data() + positionBase[i], chunk.positions);
+				copyFloats(texCoords.data() + texCoordBase[i], chunk.texCoords);
+				copyFloats(normals.data() + normalBase[i], chunk.normals);
+				if (hasColors)
+				{
+					if (chunk.hasColors) copyFloats(colors.data() + positionBase[i], chunk.colors);
+					else fill(colors.begin() + positionBase[i], colors.begin() + positionBase[i + 1], glm::vec3(1.0f));
+				}
+
+				for (size_t c = 0; c < chunk.corners.size(); c++)
+				{
+					ObjCorner corner = chunk.corners[c];
+					bool valid = resolve(corner.position, (corner.relative & 1) != 0, positionBase[i], positionCount, false)
+						&& resolve(corner.texCoord, (corner.relative & 2) != 0, texCoordBase[i], texCoordCount, true)
+						&& resolve(corner.normal, (corner.relative & 4) != 0, normalBase[i], normalCount, true);
+					corner.relative = 0;
+					if (!valid)
+					{
+						invalid[i] = 1;
+					}
+					corners[cornerBase[i] + c] = corner;
+				}
+			}
+		});
+
+		for (char bad : invalid)
+		{
+			if (bad)
+			{
+				error = "indeks sciany poza zakresem";
+				return false;
+			}
+		}
+		chunks.clear();
+
+		mesh.hasColors = hasColors;
+		hasNormals = usesNormals;
+		mesh.indices.resize(corners.size());
+
+		if (!usesTexCoords && !usesNormals)
+		{
+			// same pozycje - wierzchołki to dokładnie tablica v, bez scalania
+			mesh.vertices.resize(positionCount);
+			ThreadPool::shared().parallelFor(positionCount, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					mesh.vertices[i] = { positions[i], glm::vec3(0.0f), hasColors ? colors[i] : glm::vec3(1.0f), glm::vec2(0.0f) };
+				}
+			}, 1 << 16);
+			for (size_t i = 0; i < corners.size(); i++)
+			{
+				mesh.indices[i] = (unsigned int)corners[i].position;
+			}
+			return true;
+		}
+
+		// scalanie narożników o tych samych indeksach v/vt/vn (adresowanie otwarte)
+		size_t capacity = 16;
+		while (capacity < corners.size() * 2) capacity *= 2;
+		vector<ObjCorner> keys(capacity, { Missing, Missing, Missing, 0 });
+		vector<unsigned int> values(capacity);
+		mesh.vertices.reserve(positionCount);
+
+		for (size_t i = 0; i < corners.size(); i++)
+		{
+			const ObjCorner& corner = corners[i];
+			uint64_t hash = (uint64_t)(uint32_t)corner.position * 0x9E3779B97F4A7C15ull
+				^ (uint64_t)(uint32_t)corner.texCoord * 0xC2B2AE3D27D4EB4Full
+				^ (uint64_t)(uint32_t)corner.normal * 0x165667B19E3779F9ull;
+			size_t slot = (size_t)(hash ^ (hash >> 29)) & (capacity - 1);
+
+			for (;;)
+			{
+				ObjCorner& key = keys[slot];
+				if (key.position == Missing)
+				{
+					key = corner;
+					values[slot] = (unsigned int)mesh.vertices.size();
+
+					Vertex vertex;
+					vertex.position = positions[corner.position];
+					vertex.color = hasColors ? colors[corner.position] : glm::vec3(1.0f);
+					vertex.texCoord = corner.texCoord >= 0 ? texCoords[corner.texCoord] : glm::vec2(0.0f);
+					vertex.normal = corner.normal >= 0 ? normals[corner.normal] : glm::vec3(0.0f);
+					mesh.vertices.push_back(vertex);
+					break;
+				}
+				if (key.position == corner.position && key.texCoord == corner.texCoord && key.normal == corner.normal)
+				{
+					break;
+				}
+				slot = (slot + 1) & (capacity - 1);
+			}
+			mesh.indices[i] = values[slot];
+		}
+		return true;
+	}
+
+	// Liczby fragmentu do scalonej tablicy wektorów - pusty fragment (i pusta tablica docelowa) bez memcpy na nullptr
+	static void copyFloats(void* target, const vector<float>& source)
+	{
+		if (!source.empty())
+		{
+			memcpy(target, source.data(), source.size() * sizeof(float));
+		}
+	}
+
+	static bool resolve(int32_t& index, bool relative, size_t base, size_t count, bool optional)
+	{
+		if (index == Missing)
+		{
+			return optional;
+		}
+		int64_t global = relative ? (int64_t)base + index : index;
+		if (global < 0 || global >= (int64_t)count)
+		{
+			return false;
+		}
+		index = (int32_t)global;
+		return true;
+	}
+
+	static void parseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+	{
+		vector<ObjCorner> face;
+		while (p < end)
+		{
+			while (p < end && (*p == ' ' || *p == '\t')) p++;
+
+			if (p + 1 < end && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+			{
+				float values[6];
+				int count = 0;
+				const char* q = p + 2;
+				while (count < 6)
+				{
+					const char* next = parseFloat(q, end, values[count]);
+					if (!next) break;
+					q = next;
+					count++;
+				}
+				if (count < 3)
+				{
+					chunk.error = "niepoprawna linia v";
+					return;
+				}
+				chunk.positions.insert(chunk.positions.end(), values, values + 3);
+				if (count == 6)
+				{
+					if (!chunk.hasColors)
+					{
+						chunk.colors.assign(chunk.positions.size() - 3, 1.0f);
+						chunk.hasColors = true;
+					}
+					chunk.colors.insert(chunk.colors.end(), values + 3, values + 6);
+				}
+				else if (chunk.hasColors)
+				{
+					chunk.colors.insert(chunk.colors.end(), 3, 1.0f);
+				}
+				p = q;
+			}
+			else if (p + 2 < end && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t'))
+			{
+				float u = 0.0f, v = 0.0f;
+				const char* q = parseFloat(p + 3, end, u);
+				if (!q)
+				{
+					chunk.error = "niepoprawna linia vt";
+					return;
+				}
+				const char* next = parseFloat(q, end, v);
+				chunk.texCoords.push_back(u);
+				chunk.texCoords.push_back(v);
+				p = next ? next : q;
+			}
+			else if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
+			{
+				float n[3];
+				const char* q = p + 3;
+				for (int i = 0; i < 3; i++)
+				{
+					q = parseFloat(q, end, n[i]);
+					if (!q)
+					{
+						chunk.error = "niepoprawna linia vn";
+						return;
+					}
+				}
+				chunk.normals.insert(chunk.normals.end(), n, n + 3);
+				p = q;
+			}
+			else if (p + 1 < end && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+			{
+				face.clear();
+				const char* q = p + 2;
+				for (;;)
+				{
+					while (q < end && (*q == ' ' || *q == '\t')) q++;
+					if (q >= end || *q == '\n' || *q == '\r' || *q == '#')
+					{
+						break;
+					}
+
+					ObjCorner corner = { Missing, Missing, Missing, 0 };
+					if (!parseIndex(q, end, chunk.positions.size() / 3, corner.position, corner.relative, 1))
+					{
+						chunk.error = "niepoprawna linia f";
+						return;
+					}
+					if (q < end && *q == '/')
+					{
+						q++;
+						if (q < end && *q != '/')
+						{
+							if (!parseIndex(q, end, chunk.texCoords.size() / 2, corner.texCoord, corner.relative, 2)) { chunk.error = "niepoprawna linia f"; return; }
+							chunk.usesTexCoords = true;
+						}
+						if (q < end && *q == '/')
+						{
+							q++;
+							if (!parseIndex(q, end, chunk.normals.size() / 3, corner.normal, corner.relative, 4)) { chunk.error = "niepoprawna linia f"; return; }
+							chunk.usesNormals = true;
+						}
+					}
+					face.push_back(corner);
+				}
+
+				// wielokąt dzielony na wachlarz trójkątów
+				for (size_t i = 2; i < face.size(); i++)
+				{
+					chunk.corners.push_back(face[0]);
+					chunk.corners.push_back(face[i - 1]);
+					chunk.corners.push_back(face[i]);
+				}
+				p = q;
+			}
+
+			// reszta linii (komentarze, o/g/s/usemtl/mtllib i nieobsługiwane polecenia)
+			const char* newline = (const char*)memchr(p, '\n', end - p);
+			p = newline ? newline + 1 : end;
+		}
+	}
+
+	// Indeks OBJ (od 1, ujemny - względem ostatniego wczytanego) zamieniony na indeks od 0
+	static bool parseIndex(const char*& p, const char* end, size_t localCount, int32_t& out, uint8_t& relative, uint8_t flag)
+	{
+		bool negative = p < end && *p == '-';
+		if (negative) p++;
+
+		int64_t value = 0;
+		const char* first = p;
+		for (; p < end && (unsigned)(*p - '0') < 10; p++)
+		{
+			value = std::min<int64_t>(value * 10 + (*p - '0'), INT32_MAX);
+		}
+		if (p == first || value == 0)
+		{
+			return false;
+		}
+
+		if (!negative)
+		{
+			out = (int32_t)(value - 1);
+			return true;
+		}
+
+		// może wskazywać przed początek kawałka - wtedy jest ujemny
+		out = (int32_t)((int64_t)localCount - value);
+		relative |= flag;
+		return true;
+	}
+
+	// --- PLY (binarny) ---
+
+	enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+	struct PlyProperty
+	{
+		string name;
+		PlyType type = PlyType::Invalid;
+		bool list = false;
+		PlyType countType = PlyType::Invalid;
+	};
+
+	struct PlyElement
+	{
+		string name;
+		size_t count = 0;
+		vector<PlyProperty> properties;
+
+		bool fixedSize() const
+		{
+			for (const PlyProperty& property : properties)
+			{
+				if (property.list) return false;
+			}
+			return true;
+		}
+
+		size_t stride() const
+		{
+			size_t bytes = 0;
+			for (const PlyProperty& property : properties) bytes += typeSize(property.type);
+			return bytes;
+		}
+	};
+
+	static size_t typeSize(PlyType type)
+	{
+		switch (type)
+		{
+		case PlyType::Int8: case PlyType::UInt8: return 1;
+		case PlyType::Int16: case PlyType::UInt16: return 2;
+		case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+		case PlyType::Float64: return 8;
+		default: return 0;
+		}
+	}
+
+	static PlyType parseType(const string& name)
+	{
+		if (name == "char" || name == "int8") return PlyType::Int8;
+		if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+		if (name == "short" || name == "int16") return PlyType::Int16;
+		if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+		if (name == "int" || name == "int32") return PlyType::Int32;
+		if (name == "uint" || name == "uint32") return PlyType::UInt32;
+		if (name == "float" || name == "float32") return PlyType::Float32;
+		if (name == "double" || name == "float64") return PlyType::Float64;
+		return PlyType::Invalid;
+	}
+
+	static double readValue(const uint8_t* p, PlyType type, bool bigEndian)
+	{
+		uint8_t bytes[8];
+		size_t size = typeSize(type);
+		for (size_t i = 0; i < size; i++)
+		{
+			bytes[i] = bigEndian ? p[size - 1 - i] : p[i];
+		}
+
+		switch (type)
+		{
+		case PlyType::Int8: return (int8_t)bytes[0];
+		case PlyType::UInt8: return bytes[0];
+		case PlyType::Int16: { int16_t v; memcpy(&v, bytes, 2); return v; }
+		case PlyType::UInt16: { uint16_t v; memcpy(&v, bytes, 2); return v; }
+		case PlyType::Int32: { int32_t v; memcpy(&v, bytes, 4); return v; }
+		case PlyType::UInt32: { uint32_t v; memcpy(&v, bytes, 4); return v; }
+		case PlyType::Float32: { float v; memcpy(&v, bytes, 4); return v; }
+		case PlyType::Float64: { double v; memcpy(&v, bytes, 8); return v; }
+		default: return 0.0;
+		}
+	}
+
+	static bool parsePly(const MappedFile& file, Mesh& mesh, bool& hasNormals, string& error)
+	{
+		const char* text = (const char*)file.data();
+		const char* end = text + file.size();
+		const char* headerEnd = nullptr;
+		for (const char* p = text; p + 10 <= end; )
+		{
+			const char* newline = (const char*)memchr(p, '\n', end - p);
+			if (!newline) break;
+			if (newline - p >= 10 && strncmp(p, "end_header", 10) == 0)
+			{
+				headerEnd = newline + 1;
+				break;
+			}
+			p = newline + 1;
+		}
+		if (!headerEnd)
+		{
+			error = "brak end_header";
+			return false;
+		}
+
+		// nagłówek
+		bool bigEndian = false, formatFound = false;
+		vector<PlyElement> elements;
+		istringstream header(string(text, headerEnd));
+		string line;
+		while (getline(header, line))
+		{
+			istringstream words(line);
+			string keyword;
+			words >> keyword;
+			if (keyword == "format")
+			{
+				string format;
+				words >> format;
+				if (format == "ascii")
+				{
+					error = "obslugiwany jest tylko binarny PLY";
+					return false;
+				}
+				bigEndian = format == "binary_big_endian";
+				formatFound = true;
+			}
+			else if (keyword == "element")
+			{
+				PlyElement element;
+				words >> element.name >> element.count;
+				elements.push_back(element);
+			}
+			else if (keyword == "property" && !elements.empty())
+			{
+				PlyProperty property;
+				string type;
+				words >> type;
+				if (type == "list")
+				{
+					string countType, itemType;
+					words >> countType >> itemType;
+					property.list = true;
+					property.countType = parseType(countType);
+					property.type = parseType(itemType);
+				}
+				else
+				{
+					property.type = parseType(type);
+				}
+				words >> property.name;
+				if (property.type == PlyType::Invalid || (property.list && property.countType == PlyType::Invalid))
+				{
+					error = "nieznany typ wlasciwosci " + line;
+					return false;
+				}
+				elements.back().properties.push_back(property);
+			}
+		}
+		if (!formatFound)
+		{
+			error = "brak formatu";
+			return false;
+		}
+
+		const uint8_t* data = (const uint8_t*)headerEnd;
+		const uint8_t* dataEnd = (const uint8_t*)end;
+		bool hasVertices = false;
+		for (const PlyElement& element : elements)
+		{
+			const uint8_t* next = nullptr;
+			if (element.name == "vertex")
+			{
+				next = readPlyVertices(element, data, dataEnd, bigEndian, mesh, hasNormals, error);
+				hasVertices = true;
+			}
+			else if (element.name == "face")
+			{
+				next = readPlyFaces(element, data, dataEnd, bigEndian, mesh, error);
+			}
+			else
+			{
+				next = skipPlyElement(element, data, dataEnd, bigEndian);
+			}
+
+			if (!next)
+			{
+				if (error.empty()) error = "plik uciety w elemencie " + element.name;
+				return false;
+			}
+			data = next;
+		}
+
+		if (!hasVertices)
+		{
+			error = "brak wierzcholkow";
+			return false;
+		}
+		for (unsigned int index : mesh.indices)
+		{
+			if (index >= mesh.vertices.size())
+			{
+				error = "indeks sciany poza zakresem";
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static const uint8_t* readPlyVertices(const PlyElement& element, const uint8_t* data, const uint8_t* end, bool bigEndian, Mesh& mesh,
+		bool& hasNormals, string& error)
+	{
+		if (!element.fixedSize())
+		{
+			error = "lista we wierzcholkach";
+			return nullptr;
+		}
+
+		size_t stride = element.stride();
+		if ((size_t)(end - data) / std::max<size_t>(stride, 1) < element.count)
+		{
+			return nullptr;
+		}
+
+		// położenie znanych właściwości w rekordzie
+		enum { X, Y, Z, NX, NY, NZ, R, G, B, U, V, Fields };
+		static const char* names[Fields][3] =
+		{
+			{ "x" }, { "y" }, { "z" }, { "nx" }, { "ny" }, { "nz" },
+			{ "red", "r", "diffuse_red" }, { "green", "g", "diffuse_green" }, { "blue", "b", "diffuse_blue" },
+			{ "u", "s", "texture_u" }, { "v", "t", "texture_v" }
+		};
+		int offsets[Fields];
+		PlyType types[Fields];
+		size_t offset = 0;
+		fill(offsets, offsets + Fields, -1);
+		for (const PlyProperty& property : element.properties)
+		{
+			for (int f = 0; f < Fields; f++)
+			{
+				for (const char* name : names[f])
+				{
+					if (name && property.name == name)
+					{
+						offsets[f] = (int)offset;
+						types[f] = property.type;
+					}
+				}
+			}
+			offset += typeSize(property.type);
+		}
+		if (offsets[X] < 0 || offsets[Y] < 0 || offsets[Z] < 0)
+		{
+			error = "brak x/y/z";
+			return nullptr;
+		}
+
+		hasNormals = offsets[NX] >= 0 && offsets[NY] >= 0 && offsets[NZ] >= 0;
+		bool hasColors = offsets[R] >= 0 && offsets[G] >= 0 && offsets[B] >= 0;
+		bool hasTexCoords = offsets[U] >= 0 && offsets[V] >= 0;
+		bool fastPositions = !bigEndian && types[X] == PlyType::Float32 && types[Y] == PlyType::Float32 && types[Z] == PlyType::Float32
+			&& offsets[Y] == offsets[X] + 4 && offsets[Z] == offsets[X] + 8;
+
+		mesh.hasColors = hasColors;
+		mesh.vertices.resize(element.count);
+		ThreadPool::shared().parallelFor(element.count, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const uint8_t* record = data + i * stride;
+				Vertex& vertex = mesh.vertices[i];
+				if (fastPositions)
+				{
+					memcpy(&vertex.position, record + offsets[X], 12);
+				}
+				else
+				{
+					for (int c = 0; c < 3; c++) vertex.position[c] = (float)readValue(record + offsets[X + c], types[X + c], bigEndian);
+				}
+
+				vertex.normal = glm::vec3(0.0f);
+				if (hasNormals)
+				{
+					for (int c = 0; c < 3; c++) vertex.normal[c] = (float)readValue(record + offsets[NX + c], types[NX + c], bigEndian);
+				}
+
+				vertex.color = glm::vec3(1.0f);
+				if (hasColors)
+				{
+					for (int c = 0; c < 3; c++)
+					{
+						float value = (float)readValue(record + offsets[R + c], types[R + c], bigEndian);
+						vertex.color[c] = types[R + c] == PlyType::UInt8 ? value / 255.0f : value;
+					}
+				}
+
+				vertex.texCoord = glm::vec2(0.0f);
+				if (hasTexCoords)
+				{
+					for (int c = 0; c < 2; c++) vertex.texCoord[c] = (float)readValue(record + offsets[U + c], types[U + c], bigEndian);
+				}
+			}
+		}, 1 << 16);
+
+		return data + element.count * stride;
+	}
+
+	static const uint8_t* readPlyFaces(const PlyElement& element, const uint8_t* data, const uint8_t* end, bool bigEndian, Mesh& mesh, string& error)
+	{
+		int listIndex = -1;
+		for (size_t i = 0; i < element.properties.size(); i++)
+		{
+			const string& name = element.properties[i].name;
+			if (element.properties[i].list && (name == "vertex_indices" || name == "vertex_index"))
+			{
+				listIndex = (int)i;
+			}
+		}
+		if (listIndex < 0)
+		{
+			error = "brak vertex_indices";
+			return nullptr;
+		}
+
+		const PlyProperty& list = element.properties[listIndex];
+		size_t countSize = typeSize(list.countType), indexSize = typeSize(list.type);
+
+		// same trójkąty bez innych właściwości - stały rozmiar rekordu, czytanie równoległe
+		if (element.properties.size() == 1 && element.count > 0 && (size_t)(end - data) >= countSize
+			&& readValue(data, list.countType, bigEndian) == 3.0)
+		{
+			size_t stride = countSize + 3 * indexSize;
+			if ((size_t)(end - data) / stride >= element.count)
+			{
+				mesh.indices.resize(element.count * 3);
+				atomic<bool> triangles(true);
+				ThreadPool::shared().parallelFor(element.count, [&](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						const uint8_t* record = data + i * stride;
+						if (readValue(record, list.countType, bigEndian) != 3.0)
+						{
+							triangles = false;
+							return;
+						}
+						for (int c = 0; c < 3; c++)
+						{
+							mesh.indices[i * 3 + c] = (unsigned int)readValue(record + countSize + c * indexSize, list.type, bigEndian);
+						}
+					}
+				}, 1 << 16);
+
+				if (triangles)
+				{
+					return data + element.count * stride;
+				}
+				mesh.indices.clear();
+			}
+		}
+
+		// wielokąty lub dodatkowe właściwości - czytanie po kolei
+		const uint8_t* p = data;
+		vector<unsigned int> polygon;
+		for (size_t i = 0; i < element.count; i++)
+		{
+			for (size_t k = 0; k < element.properties.size(); k++)
+			{
+				const PlyProperty& property = element.properties[k];
+				if (!property.list)
+				{
+					p += typeSize(property.type);
+					if (p > end) return nullptr;
+					continue;
+				}
+
+				if (p + countSize > end) return nullptr;
+				size_t count = (size_t)readValue(p, property.countType, bigEndian);
+				p += countSize;
+				size_t itemSize = typeSize(property.type);
+				if ((size_t)(end - p) / itemSize < count) return nullptr;
+
+				if ((int)k == listIndex)
+				{
+					polygon.resize(count);
+					for (size_t c = 0; c < count; c++)
+					{
+						polygon[c] = (unsigned int)readValue(p + c * itemSize, property.type, bigEndian);
+					}
+					for (size_t c = 2; c < count; c++)
+					{
+						mesh.indices.push_back(polygon[0]);
+						mesh.indices.push_back(polygon[c - 1]);
+						mesh.indices.push_back(polygon[c]);
+					}
+				}
+				p += count * itemSize;
+			}
+		}
+		return p;
+	}
+
+	static const uint8_t* skipPlyElement(const PlyElement& element, const uint8_t* data, const uint8_t* end, bool bigEndian)
+	{
+		if (element.fixedSize())
+		{
+			size_t stride = element.stride();
+			if (stride > 0 && (size_t)(end - data) / stride < element.count) return nullptr;
+			return data + element.count * stride;
+		}
+
+		const uint8_t* p = data;
+		for (size_t i = 0; i < element.count; i++)
+		{
+			for (const PlyProperty& property : element.properties)
+			{
+				size_t count = 1;
+				if (property.list)
+				{
+					if (p + typeSize(property.countType) > end) return nullptr;
+					count = (size_t)readValue(p, property.countType, bigEndian);
+					p += typeSize(property.countType);
+				}
+				size_t bytes = count * typeSize(property.type);
+				if ((size_t)(end - p) < bytes) return nullptr;
+				p += bytes;
+			}
+		}
+		return p;
+	}
+
+	// --- wspólne ---
+
+	// Normalne wierzchołków jako suma normalnych sąsiednich trójkątów (ważona polem)
+	static void generateNormals(Mesh& mesh)
+	{
+		vector<glm::vec3> normals(mesh.vertices.size(), glm::vec3(0.0f));
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			unsigned int a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+			glm::vec3 n = glm::cross(mesh.vertices[b].position - mesh.vertices[a].position, mesh.vertices[c].position - mesh.vertices[a].position);
+			normals[a] += n;
+			normals[b] += n;
+			normals[c] += n;
+		}
+
+		ThreadPool::shared().parallelFor(mesh.vertices.size(), [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				float length = glm::length(normals[i]);
+				mesh.vertices[i].normal = length > 0.0f ? normals[i] / length : glm::vec3(0.0f, 1.0f, 0.0f);
+			}
+		}, 1 << 16);
+	}
+};
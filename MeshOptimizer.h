@@ -0,0 +1,390 @@
+﻿#pragma once
+#include "includy.h"
+#include "Mesh.h"
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+/**
+* @struct VertexCacheStats
+* @brief Wynik symulacji bufora wierzchołków po transformacji
+* acmr - średnia liczba transformowanych wierzchołków na trójkąt (0.5 idealnie, 3 najgorzej)
+* atvr - transformacje na unikalny wierzchołek (1 idealnie)
+*/
+struct VertexCacheStats
+{
+	unsigned int transformed = 0;
+	float acmr = 0.0f;
+	float atvr = 0.0f;
+};
+
+/**
+* @struct MeshOptimizeStats
+* @brief Wynik MeshOptimizer::optimize - liczba wierzchołków i bufor wierzchołków przed i po
+*/
+struct MeshOptimizeStats
+{
+	size_t verticesBefore = 0;
+	size_t verticesAfter = 0;
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+/**
+* @class MeshOptimizer
+* @brief Optymalizacja siatek indeksowanych pod bufor wierzchołków, overdraw i odczyt pamięci
+* Kolejność przebiegów: usunięcie duplikatów wierzchołków, kolejność trójkątów pod bufor
+* (algorytm Forsytha), kolejność grup trójkątów pod overdraw, kolejność wierzchołków wg pierwszego użycia
+*/
+class MeshOptimizer
+{
+public:
+	static const int CacheSize = 32;     // bufor zakładany przy układaniu trójkątów
+	static const int FifoCacheSize = 16; // bufor FIFO używany do raportowania ACMR
+
+	// Pełna optymalizacja siatki (wszystkich poziomów LOD); statystyki wypisuje tylko narzędzie --cook-mesh
+	static MeshOptimizeStats optimize(Mesh& mesh)
+	{
+		MeshOptimizeStats stats;
+		stats.before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+		stats.verticesBefore = mesh.vertices.size();
+
+		deduplicate(mesh);
+		for (size_t level = 0; level < mesh.lodCount(); level++)
+		{
+			MeshLod range = mesh.lod(level);
+			vector<unsigned int> lod(mesh.indices.begin() + range.indexOffset, mesh.indices.begin() + range.indexOffset + range.indexCount);
+			optimizeVertexCache(lod, mesh.vertices.size());
+			optimizeOverdraw(lod, mesh.vertices);
+			copy(lod.begin(), lod.end(), mesh.indices.begin() + range.indexOffset);
+		}
+		optimizeVertexFetch(mesh);
+		mesh.invalidate();
+
+		stats.after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+		stats.verticesAfter = mesh.vertices.size();
+		return stats;
+	}
+
+	// Symulacja bufora FIFO o zadanym rozmiarze
+	static VertexCacheStats analyzeVertexCache(const vector<unsigned int>& indices, size_t vertexCount, int cacheSize = FifoCacheSize)
+	{
+		VertexCacheStats stats;
+		vector<unsigned int> timestamps(vertexCount, 0);
+		unsigned int time = cacheSize + 1;
+
+		for (unsigned int index : indices)
+		{
+			if (time - timestamps[index] > (unsigned int)cacheSize)
+			{
+				timestamps[index] = time++;
+				stats.transformed++;
+			}
+		}
+
+		size_t triangles = indices.size() / 3;
+		vector<char> used(vertexCount, 0);
+		size_t unique = 0;
+		for (unsigned int index : indices)
+		{
+			if (!used[index]) { used[index] = 1; unique++; }
+		}
+
+		stats.acmr = triangles ? (float)stats.transformed / triangles : 0.0f;
+		stats.atvr = unique ? (float)stats.transformed / unique : 0.0f;
+		return stats;
+	}
+
+	// Scalenie identycznych wierzchołków (porównanie bajt po bajcie)
+	static void deduplicate(Mesh& mesh)
+	{
+		struct VertexHash
+		{
+			size_t operator()(const Vertex& v) const
+			{
+				uint32_t words[sizeof(Vertex) / 4];
+				memcpy(words, &v, sizeof(Vertex));
+				uint32_t h = 2166136261u;
+				for (uint32_t w : words)
+				{
+					h = (h ^ w) * 16777619u;
+				}
+				return h;
+			}
+		};
+		struct VertexEqual
+		{
+			bool operator()(const Vertex& a, const Vertex& b) const
+			{
+				return memcmp(&a, &b, sizeof(Vertex)) == 0;
+			}
+		};
+
+		unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+		unique.reserve(mesh.vertices.size());
+		vector<unsigned int> remap(mesh.vertices.size());
+		vector<Vertex> vertices;
+		vertices.reserve(mesh.vertices.size());
+
+		for (size_t i = 0; i < mesh.vertices.size(); i++)
+		{
+			auto inserted = unique.emplace(mesh.vertices[i], (unsigned int)vertices.size());
+			if (inserted.second)
+			{
+				vertices.push_back(mesh.vertices[i]);
+			}
+			remap[i] = inserted.first->second;
+		}
+
+		for (unsigned int& index : mesh.indices)
+		{
+			index = remap[index];
+		}
+		mesh.vertices.swap(vertices);
+	}
+
+	// Kolejność trójkątów pod bufor wierzchołków - algorytm Toma Forsytha
+	static void optimizeVertexCache(vector<unsigned int>& indices, size_t vertexCount)
+	{
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		// trójkąty przy każdym wierzchołku (CSR)
+		vector<unsigned int> offsets(vertexCount + 1, 0);
+		for (unsigned int index : indices) offsets[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+		vector<unsigned int> adjacency(indices.size());
+		{
+			vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+			{
+				adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+			}
+		}
+
+		vector<unsigned int> remaining(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++) remaining[v] = offsets[v + 1] - offsets[v];
+
+		vector<float> vertexScore(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++) vertexScore[v] = score(-1, remaining[v]);
+
+		vector<float> triangleScore(triangleCount);
+		vector<char> emitted(triangleCount, 0);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		}
+
+		vector<unsigned int> result;
+		result.reserve(indices.size());
+		vector<unsigned int> cache, newCache;
+		cache.reserve(CacheSize + 3);
+		newCache.reserve(CacheSize + 3);
+
+		size_t scanCursor = 0;
+		int best = -1;
+
+		while (result.size() < indices.size())
+		{
+			if (best < 0)
+			{
+				// brak kandydata w buforze - następny niewyemitowany trójkąt
+				while (scanCursor < triangleCount && emitted[scanCursor]) scanCursor++;
+				if (scanCursor == triangleCount) break;
+				best = (int)scanCursor;
+			}
+
+			emitted[best] = 1;
+			unsigned int tri[3] = { indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2] };
+			result.insert(result.end(), tri, tri + 3);
+
+			// wierzchołki trójkąta na początek bufora, reszta za nimi
+			newCache.assign(tri, tri + 3);
+			for (unsigned int v : cache)
+			{
+				if (v != tri[0] && v != tri[1] && v != tri[2]) newCache.push_back(v);
+			}
+
+			for (unsigned int v : tri)
+			{
+				remaining[v]--;
+				unsigned int* begin = &adjacency[offsets[v]];
+				unsigned int* end = begin + remaining[v] + 1;
+				unsigned int* found = find(begin, end, (unsigned int)best);
+				std::swap(*found, *(end - 1)); // wyemitowane trójkąty za końcem aktywnej listy
+			}
+
+			// nowe oceny wierzchołków (także wypadających z bufora) i ich trójkątów
+			for (size_t i = 0; i < newCache.size(); i++)
+			{
+				unsigned int v = newCache[i];
+				float updated = score(i < (size_t)CacheSize ? (int)i : -1, remaining[v]);
+				float delta = updated - vertexScore[v];
+				vertexScore[v] = updated;
+
+				for (unsigned int k = offsets[v]; k < offsets[v] + remaining[v]; k++)
+				{
+					triangleScore[adjacency[k]] += delta;
+				}
+			}
+			if (newCache.size() > (size_t)CacheSize) newCache.resize(CacheSize);
+			cache.swap(newCache);
+
+			// najlepszy trójkąt wśród sąsiadów wierzchołków z bufora
+			best = -1;
+			float bestScore = -1.0f;
+			for (unsigned int v : cache)
+			{
+				for (unsigned int k = offsets[v]; k < offsets[v] + remaining[v]; k++)
+				{
+					unsigned int t = adjacency[k];
+					if (triangleScore[t] > bestScore)
+					{
+						bestScore = triangleScore[t];
+						best = (int)t;
+					}
+				}
+			}
+		}
+
+		indices.swap(result);
+	}
+
+	// Kolejność grup trójkątów pod overdraw: siatka dzielona w miejscach, gdzie bufor
+	// i tak jest pusty (trójkąt z trzema nowymi wierzchołkami), a grupy skierowane na zewnątrz
+	// idą pierwsze - zasłaniają resztę i test głębokości odrzuca więcej fragmentów
+	static void optimizeOverdraw(vector<unsigned int>& indices, const vector<Vertex>& vertices, int cacheSize = FifoCacheSize)
+	{
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount < 2)
+		{
+			return;
+		}
+
+		// granice grup
+		vector<size_t> clusters;
+		vector<unsigned int> timestamps(vertices.size(), 0);
+		unsigned int time = cacheSize + 1;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			int misses = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int v = indices[t * 3 + k];
+				if (time - timestamps[v] > (unsigned int)cacheSize)
+				{
+					timestamps[v] = time++;
+					misses++;
+				}
+			}
+			if (t == 0 || misses == 3)
+			{
+				clusters.push_back(t);
+			}
+		}
+
+		glm::vec3 meshCenter(0.0f);
+		for (unsigned int index : indices) meshCenter += vertices[index].position;
+		meshCenter /= (float)indices.size();
+
+		struct Cluster
+		{
+			size_t begin, end;
+			float sortKey;
+		};
+		vector<Cluster> sorted;
+		sorted.reserve(clusters.size());
+
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			size_t begin = clusters[c];
+			size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+
+			glm::vec3 center(0.0f), normal(0.0f);
+			float area = 0.0f;
+			for (size_t t = begin; t < end; t++)
+			{
+				const glm::vec3& p0 = vertices[indices[t * 3]].position;
+				const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+				const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+				glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+				float a = glm::length(n);
+				center += (p0 + p1 + p2) * (a / 3.0f);
+				normal += n;
+				area += a;
+			}
+
+			float key = 0.0f;
+			if (area > 0.0f)
+			{
+				center /= area;
+				float len = glm::length(normal);
+				if (len > 0.0f) key = glm::dot(center - meshCenter, normal / len);
+			}
+			sorted.push_back({ begin, end, key });
+		}
+
+		stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+		vector<unsigned int> result;
+		result.reserve(indices.size());
+		for (const Cluster& c : sorted)
+		{
+			result.insert(result.end(), indices.begin() + c.begin * 3, indices.begin() + c.end * 3);
+		}
+		indices.swap(result);
+	}
+
+	// Kolejność wierzchołków wg pierwszego użycia - odczyt pamięci idzie po kolei.
+	// Nieużywane wierzchołki są usuwane
+	static void optimizeVertexFetch(Mesh& mesh)
+	{
+		const unsigned int unused = ~0u;
+		vector<unsigned int> remap(mesh.vertices.size(), unused);
+		vector<Vertex> vertices;
+		vertices.reserve(mesh.vertices.size());
+
+		for (unsigned int& index : mesh.indices)
+		{
+			if (remap[index] == unused)
+			{
+				remap[index] = (unsigned int)vertices.size();
+				vertices.push_back(mesh.vertices[index]);
+			}
+			index = remap[index];
+		}
+		mesh.vertices.swap(vertices);
+	}
+
+private:
+	// Ocena wierzchołka wg pozycji w buforze i liczby pozostałych trójkątów
+	static float score(int cachePosition, unsigned int remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+		{
+			return -1.0f;
+		}
+
+		float result = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				result = 0.75f; // ostatni trójkąt - bez premii, żeby nie trzymać się jednego pasa
+			}
+			else
+			{
+				float scaler = 1.0f / (CacheSize - 3);
+				result = pow(1.0f - (cachePosition - 3) * scaler, 1.5f);
+			}
+		}
+
+		// premia dla wierzchołków z małą liczbą pozostałych trójkątów
+		result += 2.0f * pow((float)remainingTriangles, -0.5f);
+		return result;
+	}
+};
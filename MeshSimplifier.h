@@ -0,0 +1,596 @@
+﻿#pragma once
+#include "includy.h"
+#include "Mesh.h"
+#include "ThreadPool.h"
+#include <queue>
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+
+/**
+* @struct SimplifyOptions
+* @brief Parametry upraszczania siatki
+*/
+struct SimplifyOptions
+{
+	float normalWeight = 0.05f;   // waga różnicy normalnych (względem przekątnej siatki)
+	float colorWeight = 0.05f;    // waga różnicy kolorów
+	float texCoordWeight = 0.05f; // waga różnicy współrzędnych tekstury
+	float borderWeight = 10.0f;   // waga płaszczyzn pilnujących krawędzi brzegowych
+	float maxError = 1e30f;       // przerwanie, gdy błąd kolejnego scalenia przekroczy próg
+	bool lockBorders = false;     // true - wierzchołki brzegowe nie są ruszane
+};
+
+/**
+* @class MeshSimplifier
+* @brief Upraszczanie siatek metodą kwadryk błędu (Garland-Heckbert) ze scalaniem krawędzi
+* Krawędzie czekają w kopcu priorytetowym według kosztu scalenia. Scalanie jest "do wierzchołka"
+* (half-edge collapse), więc nie powstają nowe wierzchołki - wynikiem są same bufory indeksów
+* do oryginalnych wierzchołków, gotowe do rysowania przez Mesh::draw jako kolejne poziomy LOD.
+* Wierzchołki o tej samej pozycji, a różnych normalnych/kolorach (szwy) są scalane razem,
+* a koszt uwzględnia różnicę atrybutów, żeby szwy i granice kolorów zostawały na miejscu
+*/
+class MeshSimplifier
+{
+public:
+	// Uproszczenie do zadanej liczby trójkątów, zwraca indeksy do mesh.vertices.
+	// error (opcjonalnie) - przybliżony błąd geometryczny wyniku w jednostkach siatki
+	static vector<unsigned int> simplify(const Mesh& mesh, size_t targetTriangles, const SimplifyOptions& options = SimplifyOptions(), float* error = nullptr)
+	{
+		MeshSimplifier simplifier(mesh, options);
+		simplifier.run(targetTriangles);
+		if (error)
+		{
+			*error = simplifier.currentError();
+		}
+		return simplifier.liveIndices();
+	}
+
+	// Dopisanie poziomów LOD do siatki - każdy poziom ma ok. ratio trójkątów poprzedniego.
+	// Wszystkie poziomy powstają w jednym przebiegu upraszczania i dzielą wierzchołki siatki
+	static void buildLods(Mesh& mesh, int levels = 4, float ratio = 0.5f, size_t minTriangles = 32, const SimplifyOptions& options = SimplifyOptions())
+	{
+		vector<unsigned int> base(mesh.indices.begin() + mesh.lod(0).indexOffset,
+			mesh.indices.begin() + mesh.lod(0).indexOffset + mesh.lod(0).indexCount);
+
+		Mesh source;
+		source.vertices = mesh.vertices;
+		source.indices = base;
+
+		mesh.indices = base;
+		mesh.lods.clear();
+		mesh.lods.push_back({ 0, (unsigned int)base.size(), 0.0f });
+
+		MeshSimplifier simplifier(source, options);
+		size_t target = base.size() / 3;
+		for (int level = 1; level < levels; level++)
+		{
+			target = (size_t)(target * ratio);
+			if (target < minTriangles)
+			{
+				break;
+			}
+
+			simplifier.run(target);
+			vector<unsigned int> lod = simplifier.liveIndices();
+			if (lod.size() >= mesh.lods.back().indexCount)
+			{
+				break; // dalsze upraszczanie nic nie daje (np. same krawędzie brzegowe)
+			}
+
+			mesh.lods.push_back({ (unsigned int)mesh.indices.size(), (unsigned int)lod.size(), simplifier.currentError() });
+			mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+		}
+		mesh.invalidate();
+	}
+
+	// To samo w tle (np. przy wczytywaniu) - siatka przekazywana przez wartość. Jej dotychczasowe listy
+	// wyświetlania usuwa wątek renderowania (Mesh::deleteReleased), wątek roboczy nie ma kontekstu GL
+	static future<Mesh> buildLodsAsync(Mesh mesh, int levels = 4, float ratio = 0.5f, size_t minTriangles = 32, const SimplifyOptions& options = SimplifyOptions())
+	{
+		auto shared = make_shared<Mesh>(std::move(mesh));
+		shared->releaseDeferred();
+		return ThreadPool::shared().submit([shared, levels, ratio, minTriangles, options]()
+		{
+			buildLods(*shared, levels, ratio, minTriangles, options);
+			return std::move(*shared);
+		});
+	}
+
+private:
+	// Kwadryka błędu - macierz symetryczna 4x4 zapisana jako 10 współczynników
+	struct Quadric
+	{
+		double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+		static Quadric plane(double a, double b, double c, double d, double weight)
+		{
+			Quadric q;
+			q.a2 = a * a * weight; q.ab = a * b * weight; q.ac = a * c * weight; q.ad = a * d * weight;
+			q.b2 = b * b * weight; q.bc = b * c * weight; q.bd = b * d * weight;
+			q.c2 = c * c * weight; q.cd = c * d * weight;
+			q.d2 = d * d * weight;
+			return q;
+		}
+
+		void add(const Quadric& q)
+		{
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2;
+			bc += q.bc; bd += q.bd; c2 += q.c2; cd += q.cd; d2 += q.d2;
+		}
+
+		double error(const glm::vec3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+				+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+				+ c2 * z * z + 2 * cd * z + d2;
+		}
+	};
+
+	// Kandydat do scalenia from -> to; wersje pozwalają odrzucić nieaktualne wpisy kopca
+	struct Collapse
+	{
+		float cost;
+		unsigned int from, to;
+		unsigned int fromVersion, toVersion;
+
+		bool operator<(const Collapse& other) const
+		{
+			return cost > other.cost; // kopiec minimalny
+		}
+	};
+
+	const Mesh& mesh;
+	SimplifyOptions options;
+	float attributeScale;
+
+	vector<unsigned int> triangles;     // indeksy wierzchołków (atrybutów), aktualizowane przy scaleniach
+	vector<char> triangleDead;
+	size_t liveTriangles = 0;
+
+	vector<unsigned int> vertexClass;   // wierzchołek -> klasa pozycji (pierwszy wierzchołek o tej pozycji)
+	vector<unsigned int> memberStart;   // członkowie klasy c: members[memberStart[c] .. memberStart[c + 1])
+	vector<unsigned int> members;
+	vector<vector<unsigned int>> classTriangles;
+	vector<Quadric> quadrics;
+	vector<unsigned int> versions;
+	vector<char> border;
+	vector<char> removed;
+
+	priority_queue<Collapse> heap;
+	double maxCollapseCost = 0.0;
+
+	MeshSimplifier(const Mesh& source, const SimplifyOptions& opts)
+		: mesh(source), options(opts)
+	{
+		glm::vec3 bmin = source.vertices.empty() ? glm::vec3(0.0f) : source.vertices[0].position;
+		glm::vec3 bmax = bmin;
+		for (const Vertex& v : source.vertices)
+		{
+			bmin = glm::min(bmin, v.position);
+			bmax = glm::max(bmax, v.position);
+		}
+		attributeScale = glm::length(bmax - bmin);
+
+		triangles = source.indices;
+		triangleDead.assign(triangles.size() / 3, 0);
+		liveTriangles = triangles.size() / 3;
+
+		weldPositions();
+		buildAdjacency();
+		computeQuadrics();
+	}
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& p) const
+		{
+			uint32_t h[3];
+			memcpy(h, &p.x, sizeof(h));
+			return (size_t)(h[0] * 73856093u ^ h[1] * 19349663u ^ h[2] * 83492791u);
+		}
+	};
+
+	struct PositionEqual
+	{
+		bool operator()(const glm::vec3& a, const glm::vec3& b) const
+		{
+			return a.x == b.x && a.y == b.y && a.z == b.z;
+		}
+	};
+
+	// Łączenie wierzchołków o identycznej pozycji w klasy
+	void weldPositions()
+	{
+		size_t count = mesh.vertices.size();
+		vertexClass.resize(count);
+
+		unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> firstAt;
+		firstAt.reserve(count);
+		for (unsigned int v = 0; v < count; v++)
+		{
+			auto inserted = firstAt.emplace(mesh.vertices[v].position, v);
+			vertexClass[v] = inserted.first->second;
+		}
+
+		memberStart.assign(count + 1, 0);
+		for (unsigned int v = 0; v < count; v++)
+		{
+			memberStart[vertexClass[v] + 1]++;
+		}
+		for (size_t c = 0; c < count; c++)
+		{
+			memberStart[c + 1] += memberStart[c];
+		}
+
+		members.resize(count);
+		vector<unsigned int> fill(memberStart.begin(), memberStart.end() - 1);
+		for (unsigned int v = 0; v < count; v++)
+		{
+			members[fill[vertexClass[v]]++] = v;
+		}
+	}
+
+	void buildAdjacency()
+	{
+		size_t count = mesh.vertices.size();
+		classTriangles.assign(count, vector<unsigned int>());
+		for (unsigned int t = 0; t < triangleDead.size(); t++)
+		{
+			unsigned int a = vertexClass[triangles[t * 3]];
+			unsigned int b = vertexClass[triangles[t * 3 + 1]];
+			unsigned int c = vertexClass[triangles[t * 3 + 2]];
+			if (a == b || b == c || a == c)
+			{
+				triangleDead[t] = 1; // trójkąt zdegenerowany już na wejściu
+				liveTriangles--;
+				continue;
+			}
+			classTriangles[a].push_back(t);
+			classTriangles[b].push_back(t);
+			classTriangles[c].push_back(t);
+		}
+
+		versions.assign(count, 0);
+		removed.assign(count, 0);
+		border.assign(count, 0);
+	}
+
+	// Kwadryki płaszczyzn trójkątów oraz płaszczyzn prostopadłych na krawędziach brzegowych,
+	// na końcu każda krawędź trafia raz do kopca
+	void computeQuadrics()
+	{
+		quadrics.assign(mesh.vertices.size(), Quadric());
+
+		vector<pair<uint64_t, unsigned int>> edges;
+		edges.reserve(liveTriangles * 3);
+
+		for (unsigned int t = 0; t < triangleDead.size(); t++)
+		{
+			if (triangleDead[t]) continue;
+
+			unsigned int c[3] = { vertexClass[triangles[t * 3]], vertexClass[triangles[t * 3 + 1]], vertexClass[triangles[t * 3 + 2]] };
+			glm::vec3 p0 = position(c[0]), p1 = position(c[1]), p2 = position(c[2]);
+			glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(n);
+			if (area > 0.0f)
+			{
+				n /= area;
+				Quadric q = Quadric::plane(n.x, n.y, n.z, -glm::dot(n, p0), 1.0);
+				for (int k = 0; k < 3; k++)
+				{
+					quadrics[c[k]].add(q);
+				}
+			}
+
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int a = c[k], b = c[(k + 1) % 3];
+				uint64_t key = a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+				edges.push_back(make_pair(key, t));
+			}
+		}
+
+		// krawędź użyta przez jeden trójkąt = brzeg (lub szew UV/normalnych przed połączeniem klas)
+		sort(edges.begin(), edges.end());
+		for (size_t i = 0; i < edges.size();)
+		{
+			size_t j = i + 1;
+			while (j < edges.size() && edges[j].first == edges[i].first) j++;
+
+			if (j - i == 1)
+			{
+				unsigned int a = (unsigned int)(edges[i].first >> 32);
+				unsigned int b = (unsigned int)(edges[i].first & 0xffffffffu);
+				unsigned int t = edges[i].second;
+				border[a] = border[b] = 1;
+
+				glm::vec3 p0 = position(vertexClass[triangles[t * 3]]);
+				glm::vec3 p1 = position(vertexClass[triangles[t * 3 + 1]]);
+				glm::vec3 p2 = position(vertexClass[triangles[t * 3 + 2]]);
+				glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+				glm::vec3 edge = position(b) - position(a);
+				glm::vec3 n = glm::cross(edge, faceNormal);
+				float len = glm::length(n);
+				if (len > 0.0f)
+				{
+					n /= len;
+					double weight = options.borderWeight * glm::dot(edge, edge);
+					Quadric q = Quadric::plane(n.x, n.y, n.z, -glm::dot(n, position(a)), weight);
+					quadrics[a].add(q);
+					quadrics[b].add(q);
+				}
+			}
+			i = j;
+		}
+
+		uint64_t previous = ~(uint64_t)0;
+		for (const auto& edge : edges)
+		{
+			if (edge.first != previous)
+			{
+				pushCandidate((unsigned int)(edge.first >> 32), (unsigned int)(edge.first & 0xffffffffu));
+				previous = edge.first;
+			}
+		}
+	}
+
+	glm::vec3 position(unsigned int cls) const
+	{
+		return mesh.vertices[cls].position;
+	}
+
+	float attributeDistance(unsigned int v, unsigned int w) const
+	{
+		const Vertex& a = mesh.vertices[v];
+		const Vertex& b = mesh.vertices[w];
+		float dn = glm::length(a.normal - b.normal) * options.normalWeight;
+		float dc = glm::length(a.color - b.color) * options.colorWeight;
+		float dt = glm::length(a.texCoord - b.texCoord) * options.texCoordWeight;
+		return (dn * dn + dc * dc + dt * dt) * attributeScale * attributeScale;
+	}
+
+	// Wierzchołek klasy to, który przejmie rolę wierzchołka v (najbliższy atrybutami)
+	unsigned int attributeTarget(unsigned int v, unsigned int to, float* distance = nullptr) const
+	{
+		unsigned int best = members[memberStart[to]];
+		float bestDistance = 1e30f;
+		for (unsigned int i = memberStart[to]; i < memberStart[to + 1]; i++)
+		{
+			float d = attributeDistance(v, members[i]);
+			if (d < bestDistance)
+			{
+				bestDistance = d;
+				best = members[i];
+			}
+		}
+		if (distance)
+		{
+			*distance = bestDistance;
+		}
+		return best;
+	}
+
+	float collapseCost(unsigned int from, unsigned int to) const
+	{
+		Quadric q = quadrics[from];
+		q.add(quadrics[to]);
+		double cost = std::max(0.0, q.error(position(to)));
+
+		for (unsigned int i = memberStart[from]; i < memberStart[from + 1]; i++)
+		{
+			float d;
+			attributeTarget(members[i], to, &d);
+			cost += d;
+		}
+		return (float)cost;
+	}
+
+	void pushCandidate(unsigned int a, unsigned int b)
+	{
+		if (options.lockBorders && (border[a] || border[b]))
+		{
+			return;
+		}
+
+		// z brzegu można zejść tylko wzdłuż brzegu
+		bool canAB = !border[a] || border[b];
+		bool canBA = !border[b] || border[a];
+		float costAB = canAB ? collapseCost(a, b) : 1e30f;
+		float costBA = canBA ? collapseCost(b, a) : 1e30f;
+		if (!canAB && !canBA)
+		{
+			return;
+		}
+
+		if (costAB <= costBA)
+		{
+			heap.push({ costAB, a, b, versions[a], versions[b] });
+		}
+		else
+		{
+			heap.push({ costBA, b, a, versions[b], versions[a] });
+		}
+	}
+
+	// Sprawdzenie, czy scalenie nie odwróci ani nie zdegeneruje trójkątów i nie zepsuje topologii
+	bool isValid(unsigned int from, unsigned int to)
+	{
+		glm::vec3 target = position(to);
+		size_t shared = 0;
+		vector<unsigned int>& neighboursFrom = scratchA;
+		vector<unsigned int>& neighboursTo = scratchB;
+		neighboursFrom.clear();
+		neighboursTo.clear();
+
+		for (unsigned int t : classTriangles[from])
+		{
+			if (triangleDead[t]) continue;
+
+			unsigned int c[3] = { vertexClass[triangles[t * 3]], vertexClass[triangles[t * 3 + 1]], vertexClass[triangles[t * 3 + 2]] };
+			for (int k = 0; k < 3; k++)
+			{
+				if (c[k] != from && c[k] != to) neighboursFrom.push_back(c[k]);
+			}
+
+			if (c[0] == to || c[1] == to || c[2] == to)
+			{
+				shared++;
+				continue;
+			}
+
+			glm::vec3 p[3] = { position(c[0]), position(c[1]), position(c[2]) };
+			glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+			for (int k = 0; k < 3; k++)
+			{
+				if (c[k] == from) p[k] = target;
+			}
+			glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+			float lenBefore = glm::length(before), lenAfter = glm::length(after);
+			if (lenAfter <= 1e-12f || glm::dot(before, after) < 0.2f * lenBefore * lenAfter)
+			{
+				return false;
+			}
+		}
+
+		if (shared == 0)
+		{
+			return false; // krawędź już nie istnieje
+		}
+
+		// warunek łącza: wspólni sąsiedzi tylko po drugiej stronie scalanej krawędzi
+		for (unsigned int t : classTriangles[to])
+		{
+			if (triangleDead[t]) continue;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int c = vertexClass[triangles[t * 3 + k]];
+				if (c != to && c != from) neighboursTo.push_back(c);
+			}
+		}
+		sort(neighboursFrom.begin(), neighboursFrom.end());
+		neighboursFrom.erase(unique(neighboursFrom.begin(), neighboursFrom.end()), neighboursFrom.end());
+		sort(neighboursTo.begin(), neighboursTo.end());
+		neighboursTo.erase(unique(neighboursTo.begin(), neighboursTo.end()), neighboursTo.end());
+
+		size_t common = 0;
+		for (size_t i = 0, j = 0; i < neighboursFrom.size() && j < neighboursTo.size();)
+		{
+			if (neighboursFrom[i] < neighboursTo[j]) i++;
+			else if (neighboursFrom[i] > neighboursTo[j]) j++;
+			else { common++; i++; j++; }
+		}
+		// każdy trójkąt ze scalaną krawędzią daje jednego wspólnego sąsiada, więcej oznacza
+		// zlepienie dwóch płatów powierzchni w jednej krawędzi
+		return common == shared;
+	}
+
+	vector<unsigned int> scratchA, scratchB;
+
+	void collapse(unsigned int from, unsigned int to)
+	{
+		for (unsigned int t : classTriangles[from])
+		{
+			if (triangleDead[t]) continue;
+
+			bool degenerate = false;
+			for (int k = 0; k < 3; k++)
+			{
+				if (vertexClass[triangles[t * 3 + k]] == to) degenerate = true;
+			}
+
+			if (degenerate)
+			{
+				triangleDead[t] = 1;
+				liveTriangles--;
+				continue;
+			}
+
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int& v = triangles[t * 3 + k];
+				if (vertexClass[v] == from)
+				{
+					v = attributeTarget(v, to);
+				}
+			}
+			classTriangles[to].push_back(t);
+		}
+
+		vector<unsigned int>().swap(classTriangles[from]);
+		quadrics[to].add(quadrics[from]);
+		removed[from] = 1;
+		versions[from]++;
+		versions[to]++;
+
+		// usunięcie martwych trójkątów z listy i nowe kandydatury dla krawędzi wokół "to"
+		vector<unsigned int>& list = classTriangles[to];
+		list.erase(remove_if(list.begin(), list.end(), [this](unsigned int t) { return triangleDead[t] != 0; }), list.end());
+
+		vector<unsigned int>& neighbours = scratchA;
+		neighbours.clear();
+		for (unsigned int t : list)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int c = vertexClass[triangles[t * 3 + k]];
+				if (c != to) neighbours.push_back(c);
+			}
+		}
+		sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(unique(neighbours.begin(), neighbours.end()), neighbours.end());
+		for (unsigned int n : neighbours)
+		{
+			pushCandidate(to, n);
+		}
+	}
+
+	void run(size_t targetTriangles)
+	{
+		double maxCost = (double)options.maxError * options.maxError;
+
+		while (liveTriangles > targetTriangles && !heap.empty())
+		{
+			Collapse top = heap.top();
+			if (top.cost > maxCost)
+			{
+				break;
+			}
+			heap.pop();
+
+			if (removed[top.from] || removed[top.to] || versions[top.from] != top.fromVersion || versions[top.to] != top.toVersion)
+			{
+				continue; // wpis nieaktualny
+			}
+
+			if (!isValid(top.from, top.to))
+			{
+				continue;
+			}
+
+			maxCollapseCost = std::max(maxCollapseCost, (double)top.cost);
+			collapse(top.from, top.to);
+		}
+	}
+
+	float currentError() const
+	{
+		return (float)sqrt(maxCollapseCost);
+	}
+
+	vector<unsigned int> liveIndices() const
+	{
+		vector<unsigned int> result;
+		result.reserve(liveTriangles * 3);
+		for (size_t t = 0; t < triangleDead.size(); t++)
+		{
+			if (!triangleDead[t])
+			{
+				result.insert(result.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+			}
+		}
+		return result;
+	}
+};
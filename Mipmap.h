@@ -0,0 +1,464 @@
+﻿#pragma once
+#include "includy.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPMAP_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__) || defined(__AVX__)
+#define MIPMAP_SSSE3
+#include <tmmintrin.h>
+#endif
+
+/**
+* @struct ImageLevel
+* @brief Jeden poziom mipmapy w formacie RGBA8
+*/
+struct ImageLevel
+{
+	int width = 0;
+	int height = 0;
+	vector<uint8_t> pixels;
+};
+
+enum class MipFilter
+{
+	Box,    // średnia 2x2
+	Kaiser  // okienkowany sinc 8x8 - ostrzejsze mipmapy, wolniej
+};
+
+/**
+* @struct MipOptions
+* @brief Sposób liczenia mipmap
+*/
+struct MipOptions
+{
+	MipFilter filter = MipFilter::Box;
+	bool srgb = false;             // kolory w sRGB - uśrednianie w przestrzeni liniowej
+	bool premultiplyAlpha = false; // przemnożenie kolorów przez alfę przed filtrowaniem
+
+	bool operator<(const MipOptions& other) const
+	{
+		if (filter != other.filter) return filter < other.filter;
+		if (srgb != other.srgb) return srgb < other.srgb;
+		return premultiplyAlpha < other.premultiplyAlpha;
+	}
+};
+
+/**
+* @class Mipmap
+* @brief Konwersje formatów i liczenie łańcucha mipmap na CPU (zamiast gluBuild2DMipmaps).
+* Filtr pudełkowy bez sRGB działa na liczbach całkowitych (SSE2), pozostałe przypadki na float4 w przestrzeni liniowej.
+* Każdy poziom dzielony jest na pasy wierszy liczone równolegle na ThreadPool::shared()
+*/
+class Mipmap
+{
+public:
+	// Konwersja 1-4 kanałów (szarość, szarość+alfa, RGB, RGBA) do RGBA8
+	static void toRgba(const uint8_t* src, int channels, uint8_t* dst, size_t pixels)
+	{
+		switch (channels)
+		{
+		case 4:
+			memcpy(dst, src, pixels * 4);
+			break;
+		case 3:
+			rgbToRgba(src, dst, pixels);
+			break;
+		case 2:
+			for (size_t i = 0; i < pixels; i++)
+			{
+				dst[i * 4 + 0] = dst[i * 4 + 1] = dst[i * 4 + 2] = src[i * 2];
+				dst[i * 4 + 3] = src[i * 2 + 1];
+			}
+			break;
+		default:
+			for (size_t i = 0; i < pixels; i++)
+			{
+				dst[i * 4 + 0] = dst[i * 4 + 1] = dst[i * 4 + 2] = src[i];
+				dst[i * 4 + 3] = 255;
+			}
+			break;
+		}
+	}
+
+	static void rgbToRgba(const uint8_t* src, uint8_t* dst, size_t pixels)
+	{
+		size_t i = 0;
+#ifdef MIPMAP_SSSE3
+		// 4 piksele na krok, odczyt 16 bajtów z 12 potrzebnych - stąd zapas 6 pikseli
+		const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+		for (; i + 6 <= pixels; i += 4)
+		{
+			__m128i rgb = _mm_loadu_si128((const __m128i*)(src + i * 3));
+			_mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+		}
+#endif
+		for (; i < pixels; i++)
+		{
+			uint32_t pixel = src[i * 3] | (src[i * 3 + 1] << 8) | (src[i * 3 + 2] << 16) | 0xFF000000u;
+			memcpy(dst + i * 4, &pixel, 4);
+		}
+	}
+
+	// Przemnożenie kolorów przez alfę (w sRGB - w przestrzeni liniowej)
+	static void premultiply(ImageLevel& image, bool srgb)
+	{
+		uint8_t* pixels = image.pixels.data();
+		size_t count = (size_t)image.width * image.height;
+
+		if (srgb)
+		{
+			const float* toLinear = srgbToLinearTable();
+			ThreadPool::shared().parallelFor(count, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					uint8_t* p = pixels + i * 4;
+					float a = p[3] / 255.0f;
+					for (int c = 0; c < 3; c++)
+					{
+						p[c] = linearToSrgb(toLinear[p[c]] * a);
+					}
+				}
+			}, 1 << 16);
+			return;
+		}
+
+		ThreadPool::shared().parallelFor(count, [&](size_t begin, size_t end)
+		{
+			size_t i = begin;
+#ifdef MIPMAP_SSE2
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i bias = _mm_set1_epi16(128);
+			const __m128i alphaMask = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+			for (; i + 4 <= end; i += 4)
+			{
+				__m128i rgba = _mm_loadu_si128((const __m128i*)(pixels + i * 4));
+				__m128i halves[2] = { _mm_unpacklo_epi8(rgba, zero), _mm_unpackhi_epi8(rgba, zero) };
+				for (__m128i& v : halves)
+				{
+					// alfa każdego piksela rozgłoszona na jego 4 kanały
+					__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+					a = _mm_or_si128(_mm_andnot_si128(alphaMask, a), _mm_and_si128(alphaMask, _mm_set1_epi16(255)));
+					// dokładne (x * a) / 255 z zaokrągleniem
+					__m128i t = _mm_add_epi16(_mm_mullo_epi16(v, a), bias);
+					v = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+				}
+				_mm_storeu_si128((__m128i*)(pixels + i * 4), _mm_packus_epi16(halves[0], halves[1]));
+			}
+#endif
+			for (; i < end; i++)
+			{
+				uint8_t* p = pixels + i * 4;
+				for (int c = 0; c < 3; c++)
+				{
+					unsigned t = p[c] * p[3] + 128;
+					p[c] = (uint8_t)((t + (t >> 8)) >> 8);
+				}
+			}
+		}, 1 << 16);
+	}
+
+	// Jeden poziom w dół (wymiary połówkowe, zaokrąglone w dół, co najmniej 1)
+	static ImageLevel downsample(const ImageLevel& src, const MipOptions& options)
+	{
+		ImageLevel dst;
+		dst.width = std::max(1, src.width / 2);
+		dst.height = std::max(1, src.height / 2);
+		dst.pixels.resize((size_t)dst.width * dst.height * 4);
+
+		// pasy po ok. 16 tys. pikseli wyjściowych
+		size_t grain = std::max<size_t>(1, 16384 / dst.width);
+		ThreadPool::shared().parallelFor(dst.height, [&](size_t begin, size_t end)
+		{
+			if (options.filter == MipFilter::Kaiser)
+			{
+				kaiserRows(src, dst, (int)begin, (int)end, options.srgb);
+			}
+			else if (options.srgb)
+			{
+				boxRowsLinear(src, dst, (int)begin, (int)end);
+			}
+			else
+			{
+				boxRows(src, dst, (int)begin, (int)end);
+			}
+		}, grain);
+		return dst;
+	}
+
+	// Łańcuch mipmap aż do 1x1, levels[0] to obraz wejściowy
+	static void buildChain(vector<ImageLevel>& levels, const MipOptions& options = MipOptions())
+	{
+		if (options.premultiplyAlpha)
+		{
+			premultiply(levels[0], options.srgb);
+		}
+
+		while (levels.back().width > 1 || levels.back().height > 1)
+		{
+			ImageLevel next = downsample(levels.back(), options);
+			levels.push_back(std::move(next));
+		}
+	}
+
+private:
+	// Średnia 2x2 na bajtach, dla nieparzystych wymiarów ostatni wiersz/kolumna jest pomijany
+	static void boxRows(const ImageLevel& src, ImageLevel& dst, int begin, int end)
+	{
+		for (int y = begin; y < end; y++)
+		{
+			const uint8_t* row0 = &src.pixels[(size_t)std::min(y * 2, src.height - 1) * src.width * 4];
+			const uint8_t* row1 = &src.pixels[(size_t)std::min(y * 2 + 1, src.height - 1) * src.width * 4];
+			uint8_t* out = &dst.pixels[(size_t)y * dst.width * 4];
+
+			int x = 0;
+#ifdef MIPMAP_SSE2
+			if (src.width > 1)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i two = _mm_set1_epi16(2);
+				for (; x + 4 <= dst.width; x += 4)
+				{
+					// 8 pikseli źródłowych z każdego wiersza -> 4 piksele wyjściowe
+					__m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+					__m128i a1 = _mm_loadu_si128((const __m128i*)(row0 + x * 8 + 16));
+					__m128i b0 = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+					__m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + x * 8 + 16));
+
+					__m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+					__m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+					__m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+					__m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+					// suma sąsiednich pikseli w poziomie (dolna połowa rejestru)
+					s0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+					s1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+					s2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8));
+					s3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+
+					__m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s0, s1), two), 2);
+					__m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s2, s3), two), 2);
+					_mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(lo, hi));
+				}
+			}
+#endif
+			for (; x < dst.width; x++)
+			{
+				int x0 = std::min(x * 2, src.width - 1) * 4, x1 = std::min(x * 2 + 1, src.width - 1) * 4;
+				for (int c = 0; c < 4; c++)
+				{
+					out[x * 4 + c] = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+				}
+			}
+		}
+	}
+
+	// Średnia 2x2 w przestrzeni liniowej (kolory sRGB, alfa liniowa)
+	static void boxRowsLinear(const ImageLevel& src, ImageLevel& dst, int begin, int end)
+	{
+		vector<float> row0(src.width * 4), row1(src.width * 4);
+		for (int y = begin; y < end; y++)
+		{
+			decodeRow(src, std::min(y * 2, src.height - 1), row0.data(), true);
+			decodeRow(src, std::min(y * 2 + 1, src.height - 1), row1.data(), true);
+
+			vector<float> sum(dst.width * 4);
+			for (int x = 0; x < dst.width; x++)
+			{
+				int x0 = std::min(x * 2, src.width - 1) * 4, x1 = std::min(x * 2 + 1, src.width - 1) * 4;
+				addPixel(&sum[x * 4], &row0[x0], 0.25f);
+				addPixel(&sum[x * 4], &row0[x1], 0.25f);
+				addPixel(&sum[x * 4], &row1[x0], 0.25f);
+				addPixel(&sum[x * 4], &row1[x1], 0.25f);
+			}
+			encodeRow(sum.data(), &dst.pixels[(size_t)y * dst.width * 4], dst.width, true);
+		}
+	}
+
+	// Rozdzielny filtr Kaisera 8 próbek w każdym kierunku
+	static void kaiserRows(const ImageLevel& src, ImageLevel& dst, int begin, int end, bool srgb)
+	{
+		const float* weights = kaiserWeights();
+
+		// wiersze źródła potrzebne dla pasa [begin, end), przefiltrowane w poziomie
+		int firstRow = begin * 2 - 3;
+		int rowCount = (end - begin) * 2 + 6;
+		vector<float> filtered((size_t)rowCount * dst.width * 4);
+		vector<float> row(src.width * 4);
+
+		for (int r = 0; r < rowCount; r++)
+		{
+			int sy = std::min(std::max(firstRow + r, 0), src.height - 1);
+			decodeRow(src, sy, row.data(), srgb);
+
+			float* out = &filtered[(size_t)r * dst.width * 4];
+			for (int x = 0; x < dst.width; x++)
+			{
+				float* pixel = out + x * 4;
+				pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0.0f;
+				for (int k = 0; k < 8; k++)
+				{
+					int sx = std::min(std::max(x * 2 - 3 + k, 0), src.width - 1);
+					addPixel(pixel, &row[sx * 4], weights[k]);
+				}
+			}
+		}
+
+		vector<float> sum(dst.width * 4);
+		for (int y = begin; y < end; y++)
+		{
+			std::fill(sum.begin(), sum.end(), 0.0f);
+			for (int k = 0; k < 8; k++)
+			{
+				const float* in = &filtered[(size_t)((y - begin) * 2 + k) * dst.width * 4];
+				for (int x = 0; x < dst.width; x++)
+				{
+					addPixel(&sum[x * 4], in + x * 4, weights[k]);
+				}
+			}
+			encodeRow(sum.data(), &dst.pixels[(size_t)y * dst.width * 4], dst.width, srgb);
+		}
+	}
+
+	static inline void addPixel(float* sum, const float* pixel, float weight)
+	{
+#ifdef MIPMAP_SSE2
+		_mm_storeu_ps(sum, _mm_add_ps(_mm_loadu_ps(sum), _mm_mul_ps(_mm_loadu_ps(pixel), _mm_set1_ps(weight))));
+#else
+		for (int c = 0; c < 4; c++) sum[c] += pixel[c] * weight;
+#endif
+	}
+
+	static void decodeRow(const ImageLevel& image, int y, float* out, bool srgb)
+	{
+		const uint8_t* in = &image.pixels[(size_t)y * image.width * 4];
+		const float* toLinear = srgb ? srgbToLinearTable() : unormTable();
+		const float* alpha = unormTable();
+		for (int x = 0; x < image.width; x++)
+		{
+			out[x * 4 + 0] = toLinear[in[x * 4 + 0]];
+			out[x * 4 + 1] = toLinear[in[x * 4 + 1]];
+			out[x * 4 + 2] = toLinear[in[x * 4 + 2]];
+			out[x * 4 + 3] = alpha[in[x * 4 + 3]];
+		}
+	}
+
+	static void encodeRow(const float* in, uint8_t* out, int width, bool srgb)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				out[x * 4 + c] = srgb ? linearToSrgb(in[x * 4 + c]) : unorm(in[x * 4 + c]);
+			}
+			out[x * 4 + 3] = unorm(in[x * 4 + 3]);
+		}
+	}
+
+	static inline uint8_t unorm(float v)
+	{
+		v = std::min(std::max(v, 0.0f), 1.0f);
+		return (uint8_t)(v * 255.0f + 0.5f);
+	}
+
+	static inline uint8_t linearToSrgb(float v)
+	{
+		v = std::min(std::max(v, 0.0f), 1.0f);
+		return linearToSrgbTable()[(int)(v * 4095.0f + 0.5f)];
+	}
+
+	static const float* unormTable()
+	{
+		struct Table
+		{
+			float values[256];
+			Table() { for (int i = 0; i < 256; i++) values[i] = i / 255.0f; }
+		};
+		static const Table table;
+		return table.values;
+	}
+
+	static const float* srgbToLinearTable()
+	{
+		struct Table
+		{
+			float values[256];
+			Table()
+			{
+				for (int i = 0; i < 256; i++)
+				{
+					float c = i / 255.0f;
+					values[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+				}
+			}
+		};
+		static const Table table;
+		return table.values;
+	}
+
+	static const uint8_t* linearToSrgbTable()
+	{
+		struct Table
+		{
+			uint8_t values[4096];
+			Table()
+			{
+				for (int i = 0; i < 4096; i++)
+				{
+					float c = i / 4095.0f;
+					float s = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+					values[i] = (uint8_t)(std::min(std::max(s, 0.0f), 1.0f) * 255.0f + 0.5f);
+				}
+			}
+		};
+		static const Table table;
+		return table.values;
+	}
+
+	// Wagi dla zmniejszenia 2x: próbki w odległości +-0.25, 0.75, 1.25, 1.75 piksela wyjściowego, alfa = 4
+	static const float* kaiserWeights()
+	{
+		struct Table
+		{
+			float values[8];
+			Table()
+			{
+				const double alpha = 4.0, radius = 2.0;
+				double sum = 0.0;
+				for (int k = 0; k < 8; k++)
+				{
+					double t = (k - 3.5) * 0.5;
+					double sinc = t == 0.0 ? 1.0 : sin(3.14159265358979323846 * t) / (3.14159265358979323846 * t);
+					double r = t / radius;
+					double window = besselI0(alpha * sqrt(std::max(0.0, 1.0 - r * r))) / besselI0(alpha);
+					values[k] = (float)(sinc * window);
+					sum += values[k];
+				}
+				for (int k = 0; k < 8; k++)
+				{
+					values[k] = (float)(values[k] / sum);
+				}
+			}
+		};
+		static const Table table;
+		return table.values;
+	}
+
+	static double besselI0(double x)
+	{
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 32; k++)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+		return sum;
+	}
+};
@@ -0,0 +1,198 @@
+﻿#pragma once
+#include "includy.h"
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+/**
+* @class PerfCounters
+* @brief Rejestr liczników wydajności klatki. Licznik to indeks w tablicy, więc add() to jedno dodawanie -
+* bez szukania po nazwie i bez alokacji (nazwy tylko do wyświetlania). Czas CPU klatki dzielony jest na fazy:
+* phase() zamyka bieżącą fazę i otwiera następną jednym odczytem zegara, do fazy można wracać.
+* endFrame() przepisuje liczniki i czasy do "ostatniej klatki" i dopisuje czas klatki do historii.
+* Tylko wątek renderowania
+*/
+class PerfCounters
+{
+public:
+	enum Counter
+	{
+		DrawCalls,
+		Triangles,
+		StateChanges,     // materiał, program GLSL, światło w slocie
+		VisibleObjects,
+		CulledObjects,
+		BuiltinCounters
+	};
+
+	enum Phase
+	{
+		Update,           // przeładowania, tekstury, strumieniowanie
+		Lighting,         // odrzucanie świateł, klastry
+		ShadowMaps,
+		Scene,            // kolejka i obiekty wbudowane
+		Overlay,          // tekst i HUD
+		Present,          // glutSwapBuffers (czekanie na GPU / synchronizację pionową)
+		PhaseCount
+	};
+
+	static const int MaxCounters = 32;
+	static const int HistorySize = 240;   // klatki na wykresie
+
+	// Licznik o danej nazwie (ten sam przy ponownym wywołaniu), -1 - brak miejsca
+	static int declare(const char* name)
+	{
+		for (int i = 0; i < counters; i++)
+		{
+			if (strcmp(names[i], name) == 0)
+			{
+				return i;
+			}
+		}
+		if (counters == MaxCounters)
+		{
+			return -1;
+		}
+		names[counters] = name;
+		return counters++;
+	}
+
+	static void add(int counter, int64_t value = 1)
+	{
+		current[counter] += value;
+	}
+
+	// Wartość z ostatniej zakończonej klatki
+	static int64_t value(int counter)
+	{
+		return last[counter];
+	}
+
+	static const char* name(int counter)
+	{
+		return names[counter];
+	}
+
+	static int counterCount()
+	{
+		return counters;
+	}
+
+	// Początek klatki - otwiera fazę Update
+	static void beginFrame()
+	{
+		Clock::time_point now = Clock::now();
+		if (started)
+		{
+			frameTime = chrono::duration<float, milli>(now - frameStart).count();
+			history[historyNext] = frameTime;
+			historyNext = (historyNext + 1) % HistorySize;
+			historyCount = std::min(historyCount + 1, HistorySize);
+		}
+		started = true;
+		frameStart = now;
+		phaseStart = now;
+		currentPhase = Update;
+	}
+
+	static void phase(Phase next)
+	{
+		Clock::time_point now = Clock::now();
+		phaseTimes[currentPhase] += chrono::duration<float, milli>(now - phaseStart).count();
+		phaseStart = now;
+		currentPhase = next;
+	}
+
+	// Koniec klatki (po glutSwapBuffers)
+	static void endFrame()
+	{
+		phase(currentPhase);
+		memcpy(last, current, sizeof(current));
+		memset(current, 0, sizeof(current));
+		memcpy(lastPhaseTimes, phaseTimes, sizeof(phaseTimes));
+		memset(phaseTimes, 0, sizeof(phaseTimes));
+		frames++;
+	}
+
+	static float phaseMs(Phase phase)
+	{
+		return lastPhaseTimes[phase];
+	}
+
+	static const char* phaseName(Phase phase)
+	{
+		static const char* const phaseNames[PhaseCount] = { "Update", "Lighting", "Shadows", "Scene", "Overlay", "Present" };
+		return phaseNames[phase];
+	}
+
+	// Czas CPU ostatniej klatki (suma faz)
+	static float cpuMs()
+	{
+		float total = 0.0f;
+		for (float time : lastPhaseTimes)
+		{
+			total += time;
+		}
+		return total;
+	}
+
+	// Odstęp między dwoma ostatnimi początkami klatek
+	static float frameMs()
+	{
+		return frameTime;
+	}
+
+	static uint64_t frameCount()
+	{
+		return frames;
+	}
+
+	// Czasy klatek do wykresu: 0 - najstarszy, historyLength() - 1 - ostatni
+	static int historyLength()
+	{
+		return historyCount;
+	}
+
+	static float historyAt(int i)
+	{
+		return history[(historyNext - historyCount + i + HistorySize) % HistorySize];
+	}
+
+private:
+	typedef chrono::steady_clock Clock;
+
+	static const char* names[MaxCounters];
+	static int counters;
+	static int64_t current[MaxCounters];
+	static int64_t last[MaxCounters];
+
+	static float phaseTimes[PhaseCount];
+	static float lastPhaseTimes[PhaseCount];
+	static Phase currentPhase;
+	static Clock::time_point phaseStart;
+	static Clock::time_point frameStart;
+	static bool started;
+	static float frameTime;
+	static uint64_t frames;
+
+	static float history[HistorySize];
+	static int historyNext;
+	static int historyCount;
+};
+
+const char* PerfCounters::names[PerfCounters::MaxCounters] = { "Draw calls", "Triangles", "State changes", "Visible objects", "Culled objects" };
+int PerfCounters::counters = PerfCounters::BuiltinCounters;
+int64_t PerfCounters::current[PerfCounters::MaxCounters] = {};
+int64_t PerfCounters::last[PerfCounters::MaxCounters] = {};
+float PerfCounters::phaseTimes[PerfCounters::PhaseCount] = {};
+float PerfCounters::lastPhaseTimes[PerfCounters::PhaseCount] = {};
+PerfCounters::Phase PerfCounters::currentPhase = PerfCounters::Update;
+PerfCounters::Clock::time_point PerfCounters::phaseStart;
+PerfCounters::Clock::time_point PerfCounters::frameStart;
+bool PerfCounters::started = false;
+float PerfCounters::frameTime = 0.0f;
+uint64_t PerfCounters::frames = 0;
+float PerfCounters::history[PerfCounters::HistorySize] = {};
+int PerfCounters::historyNext = 0;
+int PerfCounters::historyCount = 0;
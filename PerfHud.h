@@ -0,0 +1,271 @@
+﻿#pragma once
+#include "includy.h"
+#include "PerfCounters.h"
+#include "TextRenderer.h"
+#include "TextureCache.h"
+#include "WorldStreaming.h"
+#include "GpuTimer.h"
+#include "Profiler.h"
+#include <cstdio>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+/**
+* @class PerfHud
+* @brief Nakładka wydajności (F9) w prawym górnym rogu: wykres czasów ostatnich klatek, FPS, czas CPU
+* w fazach silnika, rysowania, trójkąty, zmiany stanu, obiekty widoczne i odrzucone, pamięć.
+* Czasy GPU przebiegów z GpuTimer (kilka klatek opóźnienia). Wartości uśredniane są w okresach refreshInterval - napisy zmieniają się kilka razy
+* na sekundę (czytelne, a TextRenderer nie przebudowuje bufora co klatkę), wykres co klatkę
+*/
+class PerfHud
+{
+public:
+	static bool enabled;
+	static float refreshInterval;  // s
+	static float graphScaleMs;     // górna krawędź wykresu
+
+	// Przed TextRenderer::draw - napisy trafiają do wspólnego bufora tekstu
+	static void draw(int width, int height)
+	{
+		PROFILE_ZONE("PerfHud::draw");
+		if (!enabled)
+		{
+			samples = 0;
+			return;
+		}
+
+		accumulate();
+		if (samples > 0 && (lines.empty() || sampledMs >= refreshInterval * 1000.0f))
+		{
+			refresh();
+		}
+
+		int left = width - PerfCounters::HistorySize - 10;
+		int top = height - 10;
+		drawGraph(width, height, left, top - GraphHeight);
+
+		int y = top - GraphHeight - 20;
+		for (const string& line : lines)
+		{
+			TextRenderer::add(left, y, line, glm::vec3(0.8f, 1.0f, 0.8f));
+			y -= 20;
+		}
+	}
+
+private:
+	static const int GraphHeight = 60;
+
+	static vector<string> lines;
+	static uint64_t lastFrame;
+	static int samples;            // klatki w bieżącym okresie
+	static float sampledMs;
+	static float phaseSums[PerfCounters::PhaseCount];
+	static float cpuSum;
+	static double counterSums[PerfCounters::MaxCounters];
+	static uint64_t lastGpuFrame;
+	static int gpuSamples;
+	static float gpuSums[GpuTimer::MaxPasses];
+	static vector<glm::vec2> points;
+
+	// Ostatnia zakończona klatka do sum okresu (raz na klatkę)
+	static void accumulate()
+	{
+		if (PerfCounters::frameCount() == lastFrame)
+		{
+			return;
+		}
+		lastFrame = PerfCounters::frameCount();
+		if (samples == 0)
+		{
+			sampledMs = 0.0f;
+			cpuSum = 0.0f;
+			fill(begin(phaseSums), end(phaseSums), 0.0f);
+			fill(begin(counterSums), end(counterSums), 0.0);
+			fill(begin(gpuSums), end(gpuSums), 0.0f);
+			gpuSamples = 0;
+		}
+
+		samples++;
+		sampledMs += PerfCounters::frameMs();
+		cpuSum += PerfCounters::cpuMs();
+		for (int phase = 0; phase < PerfCounters::PhaseCount; phase++)
+		{
+			phaseSums[phase] += PerfCounters::phaseMs((PerfCounters::Phase)phase);
+		}
+		for (int counter = 0; counter < PerfCounters::counterCount(); counter++)
+		{
+			counterSums[counter] += (double)PerfCounters::value(counter);
+		}
+
+		if (GpuTimer::resolvedFrames() != lastGpuFrame)
+		{
+			lastGpuFrame = GpuTimer::resolvedFrames();
+			gpuSamples++;
+			for (int pass = 0; pass < GpuTimer::passCount(); pass++)
+			{
+				gpuSums[pass] += GpuTimer::passMs(pass);
+			}
+		}
+	}
+
+	static void refresh()
+	{
+		lines.clear();
+		float count = (float)std::max(samples, 1);
+		char text[128];
+
+		float frame = samples > 0 ? sampledMs / count : 0.0f;
+		snprintf(text, sizeof(text), "FPS %.1f  frame %.2f ms  CPU %.2f ms", frame > 0.0f ? 1000.0f / frame : 0.0f, frame, cpuSum / count);
+		lines.push_back(text);
+		for (int phase = 0; phase < PerfCounters::PhaseCount; phase++)
+		{
+			snprintf(text, sizeof(text), "  %s %.2f ms", PerfCounters::phaseName((PerfCounters::Phase)phase), phaseSums[phase] / count);
+			lines.push_back(text);
+		}
+		if (gpuSamples > 0)
+		{
+			// pierwszy przebieg to cała klatka
+			snprintf(text, sizeof(text), "GPU %.2f ms", gpuSums[0] / gpuSamples);
+			lines.push_back(text);
+			for (int pass = 1; pass < GpuTimer::passCount(); pass++)
+			{
+				snprintf(text, sizeof(text), "  %s %.2f ms", GpuTimer::passName(pass), gpuSums[pass] / gpuSamples);
+				lines.push_back(text);
+			}
+		}
+
+		snprintf(text, sizeof(text), "Draw calls %.0f  triangles %.0f", counter(PerfCounters::DrawCalls), counter(PerfCounters::Triangles));
+		lines.push_back(text);
+		snprintf(text, sizeof(text), "State changes %.0f", counter(PerfCounters::StateChanges));
+		lines.push_back(text);
+		snprintf(text, sizeof(text), "Objects %.0f visible  %.0f culled", counter(PerfCounters::VisibleObjects), counter(PerfCounters::CulledObjects));
+		lines.push_back(text);
+		for (int i = PerfCounters::BuiltinCounters; i < PerfCounters::counterCount(); i++)
+		{
+			snprintf(text, sizeof(text), "%s %.0f", PerfCounters::name(i), counter(i));
+			lines.push_back(text);
+		}
+
+		TextureCacheStats textures = TextureCache::stats();
+		const float megabyte = 1.0f / (1024.0f * 1024.0f);
+		snprintf(text, sizeof(text), "Memory %.0f MB  textures %.1f MB  world %.1f MB", processMemory() * megabyte,
+			(textures.gpuBytes + textures.cpuBytes) * megabyte, WorldStreamer::stats().residentBytes * megabyte);
+		lines.push_back(text);
+
+		samples = 0;
+	}
+
+	// Średnia na klatkę w okresie
+	static double counter(int id)
+	{
+		return counterSums[id] / std::max(samples, 1);
+	}
+
+	// Pamięć procesu (zbiór roboczy / strony rezydentne)
+	static size_t processMemory()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			return counters.WorkingSetSize;
+		}
+		return 0;
+#else
+		long pages = 0, resident = 0;
+		FILE* file = fopen("/proc/self/statm", "r");
+		if (file)
+		{
+			if (fscanf(file, "%ld %ld", &pages, &resident) != 2)
+			{
+				resident = 0;
+			}
+			fclose(file);
+		}
+		return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+#endif
+	}
+
+	// Tło, linie 60 i 30 FPS i czasy klatek (prawa krawędź - ostatnia klatka)
+	static void drawGraph(int width, int height, int left, int bottom)
+	{
+		int length = PerfCounters::historyLength();
+		int right = left + PerfCounters::HistorySize;
+		float scale = GraphHeight / graphScaleMs;
+
+		glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_POLYGON_BIT | GL_CURRENT_BIT | GL_LINE_BIT);
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_LIGHTING);
+		glDisable(GL_TEXTURE_2D);
+		glDisable(GL_CULL_FACE);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glLineWidth(1.0f);
+
+		glMatrixMode(GL_PROJECTION);
+		glPushMatrix();
+		glLoadIdentity();
+		gluOrtho2D(0, width, 0, height);
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glLoadIdentity();
+
+		points.clear();
+		points.push_back(glm::vec2(left, bottom));
+		points.push_back(glm::vec2(right, bottom));
+		points.push_back(glm::vec2(right, bottom + GraphHeight));
+		points.push_back(glm::vec2(left, bottom + GraphHeight));
+		for (float budget : { 1000.0f / 60.0f, 1000.0f / 30.0f })
+		{
+			float y = bottom + std::min(budget * scale, (float)GraphHeight);
+			points.push_back(glm::vec2(left, y));
+			points.push_back(glm::vec2(right, y));
+		}
+		for (int i = 0; i < length; i++)
+		{
+			float y = bottom + std::min(PerfCounters::historyAt(i) * scale, (float)GraphHeight);
+			points.push_back(glm::vec2(right - length + i + 0.5f, y));
+		}
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(2, GL_FLOAT, sizeof(glm::vec2), points.data());
+		glColor4f(0.0f, 0.0f, 0.0f, 0.6f);
+		glDrawArrays(GL_QUADS, 0, 4);
+		glColor4f(0.4f, 0.4f, 0.4f, 1.0f);
+		glDrawArrays(GL_LINES, 4, 4);
+		if (length > 1)
+		{
+			glColor4f(0.3f, 1.0f, 0.3f, 1.0f);
+			glDrawArrays(GL_LINE_STRIP, 8, length);
+		}
+		glDisableClientState(GL_VERTEX_ARRAY);
+
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+		glMatrixMode(GL_MODELVIEW);
+		glPopMatrix();
+		glPopAttrib();
+	}
+};
+
+bool PerfHud::enabled = false;
+float PerfHud::refreshInterval = 0.25f;
+float PerfHud::graphScaleMs = 50.0f;
+vector<string> PerfHud::lines;
+uint64_t PerfHud::lastFrame = 0;
+int PerfHud::samples = 0;
+float PerfHud::sampledMs = 0.0f;
+float PerfHud::phaseSums[PerfCounters::PhaseCount] = {};
+float PerfHud::cpuSum = 0.0f;
+double PerfHud::counterSums[PerfCounters::MaxCounters] = {};
+uint64_t PerfHud::lastGpuFrame = 0;
+int PerfHud::gpuSamples = 0;
+float PerfHud::gpuSums[GpuTimer::MaxPasses] = {};
+vector<glm::vec2> PerfHud::points;
@@ -0,0 +1,344 @@
+﻿#pragma once
+#include "includy.h"
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+
+// Znaczniki czasu z licznika cykli (rdtsc, kilka ns) przeliczane na nanosekundy przy zapisie,
+// bez niego - steady_clock
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define PROFILE_TSC
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#define PROFILE_TSC
+#include <x86intrin.h>
+#endif
+
+/**
+* Strefy profilowania: PROFILE_ZONE("nazwa") mierzy czas do końca bloku, PROFILE_FUNCTION() - całej funkcji,
+* PROFILE_THREAD("nazwa") nazywa bieżący wątek w pliku. Bez JOJO_PROFILE (definiowane w ustawieniach projektu lub przed dołączeniem nagłówków) makra znikają
+* całkowicie - zero kodu w strefach
+*/
+#ifdef JOJO_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+#define PROFILE_THREAD(name) Profiler::setThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
+
+/**
+* @class Profiler
+* @brief Zapis stref czasowych CPU do pliku Chrome trace (JSON - chrome://tracing, ui.perfetto.dev).
+* Każdy wątek ma własny bufor zdarzeń (thread_local) - zapis strefy nie bierze blokady, tylko wątek
+* właściciel pisze do bufora, a liczba zdarzeń, numer sesji i licznik pominiętych są atomowe. Zagnieżdżenie stref
+* wynika z czasów (zdarzenia "X" z początkiem i długością w nanosekundach). Poza przechwytywaniem
+* strefa to jeden odczyt flagi atomowej, w trakcie - dwa odczyty licznika czasu i zapis 24 bajtów.
+* Nazwy stref muszą żyć do zapisu pliku (literały)
+*/
+class Profiler
+{
+public:
+	static const size_t EventsPerThread = 1 << 18;  // nadmiarowe zdarzenia są liczone i pomijane
+	static string outputPath;
+
+	/**
+	* @class Zone
+	* @brief Strefa od konstrukcji do destrukcji (przez PROFILE_ZONE)
+	*/
+	class Zone
+	{
+	public:
+		explicit Zone(const char* name)
+			: name(name), begin(capturing() ? ticks() : -1)
+		{
+		}
+
+		~Zone()
+		{
+			if (begin >= 0)
+			{
+				record(name, begin, ticks());
+			}
+		}
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+		const char* name;
+		int64_t begin;
+	};
+
+	static bool compiledIn()
+	{
+#ifdef JOJO_PROFILE
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	static bool capturing()
+	{
+		return active.load(memory_order_relaxed);
+	}
+
+	// Nowa sesja - wątki zaczynają swoje bufory od początku przy pierwszej strefie
+	static void start()
+	{
+		if (capturing())
+		{
+			return;
+		}
+		session.fetch_add(1, memory_order_relaxed);
+		{
+			lock_guard<mutex> lock(registryMutex);
+			gpuEvents.clear();
+		}
+		startTicks = ticks();
+		startTime = chrono::steady_clock::now();
+		active.store(true, memory_order_release);
+	}
+
+	// Koniec sesji i zapis do outputPath
+	static bool stop()
+	{
+		if (!capturing())
+		{
+			return false;
+		}
+		active.store(false, memory_order_release);
+#ifdef PROFILE_TSC
+		// częstotliwość licznika z długości sesji
+		double nanoseconds = chrono::duration<double, nano>(chrono::steady_clock::now() - startTime).count();
+		ticksPerNanosecond = nanoseconds > 0.0 ? (ticks() - startTicks) / nanoseconds : 1.0;
+#endif
+		return write(outputPath);
+	}
+
+	// F10: start albo stop z zapisem
+	static void toggle()
+	{
+		if (!compiledIn())
+		{
+			cout << "Profiler wylaczony - zbuduj z JOJO_PROFILE\n";
+			return;
+		}
+		if (!capturing())
+		{
+			start();
+			cout << "Profiler: przechwytywanie...\n";
+			return;
+		}
+		if (!stop())
+		{
+			cout << "Profiler: nie mozna zapisac " << outputPath << "\n";
+		}
+	}
+
+	// Nazwa wątku w pliku (wywołana z danego wątku)
+	static void setThreadName(const string& name)
+	{
+		ThreadBuffer* buffer = threadBuffer();
+		lock_guard<mutex> lock(registryMutex);
+		buffer->name = name;
+	}
+
+	static void record(const char* name, int64_t begin, int64_t end)
+	{
+		ThreadBuffer* buffer = threadBuffer();
+		uint32_t current = session.load(memory_order_relaxed);
+		if (buffer->session.load(memory_order_relaxed) != current)
+		{
+			// wyzerowane liczniki widoczne dla write() razem z nowym numerem sesji
+			buffer->count.store(0, memory_order_relaxed);
+			buffer->dropped.store(0, memory_order_relaxed);
+			buffer->session.store(current, memory_order_release);
+		}
+		if (!buffer->events)
+		{
+			buffer->events.reset(new Event[EventsPerThread]()); // wyzerowane - strony przydzielone od razu, nie w trakcie stref
+		}
+		if (!capturing())
+		{
+			return; // strefa zamknięta już po stop()
+		}
+
+		size_t count = buffer->count.load(memory_order_relaxed);
+		if (count == EventsPerThread)
+		{
+			buffer->dropped.store(buffer->dropped.load(memory_order_relaxed) + 1, memory_order_relaxed); // jeden piszący
+			return;
+		}
+		buffer->events[count] = { name, begin, end };
+		buffer->count.store(count + 1, memory_order_release);
+	}
+
+	// Przebieg GPU (GpuTimer) na osobnej osi "GPU" - czasy przeliczone na zegar CPU, raz na przebieg i klatkę
+	static void recordGpu(const char* name, chrono::steady_clock::time_point begin, chrono::steady_clock::time_point end)
+	{
+		if (!capturing())
+		{
+			return;
+		}
+		lock_guard<mutex> lock(registryMutex);
+		gpuEvents.push_back({ name, begin, end });
+	}
+
+	// Znacznik czasu strefy (cykle albo nanosekundy)
+	static int64_t ticks()
+	{
+#ifdef PROFILE_TSC
+		return (int64_t)__rdtsc();
+#else
+		return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+private:
+	struct Event
+	{
+		const char* name;
+		int64_t begin;
+		int64_t end;
+	};
+
+	struct GpuEvent
+	{
+		const char* name;
+		chrono::steady_clock::time_point begin;
+		chrono::steady_clock::time_point end;
+	};
+
+	struct ThreadBuffer
+	{
+		unique_ptr<Event[]> events;   // przy pierwszej strefie wątku
+		atomic<size_t> count{ 0 };
+		atomic<uint32_t> session{ 0 }; // pisane tylko przez wątek właściciela, czytane przez write()
+		atomic<size_t> dropped{ 0 };
+		uint32_t id = 0;
+		string name;
+	};
+
+	static atomic<bool> active;
+	static atomic<uint32_t> session;
+	static int64_t startTicks;
+	static chrono::steady_clock::time_point startTime;
+	static double ticksPerNanosecond;
+	static mutex registryMutex;
+	static vector<unique_ptr<ThreadBuffer>> threads;  // bufory żyją do końca programu (wątki puli też)
+	static vector<GpuEvent> gpuEvents;
+	static thread_local ThreadBuffer* local;
+
+	static ThreadBuffer* threadBuffer()
+	{
+		if (!local)
+		{
+			lock_guard<mutex> lock(registryMutex);
+			threads.emplace_back(new ThreadBuffer());
+			local = threads.back().get();
+			local->id = (uint32_t)threads.size();
+			local->name = "Thread " + to_string(local->id);
+		}
+		return local;
+	}
+
+	static void writeEscaped(ofstream& out, const char* text)
+	{
+		for (; *text; text++)
+		{
+			if (*text == '"' || *text == '\\')
+			{
+				out << '\\';
+			}
+			out << *text;
+		}
+	}
+
+	static bool write(const string& path)
+	{
+		ofstream out(path, ios::binary);
+		if (!out)
+		{
+			return false;
+		}
+
+		uint32_t current = session.load(memory_order_relaxed);
+		size_t events = 0, dropped = 0;
+		char numbers[64];
+		out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		bool first = true;
+
+		lock_guard<mutex> lock(registryMutex);
+		if (!gpuEvents.empty())
+		{
+			out << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+			first = false;
+		}
+		for (const GpuEvent& event : gpuEvents)
+		{
+			double begin = chrono::duration<double, micro>(event.begin - startTime).count();
+			double duration = chrono::duration<double, micro>(event.end - event.begin).count();
+			snprintf(numbers, sizeof(numbers), "%.3f,\"dur\":%.3f", begin, duration);
+			out << ",\n{\"name\":\"";
+			writeEscaped(out, event.name);
+			out << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":" << numbers << "}";
+		}
+		events += gpuEvents.size();
+
+		for (const unique_ptr<ThreadBuffer>& buffer : threads)
+		{
+			out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":\"";
+			writeEscaped(out, buffer->name.c_str());
+			out << "\"}}";
+			first = false;
+
+			if (buffer->session.load(memory_order_acquire) != current)
+			{
+				continue; // wątek nie zapisał nic w tej sesji
+			}
+			size_t count = buffer->count.load(memory_order_acquire);
+			for (size_t i = 0; i < count; i++)
+			{
+				const Event& event = buffer->events[i];
+				// mikrosekundy z częścią ułamkową - pełna rozdzielczość nanosekund
+				double begin = (event.begin - startTicks) / ticksPerNanosecond, duration = (event.end - event.begin) / ticksPerNanosecond;
+				snprintf(numbers, sizeof(numbers), "%.3f,\"dur\":%.3f", begin / 1000.0, duration / 1000.0);
+				out << ",\n{\"name\":\"";
+				writeEscaped(out, event.name);
+				out << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id << ",\"ts\":" << numbers << "}";
+			}
+			events += count;
+			dropped += buffer->dropped.load(memory_order_relaxed);
+		}
+		out << "\n]}\n";
+
+		cout << "Profiler: " << events << " stref z " << threads.size() << " watkow zapisane do " << path;
+		if (dropped > 0)
+		{
+			cout << " (pominiete: " << dropped << ")";
+		}
+		cout << "\n";
+		return (bool)out;
+	}
+};
+
+string Profiler::outputPath = "trace.json";
+atomic<bool> Profiler::active{ false };
+atomic<uint32_t> Profiler::session{ 0 };
+int64_t Profiler::startTicks = 0;
+chrono::steady_clock::time_point Profiler::startTime;
+double Profiler::ticksPerNanosecond = 1.0;
+mutex Profiler::registryMutex;
+vector<unique_ptr<Profiler::ThreadBuffer>> Profiler::threads;
+vector<Profiler::GpuEvent> Profiler::gpuEvents;
+thread_local Profiler::ThreadBuffer* Profiler::local = nullptr;
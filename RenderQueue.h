@@ -0,0 +1,147 @@
+﻿#pragma once
+#include "includy.h"
+#include "Material.h"
+#include "LightManager.h"
+#include "Shader.h"
+#include "UniformRing.h"
+#include "Profiler.h"
+#include <cstring>
+#include <algorithm>
+
+/**
+* @struct DrawItem
+* @brief Jedno rysowanie w kolejce: materiał, macierz obiektu, sfera (do wyboru świateł) i funkcja
+* rysująca obiekt na danym poziomie szczegółowości
+*/
+struct DrawItem
+{
+	typedef void (*DrawFunction)(const void* object, size_t level);
+
+	const Material* material = nullptr;
+	glm::mat4 transform = glm::mat4(1.0f);
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+	DrawFunction draw = nullptr;
+	const void* object = nullptr;
+	size_t level = 0;
+};
+
+/**
+* @class RenderQueue
+* @brief Kolejka rysowań sortowana wg materiału (najpierw tekstura, potem blok materiału), dzięki czemu
+* każdy materiał ustawiany jest raz na klatkę, a nie raz na obiekt. Materiały i obiekty muszą istnieć
+* do flush(). Na ścieżce z shaderami permutacja to cechy klatki plus tekstura materiału, a macierze
+* wszystkich obiektów zapisywane są naraz do UniformRing (bloki po MaxObjects) - rysowanie podaje
+* tylko indeks obiektu w bloku zamiast glMultMatrixf
+*/
+class RenderQueue
+{
+public:
+	static void submit(const DrawItem& item)
+	{
+		uint64_t texture = item.material && item.material->texture ? item.material->texture.id() : 0;
+		uint64_t material = item.material ? item.material->id : 0;
+		keys.push_back(make_pair((texture << 32) | material, (uint32_t)items.size()));
+		items.push_back(item);
+	}
+
+	static void flush()
+	{
+		PROFILE_ZONE("RenderQueue::flush");
+		sort(keys.begin(), keys.end());
+		uploadObjects();
+
+		const size_t blockSize = ShaderCache::MaxObjects;
+		for (size_t n = 0; n < keys.size(); n++)
+		{
+			const DrawItem& item = items[keys[n].second];
+			MaterialRegistry::bind(item.material);
+			uint32_t features = ShaderCache::getFrameFeatures() | materialFeatures(item.material);
+
+			const UniformRing::Allocation* block = n / blockSize < blocks.size() ? &blocks[n / blockSize] : nullptr;
+			if (block && *block)
+			{
+				if (n % blockSize == 0)
+				{
+					GLExt::BindBufferRange(GL_UNIFORM_BUFFER, ShaderCache::ObjectBinding, UniformRing::buffer(), (ptrdiff_t)block->offset, (ptrdiff_t)block->size);
+				}
+				ShaderCache::use(features | ShaderCache::ObjectBuffer);
+				ShaderCache::bindLights(item.center, item.radius);
+				GLExt::VertexAttrib1f(ShaderCache::ObjectIndexAttribute, (float)(n % blockSize));
+				item.draw(item.object, item.level);
+				continue;
+			}
+
+			ShaderCache::use(features);
+			ShaderCache::bindLights(item.center, item.radius);
+			glPushMatrix();
+			glMultMatrixf(glm::value_ptr(item.transform));
+			item.draw(item.object, item.level);
+			glPopMatrix();
+		}
+		drawn = items.size();
+		keys.clear();
+		items.clear();
+	}
+
+	// Cechy programu zależne od materiału: tekstura i kolor wierzchołków zamiast parametrów materiału
+	static uint32_t materialFeatures(const Material* material)
+	{
+		uint32_t features = 0;
+		if (material && material->texture.ready())
+		{
+			features |= (uint32_t)ShaderCache::Texture;
+		}
+		if (material && material->desc.vertexColor && (ShaderCache::getFrameFeatures() & ShaderCache::Material))
+		{
+			features |= (uint32_t)ShaderCache::VertexColor;
+		}
+		return features;
+	}
+
+	// Liczba rysowań w ostatnim flush()
+	static size_t lastCount()
+	{
+		return drawn;
+	}
+
+private:
+	static vector<DrawItem> items;
+	static vector<UniformRing::Allocation> blocks; // macierze obiektów w kolejności rysowania
+	static vector<pair<uint64_t, uint32_t>> keys; // (klucz sortowania, indeks rysowania)
+	static size_t drawn;
+
+	// Macierze w pierścieniu jednym zapisem - blok zawsze pełnego rozmiaru, jak zadeklarowany w shaderze
+	static void uploadObjects()
+	{
+		PROFILE_ZONE("RenderQueue::uploadObjects");
+		blocks.clear();
+		if (keys.empty() || !ShaderCache::active() || !UniformRing::active() ||
+			!ShaderCache::get(ShaderCache::getFrameFeatures() | ShaderCache::ObjectBuffer))
+		{
+			return;
+		}
+
+		const size_t blockSize = ShaderCache::MaxObjects;
+		for (size_t first = 0; first < keys.size(); first += blockSize)
+		{
+			UniformRing::Allocation block = UniformRing::allocate(blockSize * sizeof(glm::mat4));
+			if (!block)
+			{
+				break; // reszta obiektów przez glMultMatrixf
+			}
+			size_t count = std::min(blockSize, keys.size() - first);
+			for (size_t i = 0; i < count; i++)
+			{
+				memcpy(block.data + i * sizeof(glm::mat4), glm::value_ptr(items[keys[first + i].second].transform), sizeof(glm::mat4));
+			}
+			blocks.push_back(block);
+		}
+		UniformRing::commit();
+	}
+};
+
+vector<DrawItem> RenderQueue::items;
+vector<UniformRing::Allocation> RenderQueue::blocks;
+vector<pair<uint64_t, uint32_t>> RenderQueue::keys;
+size_t RenderQueue::drawn = 0;
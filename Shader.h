@@ -0,0 +1,897 @@
+﻿#pragma once
+#include "includy.h"
+#include "GLExt.h"
+#include "LightManager.h"
+#include <map>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+/**
+* @class ShaderProgram
+* @brief Program GLSL jednej permutacji z zapamiętanymi położeniami uniformów
+*/
+class ShaderProgram
+{
+public:
+	GLuint id = 0;
+	bool fromCache = false;   // wczytany z pliku binarnego zamiast kompilacji
+
+	~ShaderProgram()
+	{
+		if (id && GLExt::DeleteProgram)
+		{
+			GLExt::DeleteProgram(id);
+		}
+	}
+
+	GLint location(const char* name)
+	{
+		auto it = locations.find(name);
+		if (it != locations.end())
+		{
+			return it->second;
+		}
+		GLint result = GLExt::GetUniformLocation(id, name);
+		locations[name] = result;
+		return result;
+	}
+
+	void setInt(const char* name, int value)
+	{
+		GLint where = location(name);
+		if (where >= 0)
+		{
+			GLExt::Uniform1i(where, value);
+		}
+	}
+
+	void setMatrices(const char* name, const glm::mat4* matrices, size_t count)
+	{
+		GLint where = location(name);
+		if (where >= 0)
+		{
+			GLExt::UniformMatrix4fv(where, (GLsizei)count, GL_FALSE, glm::value_ptr(matrices[0]));
+		}
+	}
+
+	void setVectors(const char* name, const glm::vec4* vectors, size_t count)
+	{
+		GLint where = location(name);
+		if (where >= 0)
+		{
+			GLExt::Uniform4fv(where, (GLsizei)count, glm::value_ptr(vectors[0]));
+		}
+	}
+
+	void setInts(const char* name, const int* values, size_t count)
+	{
+		GLint where = location(name);
+		if (where >= 0)
+		{
+			GLExt::Uniform1iv(where, (GLsizei)count, values);
+		}
+	}
+
+	uint32_t features = 0;
+	int lightCount = -1;    // ostatnio wysłana wartość uniformu
+	uint32_t frame = 0;     // klatka, dla której ustawiono uniformy klatki
+
+private:
+	map<string, GLint> locations;
+};
+
+/**
+* @struct ShaderCacheStats
+* @brief Liczniki pamięci podręcznej programów
+*/
+struct ShaderCacheStats
+{
+	size_t programs = 0;
+	size_t compiled = 0;      // skompilowane ze źródeł
+	size_t loaded = 0;        // wczytane z plików binarnych
+	size_t failed = 0;
+	float compileMs = 0.0f;   // łączny czas przygotowania programów
+};
+
+/**
+* @class ShaderCache
+* @brief Programowalna ścieżka renderowania (GLSL 1.20). Shadery odtwarzają model oświetlenia
+* stałego potoku - sloty GL_LIGHTn ustawiane przez LightManager, parametry glMaterial z MaterialRegistry,
+* tekstura w trybie GL_MODULATE - ale liczą światło na piksel. Permutacje programu wybierane są bitami
+* cech i tworzone przy pierwszym użyciu; gotowe programy zapisywane są jako pliki binarne sterownika
+* (GL_ARB_get_program_binary) w cacheDirectory, więc kolejne uruchomienia pomijają kompilację.
+* Klucz pliku obejmuje źródło, cechy i sterownik - po zmianie któregokolwiek program kompilowany jest od nowa
+*/
+class ShaderCache
+{
+public:
+	enum Feature : uint32_t
+	{
+		Lighting = 1 << 0,    // światła GL_LIGHT0..lightCount-1
+		Material = 1 << 1,    // parametry z gl_FrontMaterial (bez - kolor wierzchołka jako otoczenie i rozproszenie)
+		Texture = 1 << 2,     // tekstura 0 mnożona przez kolor
+		Instancing = 1 << 3,  // macierze obiektów w instanceMatrices[gl_InstanceID]
+		ObjectBuffer = 1 << 4, // macierz obiektu z bloku ObjectData (UniformRing) pod indeksem z atrybutu objectIndex
+		ShadowMaps = 1 << 5,  // cienie świateł z setShadowLights (kaskady i mapy sześcienne z Shadows)
+		VertexColor = 1 << 6, // z Material: otoczenie i rozproszenie z koloru wierzchołka (GL_COLOR_MATERIAL)
+		Clustered = 1 << 7,   // z Lighting: światła z listy klastra piksela (ClusteredLighting) zamiast slotów GL_LIGHTn
+		FeatureCount = 8
+	};
+
+	static const int MaxInstances = 64;
+	static const int MaxObjects = 256;           // 16 KB - minimalny GL_MAX_UNIFORM_BLOCK_SIZE
+	static const GLuint ObjectBinding = 0;       // punkt wiązania bloku ObjectData
+	static const GLuint ObjectIndexAttribute = 7;
+
+	static const int MaxCascades = 4;
+	static const int MaxPointShadows = 4;
+	static const int MaxShadowSlots = 8;         // sloty GL_LIGHTn z cieniem (minimalne GL_MAX_LIGHTS)
+	static const int CascadeTextureUnit = 1;     // kaskady w jednostkach 1..4, mapy sześcienne 5..8
+	static const int PointShadowTextureUnit = CascadeTextureUnit + MaxCascades;
+	static const int ClusterTextureUnit = PointShadowTextureUnit + MaxPointShadows; // tekstury ClusteredLighting 9..11
+	static const int MaxClusterLights = 256;     // światła na piksel w permutacji Clustered (z kierunkowymi)
+
+	// Uniformy wspólne dla klatki (macierze cieni, dane klastrów) - wywoływane raz na klatkę dla każdego użytego programu
+	typedef void (*FrameUniforms)(ShaderProgram& program);
+
+	static void addFrameUniforms(FrameUniforms function)
+	{
+		if (find(frameUniforms.begin(), frameUniforms.end(), function) == frameUniforms.end())
+		{
+			frameUniforms.push_back(function);
+		}
+	}
+
+	static bool enabled;              // przełączane F8
+	static string cacheDirectory;
+
+	static bool supported()
+	{
+		return GLExt::supportsShaders();
+	}
+
+	static bool active()
+	{
+		return enabled && supported();
+	}
+
+	// Przygotowanie wszystkich permutacji (przy starcie, zamiast przestojów przy pierwszym użyciu)
+	static void warmUp()
+	{
+		PROFILE_ZONE("ShaderCache::warmUp");
+		if (!supported())
+		{
+			return;
+		}
+		for (uint32_t features = 0; features < (1u << FeatureCount); features++)
+		{
+			if (((features & Instancing) && !GLExt::supportsInstancing()) || ((features & ObjectBuffer) && !GLExt::supportsUniformBuffers()) ||
+				((features & ShadowMaps) && (!(features & Lighting) || !GLExt::supportsShadowMaps())) ||
+				((features & VertexColor) && !(features & Material)) ||
+				((features & Clustered) && (!(features & Lighting) || !GLExt::hasExtension("GL_ARB_texture_float"))))
+			{
+				continue;
+			}
+			get(features);
+		}
+		ShaderCacheStats result = stats();
+		cout << "Shadery: " << result.compiled << " skompilowanych, " << result.loaded << " z pamieci podrecznej, "
+			<< result.compileMs << " ms\n";
+	}
+
+	// Program permutacji (nullptr, jeśli się nie skompilował)
+	static ShaderProgram* get(uint32_t features)
+	{
+		auto it = programs.find(features);
+		if (it == programs.end())
+		{
+			it = programs.emplace(features, create(features)).first;
+		}
+		return it->second->id ? it->second.get() : nullptr;
+	}
+
+	// Cechy wspólne dla klatki (oświetlenie, materiał, cienie); rysowania dodają własne (tekstura).
+	// Wywoływane raz na klatkę - zaczyna nową klatkę dla frameUniforms
+	static void setFrameFeatures(uint32_t features)
+	{
+		frameFeatures = features;
+		frameStamp++;
+	}
+
+	static uint32_t getFrameFeatures()
+	{
+		return frameFeatures;
+	}
+
+	// Włączenie permutacji; bez obsługi shaderów lub z wyłączoną ścieżką - stały potok
+	static void use(uint32_t features)
+	{
+		if (!active())
+		{
+			return;
+		}
+
+		ShaderProgram* program = get(features);
+		if (program == current)
+		{
+			return;
+		}
+		GLExt::UseProgram(program ? program->id : 0);
+		PerfCounters::add(PerfCounters::StateChanges);
+		current = program;
+		if (current)
+		{
+			current->lightCount = -1;
+			fill(begin(sentShadowSlots), end(sentShadowSlots), -2);
+			if (current->frame != frameStamp)
+			{
+				for (FrameUniforms function : frameUniforms)
+				{
+					function(*current);
+				}
+				current->frame = frameStamp;
+			}
+		}
+	}
+
+	static void stop()
+	{
+		if (current)
+		{
+			GLExt::UseProgram(0);
+			current = nullptr;
+		}
+	}
+
+	// Światła z mapami cieni w tej klatce: kierunkowe z kaskadami i punktowe z mapami sześciennymi
+	// (kolejność jak tekstury w jednostkach PointShadowTextureUnit..)
+	static void setShadowLights(LightId directional, const LightId* points, int count)
+	{
+		shadowLights[0] = directional;
+		for (int i = 0; i < MaxPointShadows; i++)
+		{
+			shadowLights[1 + i] = i < count ? points[i] : LightManager::InvalidLight;
+		}
+	}
+
+	// LightManager::bind i liczba świateł dla aktywnego programu (z cieniami - mapa cienia każdego slotu).
+	// Permutacja Clustered bierze światła z klastrów - sloty GL_LIGHTn nie są wtedy ustawiane
+	static void bindLights(const glm::vec3& center, float radius)
+	{
+		if (current && (current->features & Clustered))
+		{
+			return;
+		}
+		LightManager::bind(center, radius);
+		if (!current)
+		{
+			return;
+		}
+
+		int count = LightManager::boundCount();
+		if (count != current->lightCount)
+		{
+			current->setInt("lightCount", count);
+			current->lightCount = count;
+		}
+
+		if (current->features & ShadowMaps)
+		{
+			// -1: bez cienia, 0: kaskady, 1 + n: mapa sześcienna n
+			int slots[MaxShadowSlots];
+			for (int slot = 0; slot < MaxShadowSlots; slot++)
+			{
+				LightId light = slot < count ? LightManager::slotLight(slot) : LightManager::InvalidLight;
+				slots[slot] = -1;
+				for (int n = 0; light != LightManager::InvalidLight && n <= MaxPointShadows; n++)
+				{
+					if (shadowLights[n] == light)
+					{
+						slots[slot] = n;
+						break;
+					}
+				}
+			}
+			if (!equal(begin(slots), end(slots), begin(sentShadowSlots)))
+			{
+				current->setInts("shadowSlots", slots, MaxShadowSlots);
+				copy(begin(slots), end(slots), begin(sentShadowSlots));
+			}
+		}
+	}
+
+	static ShaderProgram* program()
+	{
+		return current;
+	}
+
+	// Światło z mapą cienia: 0 - kaskady, 1 + n - mapa sześcienna n
+	static LightId shadowLight(int index)
+	{
+		return shadowLights[index];
+	}
+
+	static ShaderCacheStats stats()
+	{
+		ShaderCacheStats result = counters;
+		result.programs = programs.size();
+		return result;
+	}
+
+	static void release()
+	{
+		stop();
+		programs.clear();
+	}
+
+private:
+	static map<uint32_t, unique_ptr<ShaderProgram>> programs;
+	static ShaderProgram* current;
+	static uint32_t frameFeatures;
+	static uint32_t frameStamp;
+	static ShaderCacheStats counters;
+	static LightId shadowLights[1 + MaxPointShadows];
+	static int sentShadowSlots[MaxShadowSlots]; // ostatnio wysłane do aktywnego programu
+	static vector<FrameUniforms> frameUniforms;
+
+	static const char* vertexSource()
+	{
+		return R"(
+#ifdef INSTANCING
+#extension GL_ARB_draw_instanced : require
+#endif
+#ifdef OBJECT_BUFFER
+#extension GL_ARB_uniform_buffer_object : require
+#endif
+
+#ifdef INSTANCING
+uniform mat4 instanceMatrices[MAX_INSTANCES];
+#endif
+#ifdef OBJECT_BUFFER
+layout(std140) uniform ObjectData
+{
+	mat4 objectMatrices[MAX_OBJECTS];
+};
+attribute float objectIndex;
+#endif
+
+varying vec3 viewPosition;
+varying vec3 viewNormal;
+
+void main()
+{
+	vec4 position = gl_Vertex;
+	vec3 normal = gl_Normal;
+#ifdef OBJECT_BUFFER
+	mat4 object = objectMatrices[int(objectIndex + 0.5)];
+	position = object * position;
+	normal = mat3(object[0].xyz, object[1].xyz, object[2].xyz) * normal;
+#endif
+#ifdef INSTANCING
+	mat4 instance = instanceMatrices[gl_InstanceIDARB];
+	position = instance * position;
+	normal = mat3(instance[0].xyz, instance[1].xyz, instance[2].xyz) * normal;
+#endif
+	vec4 eye = gl_ModelViewMatrix * position;
+	viewPosition = eye.xyz;
+	viewNormal = gl_NormalMatrix * normal;
+	gl_FrontColor = gl_Color;
+	gl_TexCoord[0] = gl_MultiTexCoord0;
+	gl_Position = gl_ProjectionMatrix * eye;
+}
+)";
+	}
+
+	static const char* fragmentSource()
+	{
+		return R"(
+uniform sampler2D diffuseMap;
+uniform int lightCount;
+
+varying vec3 viewPosition;
+varying vec3 viewNormal;
+
+// parametry materialu piksela (ustawiane w main)
+vec4 ambient;
+vec4 diffuse;
+vec4 specular;
+float shininess;
+
+#ifdef SHADOWS
+uniform sampler2DShadow cascadeMaps[MAX_CASCADES];
+uniform samplerCube pointShadowMaps[MAX_POINT_SHADOWS];
+uniform mat4 cascadeMatrices[MAX_CASCADES];          // widok kamery -> wspolrzedne mapy [0, 1]
+uniform vec4 cascadeSplits;                          // dalekie granice kaskad (glebokosc w widoku)
+uniform int cascadeCount;
+uniform mat4 shadowViewToWorld;
+uniform vec4 pointShadowLights[MAX_POINT_SHADOWS];  // pozycja w swiecie, zasieg (daleka plaszczyzna)
+uniform vec4 shadowParams;                           // bias kaskad, wzgledny bias punktowych, bliska plaszczyzna
+uniform int shadowSlots[MAX_SHADOW_SLOTS];           // -1 bez cienia, 0 kaskady, 1 + n mapa szescienna n
+
+float cascadeShadow(vec3 position)
+{
+	float depth = -position.z;
+	int cascade = depth < cascadeSplits.x ? 0 : (depth < cascadeSplits.y ? 1 : (depth < cascadeSplits.z ? 2 : 3));
+	if (cascade >= cascadeCount || depth >= cascadeSplits[cascade])
+	{
+		return 1.0;
+	}
+
+	// sampler z tablicy tylko pod stalym indeksem (GLSL 1.20)
+	vec3 coord = (cascadeMatrices[cascade] * vec4(position, 1.0)).xyz;
+	coord.z -= shadowParams.x;
+	if (cascade == 0) return shadow2D(cascadeMaps[0], coord).r;
+	if (cascade == 1) return shadow2D(cascadeMaps[1], coord).r;
+	if (cascade == 2) return shadow2D(cascadeMaps[2], coord).r;
+	return shadow2D(cascadeMaps[3], coord).r;
+}
+
+float pointShadow(int index, vec3 position)
+{
+	vec4 light = pointShadowLights[index];
+	vec3 direction = (shadowViewToWorld * vec4(position, 1.0)).xyz - light.xyz;
+	vec3 axis = abs(direction);
+	float major = max(axis.x, max(axis.y, axis.z)) * (1.0 - shadowParams.y);
+	if (major >= light.w)
+	{
+		return 1.0;
+	}
+
+	// glebokosc, jaka zapisala projekcja sciany (90 stopni, bliska shadowParams.z, daleka zasieg)
+	float n = shadowParams.z;
+	float f = light.w;
+	float depth = ((f + n) / (f - n) - 2.0 * f * n / ((f - n) * major)) * 0.5 + 0.5;
+	float stored;
+	if (index == 0) stored = textureCube(pointShadowMaps[0], direction).r;
+	else if (index == 1) stored = textureCube(pointShadowMaps[1], direction).r;
+	else if (index == 2) stored = textureCube(pointShadowMaps[2], direction).r;
+	else stored = textureCube(pointShadowMaps[3], direction).r;
+	return depth <= stored ? 1.0 : 0.0;
+}
+
+// shadow: -1 bez cienia, 0 kaskady, 1 + n mapa szescienna n
+float lightShadow(int shadow, vec3 position)
+{
+	if (shadow == 0)
+	{
+		return cascadeShadow(position);
+	}
+	return shadow > 0 ? pointShadow(shadow - 1, position) : 1.0;
+}
+#endif
+
+// Udzial jednego swiatla jak w stalym potoku; cien wygasza tylko swiatlo rozproszone i odbite, otoczenie zostaje
+vec4 lightContribution(vec3 normal, vec3 toLight, float attenuation, vec4 lightAmbient, vec4 lightDiffuse, vec4 lightSpecular, int shadow)
+{
+	vec3 toEye = vec3(0.0, 0.0, 1.0); // jak staly potok bez GL_LIGHT_MODEL_LOCAL_VIEWER
+	toLight = normalize(toLight);
+	float diffuseTerm = max(dot(normal, toLight), 0.0);
+	vec4 contribution = diffuse * lightDiffuse * diffuseTerm;
+	if (diffuseTerm > 0.0)
+	{
+		// pow(0, 0) jest w GLSL nieokreslone - wykladnik 0 (shininess 0) ograniczony od dolu
+		float specularTerm = pow(max(dot(normal, normalize(toLight + toEye)), 0.0), max(shininess, 1e-4));
+		contribution += specular * lightSpecular * specularTerm;
+#ifdef SHADOWS
+		contribution *= lightShadow(shadow, viewPosition);
+#endif
+	}
+	return attenuation * (ambient * lightAmbient + contribution);
+}
+
+#ifdef CLUSTERED
+uniform sampler2D clusterLights;     // 4 teksele na swiatlo (LightManager::packUniforms)
+uniform sampler2D clusterRanges;     // (poczatek, liczba) na klaster
+uniform sampler2D clusterIndices;    // najpierw swiatla kierunkowe, potem listy klastrow
+uniform mat4 clusterView;            // swiat -> widok
+uniform vec4 clusterGrid;            // kafelki x, y, przedzialy glebokosci, liczba swiatel kierunkowych
+uniform vec4 clusterDepth;           // skala i przesuniecie przedzialu (log glebokosci), kafelki na piksel x, y
+uniform vec4 clusterTexels;          // 1 / wysokosc tekstur swiatel, zakresow, indeksow, 1 / szerokosc
+#ifdef SHADOWS
+uniform int clusterShadowLights[MAX_POINT_SHADOWS + 1];   // indeks swiatla z cieniem (0 kaskady, 1 + n mapa n), -1 brak
+#endif
+
+// Teksel danych o numerze index (wiersze po 1 / clusterTexels.w)
+vec4 clusterTexel(sampler2D map, float index, float inverseHeight)
+{
+	float row = floor(index * clusterTexels.w);
+	float column = index - row / clusterTexels.w;
+	return texture2D(map, vec2((column + 0.5) * clusterTexels.w, (row + 0.5) * inverseHeight));
+}
+
+float clusterOf(vec3 position)
+{
+	vec2 tile = clamp(floor(gl_FragCoord.xy * clusterDepth.zw), vec2(0.0), clusterGrid.xy - 1.0);
+	float slice = clamp(floor(log(-position.z) * clusterDepth.x + clusterDepth.y), 0.0, clusterGrid.z - 1.0);
+	return (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+}
+
+// Swiatlo z danych klastrow - te same wzory co sloty GL_LIGHTn z LightManager, poza zasiegiem zero
+vec4 clusterLight(float light, vec3 normal)
+{
+	vec4 position = clusterTexel(clusterLights, light * 4.0, clusterTexels.x);
+	vec4 color = clusterTexel(clusterLights, light * 4.0 + 1.0, clusterTexels.x);
+	vec4 direction = clusterTexel(clusterLights, light * 4.0 + 2.0, clusterTexels.x);
+	vec4 lightAmbient = clusterTexel(clusterLights, light * 4.0 + 3.0, clusterTexels.x);
+	vec3 spotDirection = mat3(clusterView) * direction.xyz;
+
+	vec3 toLight = -spotDirection;
+	float attenuation = 1.0;
+	if (color.w != 2.0)
+	{
+		toLight = (clusterView * vec4(position.xyz, 1.0)).xyz - viewPosition;
+		float ratio = length(toLight) / position.w;
+		attenuation = ratio < 1.0 ? 1.0 / (1.0 + ATTENUATION_SCALE * ratio * ratio) : 0.0;
+		if (color.w == 1.0)
+		{
+			// wykladnik jak w LightManager - na krawedzi stozka ~10% swiatla
+			float spot = dot(normalize(-toLight), normalize(spotDirection));
+			float exponent = direction.w < 0.999 ? min(log(0.1) / log(max(direction.w, 0.001)), 128.0) : 0.0;
+			attenuation *= spot < direction.w ? 0.0 : pow(max(spot, 1e-4), exponent);
+		}
+	}
+
+	int shadow = -1;
+#ifdef SHADOWS
+	for (int n = 0; n <= MAX_POINT_SHADOWS; n++)
+	{
+		if (float(clusterShadowLights[n]) == light)
+		{
+			shadow = n;
+		}
+	}
+#endif
+	return lightContribution(normal, toLight, attenuation, vec4(lightAmbient.rgb, 1.0), vec4(color.rgb, 1.0), vec4(color.rgb, 1.0), shadow);
+}
+#endif
+
+void main()
+{
+	vec4 color = gl_Color;
+#ifdef LIGHTING
+#ifdef MATERIAL
+#ifdef VERTEX_COLOR
+	ambient = gl_Color;
+	diffuse = gl_Color;
+#else
+	ambient = gl_FrontMaterial.ambient;
+	diffuse = gl_FrontMaterial.diffuse;
+#endif
+	specular = gl_FrontMaterial.specular;
+	shininess = gl_FrontMaterial.shininess;
+	vec4 lit = gl_FrontMaterial.emission + ambient * gl_LightModel.ambient;
+#else
+	ambient = gl_Color;
+	diffuse = gl_Color;
+	specular = vec4(0.0);
+	shininess = 0.0;
+	vec4 lit = ambient * gl_LightModel.ambient;
+#endif
+	vec3 normal = normalize(viewNormal);
+#ifdef CLUSTERED
+	// swiatla kierunkowe (wspolne) i lista klastra piksela - koszt zalezy tylko od swiatel w poblizu
+	vec4 range = clusterTexel(clusterRanges, clusterOf(viewPosition), clusterTexels.y);
+	float globalCount = clusterGrid.w;
+	for (int n = 0; n < MAX_CLUSTER_LIGHTS; n++)
+	{
+		float i = float(n);
+		if (i >= globalCount + range.a)
+		{
+			break;
+		}
+		float entry = i < globalCount ? i : range.r + i - globalCount;
+		lit += clusterLight(clusterTexel(clusterIndices, entry, clusterTexels.z).r, normal);
+	}
+#else
+	for (int i = 0; i < gl_MaxLights; i++)
+	{
+		if (i >= lightCount)
+		{
+			break;
+		}
+
+		// jak staly potok: oslabienie 1 / (c + l d + q d^2), stozek reflektora z wykladnikiem (tylko ASCII w GLSL)
+		vec4 source = gl_LightSource[i].position;
+		vec3 toLight = source.xyz;
+		float attenuation = 1.0;
+		if (source.w != 0.0)
+		{
+			toLight = source.xyz - viewPosition;
+			float range = length(toLight);
+			attenuation = 1.0 / (gl_LightSource[i].constantAttenuation + gl_LightSource[i].linearAttenuation * range +
+				gl_LightSource[i].quadraticAttenuation * range * range);
+			if (gl_LightSource[i].spotCutoff <= 90.0)
+			{
+				float spot = dot(normalize(-toLight), normalize(gl_LightSource[i].spotDirection));
+				attenuation *= spot < gl_LightSource[i].spotCosCutoff ? 0.0 : pow(max(spot, 1e-4), gl_LightSource[i].spotExponent);
+			}
+		}
+
+		int shadow = -1;
+#ifdef SHADOWS
+		shadow = i < MAX_SHADOW_SLOTS ? shadowSlots[i] : -1;
+#endif
+		lit += lightContribution(normal, toLight, attenuation, gl_LightSource[i].ambient, gl_LightSource[i].diffuse,
+			gl_LightSource[i].specular, shadow);
+	}
+#endif
+	color = vec4(lit.rgb, diffuse.a);
+#endif
+#ifdef TEXTURE
+	color *= texture2D(diffuseMap, gl_TexCoord[0].st);
+#endif
+	gl_FragColor = color;
+}
+)";
+	}
+
+	static string defines(uint32_t features)
+	{
+		ostringstream text;
+		text << "#version 120\n";
+		if (features & Lighting) text << "#define LIGHTING\n";
+		if (features & Material) text << "#define MATERIAL\n";
+		if (features & Texture) text << "#define TEXTURE\n";
+		if (features & VertexColor) text << "#define VERTEX_COLOR\n";
+		if (features & Clustered)
+		{
+			text << "#define CLUSTERED\n#define MAX_CLUSTER_LIGHTS " << MaxClusterLights << "\n#define ATTENUATION_SCALE " <<
+				fixed << LightManager::AttenuationScale << "\n";
+		}
+		if (features & Instancing) text << "#define INSTANCING\n#define MAX_INSTANCES " << MaxInstances << "\n";
+		if (features & ObjectBuffer) text << "#define OBJECT_BUFFER\n#define MAX_OBJECTS " << MaxObjects << "\n";
+		if (features & ShadowMaps)
+		{
+			text << "#define SHADOWS\n#define MAX_CASCADES " << MaxCascades << "\n#define MAX_POINT_SHADOWS " << MaxPointShadows <<
+				"\n#define MAX_SHADOW_SLOTS " << MaxShadowSlots << "\n";
+		}
+		return text.str();
+	}
+
+	static unique_ptr<ShaderProgram> create(uint32_t features)
+	{
+		auto start = chrono::steady_clock::now();
+		unique_ptr<ShaderProgram> program(new ShaderProgram());
+		string header = defines(features);
+		string vertex = header + vertexSource();
+		string fragment = header + fragmentSource();
+
+		bool binary = GLExt::supportsProgramBinary();
+		string path = cacheDirectory + "/" + cacheName(vertex + fragment) + ".bin";
+		if (binary && loadBinary(*program, path))
+		{
+			program->fromCache = true;
+			counters.loaded++;
+		}
+		else if (compile(*program, vertex, fragment, binary))
+		{
+			counters.compiled++;
+			if (binary)
+			{
+				saveBinary(*program, path);
+			}
+		}
+		else
+		{
+			counters.failed++;
+		}
+
+		program->features = features;
+		if (program->id)
+		{
+			GLExt::UseProgram(program->id);
+			program->setInt("diffuseMap", 0);
+			if (features & ShadowMaps)
+			{
+				int cascadeUnits[MaxCascades], pointUnits[MaxPointShadows];
+				for (int i = 0; i < MaxCascades; i++)
+				{
+					cascadeUnits[i] = CascadeTextureUnit + i;
+				}
+				for (int i = 0; i < MaxPointShadows; i++)
+				{
+					pointUnits[i] = PointShadowTextureUnit + i;
+				}
+				program->setInts("cascadeMaps", cascadeUnits, MaxCascades);
+				program->setInts("pointShadowMaps", pointUnits, MaxPointShadows);
+			}
+			if (features & Clustered)
+			{
+				program->setInt("clusterLights", ClusterTextureUnit);
+				program->setInt("clusterRanges", ClusterTextureUnit + 1);
+				program->setInt("clusterIndices", ClusterTextureUnit + 2);
+			}
+			GLExt::UseProgram(current ? current->id : 0);
+			if (features & ObjectBuffer)
+			{
+				GLuint block = GLExt::GetUniformBlockIndex(program->id, "ObjectData");
+				if (block != GL_INVALID_INDEX)
+				{
+					GLExt::UniformBlockBinding(program->id, block, ObjectBinding);
+				}
+			}
+		}
+		counters.compileMs += chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+		return program;
+	}
+
+	static GLuint compileStage(GLenum type, const string& source)
+	{
+		GLuint shader = GLExt::CreateShader(type);
+		const char* text = source.c_str();
+		GLExt::ShaderSource(shader, 1, &text, nullptr);
+		GLExt::CompileShader(shader);
+
+		GLint status = 0;
+		GLExt::GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (!status)
+		{
+			GLint length = 0;
+			GLExt::GetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+			string log(std::max(length, 1), '\0');
+			GLExt::GetShaderInfoLog(shader, (GLsizei)log.size(), nullptr, &log[0]);
+			cout << "Blad kompilacji shadera: " << log.c_str() << "\n";
+			GLExt::DeleteShader(shader);
+			return 0;
+		}
+		return shader;
+	}
+
+	static bool compile(ShaderProgram& program, const string& vertex, const string& fragment, bool retrievable)
+	{
+		GLuint vertexShader = compileStage(GL_VERTEX_SHADER, vertex);
+		GLuint fragmentShader = compileStage(GL_FRAGMENT_SHADER, fragment);
+		if (!vertexShader || !fragmentShader)
+		{
+			if (vertexShader) GLExt::DeleteShader(vertexShader);
+			if (fragmentShader) GLExt::DeleteShader(fragmentShader);
+			return false;
+		}
+
+		GLuint id = GLExt::CreateProgram();
+		if (retrievable)
+		{
+			GLExt::ProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+		GLExt::AttachShader(id, vertexShader);
+		GLExt::AttachShader(id, fragmentShader);
+		if (GLExt::BindAttribLocation)
+		{
+			GLExt::BindAttribLocation(id, ObjectIndexAttribute, "objectIndex");
+		}
+		GLExt::LinkProgram(id);
+		GLExt::DetachShader(id, vertexShader);
+		GLExt::DetachShader(id, fragmentShader);
+		GLExt::DeleteShader(vertexShader);
+		GLExt::DeleteShader(fragmentShader);
+
+		GLint status = 0;
+		GLExt::GetProgramiv(id, GL_LINK_STATUS, &status);
+		if (!status)
+		{
+			GLint length = 0;
+			GLExt::GetProgramiv(id, GL_INFO_LOG_LENGTH, &length);
+			string log(std::max(length, 1), '\0');
+			GLExt::GetProgramInfoLog(id, (GLsizei)log.size(), nullptr, &log[0]);
+			cout << "Blad linkowania programu: " << log.c_str() << "\n";
+			GLExt::DeleteProgram(id);
+			return false;
+		}
+		program.id = id;
+		return true;
+	}
+
+	// Plik: "JSHB", format sterownika, długość, dane programu
+	struct BinaryHeader
+	{
+		char magic[4];
+		uint32_t format;
+		uint32_t length;
+	};
+
+	static bool loadBinary(ShaderProgram& program, const string& path)
+	{
+		ifstream file(path, ios::binary);
+		BinaryHeader header;
+		if (!file.read((char*)&header, sizeof(header)) || memcmp(header.magic, "JSHB", 4) != 0 || header.length == 0)
+		{
+			return false;
+		}
+		vector<char> data(header.length);
+		if (!file.read(data.data(), data.size()))
+		{
+			return false;
+		}
+
+		// sterownik może odrzucić plik (np. po aktualizacji) - wtedy kompilacja od nowa
+		GLuint id = GLExt::CreateProgram();
+		GLExt::ProgramBinary(id, header.format, data.data(), (GLsizei)data.size());
+		GLint status = 0;
+		GLExt::GetProgramiv(id, GL_LINK_STATUS, &status);
+		if (!status)
+		{
+			GLExt::DeleteProgram(id);
+			return false;
+		}
+		program.id = id;
+		return true;
+	}
+
+	static void saveBinary(const ShaderProgram& program, const string& path)
+	{
+		GLint length = 0;
+		GLExt::GetProgramiv(program.id, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+		{
+			return;
+		}
+
+		vector<char> data(length);
+		GLenum format = 0;
+		GLsizei written = 0;
+		GLExt::GetProgramBinary(program.id, length, &written, &format, data.data());
+		if (written <= 0)
+		{
+			return;
+		}
+
+		makeDirectory(cacheDirectory);
+		BinaryHeader header = { { 'J', 'S', 'H', 'B' }, format, (uint32_t)written };
+		ofstream file(path, ios::binary | ios::trunc);
+		file.write((const char*)&header, sizeof(header));
+		file.write(data.data(), written);
+	}
+
+	// FNV-1a źródeł i opisu sterownika (plik z innego sterownika nie zostanie użyty)
+	static string cacheName(const string& source)
+	{
+		string key = source;
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+		{
+			const char* text = (const char*)glGetString(name);
+			key += text ? text : "";
+			key += '\n';
+		}
+
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : key)
+		{
+			hash = (hash ^ (uint8_t)c) * 1099511628211ull;
+		}
+		char name[17];
+		snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+		return name;
+	}
+
+	static void makeDirectory(const string& path)
+	{
+#ifdef _WIN32
+		_mkdir(path.c_str());
+#else
+		mkdir(path.c_str(), 0755);
+#endif
+	}
+};
+
+bool ShaderCache::enabled = false;
+string ShaderCache::cacheDirectory = "shadercache";
+map<uint32_t, unique_ptr<ShaderProgram>> ShaderCache::programs;
+ShaderProgram* ShaderCache::current = nullptr;
+uint32_t ShaderCache::frameFeatures = 0;
+uint32_t ShaderCache::frameStamp = 1;
+ShaderCacheStats ShaderCache::counters;
+vector<ShaderCache::FrameUniforms> ShaderCache::frameUniforms;
+LightId ShaderCache::shadowLights[1 + ShaderCache::MaxPointShadows] = { LightManager::InvalidLight, LightManager::InvalidLight,
+	LightManager::InvalidLight, LightManager::InvalidLight, LightManager::InvalidLight };
+int ShaderCache::sentShadowSlots[ShaderCache::MaxShadowSlots] = {};
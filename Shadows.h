@@ -0,0 +1,553 @@
+﻿#pragma once
+#include "includy.h"
+#include "GLExt.h"
+#include "Frustum.h"
+#include "LightManager.h"
+#include "Shader.h"
+#include "RenderQueue.h"
+#include "WorldStreaming.h"
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+/**
+* @struct ShadowSettings
+* @brief Parametry map cieni (rozdzielczości - przed pierwszym Shadows::render)
+*/
+struct ShadowSettings
+{
+	int cascades = 4;             // 1..ShaderCache::MaxCascades
+	int resolution = 2048;        // bok mapy kaskady
+	int cubeResolution = 512;     // bok ściany mapy sześciennej
+	float splitLambda = 0.75f;    // podział kaskad: 0 - równomierny, 1 - logarytmiczny
+	float maxDistance = 60.0f;    // zasięg kaskad od kamery
+	int maxPointShadows = 4;      // 0..ShaderCache::MaxPointShadows najbliższych kamerze świateł punktowych
+	float cascadeBias = 0.0015f;  // w głębokości mapy [0, 1]
+	float pointBias = 0.02f;      // ułamek odległości od światła
+	float pointNear = 0.05f;      // bliska płaszczyzna ścian map sześciennych
+	float offsetFactor = 2.0f;    // glPolygonOffset przy rysowaniu map
+	float offsetUnits = 4.0f;
+};
+
+/**
+* @struct ShadowStats
+* @brief Liczniki ostatniej klatki
+*/
+struct ShadowStats
+{
+	int cascades = 0;
+	int cascadesRendered = 0;
+	int cascadesCached = 0;     // mapa z poprzedniej klatki - bez zmian światła, kaskady i obiektów
+	int pointLights = 0;
+	int cubesRendered = 0;
+	int cubesCached = 0;
+	size_t casters = 0;         // rysowania obiektów do map
+	float renderMs = 0.0f;
+};
+
+/**
+* @class Shadows
+* @brief Mapy cieni dla ścieżki z shaderami. Najjaśniejsze widoczne światło kierunkowe dostaje kaskady:
+* ostrosłup kamery do maxDistance dzielony jest schematem praktycznym (mieszanka podziału logarytmicznego
+* i równomiernego), każdy wycinek obejmowany sferą, a rzut ortogonalny światła przesuwany o całe teksele -
+* obrót i drobny ruch kamery nie zmieniają mapy. Najbliższe kamerze widoczne światła punktowe dostają mapy
+* sześcienne (6 ścian po 90 stopni). Obiekty rzucające cień wybierane są dla każdej kaskady i światła
+* z SpatialIndex WorldStreamer, obiekty spoza świata (poruszające się) podaje addDynamicCaster.
+* Mapa bez obiektów dynamicznych nie jest rysowana ponownie, dopóki nie zmieni się jej macierz (światło,
+* kaskada) ani zbiór obiektów świata (WorldStreamer::version)
+*/
+class Shadows
+{
+public:
+	static bool enabled;   // przełączane F11
+	static ShadowSettings settings;
+
+	static bool supported()
+	{
+		return GLExt::supportsShadowMaps();
+	}
+
+	static bool active()
+	{
+		return enabled && !failed && ShaderCache::active() && supported();
+	}
+
+	// Obiekt rzucający cień tylko w tej klatce - przed render()
+	static void addDynamicCaster(const DrawItem& item)
+	{
+		dynamicCasters.push_back(item);
+	}
+
+	// Rysowanie map - po LightManager::beginFrame i WorldStreamer::update, przed rysowaniem sceny.
+	// Stan GL (macierze, viewport, framebuffer) jest przywracany
+	static void render(const glm::mat4& view, const glm::mat4& projection)
+	{
+		PROFILE_ZONE("Shadows::render");
+		auto start = chrono::steady_clock::now();
+		frame = ShadowStats();
+		cascadeCount = 0;
+		pointCount = 0;
+		ShaderCache::addFrameUniforms(&setUniforms);
+
+		LightId directional = LightManager::InvalidLight;
+		LightId points[ShaderCache::MaxPointShadows];
+		int count = 0;
+		if (active() && LightManager::active() && create())
+		{
+			chooseLights(view, directional, points, count);
+		}
+		if (directional == LightManager::InvalidLight && count == 0)
+		{
+			ShaderCache::setShadowLights(LightManager::InvalidLight, nullptr, 0);
+			dynamicCasters.clear();
+			return;
+		}
+
+		GLint previousFramebuffer = 0;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+		glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_VIEWPORT_BIT | GL_POLYGON_BIT | GL_CURRENT_BIT);
+		glMatrixMode(GL_PROJECTION);
+		glPushMatrix();
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		ShaderCache::stop();
+
+		// tylko głębokość, stałym potokiem
+		glDisable(GL_LIGHTING);
+		glDisable(GL_TEXTURE_2D);
+		glDisable(GL_CULL_FACE);
+		glEnable(GL_DEPTH_TEST);
+		glDepthMask(GL_TRUE);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(settings.offsetFactor, settings.offsetUnits);
+		GLExt::BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+		viewToWorld = glm::inverse(view);
+		glm::vec3 eye(viewToWorld[3]);
+		if (directional != LightManager::InvalidLight)
+		{
+			renderCascades(projection, eye, LightManager::desc(directional));
+		}
+		renderCubes(eye, points, count);
+
+		GLExt::BindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+		glMatrixMode(GL_MODELVIEW);
+		glPopMatrix();
+		glPopAttrib();
+
+		bindTextures();
+		ShaderCache::setShadowLights(cascadeCount > 0 ? directional : LightManager::InvalidLight, points, count);
+		dynamicCasters.clear();
+		frame.cascades = cascadeCount;
+		frame.pointLights = pointCount;
+		frame.renderMs = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+	}
+
+	static ShadowStats stats()
+	{
+		return frame;
+	}
+
+	static void release()
+	{
+		for (CascadeMap& map : cascadeMaps)
+		{
+			if (map.texture)
+			{
+				glDeleteTextures(1, &map.texture);
+			}
+			map = CascadeMap();
+		}
+		for (CubeMap& map : cubeMaps)
+		{
+			if (map.texture)
+			{
+				glDeleteTextures(1, &map.texture);
+			}
+			map = CubeMap();
+		}
+		if (framebuffer)
+		{
+			GLExt::DeleteFramebuffers(1, &framebuffer);
+			framebuffer = 0;
+		}
+		failed = false;
+		ShaderCache::setShadowLights(LightManager::InvalidLight, nullptr, 0);
+	}
+
+private:
+	struct CascadeMap
+	{
+		GLuint texture = 0;
+		glm::mat4 matrix = glm::mat4(0.0f); // projekcja * widok światła ostatniego rysowania
+		uint64_t version = 0;
+		bool dynamic = false;               // zawiera obiekty dynamiczne - rysowana co klatkę
+		bool valid = false;
+	};
+
+	struct CubeMap
+	{
+		GLuint texture = 0;
+		LightId light = LightManager::InvalidLight;
+		glm::vec3 position = glm::vec3(0.0f);
+		float range = 0.0f;
+		uint64_t version = 0;
+		bool dynamic = false;
+		bool valid = false;
+	};
+
+	static GLuint framebuffer;
+	static bool failed;
+	static CascadeMap cascadeMaps[ShaderCache::MaxCascades];
+	static CubeMap cubeMaps[ShaderCache::MaxPointShadows];
+	static vector<DrawItem> dynamicCasters;
+	static vector<DrawItem> casters;
+	static vector<DrawItem> faceCasters;
+	static ShadowStats frame;
+
+	// uniformy klatki
+	static int cascadeCount;
+	static int pointCount;
+	static glm::mat4 shadowMatrices[ShaderCache::MaxCascades];
+	static glm::vec4 splits;
+	static glm::mat4 viewToWorld;
+	static glm::vec4 pointLights[ShaderCache::MaxPointShadows];
+
+	static void setUniforms(ShaderProgram& program)
+	{
+		if (!(program.features & ShaderCache::ShadowMaps))
+		{
+			return;
+		}
+		glm::vec4 params(settings.cascadeBias, settings.pointBias, settings.pointNear, 0.0f);
+		program.setMatrices("cascadeMatrices", shadowMatrices, ShaderCache::MaxCascades);
+		program.setVectors("cascadeSplits", &splits, 1);
+		program.setInt("cascadeCount", cascadeCount);
+		program.setMatrices("shadowViewToWorld", &viewToWorld, 1);
+		program.setVectors("pointShadowLights", pointLights, ShaderCache::MaxPointShadows);
+		program.setVectors("shadowParams", &params, 1);
+	}
+
+	// Najjaśniejsze widoczne światło kierunkowe i najbliższe kamerze punktowe (także reflektory)
+	static void chooseLights(const glm::mat4& view, LightId& directional, LightId* points, int& count)
+	{
+		glm::vec3 eye(glm::inverse(view)[3]);
+		float brightest = -1.0f;
+		vector<pair<float, LightId>> nearest;
+		for (uint32_t index : LightManager::visibleLights())
+		{
+			LightId id = LightManager::idOf(index);
+			LightDesc desc = LightManager::desc(id);
+			if (desc.type == LightType::Directional)
+			{
+				float brightness = glm::dot(desc.color, glm::vec3(1.0f)) * desc.intensity;
+				if (brightness > brightest)
+				{
+					brightest = brightness;
+					directional = id;
+				}
+				continue;
+			}
+			float distance = glm::length(desc.position - eye) - desc.range;
+			if (distance < settings.maxDistance)
+			{
+				nearest.push_back(make_pair(distance, id));
+			}
+		}
+
+		count = std::min((int)nearest.size(), std::max(0, std::min(settings.maxPointShadows, (int)ShaderCache::MaxPointShadows)));
+		partial_sort(nearest.begin(), nearest.begin() + count, nearest.end());
+		for (int i = 0; i < count; i++)
+		{
+			points[i] = nearest[i].second;
+		}
+	}
+
+	static void renderCascades(const glm::mat4& projection, const glm::vec3& eye, const LightDesc& light)
+	{
+		// płaszczyzny i kąty kamery z macierzy projekcji
+		float nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+		float farPlane = std::min(projection[3][2] / (projection[2][2] + 1.0f), settings.maxDistance);
+		float tanX = 1.0f / projection[0][0];
+		float tanY = 1.0f / projection[1][1];
+		float diagonal = tanX * tanX + tanY * tanY; // (promień przekroju / głębokość)^2
+		glm::vec3 forward = -glm::vec3(viewToWorld[2]);
+
+		glm::vec3 up = fabs(light.direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), light.direction, up);
+		float top = -1e30f;
+		sceneTop(lightView, top);
+
+		// przesunięcie z [-1, 1] do współrzędnych mapy [0, 1]
+		glm::mat4 bias = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
+		int count = std::max(1, std::min(settings.cascades, (int)ShaderCache::MaxCascades));
+		uint64_t version = WorldStreamer::version();
+		float previous = nearPlane;
+		splits = glm::vec4(0.0f);
+		for (int c = 0; c < count; c++)
+		{
+			float ratio = (float)(c + 1) / count;
+			float logarithmic = nearPlane * pow(farPlane / nearPlane, ratio);
+			float uniform = nearPlane + (farPlane - nearPlane) * ratio;
+			float split = glm::mix(uniform, logarithmic, settings.splitLambda);
+
+			// sfera wycinka [previous, split]: środek na osi, równa odległość do rogów obu podstaw
+			float distance = std::min(0.5f * (previous + split) * (1.0f + diagonal), split);
+			float radius = sqrt((split - distance) * (split - distance) + split * split * diagonal);
+			radius = ceil(radius * 16.0f) / 16.0f;
+			glm::vec3 center = glm::vec3(lightView * glm::vec4(eye + forward * distance, 1.0f));
+			float texel = 2.0f * radius / settings.resolution;
+			center.x = floor(center.x / texel) * texel;
+			center.y = floor(center.y / texel) * texel;
+
+			// bliska płaszczyzna sięga do najwyższego obiektu - cień rzucają też obiekty spoza wycinka
+			float nearDistance = -std::max(center.z + radius, top);
+			float farDistance = -(center.z - radius);
+			glm::mat4 lightProjection = glm::ortho(center.x - radius, center.x + radius, center.y - radius, center.y + radius, nearDistance, farDistance);
+			glm::mat4 matrix = lightProjection * lightView;
+			Frustum frustum = Frustum::fromMatrix(matrix);
+
+			splits[c] = split;
+			shadowMatrices[c] = bias * matrix * viewToWorld;
+			previous = split;
+
+			bool dynamic = false;
+			for (const DrawItem& item : dynamicCasters)
+			{
+				dynamic = dynamic || frustum.intersectsSphere(item.center, item.radius);
+			}
+			CascadeMap& map = cascadeMaps[c];
+			if (map.valid && map.matrix == matrix && map.version == version && !dynamic && !map.dynamic)
+			{
+				frame.cascadesCached++;
+				continue;
+			}
+
+			casters.clear();
+			if (WorldStreamer::isOpen())
+			{
+				WorldStreamer::queryCasters(frustum, eye, casters);
+			}
+			for (const DrawItem& item : dynamicCasters)
+			{
+				if (frustum.intersectsSphere(item.center, item.radius))
+				{
+					casters.push_back(item);
+				}
+			}
+			drawMap(GL_TEXTURE_2D, map.texture, settings.resolution, lightProjection, lightView, casters);
+
+			map.matrix = matrix;
+			map.version = version;
+			map.dynamic = dynamic;
+			map.valid = true;
+			frame.cascadesRendered++;
+		}
+		cascadeCount = count;
+	}
+
+	static void renderCubes(const glm::vec3& eye, const LightId* lights, int count)
+	{
+		static const glm::vec3 directions[6] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+			glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+		static const glm::vec3 ups[6] = { glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+			glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f) };
+
+		uint64_t version = WorldStreamer::version();
+		for (int n = 0; n < count; n++)
+		{
+			LightDesc light = LightManager::desc(lights[n]);
+			pointLights[n] = glm::vec4(light.position, light.range);
+
+			bool dynamic = false;
+			for (const DrawItem& item : dynamicCasters)
+			{
+				dynamic = dynamic || glm::length(item.center - light.position) < light.range + item.radius;
+			}
+			CubeMap& map = cubeMaps[n];
+			if (map.valid && map.light == lights[n] && map.position == light.position && map.range == light.range &&
+				map.version == version && !dynamic && !map.dynamic)
+			{
+				frame.cubesCached++;
+				continue;
+			}
+
+			casters.clear();
+			glm::vec3 extent(light.range);
+			if (WorldStreamer::isOpen())
+			{
+				WorldStreamer::queryCasters(light.position - extent, light.position + extent, eye, casters);
+			}
+			for (const DrawItem& item : dynamicCasters)
+			{
+				if (glm::length(item.center - light.position) < light.range + item.radius)
+				{
+					casters.push_back(item);
+				}
+			}
+
+			glm::mat4 faceProjection = glm::perspective(glm::radians(90.0f), 1.0f, settings.pointNear, light.range);
+			for (int face = 0; face < 6; face++)
+			{
+				glm::mat4 faceView = glm::lookAt(light.position, light.position + directions[face], ups[face]);
+				Frustum frustum = Frustum::fromMatrix(faceProjection * faceView);
+				faceCasters.clear();
+				for (const DrawItem& item : casters)
+				{
+					if (frustum.intersectsSphere(item.center, item.radius))
+					{
+						faceCasters.push_back(item);
+					}
+				}
+				drawMap(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, map.texture, settings.cubeResolution, faceProjection, faceView, faceCasters);
+			}
+
+			map.light = lights[n];
+			map.position = light.position;
+			map.range = light.range;
+			map.version = version;
+			map.dynamic = dynamic;
+			map.valid = true;
+			frame.cubesRendered++;
+		}
+		pointCount = count;
+	}
+
+	static void drawMap(GLenum target, GLuint texture, int size, const glm::mat4& projection, const glm::mat4& view, const vector<DrawItem>& items)
+	{
+		GLExt::FramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, texture, 0);
+		glViewport(0, 0, size, size);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glMatrixMode(GL_PROJECTION);
+		glLoadMatrixf(glm::value_ptr(projection));
+		glMatrixMode(GL_MODELVIEW);
+		for (const DrawItem& item : items)
+		{
+			glLoadMatrixf(glm::value_ptr(view * item.transform));
+			item.draw(item.object, item.level);
+		}
+		frame.casters += items.size();
+	}
+
+	// Najwyższy (najbliższy światłu) punkt obiektów świata i dynamicznych w przestrzeni światła
+	static void sceneTop(const glm::mat4& lightView, float& top)
+	{
+		glm::vec3 low, high;
+		if (WorldStreamer::isOpen() && WorldStreamer::bounds(low, high))
+		{
+			for (int corner = 0; corner < 8; corner++)
+			{
+				glm::vec3 point(corner & 1 ? high.x : low.x, corner & 2 ? high.y : low.y, corner & 4 ? high.z : low.z);
+				top = std::max(top, (lightView * glm::vec4(point, 1.0f)).z);
+			}
+		}
+		for (const DrawItem& item : dynamicCasters)
+		{
+			top = std::max(top, (lightView * glm::vec4(item.center, 1.0f)).z + item.radius);
+		}
+	}
+
+	// Tekstury map w jednostkach CascadeTextureUnit.. i PointShadowTextureUnit.. (jednostka 0 zostaje dla materiałów)
+	static void bindTextures()
+	{
+		for (int c = 0; c < ShaderCache::MaxCascades; c++)
+		{
+			GLExt::ActiveTexture(GL_TEXTURE0 + ShaderCache::CascadeTextureUnit + c);
+			glBindTexture(GL_TEXTURE_2D, cascadeMaps[c].texture);
+		}
+		for (int n = 0; n < ShaderCache::MaxPointShadows; n++)
+		{
+			GLExt::ActiveTexture(GL_TEXTURE0 + ShaderCache::PointShadowTextureUnit + n);
+			glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMaps[n].texture);
+		}
+		GLExt::ActiveTexture(GL_TEXTURE0);
+	}
+
+	static bool create()
+	{
+		if (framebuffer)
+		{
+			return true;
+		}
+		if (failed)
+		{
+			return false;
+		}
+
+		// tekstury tworzone poza jednostką 0 - nie zmieniają dowiązań TextureHandler
+		GLExt::ActiveTexture(GL_TEXTURE0 + ShaderCache::CascadeTextureUnit);
+		for (CascadeMap& map : cascadeMaps)
+		{
+			glGenTextures(1, &map.texture);
+			glBindTexture(GL_TEXTURE_2D, map.texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, settings.resolution, settings.resolution, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // porównanie 4 sąsiednich tekseli
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+			glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_TEXTURE_MODE, GL_LUMINANCE);
+		}
+		for (CubeMap& map : cubeMaps)
+		{
+			// porównanie w shaderze (samplerCubeShadow dopiero w GLSL 1.30)
+			glGenTextures(1, &map.texture);
+			glBindTexture(GL_TEXTURE_CUBE_MAP, map.texture);
+			for (int face = 0; face < 6; face++)
+			{
+				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24, settings.cubeResolution, settings.cubeResolution, 0,
+					GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+			}
+			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_DEPTH_TEXTURE_MODE, GL_LUMINANCE);
+		}
+		GLExt::ActiveTexture(GL_TEXTURE0);
+
+		// framebuffer bez koloru - tylko głębokość
+		GLint previousFramebuffer = 0;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+		GLExt::GenFramebuffers(1, &framebuffer);
+		GLExt::BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		GLExt::FramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, cascadeMaps[0].texture, 0);
+		bool complete = GLExt::CheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		GLExt::FramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X, cubeMaps[0].texture, 0);
+		complete = complete && GLExt::CheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		GLExt::BindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+		if (!complete)
+		{
+			cout << "Mapy cieni nie sa obslugiwane (niekompletny framebuffer glebokosci)\n";
+			release();
+			failed = true;
+			return false;
+		}
+		return true;
+	}
+};
+
+bool Shadows::enabled = false;
+ShadowSettings Shadows::settings;
+GLuint Shadows::framebuffer = 0;
+bool Shadows::failed = false;
+Shadows::CascadeMap Shadows::cascadeMaps[ShaderCache::MaxCascades];
+Shadows::CubeMap Shadows::cubeMaps[ShaderCache::MaxPointShadows];
+vector<DrawItem> Shadows::dynamicCasters;
+vector<DrawItem> Shadows::casters;
+vector<DrawItem> Shadows::faceCasters;
+ShadowStats Shadows::frame;
+int Shadows::cascadeCount = 0;
+int Shadows::pointCount = 0;
+glm::mat4 Shadows::shadowMatrices[ShaderCache::MaxCascades];
+glm::vec4 Shadows::splits = glm::vec4(0.0f);
+glm::mat4 Shadows::viewToWorld = glm::mat4(1.0f);
+glm::vec4 Shadows::pointLights[ShaderCache::MaxPointShadows];
@@ -0,0 +1,167 @@
+﻿#pragma once
+#include "includy.h"
+#include "Frustum.h"
+#include <cstdint>
+#include <algorithm>
+
+/**
+* @class SpatialIndex
+* @brief Hierarchia prostopadłościanów (BVH) obiektów sceny - zapytania ostrosłupem lub prostopadłościanem
+* odwiedzają tylko gałęzie, które go przecinają. Budowana od nowa po zmianie zbioru obiektów
+* (podział w połowie najdłuższej osi środków, liście po LeafSize obiektów)
+*/
+class SpatialIndex
+{
+public:
+	static const uint32_t LeafSize = 4;
+
+	struct Item
+	{
+		glm::vec3 low;
+		glm::vec3 high;
+		uint32_t id;   // indeks obiektu u właściciela indeksu
+	};
+
+	void build(vector<Item> source)
+	{
+		items = std::move(source);
+		nodes.clear();
+		if (items.empty())
+		{
+			return;
+		}
+		nodes.reserve(items.size() * 2 / LeafSize + 1);
+		buildNode(0, (uint32_t)items.size());
+	}
+
+	void clear()
+	{
+		items.clear();
+		nodes.clear();
+	}
+
+	bool empty() const
+	{
+		return nodes.empty();
+	}
+
+	size_t size() const
+	{
+		return items.size();
+	}
+
+	glm::vec3 boundsMin() const
+	{
+		return nodes.empty() ? glm::vec3(0.0f) : nodes[0].low;
+	}
+
+	glm::vec3 boundsMax() const
+	{
+		return nodes.empty() ? glm::vec3(0.0f) : nodes[0].high;
+	}
+
+	// visit(id) dla obiektów przecinających ostrosłup
+	template<class Visit>
+	void query(const Frustum& frustum, Visit&& visit) const
+	{
+		traverse([&frustum](const glm::vec3& low, const glm::vec3& high) { return frustum.intersectsBox(low, high); }, visit);
+	}
+
+	// visit(id) dla obiektów przecinających prostopadłościan
+	template<class Visit>
+	void query(const glm::vec3& low, const glm::vec3& high, Visit&& visit) const
+	{
+		traverse([&low, &high](const glm::vec3& a, const glm::vec3& b)
+		{
+			return a.x <= high.x && b.x >= low.x && a.y <= high.y && b.y >= low.y && a.z <= high.z && b.z >= low.z;
+		}, visit);
+	}
+
+private:
+	// Węzeł wewnętrzny: count == 0, lewe dziecko zaraz za węzłem, prawe pod indeksem first
+	struct Node
+	{
+		glm::vec3 low;
+		glm::vec3 high;
+		uint32_t first;
+		uint32_t count;
+	};
+
+	vector<Item> items;
+	vector<Node> nodes;
+
+	template<class Test, class Visit>
+	void traverse(const Test& test, Visit& visit) const
+	{
+		if (nodes.empty())
+		{
+			return;
+		}
+
+		uint32_t stack[64];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0)
+		{
+			const Node& node = nodes[stack[--top]];
+			if (!test(node.low, node.high))
+			{
+				continue;
+			}
+			if (node.count > 0)
+			{
+				for (uint32_t i = node.first; i < node.first + node.count; i++)
+				{
+					if (test(items[i].low, items[i].high))
+					{
+						visit(items[i].id);
+					}
+				}
+				continue;
+			}
+			uint32_t index = (uint32_t)(&node - nodes.data());
+			stack[top++] = node.first;
+			stack[top++] = index + 1;
+		}
+	}
+
+	uint32_t buildNode(uint32_t begin, uint32_t end)
+	{
+		uint32_t index = (uint32_t)nodes.size();
+		nodes.push_back(Node());
+
+		glm::vec3 low(1e30f), high(-1e30f), centerLow(1e30f), centerHigh(-1e30f);
+		for (uint32_t i = begin; i < end; i++)
+		{
+			low = glm::min(low, items[i].low);
+			high = glm::max(high, items[i].high);
+			glm::vec3 center = (items[i].low + items[i].high) * 0.5f;
+			centerLow = glm::min(centerLow, center);
+			centerHigh = glm::max(centerHigh, center);
+		}
+		nodes[index].low = low;
+		nodes[index].high = high;
+
+		// głębokość ograniczona stosem w traverse - przy podziale w połowie i tak rzędu log2(n)
+		glm::vec3 extent = centerHigh - centerLow;
+		if (end - begin <= LeafSize || (extent.x <= 0.0f && extent.y <= 0.0f && extent.z <= 0.0f))
+		{
+			nodes[index].first = begin;
+			nodes[index].count = end - begin;
+			return index;
+		}
+
+		int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+		uint32_t middle = begin + (end - begin) / 2;
+		nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end, [axis](const Item& a, const Item& b)
+		{
+			return a.low[axis] + a.high[axis] < b.low[axis] + b.high[axis];
+		});
+
+		buildNode(begin, middle);
+		uint32_t right = buildNode(middle, end);
+		nodes[index].first = right;
+		nodes[index].count = 0;
+		return index;
+	}
+};
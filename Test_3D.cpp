@@ -3,15 +3,152 @@
 #include "Engine.h"
 #include "light.h"
 #include "const.h"
+#include "MeshImporter.h"
+#include "MeshSimplifier.h"
+#include "MeshFile.h"
 
 
 
+/**
+* @brief Przygotowanie tekstury offline
+* Test_3D --cook obraz.png tekstura.jtx [--bc1] [--srgb] [--kaiser] [--premultiply]
+*/
+bool cookTexture(int argc, char** argv)
+{
+	TextureCookOptions options;
+	for (int i = 4; i < argc; i++)
+	{
+		string flag = argv[i];
+		if (flag == "--bc1") options.blockCompress = true;
+		else if (flag == "--srgb") options.mip.srgb = true;
+		else if (flag == "--kaiser") options.mip.filter = MipFilter::Kaiser;
+		else if (flag == "--premultiply") options.mip.premultiplyAlpha = true;
+		else
+		{
+			cout << "Nieznana opcja " << flag << "\n";
+			return false;
+		}
+	}
+	return TextureContainer::cook(argv[2], argv[3], options);
+}
+
+/**
+* @brief Przygotowanie siatki offline (OBJ/PLY -> .jmesh)
+* Test_3D --cook-mesh siatka.obj siatka.jmesh [--lods N] [--quantized | --oct]
+*/
+bool cookMesh(int argc, char** argv)
+{
+	int lods = 0;
+	VertexLayout layout = VertexLayout::Float;
+	for (int i = 4; i < argc; i++)
+	{
+		string flag = argv[i];
+		if (flag == "--lods" && i + 1 < argc) lods = atoi(argv[++i]);
+		else if (flag == "--quantized") layout = VertexLayout::Quantized;
+		else if (flag == "--oct") layout = VertexLayout::QuantizedOct;
+		else
+		{
+			cout << "Nieznana opcja " << flag << "\n";
+			return false;
+		}
+	}
+
+	// optymalizacja raz, po zbudowaniu poziomów LOD
+	Mesh mesh;
+	MeshImportOptions options;
+	options.optimize = false;
+	MeshImportStats stats;
+	if (!MeshImporter::load(argv[2], mesh, options, &stats))
+	{
+		return false;
+	}
+	cout << argv[2] << ": " << stats.vertices << " wierzcholkow, " << stats.triangles << " trojkatow, "
+		<< (int)stats.megabytesPerSecond() << " MB/s\n";
+
+	if (lods > 1)
+	{
+		MeshSimplifier::buildLods(mesh, lods);
+	}
+	MeshOptimizeStats optimized = MeshOptimizer::optimize(mesh);
+	cout << argv[2] << ": wierzcholki " << optimized.verticesBefore << " -> " << optimized.verticesAfter
+		<< ", ACMR " << optimized.before.acmr << " -> " << optimized.after.acmr
+		<< ", ATVR " << optimized.before.atvr << " -> " << optimized.after.atvr << "\n";
+	return MeshFile::save(mesh, argv[3], layout);
+}
+
+/**
+* @brief Spakowanie zasobów do jednego archiwum
+* Test_3D --pack zasoby.jpak plik1 plik2 ...
+*/
+bool packAssets(int argc, char** argv)
+{
+	vector<string> files(argv + 3, argv + argc);
+	return AssetArchive::pack(files, argv[2]);
+}
+
 /**
 * @brief Funkcja Main
-* Uruchamia inicjalizaję Engine, a następnie uruchamia okienko programu
+* Uruchamia inicjalizaję Engine, a następnie uruchamia okienko programu.
+* Z opcją --cook, --cook-mesh lub --pack tylko przygotowuje teksturę, siatkę lub archiwum i kończy działanie.
+* Zasoby z assets.jpak (jeśli istnieje) mają pierwszeństwo przed luźnymi plikami.
+* Z opcją --world plik.jworld wczytuje świat komórkami wokół kamery, z --hot-reload przeładowuje zmienione pliki,
+* z --clustered ścieżka GLSL bierze światła z list klastrów zamiast slotów GL_LIGHTn, z --shaders startuje na ścieżce GLSL (F8),
+* z --shadows dodatkowo z mapami cieni (F11), z --perf z nakładką wydajności (F9),
+* z --profile plik.json od startu zapisuje strefy profilera (F10 kończy i zapisuje, wymaga JOJO_PROFILE)
 */
 int main(int argc, char** argv) {
 
+	if (argc >= 4 && string(argv[1]) == "--cook")
+	{
+		return cookTexture(argc, argv) ? 0 : 1;
+	}
+	if (argc >= 4 && string(argv[1]) == "--cook-mesh")
+	{
+		return cookMesh(argc, argv) ? 0 : 1;
+	}
+	if (argc >= 4 && string(argv[1]) == "--pack")
+	{
+		return packAssets(argc, argv) ? 0 : 1;
+	}
+
+	AssetArchive::mount("assets.jpak");
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (string(argv[i]) == "--world")
+		{
+			WorldStreamer::open(argv[i + 1]);
+		}
+		if (string(argv[i]) == "--profile")
+		{
+			Profiler::outputPath = argv[i + 1];
+			Profiler::toggle();
+		}
+	}
+	for (int i = 1; i < argc; i++)
+	{
+		if (string(argv[i]) == "--hot-reload")
+		{
+			HotReload::enabled = true;
+		}
+		if (string(argv[i]) == "--clustered")
+		{
+			ClusteredLighting::enabled = true;
+		}
+		if (string(argv[i]) == "--shaders")
+		{
+			ShaderCache::enabled = true;
+		}
+		if (string(argv[i]) == "--shadows")
+		{
+			ShaderCache::enabled = true;
+			Shadows::enabled = true;
+		}
+		if (string(argv[i]) == "--perf")
+		{
+			PerfHud::enabled = true;
+		}
+	}
+
 	Engine::initialize(argc, argv);
 	Engine::run();
 	return 0;
@@ -0,0 +1,379 @@
+﻿#pragma once
+#include "includy.h"
+#include "GLExt.h"
+#include "TextureHandler.h"
+#include "Profiler.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+/**
+* @struct TextStats
+* @brief Liczniki ostatniego TextRenderer::draw
+*/
+struct TextStats
+{
+	size_t strings = 0;
+	size_t glyphs = 0;       // czworokąty w buforze
+	bool rebuilt = false;    // bufor zbudowany od nowa (tekst się zmienił)
+	size_t drawCalls = 0;
+};
+
+/**
+* @class TextRenderer
+* @brief Tekst na ekranie z atlasu glifów. Czcionka GLUT rysowana jest raz do atlasu (GL_ALPHA), a wszystkie
+* napisy klatki składane są w jeden bufor czworokątów rysowany jednym glDrawArrays. Bufor budowany jest
+* od nowa tylko, gdy napisy klatki różnią się od poprzednich - niezmieniony HUD to samo wywołanie rysowania.
+* Z obsługą buforów wierzchołków (OpenGL 1.5) czworokąty trzymane są w VBO, bez niej w tablicy wierzchołków
+*/
+class TextRenderer
+{
+public:
+	static void* font; // czcionka GLUT, przed pierwszym load()
+
+	// Atlas glifów rysowany w bieżącym buforze ramki - przed glClear klatki (kolejne wywołania nic nie robią).
+	// Bez atlasu draw() nic nie rysuje
+	static void load()
+	{
+		if (atlas)
+		{
+			return;
+		}
+
+		lineHeight = glutBitmapHeight(font);
+		descent = (lineHeight + 3) / 4;
+
+		// rozmieszczenie glifów półkami w atlasie o szerokości AtlasWidth
+		int x = 0, y = 0;
+		for (int c = FirstGlyph; c <= LastGlyph; c++)
+		{
+			Glyph& glyph = glyphs[c - FirstGlyph];
+			glyph.advance = glutBitmapWidth(font, c);
+			int width = glyph.advance + 2 * Padding;
+			if (x + width > AtlasWidth)
+			{
+				x = 0;
+				y += lineHeight;
+			}
+			glyph.x = x;
+			glyph.y = y;
+			glyph.width = width;
+			x += width;
+		}
+		atlasHeight = 1;
+		while (atlasHeight < y + lineHeight)
+		{
+			atlasHeight *= 2;
+		}
+
+		// rysowanie glifów czcionką GLUT (białe na czarnym) i odczyt pokrycia
+		glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_VIEWPORT_BIT | GL_CURRENT_BIT);
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_LIGHTING);
+		glDisable(GL_TEXTURE_2D);
+		glDisable(GL_BLEND);
+		glViewport(0, 0, AtlasWidth, atlasHeight);
+		glMatrixMode(GL_PROJECTION);
+		glPushMatrix();
+		glLoadIdentity();
+		gluOrtho2D(0, AtlasWidth, 0, atlasHeight);
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glLoadIdentity();
+
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glColor3f(1.0f, 1.0f, 1.0f);
+		for (int c = FirstGlyph; c <= LastGlyph; c++)
+		{
+			const Glyph& glyph = glyphs[c - FirstGlyph];
+			glRasterPos2i(glyph.x + Padding, glyph.y + descent);
+			glutBitmapCharacter(font, c);
+		}
+
+		vector<uint8_t> pixels((size_t)AtlasWidth * atlasHeight * 4);
+		glReadPixels(0, 0, AtlasWidth, atlasHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+		glMatrixMode(GL_MODELVIEW);
+		glPopMatrix();
+		glPopAttrib();
+
+		vector<uint8_t> coverage((size_t)AtlasWidth * atlasHeight);
+		for (size_t i = 0; i < coverage.size(); i++)
+		{
+			coverage[i] = pixels[i * 4];
+		}
+
+		glGenTextures(1, &atlas);
+		TextureHandler::bind(atlas);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, AtlasWidth, atlasHeight, 0, GL_ALPHA, GL_UNSIGNED_BYTE, coverage.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	// Napis w klatce: (x, y) - początek linii bazowej w pikselach okna, y od dołu (jak glRasterPos)
+	static void add(int x, int y, const string& text, const glm::vec3& color = glm::vec3(1.0f))
+	{
+		Entry entry;
+		entry.x = x;
+		entry.y = y;
+		entry.color = packColor(color);
+		entry.text = text;
+		pending.push_back(std::move(entry));
+	}
+
+	// Etykieta w punkcie świata (pomijana za kamerą)
+	static void addLabel(const glm::vec3& position, const glm::mat4& viewProjection, int width, int height, const string& text,
+		const glm::vec3& color = glm::vec3(1.0f))
+	{
+		glm::vec4 clip = viewProjection * glm::vec4(position, 1.0f);
+		if (clip.w <= 0.0f)
+		{
+			return;
+		}
+		float x = (clip.x / clip.w * 0.5f + 0.5f) * width;
+		float y = (clip.y / clip.w * 0.5f + 0.5f) * height;
+		add((int)x, (int)y, text, color);
+	}
+
+	// Narysowanie napisów klatki w oknie width x height jednym wywołaniem
+	static void draw(int width, int height)
+	{
+		PROFILE_ZONE("TextRenderer::draw");
+		frame = TextStats();
+		frame.strings = pending.size();
+		if (!atlas)
+		{
+			pending.clear();
+			return;
+		}
+
+		if (pending != built)
+		{
+			rebuild();
+			frame.rebuilt = true;
+		}
+		pending.clear();
+		frame.glyphs = vertices.size() / 4;
+		if (vertices.empty())
+		{
+			return;
+		}
+
+		glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT | GL_POLYGON_BIT);
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_LIGHTING);
+		glDisable(GL_CULL_FACE);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); // czworokąty glifów także w trybie siatki (F1)
+		glEnable(GL_TEXTURE_2D);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+		TextureHandler::bind(atlas);
+
+		glMatrixMode(GL_PROJECTION);
+		glPushMatrix();
+		glLoadIdentity();
+		gluOrtho2D(0, width, 0, height);
+		glMatrixMode(GL_MODELVIEW);
+		glPushMatrix();
+		glLoadIdentity();
+
+		const uint8_t* base = (const uint8_t*)vertices.data();
+		if (buffer)
+		{
+			GLExt::BindBuffer(GL_ARRAY_BUFFER, buffer);
+			base = nullptr; // przesunięcia w VBO
+		}
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+		glVertexPointer(2, GL_SHORT, sizeof(GlyphVertex), base + offsetof(GlyphVertex, x));
+		glTexCoordPointer(2, GL_FLOAT, sizeof(GlyphVertex), base + offsetof(GlyphVertex, u));
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(GlyphVertex), base + offsetof(GlyphVertex, color));
+		glDrawArrays(GL_QUADS, 0, (GLsizei)vertices.size());
+		glDisableClientState(GL_VERTEX_ARRAY);
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glDisableClientState(GL_COLOR_ARRAY);
+		if (buffer)
+		{
+			GLExt::BindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+		frame.drawCalls = 1;
+
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+		glMatrixMode(GL_MODELVIEW);
+		glPopMatrix();
+		glPopAttrib();
+		TextureHandler::invalidate(); // glPopAttrib przywrócił wcześniejszą teksturę
+	}
+
+	// Szerokość napisu w pikselach
+	static int width(const string& text)
+	{
+		int result = 0;
+		for (char c : text)
+		{
+			result += isGlyph(c) ? glutBitmapWidth(font, (unsigned char)c) : 0;
+		}
+		return result;
+	}
+
+	static int height()
+	{
+		return glutBitmapHeight(font);
+	}
+
+	static TextStats stats()
+	{
+		return frame;
+	}
+
+	static void release()
+	{
+		if (atlas)
+		{
+			glDeleteTextures(1, &atlas);
+			atlas = 0;
+		}
+		if (buffer)
+		{
+			GLExt::DeleteBuffers(1, &buffer);
+			buffer = 0;
+		}
+		vertices.clear();
+		built.clear();
+		pending.clear();
+	}
+
+private:
+	static const int FirstGlyph = 32;
+	static const int LastGlyph = 126;
+	static const int AtlasWidth = 256;
+	static const int Padding = 1;   // glify GLUT mogą wychodzić piksel przed początek
+
+	struct Glyph
+	{
+		int x = 0, y = 0;   // róg komórki w atlasie
+		int width = 0;      // komórka z marginesami
+		int advance = 0;
+	};
+
+	// 16 bajtów na wierzchołek
+	struct GlyphVertex
+	{
+		int16_t x, y;
+		float u, v;
+		uint32_t color;
+	};
+
+	struct Entry
+	{
+		int x = 0, y = 0;
+		uint32_t color = 0;
+		string text;
+
+		bool operator==(const Entry& other) const
+		{
+			return x == other.x && y == other.y && color == other.color && text == other.text;
+		}
+
+		bool operator!=(const Entry& other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	static GLuint atlas;
+	static int atlasHeight;
+	static int lineHeight;
+	static int descent;          // linia bazowa nad dołem komórki
+	static Glyph glyphs[LastGlyph - FirstGlyph + 1];
+	static vector<Entry> pending;  // napisy bieżącej klatki
+	static vector<Entry> built;    // napisy w buforze
+	static vector<GlyphVertex> vertices;
+	static GLuint buffer;
+	static size_t bufferCapacity;  // wierzchołki w VBO
+	static TextStats frame;
+
+	static bool isGlyph(char c)
+	{
+		return (unsigned char)c >= FirstGlyph && (unsigned char)c <= LastGlyph;
+	}
+
+	static uint32_t packColor(const glm::vec3& color)
+	{
+		glm::vec3 value = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+		uint8_t bytes[4] = { (uint8_t)value.x, (uint8_t)value.y, (uint8_t)value.z, 255 };
+		uint32_t result;
+		memcpy(&result, bytes, 4);
+		return result;
+	}
+
+	static void rebuild()
+	{
+		vertices.clear();
+		float scaleU = 1.0f / AtlasWidth, scaleV = 1.0f / atlasHeight;
+		for (const Entry& entry : pending)
+		{
+			int pen = entry.x;
+			for (char c : entry.text)
+			{
+				if (!isGlyph(c))
+				{
+					continue;
+				}
+				const Glyph& glyph = glyphs[(unsigned char)c - FirstGlyph];
+				int left = pen - Padding, bottom = entry.y - descent;
+				int right = left + glyph.width, top = bottom + lineHeight;
+				float u0 = glyph.x * scaleU, v0 = glyph.y * scaleV;
+				float u1 = (glyph.x + glyph.width) * scaleU, v1 = (glyph.y + lineHeight) * scaleV;
+				vertices.push_back({ (int16_t)left, (int16_t)bottom, u0, v0, entry.color });
+				vertices.push_back({ (int16_t)right, (int16_t)bottom, u1, v0, entry.color });
+				vertices.push_back({ (int16_t)right, (int16_t)top, u1, v1, entry.color });
+				vertices.push_back({ (int16_t)left, (int16_t)top, u0, v1, entry.color });
+				pen += glyph.advance;
+			}
+		}
+		built.swap(pending);
+
+		if (!GLExt::supportsVertexBuffers() || vertices.empty())
+		{
+			return;
+		}
+		if (!buffer)
+		{
+			GLExt::GenBuffers(1, &buffer);
+			bufferCapacity = 0;
+		}
+		GLExt::BindBuffer(GL_ARRAY_BUFFER, buffer);
+		if (vertices.size() > bufferCapacity)
+		{
+			bufferCapacity = vertices.size() + vertices.size() / 2;
+			GLExt::BufferData(GL_ARRAY_BUFFER, (ptrdiff_t)(bufferCapacity * sizeof(GlyphVertex)), nullptr, GL_DYNAMIC_DRAW);
+		}
+		GLExt::BufferSubData(GL_ARRAY_BUFFER, 0, (ptrdiff_t)(vertices.size() * sizeof(GlyphVertex)), vertices.data());
+		GLExt::BindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+};
+
+void* TextRenderer::font = GLUT_BITMAP_HELVETICA_18;
+GLuint TextRenderer::atlas = 0;
+int TextRenderer::atlasHeight = 1;
+int TextRenderer::lineHeight = 0;
+int TextRenderer::descent = 0;
+TextRenderer::Glyph TextRenderer::glyphs[TextRenderer::LastGlyph - TextRenderer::FirstGlyph + 1];
+vector<TextRenderer::Entry> TextRenderer::pending;
+vector<TextRenderer::Entry> TextRenderer::built;
+vector<TextRenderer::GlyphVertex> TextRenderer::vertices;
+GLuint TextRenderer::buffer = 0;
+size_t TextRenderer::bufferCapacity = 0;
+TextStats TextRenderer::frame;
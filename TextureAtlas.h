@@ -0,0 +1,334 @@
+﻿#pragma once
+#include "includy.h"
+#include "TextureHandler.h"
+#include <map>
+#include <algorithm>
+#include <climits>
+
+/**
+* @struct AtlasRegion
+* @brief Położenie tekstury w atlasie - strona oraz przekształcenie UV (uv' = uvOffset + uv * uvScale)
+*/
+struct AtlasRegion
+{
+	GLuint texture = 0; // tekstura strony
+	int page = -1;
+	int x = 0, y = 0, width = 0, height = 0; // w pikselach strony, bez marginesu
+	glm::vec2 uvOffset = glm::vec2(0.0f);
+	glm::vec2 uvScale = glm::vec2(1.0f);
+
+	bool valid() const
+	{
+		return page >= 0;
+	}
+
+	glm::vec2 remap(const glm::vec2& uv) const
+	{
+		return uvOffset + uv * uvScale;
+	}
+};
+
+/**
+* @struct AtlasOptions
+* @brief Ustawienia budowania atlasu
+*/
+struct AtlasOptions
+{
+	int pageSize = 2048;
+	int padding = 4;    // powielone krawędzie wokół każdej tekstury - brak przeciekania przy filtrowaniu i mipmapach
+	MipOptions mip;
+};
+
+/**
+* @class SkylinePacker
+* @brief Pakowanie prostokątów metodą linii horyzontu (bottom-left, najmniejsza strata miejsca)
+*/
+class SkylinePacker
+{
+public:
+	SkylinePacker(int width, int height) : width(width), height(height)
+	{
+		skyline.push_back({ 0, 0, width });
+	}
+
+	bool insert(int w, int h, int& outX, int& outY)
+	{
+		int bestIndex = -1, bestY = INT_MAX, bestWaste = INT_MAX, bestWidth = INT_MAX;
+		for (size_t i = 0; i < skyline.size(); i++)
+		{
+			int y, waste;
+			if (!fits(i, w, h, y, waste))
+			{
+				continue;
+			}
+			if (y + h < bestY || (y + h == bestY && (waste < bestWaste || (waste == bestWaste && skyline[i].width < bestWidth))))
+			{
+				bestIndex = (int)i;
+				bestY = y + h;
+				bestWaste = waste;
+				bestWidth = skyline[i].width;
+				outX = skyline[i].x;
+				outY = y;
+			}
+		}
+
+		if (bestIndex < 0)
+		{
+			return false;
+		}
+
+		addSegment(bestIndex, outX, outY, w, h);
+		used += (size_t)w * h;
+		return true;
+	}
+
+	float occupancy() const
+	{
+		return (float)used / ((float)width * height);
+	}
+
+private:
+	struct Segment
+	{
+		int x, y, width;
+	};
+
+	int width, height;
+	size_t used = 0;
+	vector<Segment> skyline;
+
+	// Czy prostokąt zaczynający się na segmencie i się mieści, y - wysokość oparcia, waste - pole pod prostokątem
+	bool fits(size_t index, int w, int h, int& y, int& waste) const
+	{
+		int x = skyline[index].x;
+		if (x + w > width)
+		{
+			return false;
+		}
+
+		y = skyline[index].y;
+		int remaining = w;
+		for (size_t i = index; remaining > 0; i++)
+		{
+			y = std::max(y, skyline[i].y);
+			if (y + h > height)
+			{
+				return false;
+			}
+			remaining -= skyline[i].width;
+		}
+
+		waste = 0;
+		remaining = w;
+		for (size_t i = index; remaining > 0; i++)
+		{
+			int span = std::min(remaining, skyline[i].width);
+			waste += (y - skyline[i].y) * span;
+			remaining -= span;
+		}
+		return true;
+	}
+
+	void addSegment(int index, int x, int y, int w, int h)
+	{
+		skyline.insert(skyline.begin() + index, { x, y + h, w });
+
+		// przycięcie segmentów przykrytych nowym
+		for (size_t i = index + 1; i < skyline.size(); i++)
+		{
+			Segment& previous = skyline[i - 1];
+			int shrink = previous.x + previous.width - skyline[i].x;
+			if (shrink <= 0)
+			{
+				break;
+			}
+			skyline[i].x += shrink;
+			skyline[i].width -= shrink;
+			if (skyline[i].width > 0)
+			{
+				break;
+			}
+			skyline.erase(skyline.begin() + i);
+			i--;
+		}
+
+		// scalenie sąsiadów na tej samej wysokości
+		for (size_t i = 0; i + 1 < skyline.size(); i++)
+		{
+			if (skyline[i].y == skyline[i + 1].y)
+			{
+				skyline[i].width += skyline[i + 1].width;
+				skyline.erase(skyline.begin() + i + 1);
+				i--;
+			}
+		}
+	}
+};
+
+/**
+* @class TextureAtlas
+* @brief Atlas tekstur - wiele małych tekstur na kilku dużych stronach, żeby obiekty
+* z różnymi teksturami nie wymagały osobnego glBindTexture. Tablica regionów przelicza UV obiektu na UV strony
+*/
+class TextureAtlas
+{
+public:
+	void add(const string& name, ImageLevel image)
+	{
+		pending.push_back({ name, std::move(image) });
+	}
+
+	bool addFile(const string& path)
+	{
+		vector<ImageLevel> levels;
+		string error;
+		if (!TextureContainer::decodeImage(path, levels, MipOptions(), false, error))
+		{
+			cout << "Nie udalo sie wczytac " << path << ": " << error << "\n";
+			return false;
+		}
+		add(path, std::move(levels[0]));
+		return true;
+	}
+
+	// Pakowanie dodanych obrazów, zbudowanie stron z mipmapami i przekazanie ich do TextureHandler
+	// (wywoływane na wątku renderowania)
+	void build(const AtlasOptions& options = AtlasOptions())
+	{
+		// najpierw najwyższe - mniej dziur w linii horyzontu
+		sort(pending.begin(), pending.end(), [](const Pending& a, const Pending& b)
+		{
+			if (a.image.height != b.image.height) return a.image.height > b.image.height;
+			return a.image.width > b.image.width;
+		});
+
+		vector<ImageLevel> pages;
+		vector<SkylinePacker> packers;
+		for (Pending& item : pending)
+		{
+			int w = item.image.width + options.padding * 2, h = item.image.height + options.padding * 2;
+			int x = 0, y = 0;
+			size_t page = 0;
+			for (; page < packers.size(); page++)
+			{
+				if (packers[page].insert(w, h, x, y))
+				{
+					break;
+				}
+			}
+
+			if (page == packers.size())
+			{
+				// nowa strona; obraz większy od strony dostaje stronę na wymiar
+				int pw = std::max(options.pageSize, w), ph = std::max(options.pageSize, h);
+				packers.push_back(SkylinePacker(pw, ph));
+				ImageLevel blank;
+				blank.width = pw;
+				blank.height = ph;
+				blank.pixels.assign((size_t)pw * ph * 4, 0);
+				pages.push_back(std::move(blank));
+				packers.back().insert(w, h, x, y);
+			}
+
+			blit(item.image, pages[page], x, y, options.padding);
+
+			AtlasRegion region;
+			region.page = (int)page;
+			region.x = x + options.padding;
+			region.y = y + options.padding;
+			region.width = item.image.width;
+			region.height = item.image.height;
+			region.uvOffset = glm::vec2((float)region.x / pages[page].width, (float)region.y / pages[page].height);
+			region.uvScale = glm::vec2((float)region.width / pages[page].width, (float)region.height / pages[page].height);
+			regions[item.name] = region;
+		}
+
+		TextureSampler sampler;
+		sampler.wrap = GL_CLAMP_TO_EDGE;
+		sampler.mip = options.mip;
+
+		size_t firstPage = pageTextures.size();
+		for (size_t i = 0; i < pages.size(); i++)
+		{
+			cout << "Atlas: strona " << firstPage + i << " " << pages[i].width << "x" << pages[i].height
+				<< ", zajetosc " << (int)(packers[i].occupancy() * 100.0f) << "%\n";
+
+			vector<ImageLevel> levels;
+			levels.push_back(std::move(pages[i]));
+			Mipmap::buildChain(levels, options.mip);
+			pageTextures.push_back(TextureHandler::create(std::move(levels), sampler));
+		}
+
+		for (auto& entry : regions)
+		{
+			if (entry.second.texture == 0)
+			{
+				entry.second.page += (int)firstPage;
+				entry.second.texture = pageTextures[entry.second.page];
+			}
+		}
+		pending.clear();
+	}
+
+	// Region po nazwie (ścieżce pliku), nieznana nazwa daje region niepoprawny
+	const AtlasRegion& region(const string& name) const
+	{
+		static const AtlasRegion missing;
+		auto it = regions.find(name);
+		return it == regions.end() ? missing : it->second;
+	}
+
+	const map<string, AtlasRegion>& regionTable() const
+	{
+		return regions;
+	}
+
+	size_t pageCount() const
+	{
+		return pageTextures.size();
+	}
+
+	GLuint pageTexture(size_t page) const
+	{
+		return pageTextures[page];
+	}
+
+	void release()
+	{
+		for (GLuint texture : pageTextures)
+		{
+			TextureHandler::release(texture);
+		}
+		pageTextures.clear();
+		regions.clear();
+	}
+
+private:
+	struct Pending
+	{
+		string name;
+		ImageLevel image;
+	};
+
+	vector<Pending> pending;
+	map<string, AtlasRegion> regions;
+	vector<GLuint> pageTextures;
+
+	// Skopiowanie obrazu do strony wraz z marginesem z powielonych krawędzi
+	static void blit(const ImageLevel& image, ImageLevel& page, int x, int y, int padding)
+	{
+		for (int row = -padding; row < image.height + padding; row++)
+		{
+			int sy = std::min(std::max(row, 0), image.height - 1);
+			uint8_t* out = &page.pixels[((size_t)(y + padding + row) * page.width + x) * 4];
+			const uint8_t* in = &image.pixels[(size_t)sy * image.width * 4];
+
+			for (int column = 0; column < padding; column++)
+			{
+				memcpy(out + column * 4, in, 4);
+				memcpy(out + (padding + image.width + column) * 4, in + (image.width - 1) * 4, 4);
+			}
+			memcpy(out + padding * 4, in, (size_t)image.width * 4);
+		}
+	}
+};
@@ -0,0 +1,247 @@
+﻿#pragma once
+#include "includy.h"
+#include "TextureHandler.h"
+#include <map>
+#include <list>
+
+class TextureCache;
+
+/**
+* @struct TextureKey
+* @brief Klucz pamięci podręcznej - ścieżka pliku i parametry próbkowania
+* (w GL 1.x parametry próbkowania należą do obiektu tekstury, więc różne parametry to różne tekstury)
+*/
+struct TextureKey
+{
+	string path;
+	TextureSampler sampler;
+
+	bool operator<(const TextureKey& other) const
+	{
+		if (path != other.path) return path < other.path;
+		return sampler < other.sampler;
+	}
+};
+
+/**
+* @struct TextureCacheStats
+* @brief Statystyki pamięci podręcznej tekstur
+*/
+struct TextureCacheStats
+{
+	size_t hits = 0;
+	size_t misses = 0;
+	size_t evictions = 0;
+	size_t textures = 0;     // tekstury w pamięci podręcznej
+	size_t referenced = 0;   // tekstury z co najmniej jednym uchwytem
+	size_t gpuBytes = 0;     // dane wysłane do GL
+	size_t cpuBytes = 0;     // zdekodowane dane czekające na wysłanie
+};
+
+/**
+* @class TextureRef
+* @brief Uchwyt do tekstury z pamięci podręcznej, zlicza referencje.
+* Tekstura bez uchwytów trafia na listę LRU i może zostać usunięta po przekroczeniu budżetu
+*/
+class TextureRef
+{
+public:
+	TextureRef() : entry(nullptr) {}
+
+	TextureRef(const TextureRef& other) : entry(other.entry)
+	{
+		acquire();
+	}
+
+	TextureRef(TextureRef&& other) : entry(other.entry)
+	{
+		other.entry = nullptr;
+	}
+
+	TextureRef& operator=(TextureRef other)
+	{
+		std::swap(entry, other.entry);
+		return *this;
+	}
+
+	~TextureRef()
+	{
+		release();
+	}
+
+	GLuint id() const;
+	bool ready() const
+	{
+		return entry && TextureHandler::isReady(id());
+	}
+
+	explicit operator bool() const
+	{
+		return entry != nullptr;
+	}
+
+	bool operator==(const TextureRef& other) const
+	{
+		return entry == other.entry;
+	}
+
+	bool operator!=(const TextureRef& other) const
+	{
+		return entry != other.entry;
+	}
+
+private:
+	friend class TextureCache;
+	struct Entry;
+
+	explicit TextureRef(Entry* entry) : entry(entry)
+	{
+		acquire();
+	}
+
+	void acquire();
+	void release();
+
+	Entry* entry;
+};
+
+struct TextureRef::Entry
+{
+	const TextureKey* key = nullptr;
+	GLuint texture = 0;
+	unsigned int refs = 0;
+	list<TextureRef::Entry*>::iterator unused; // pozycja na liście LRU (end() gdy używana)
+};
+
+/**
+* @class TextureCache
+* @brief Pamięć podręczna tekstur - ten sam plik z tymi samymi parametrami jest dekodowany i wysyłany tylko raz.
+* Nieużywane tekstury usuwane są od najdawniej zwolnionej, gdy łączny rozmiar przekracza memoryBudget
+*/
+class TextureCache
+{
+public:
+	static size_t memoryBudget; // bajty GPU + CPU, tekstury z uchwytami nie są usuwane
+
+	// Wywoływane na wątku renderowania (load() potrzebuje kontekstu GL)
+	static TextureRef get(const string& path, const TextureSampler& sampler = TextureSampler())
+	{
+		TextureKey key{ path, sampler };
+		auto it = entries.find(key);
+		if (it != entries.end())
+		{
+			counters.hits++;
+			return TextureRef(&it->second);
+		}
+
+		counters.misses++;
+		it = entries.emplace(key, TextureRef::Entry()).first;
+		it->second.key = &it->first;
+		it->second.texture = TextureHandler::load(path, sampler, true);
+		it->second.unused = lru.end();
+
+		TextureRef ref(&it->second);
+		trim();
+		return ref;
+	}
+
+	// Usunięcie nieużywanych tekstur ponad budżet (najdawniej zwolnione pierwsze). Rozmiar wszystkich tekstur
+	// z pamięci podręcznej sumuje na bieżąco TextureHandler - sprawdzenie budżetu nie przegląda tekstur.
+	// Poza get() i zwolnieniami wywoływane co klatkę po TextureHandler::update (rozmiar rośnie po dekodowaniu)
+	static void trim()
+	{
+		while (TextureHandler::countedBytes() > memoryBudget && !lru.empty())
+		{
+			evict(lru.back());
+		}
+	}
+
+	// Usunięcie wszystkich nieużywanych tekstur
+	static void purge()
+	{
+		while (!lru.empty())
+		{
+			evict(lru.back());
+		}
+	}
+
+	static TextureCacheStats stats()
+	{
+		TextureCacheStats result = counters;
+		result.textures = entries.size();
+		for (const auto& entry : entries)
+		{
+			if (entry.second.refs > 0) result.referenced++;
+			result.gpuBytes += TextureHandler::gpuBytes(entry.second.texture);
+			result.cpuBytes += TextureHandler::cpuBytes(entry.second.texture);
+		}
+		return result;
+	}
+
+	static void resetStats()
+	{
+		counters = TextureCacheStats();
+	}
+
+private:
+	friend class TextureRef;
+
+	static map<TextureKey, TextureRef::Entry> entries;
+	static list<TextureRef::Entry*> lru; // nieużywane tekstury, z przodu ostatnio zwolnione
+	static TextureCacheStats counters;
+
+	static void evict(TextureRef::Entry* entry);
+	static void unused(TextureRef::Entry* entry);
+	static void used(TextureRef::Entry* entry);
+};
+
+inline GLuint TextureRef::id() const
+{
+	return entry ? entry->texture : 0;
+}
+
+inline void TextureRef::acquire()
+{
+	if (entry && entry->refs++ == 0)
+	{
+		TextureCache::used(entry);
+	}
+}
+
+inline void TextureRef::release()
+{
+	if (entry && --entry->refs == 0)
+	{
+		TextureCache::unused(entry);
+	}
+	entry = nullptr;
+}
+
+inline void TextureCache::evict(TextureRef::Entry* entry)
+{
+	lru.erase(entry->unused);
+	TextureHandler::release(entry->texture);
+	counters.evictions++;
+	entries.erase(entries.find(*entry->key));
+}
+
+inline void TextureCache::unused(TextureRef::Entry* entry)
+{
+	lru.push_front(entry);
+	entry->unused = lru.begin();
+	trim();
+}
+
+inline void TextureCache::used(TextureRef::Entry* entry)
+{
+	if (entry->unused != lru.end())
+	{
+		lru.erase(entry->unused);
+		entry->unused = lru.end();
+	}
+}
+
+size_t TextureCache::memoryBudget = 256 * 1024 * 1024;
+map<TextureKey, TextureRef::Entry> TextureCache::entries;
+list<TextureRef::Entry*> TextureCache::lru;
+TextureCacheStats TextureCache::counters;
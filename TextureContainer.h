@@ -0,0 +1,482 @@
+﻿#pragma once
+#include "includy.h"
+#include "Mipmap.h"
+#include "MappedFile.h"
+#include "AssetArchive.h"
+#include <climits>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+
+enum class TextureFormat : uint32_t
+{
+	RGBA8 = 0,
+	BC1 = 1 // DXT1 bez alfy, 8 bajtów na blok 4x4
+};
+
+/**
+* @struct TextureFileHeader
+* @brief Nagłówek pliku .jtx, za nim tablica poziomów i dane poziomów wyrównane do 16 bajtów
+*/
+struct TextureFileHeader
+{
+	char magic[4];      // "JTX1"
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	uint32_t format;    // TextureFormat
+	uint32_t flags;     // TextureFileHeader::Srgb | Premultiplied
+	uint32_t reserved;
+
+	enum Flags : uint32_t
+	{
+		Srgb = 1,
+		Premultiplied = 2
+	};
+};
+
+struct TextureFileLevel
+{
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;    // od początku pliku
+	uint64_t size;
+};
+
+static_assert(sizeof(TextureFileHeader) == 32, "TextureFileHeader layout");
+static_assert(sizeof(TextureFileLevel) == 24, "TextureFileLevel layout");
+
+/**
+* @struct TextureCookOptions
+* @brief Ustawienia przygotowania tekstury do pliku .jtx
+*/
+struct TextureCookOptions
+{
+	MipOptions mip;
+	bool blockCompress = false; // BC1, tylko dla obrazów bez przezroczystości
+};
+
+/**
+* @class TextureContainer
+* @brief Własny format tekstur (.jtx) - gotowy łańcuch mipmap, opcjonalnie skompresowany BC1.
+* cook() przygotowuje plik offline, open() mapuje go w pamięci (albo bierze z zamontowanego archiwum), a poziomy
+* wysyłane są do GL prosto z mapowania
+*/
+class TextureContainer
+{
+public:
+	static const char* extension()
+	{
+		return ".jtx";
+	}
+
+	static bool isContainer(const string& path)
+	{
+		size_t length = strlen(extension());
+		return path.size() >= length && path.compare(path.size() - length, length, extension()) == 0;
+	}
+
+	// Wczytanie obrazu (stb_image) z zamontowanego archiwum albo z dysku, konwersja do RGBA8 i łańcuch mipmap.
+	// Przyczyna błędu trafia do error (także gdy stb_image nie było wywołane)
+	static bool decodeImage(const string& path, vector<ImageLevel>& levels, const MipOptions& options, bool mipmaps, string& error)
+	{
+		int width, height, channels;
+		stbi_uc* pixels = nullptr;
+		if (const AssetArchive* archive = AssetArchive::locate(path))
+		{
+			const uint8_t* data;
+			size_t size;
+			vector<uint8_t> storage;
+			if (!archive->access(path, data, size, storage))
+			{
+				error = "nie mozna odczytac pliku z archiwum";
+				return false;
+			}
+			pixels = stbi_load_from_memory(data, (int)size, &width, &height, &channels, 0);
+		}
+		else
+		{
+			pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+		}
+		if (!pixels)
+		{
+			const char* reason = stbi_failure_reason();
+			error = reason ? reason : "nie udalo sie zdekodowac obrazu";
+			return false;
+		}
+
+		ImageLevel base;
+		base.width = width;
+		base.height = height;
+		base.pixels.resize((size_t)width * height * 4);
+		Mipmap::toRgba(pixels, channels, base.pixels.data(), (size_t)width * height);
+		stbi_image_free(pixels);
+
+		levels.clear();
+		levels.push_back(std::move(base));
+		if (mipmaps)
+		{
+			Mipmap::buildChain(levels, options);
+		}
+		return true;
+	}
+
+	// Przygotowanie pliku .jtx z obrazu źródłowego
+	static bool cook(const string& source, const string& target, const TextureCookOptions& options = TextureCookOptions())
+	{
+		vector<ImageLevel> levels;
+		string error;
+		if (!decodeImage(source, levels, options.mip, true, error))
+		{
+			cout << "Nie udalo sie wczytac " << source << ": " << error << "\n";
+			return false;
+		}
+
+		TextureFormat format = TextureFormat::RGBA8;
+		if (options.blockCompress)
+		{
+			if (isOpaque(levels[0]))
+			{
+				format = TextureFormat::BC1;
+			}
+			else
+			{
+				cout << source << ": obraz ma przezroczystosc, zapis bez kompresji BC1\n";
+			}
+		}
+
+		vector<vector<uint8_t>> compressed(levels.size());
+		if (format == TextureFormat::BC1)
+		{
+			for (size_t i = 0; i < levels.size(); i++)
+			{
+				encodeBC1(levels[i], compressed[i]);
+			}
+		}
+
+		TextureFileHeader header;
+		memcpy(header.magic, "JTX1", 4);
+		header.version = 1;
+		header.width = levels[0].width;
+		header.height = levels[0].height;
+		header.levelCount = (uint32_t)levels.size();
+		header.format = (uint32_t)format;
+		header.flags = (options.mip.srgb ? (uint32_t)TextureFileHeader::Srgb : 0) | (options.mip.premultiplyAlpha ? (uint32_t)TextureFileHeader::Premultiplied : 0);
+		header.reserved = 0;
+
+		vector<TextureFileLevel> table(levels.size());
+		uint64_t offset = align(sizeof(TextureFileHeader) + table.size() * sizeof(TextureFileLevel));
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			table[i].width = levels[i].width;
+			table[i].height = levels[i].height;
+			table[i].offset = offset;
+			table[i].size = format == TextureFormat::BC1 ? compressed[i].size() : levels[i].pixels.size();
+			offset = align(offset + table[i].size);
+		}
+
+		ofstream file(target, ios::binary);
+		if (!file)
+		{
+			cout << "Nie udalo sie zapisac " << target << "\n";
+			return false;
+		}
+
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)table.data(), table.size() * sizeof(TextureFileLevel));
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			pad(file, table[i].offset);
+			const vector<uint8_t>& data = format == TextureFormat::BC1 ? compressed[i] : levels[i].pixels;
+			file.write((const char*)data.data(), data.size());
+		}
+		pad(file, offset);
+
+		if (!file)
+		{
+			cout << "Blad zapisu " << target << "\n";
+			return false;
+		}
+
+		cout << "Tekstura " << source << " -> " << target << ": " << header.width << "x" << header.height << ", "
+			<< levels.size() << " poziomow, " << (format == TextureFormat::BC1 ? "BC1" : "RGBA8") << ", " << offset << " B\n";
+		return true;
+	}
+
+	// Plik z zamontowanego archiwum (wprost z mapowania archiwum albo rozpakowany) lub zmapowany z dysku,
+	// sprawdzenie nagłówka oraz zakresów poziomów
+	bool open(const string& path)
+	{
+		close();
+		if (const AssetArchive* archive = AssetArchive::locate(path))
+		{
+			if (!archive->access(path, bytes, length, storage))
+			{
+				return false;
+			}
+		}
+		else if (file.open(path))
+		{
+			bytes = file.data();
+			length = file.size();
+		}
+		else
+		{
+			return false;
+		}
+
+		if (length < sizeof(TextureFileHeader))
+		{
+			close();
+			return false;
+		}
+
+		const TextureFileHeader* h = (const TextureFileHeader*)bytes;
+		bool valid = memcmp(h->magic, "JTX1", 4) == 0 && h->version == 1 && h->levelCount > 0 && h->levelCount <= 32
+			&& h->format <= (uint32_t)TextureFormat::BC1
+			&& length >= sizeof(TextureFileHeader) + h->levelCount * sizeof(TextureFileLevel);
+
+		for (uint32_t i = 0; valid && i < h->levelCount; i++)
+		{
+			const TextureFileLevel& level = levelTable()[i];
+			valid = level.width > 0 && level.height > 0 && level.offset <= length && level.size <= length - level.offset
+				&& level.size >= levelBytes(level.width, level.height, (TextureFormat)h->format);
+		}
+
+		if (!valid)
+		{
+			close();
+		}
+		return valid;
+	}
+
+	void close()
+	{
+		file.close();
+		storage.clear();
+		storage.shrink_to_fit();
+		bytes = nullptr;
+		length = 0;
+	}
+
+	const TextureFileHeader& header() const
+	{
+		return *(const TextureFileHeader*)bytes;
+	}
+
+	TextureFormat format() const
+	{
+		return (TextureFormat)header().format;
+	}
+
+	size_t levelCount() const
+	{
+		return header().levelCount;
+	}
+
+	const TextureFileLevel& level(size_t i) const
+	{
+		return levelTable()[i];
+	}
+
+	// Wskaźnik do danych poziomu wewnątrz mapowania
+	const uint8_t* levelData(size_t i) const
+	{
+		return bytes + level(i).offset;
+	}
+
+	// Wczytanie stron poziomu z dysku przed wysłaniem (archiwum czyta się w całości albo przy wysyłaniu)
+	void prefetch(size_t i) const
+	{
+		if (file.isOpen())
+		{
+			file.prefetch((size_t)level(i).offset, levelBytes(level(i).width, level(i).height, format()));
+		}
+	}
+
+	static size_t levelBytes(int width, int height, TextureFormat format)
+	{
+		if (format == TextureFormat::BC1)
+		{
+			return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+		}
+		return (size_t)width * height * 4;
+	}
+
+	// Kompresja BC1: końce odcinka z obwiedni kolorów bloku (zwężonej o 1/16), indeksy do najbliższego koloru
+	static void encodeBC1(const ImageLevel& image, vector<uint8_t>& out)
+	{
+		int blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+		out.resize((size_t)blocksX * blocksY * 8);
+
+		ThreadPool::shared().parallelFor(blocksY, [&](size_t begin, size_t end)
+		{
+			for (int by = (int)begin; by < (int)end; by++)
+			{
+				for (int bx = 0; bx < blocksX; bx++)
+				{
+					uint8_t block[16][3];
+					for (int i = 0; i < 16; i++)
+					{
+						int x = std::min(bx * 4 + i % 4, image.width - 1), y = std::min(by * 4 + i / 4, image.height - 1);
+						memcpy(block[i], &image.pixels[((size_t)y * image.width + x) * 4], 3);
+					}
+					encodeBlock(block, &out[((size_t)by * blocksX + bx) * 8]);
+				}
+			}
+		}, std::max(1, 4096 / blocksX));
+	}
+
+	// Rozpakowanie BC1 do RGBA8 (gdy sterownik nie obsługuje S3TC)
+	static void decodeBC1(const uint8_t* data, int width, int height, ImageLevel& out)
+	{
+		out.width = width;
+		out.height = height;
+		out.pixels.resize((size_t)width * height * 4);
+
+		int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+		for (int by = 0; by < blocksY; by++)
+		{
+			for (int bx = 0; bx < blocksX; bx++)
+			{
+				const uint8_t* block = data + ((size_t)by * blocksX + bx) * 8;
+				uint8_t palette[4][3];
+				blockPalette(block[0] | (block[1] << 8), block[2] | (block[3] << 8), palette);
+
+				uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+				for (int i = 0; i < 16; i++)
+				{
+					int x = bx * 4 + i % 4, y = by * 4 + i / 4;
+					if (x < width && y < height)
+					{
+						uint8_t* pixel = &out.pixels[((size_t)y * width + x) * 4];
+						memcpy(pixel, palette[(indices >> (i * 2)) & 3], 3);
+						pixel[3] = 255;
+					}
+				}
+			}
+		}
+	}
+
+private:
+	MappedFile file;
+	vector<uint8_t> storage;       // rozpakowany plik ze skompresowanego wpisu archiwum
+	const uint8_t* bytes = nullptr; // zawartość pliku: mapowanie, mapowanie archiwum albo storage
+	size_t length = 0;
+
+	const TextureFileLevel* levelTable() const
+	{
+		return (const TextureFileLevel*)(bytes + sizeof(TextureFileHeader));
+	}
+
+	static uint64_t align(uint64_t offset)
+	{
+		return (offset + 15) & ~(uint64_t)15;
+	}
+
+	static void pad(ofstream& file, uint64_t offset)
+	{
+		static const char zeros[16] = {};
+		uint64_t position = (uint64_t)file.tellp();
+		if (offset > position)
+		{
+			file.write(zeros, (streamsize)(offset - position));
+		}
+	}
+
+	static bool isOpaque(const ImageLevel& image)
+	{
+		for (size_t i = 3; i < image.pixels.size(); i += 4)
+		{
+			if (image.pixels[i] != 255)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static uint16_t to565(const int* rgb)
+	{
+		return (uint16_t)(((rgb[0] * 31 + 127) / 255) << 11 | ((rgb[1] * 63 + 127) / 255) << 5 | ((rgb[2] * 31 + 127) / 255));
+	}
+
+	// Paleta 4 kolorów trybu bez przezroczystości (c0 > c1)
+	static void blockPalette(uint16_t c0, uint16_t c1, uint8_t palette[4][3])
+	{
+		uint16_t ends[2] = { c0, c1 };
+		for (int e = 0; e < 2; e++)
+		{
+			int r = (ends[e] >> 11) & 31, g = (ends[e] >> 5) & 63, b = ends[e] & 31;
+			palette[e][0] = (uint8_t)((r << 3) | (r >> 2));
+			palette[e][1] = (uint8_t)((g << 2) | (g >> 4));
+			palette[e][2] = (uint8_t)((b << 3) | (b >> 2));
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			if (c0 > c1)
+			{
+				palette[2][c] = (uint8_t)((2 * palette[0][c] + palette[1][c]) / 3);
+				palette[3][c] = (uint8_t)((palette[0][c] + 2 * palette[1][c]) / 3);
+			}
+			else
+			{
+				palette[2][c] = (uint8_t)((palette[0][c] + palette[1][c]) / 2);
+				palette[3][c] = 0;
+			}
+		}
+	}
+
+	static void encodeBlock(const uint8_t block[16][3], uint8_t* out)
+	{
+		int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				lo[c] = std::min(lo[c], (int)block[i][c]);
+				hi[c] = std::max(hi[c], (int)block[i][c]);
+			}
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			int inset = (hi[c] - lo[c]) / 16;
+			lo[c] += inset;
+			hi[c] -= inset;
+		}
+
+		uint16_t c0 = to565(hi), c1 = to565(lo);
+		uint32_t indices = 0;
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+		}
+
+		if (c0 != c1)
+		{
+			uint8_t palette[4][3];
+			blockPalette(c0, c1, palette);
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0, bestDistance = INT_MAX;
+				for (int p = 0; p < 4; p++)
+				{
+					int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+					int distance = dr * dr + dg * dg + db * db;
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				indices |= (uint32_t)best << (i * 2);
+			}
+		}
+
+		out[0] = (uint8_t)c0; out[1] = (uint8_t)(c0 >> 8);
+		out[2] = (uint8_t)c1; out[3] = (uint8_t)(c1 >> 8);
+		out[4] = (uint8_t)indices; out[5] = (uint8_t)(indices >> 8);
+		out[6] = (uint8_t)(indices >> 16); out[7] = (uint8_t)(indices >> 24);
+	}
+};
@@ -0,0 +1,594 @@
+﻿#pragma once
+#include "includy.h"
+#include "ThreadPool.h"
+#include "Mipmap.h"
+#include "TextureContainer.h"
+#include "GLExt.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#ifndef GL_TEXTURE_BASE_LEVEL
+#define GL_TEXTURE_BASE_LEVEL 0x813C
+#endif
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+/**
+* @struct TextureSampler
+* @brief Parametry próbkowania tekstury i liczenia jej mipmap
+*/
+struct TextureSampler
+{
+	GLint minFilter = GL_LINEAR_MIPMAP_LINEAR;
+	GLint magFilter = GL_LINEAR;
+	GLint wrap = GL_REPEAT;
+	MipOptions mip;
+
+	bool usesMipmaps() const
+	{
+		return minFilter != GL_LINEAR && minFilter != GL_NEAREST;
+	}
+
+	bool operator<(const TextureSampler& other) const
+	{
+		if (minFilter != other.minFilter) return minFilter < other.minFilter;
+		if (magFilter != other.magFilter) return magFilter < other.magFilter;
+		if (wrap != other.wrap) return wrap < other.wrap;
+		return mip < other.mip;
+	}
+};
+
+/**
+* @class TextureHandler
+* @brief Asynchroniczne wczytywanie tekstur
+* load() od razu zwraca nazwę tekstury GL z tymczasową szachownicą. Dekodowanie (stb_image)
+* i liczenie mipmap odbywa się na wątkach roboczych, a wysyłanie do GL w update() - na wątku
+* renderowania, z limitem bajtów na klatkę. Poziomy wysyłane są od najmniejszego, a
+* GL_TEXTURE_BASE_LEVEL przesuwany po każdym ukończonym poziomie, więc tekstura wyostrza się
+* stopniowo i nigdy nie jest niekompletna. Nazwa tekstury się nie zmienia (można ją trzymać w CUBE::textureID).
+* Pliki .jtx (TextureContainer) nie są dekodowane - poziomy wysyłane są prosto z pliku zmapowanego w pamięci
+*/
+class TextureHandler
+{
+public:
+	static size_t uploadBudget; // bajty wysyłane do GL w jednej klatce
+
+	// Rozpoczęcie wczytywania - wywoływane na wątku renderowania (potrzebny kontekst GL).
+	// Rozmiar tekstur wczytanych z counted jest na bieżąco sumowany w countedBytes()
+	static GLuint load(const string& path, const TextureSampler& sampler = TextureSampler(), bool counted = false)
+	{
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		uploadPlaceholder(texture, false);
+
+		auto state = make_shared<Texture>();
+		state->path = path;
+		state->sampler = sampler;
+		state->compressedUpload = GLExt::supportsS3TC();
+		state->counted = counted;
+		textures[texture] = state;
+
+		startDecode(texture, state);
+		return texture;
+	}
+
+	// Tekstura z obrazów przygotowanych w pamięci (np. strony atlasu), wysyłana tak jak wczytane z pliku
+	static GLuint create(vector<ImageLevel> images, const TextureSampler& sampler = TextureSampler())
+	{
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		uploadPlaceholder(texture, false);
+
+		auto state = make_shared<Texture>();
+		state->sampler = sampler;
+		state->images = std::move(images);
+		for (const ImageLevel& image : state->images)
+		{
+			state->levels.push_back({ image.width, image.height, TextureFormat::RGBA8, image.pixels.data(), image.pixels.size() });
+		}
+		account(*state, 0, levelBytes(state->levels));
+		state->nextLevel = (int)state->levels.size() - 1;
+		textures[texture] = state;
+		uploads.push_back(texture);
+		return texture;
+	}
+
+	// Ponowne wczytanie pliku pod tym samym uchwytem (np. po zmianie pliku). Gotowa tekstura jest
+	// wysyłana do osobnego obiektu GL i podmieniana w całości między klatkami, do tego czasu widać starą
+	static void reload(GLuint texture)
+	{
+		auto it = textures.find(texture);
+		if (it == textures.end() || it->second->path.empty())
+		{
+			return;
+		}
+
+		auto state = make_shared<Texture>();
+		state->path = it->second->path;
+		state->sampler = it->second->sampler;
+		state->compressedUpload = it->second->compressedUpload;
+		state->counted = it->second->counted;
+		state->ready = it->second->ready;
+		state->staging = it->second->staging; // przerwane wcześniejsze przeładowanie
+		it->second->cancelled.store(true, memory_order_relaxed);
+		size_t gpu = it->second->gpuBytes; // do podmiany w GL zostaje stara zawartość
+		account(*it->second, 0, 0);
+		account(*state, gpu, 0);
+		it->second = state;
+		startDecode(texture, state);
+	}
+
+	// Przeładowanie wszystkich tekstur wczytanych z pliku, zwraca ich liczbę
+	static size_t reload(const string& path)
+	{
+		vector<GLuint> matching;
+		for (const auto& entry : textures)
+		{
+			if (entry.second->path == path)
+			{
+				matching.push_back(entry.first);
+			}
+		}
+		for (GLuint texture : matching)
+		{
+			reload(texture);
+		}
+		return matching.size();
+	}
+
+	// Pliki wczytanych tekstur (do obserwowania zmian)
+	static void paths(vector<string>& result)
+	{
+		for (const auto& entry : textures)
+		{
+			if (!entry.second->path.empty())
+			{
+				result.push_back(entry.second->path);
+			}
+		}
+	}
+
+	// Dowiązanie tekstury z pominięciem zbędnych glBindTexture (obiekty z jednej strony atlasu)
+	static void bind(GLuint texture)
+	{
+		GLuint name = resolve(texture);
+		if (name != boundTexture)
+		{
+			glBindTexture(GL_TEXTURE_2D, name);
+			boundTexture = name;
+		}
+	}
+
+	// Dowiązanie zmienione poza TextureHandler (np. glPopAttrib) - następne bind() zawsze wywoła glBindTexture
+	static void invalidate()
+	{
+		boundTexture = UnknownBinding;
+	}
+
+	// Obiekt GL aktualnie stojący za uchwytem (inny niż uchwyt po przeładowaniu)
+	static GLuint resolve(GLuint texture)
+	{
+		if (aliases.empty())
+		{
+			return texture;
+		}
+		auto it = aliases.find(texture);
+		return it == aliases.end() ? texture : it->second;
+	}
+
+	// Wywoływane raz na klatkę na wątku renderowania
+	static void update()
+	{
+		PROFILE_ZONE("TextureHandler::update");
+		collectDecoded();
+
+		size_t budget = uploadBudget;
+		while (!uploads.empty() && budget > 0)
+		{
+			GLuint texture = uploads.front();
+			auto it = textures.find(texture);
+			if (it == textures.end() || it->second->levels.empty())
+			{
+				uploads.pop_front();
+				continue;
+			}
+
+			Texture& state = *it->second;
+			if (uploadStep(state.staging ? state.staging : resolve(texture), state, budget))
+			{
+				uploads.pop_front();
+				if (state.staging)
+				{
+					swapStaging(texture, state);
+				}
+			}
+		}
+	}
+
+	static bool isReady(GLuint texture)
+	{
+		auto it = textures.find(texture);
+		return it != textures.end() && it->second->ready;
+	}
+
+	static bool isLoading(GLuint texture)
+	{
+		auto it = textures.find(texture);
+		return it != textures.end() && !it->second->ready && !it->second->failed;
+	}
+
+	// Rozmiar danych tekstury w GL (wszystkie poziomy)
+	static size_t gpuBytes(GLuint texture)
+	{
+		auto it = textures.find(texture);
+		return it == textures.end() ? 0 : it->second->gpuBytes;
+	}
+
+	// Zdekodowane dane czekające na wysłanie do GL
+	static size_t cpuBytes(GLuint texture)
+	{
+		auto it = textures.find(texture);
+		return it == textures.end() ? 0 : it->second->cpuBytes;
+	}
+
+	// Dane GPU + CPU tekstur wczytanych z counted (bez przeglądania tekstur)
+	static size_t countedBytes()
+	{
+		return countedTotal;
+	}
+
+	static const string& path(GLuint texture)
+	{
+		static const string empty;
+		auto it = textures.find(texture);
+		return it == textures.end() ? empty : it->second->path;
+	}
+
+	// Usunięcie tekstury (także w trakcie wczytywania - wynik dekodowania zostanie pominięty)
+	static void release(GLuint texture)
+	{
+		auto it = textures.find(texture);
+		if (it == textures.end())
+		{
+			return;
+		}
+		it->second->cancelled.store(true, memory_order_relaxed);
+		account(*it->second, 0, 0);
+		deleteObject(it->second->staging);
+		auto alias = aliases.find(texture);
+		if (alias != aliases.end())
+		{
+			deleteObject(alias->second);
+			aliases.erase(alias);
+		}
+		textures.erase(it);
+		deleteObject(texture);
+	}
+
+	static size_t pendingCount()
+	{
+		size_t count = 0;
+		for (const auto& entry : textures)
+		{
+			if (!entry.second->ready && !entry.second->failed) count++;
+		}
+		return count;
+	}
+
+private:
+	// Poziom czekający na wysłanie - wskazuje do zdekodowanego obrazu albo do zmapowanego pliku .jtx
+	struct UploadLevel
+	{
+		int width;
+		int height;
+		TextureFormat format;
+		const uint8_t* data;
+		size_t bytes;
+	};
+
+	struct Texture
+	{
+		string path;
+		TextureSampler sampler;
+		bool compressedUpload = false; // sterownik przyjmuje BC1
+		vector<UploadLevel> levels;    // zwalniane po wysłaniu razem z właścicielami danych
+		vector<ImageLevel> images;
+		shared_ptr<TextureContainer> container;
+		int nextLevel = -1;        // poziom w trakcie wysyłania
+		int nextRow = 0;           // wiersz w trakcie wysyłania
+		size_t gpuBytes = 0;
+		size_t cpuBytes = 0;       // suma levels - tylko przez account()
+		bool counted = false;      // wliczana do countedTotal
+		bool ready = false;
+		bool failed = false;
+		atomic<bool> cancelled{ false }; // usunięta albo przeładowana - wątek roboczy pomija dekodowanie
+		GLuint staging = 0;        // obiekt GL, do którego wysyłana jest przeładowana zawartość
+	};
+
+	struct Decoded
+	{
+		GLuint texture;
+		shared_ptr<Texture> state;
+		vector<UploadLevel> levels;
+		vector<ImageLevel> images;
+		shared_ptr<TextureContainer> container;
+		string error;
+	};
+
+	static map<GLuint, shared_ptr<Texture>> textures;
+	static deque<GLuint> uploads;
+	static vector<Decoded> decoded; // wyniki z wątków roboczych
+	static mutex decodedMutex;
+	static size_t countedTotal;
+	static const GLuint UnknownBinding = ~0u;
+	static GLuint boundTexture;
+	static map<GLuint, GLuint> aliases; // uchwyt -> obiekt GL po przeładowaniu
+
+	static void startDecode(GLuint texture, const shared_ptr<Texture>& state)
+	{
+		string path = state->path;
+		MipOptions options = state->sampler.mip;
+		bool compressedUpload = state->compressedUpload;
+		ThreadPool::shared().submit([texture, state, path, options, compressedUpload]()
+		{
+			PROFILE_ZONE("TextureHandler::decode");
+			if (state->cancelled.load(memory_order_relaxed))
+			{
+				return; // usunięta, zanim zadanie doczekało się wątku
+			}
+			Decoded result;
+			result.texture = texture;
+			result.state = state;
+
+			if (TextureContainer::isContainer(path))
+			{
+				auto container = make_shared<TextureContainer>();
+				if (!container->open(path))
+				{
+					result.error = "niepoprawny plik tekstury";
+				}
+				else if (container->format() == TextureFormat::BC1 && !compressedUpload)
+				{
+					// brak S3TC w sterowniku - rozpakowanie na CPU
+					result.images.resize(container->levelCount());
+					for (size_t i = 0; i < container->levelCount(); i++)
+					{
+						const TextureFileLevel& level = container->level(i);
+						TextureContainer::decodeBC1(container->levelData(i), level.width, level.height, result.images[i]);
+					}
+				}
+				else
+				{
+					for (size_t i = 0; i < container->levelCount(); i++)
+					{
+						const TextureFileLevel& level = container->level(i);
+						size_t bytes = TextureContainer::levelBytes(level.width, level.height, container->format());
+						container->prefetch(i);
+						result.levels.push_back({ (int)level.width, (int)level.height, container->format(), container->levelData(i), bytes });
+					}
+					result.container = container;
+				}
+			}
+			else
+			{
+				TextureContainer::decodeImage(path, result.images, options, true, result.error);
+			}
+
+			for (const ImageLevel& image : result.images)
+			{
+				result.levels.push_back({ image.width, image.height, TextureFormat::RGBA8, image.pixels.data(), image.pixels.size() });
+			}
+
+			if (state->cancelled.load(memory_order_relaxed))
+			{
+				return; // dane zwalniane od razu, nie dopiero w collectDecoded
+			}
+			lock_guard<mutex> lock(decodedMutex);
+			decoded.push_back(std::move(result));
+		});
+	}
+
+	static void collectDecoded()
+	{
+		vector<Decoded> finished;
+		{
+			lock_guard<mutex> lock(decodedMutex);
+			finished.swap(decoded);
+		}
+
+		for (Decoded& result : finished)
+		{
+			auto it = textures.find(result.texture);
+			if (it == textures.end() || it->second != result.state)
+			{
+				continue; // tekstura usunięta albo wczytywana ponownie
+			}
+
+			Texture& texture = *it->second;
+			if (result.levels.empty())
+			{
+				cout << "Nie udalo sie wczytac tekstury " << texture.path << ": " << result.error << "\n";
+				texture.failed = true;
+				if (!texture.ready)
+				{
+					uploadPlaceholder(result.texture, true);
+				}
+				continue;
+			}
+
+			if (texture.ready && texture.staging == 0)
+			{
+				glGenTextures(1, &texture.staging);
+			}
+			texture.levels = std::move(result.levels);
+			account(texture, texture.gpuBytes, levelBytes(texture.levels));
+			texture.images = std::move(result.images);
+			texture.container = std::move(result.container);
+			texture.nextLevel = (int)texture.levels.size() - 1;
+			texture.nextRow = 0;
+			uploads.push_back(result.texture);
+		}
+	}
+
+	// Wysłanie kolejnej porcji danych, zwraca true po wysłaniu całej tekstury
+	static bool uploadStep(GLuint name, Texture& texture, size_t& budget)
+	{
+		bind(name);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		int lastLevel = (int)texture.levels.size() - 1;
+		while (texture.nextLevel >= 0 && budget > 0)
+		{
+			const UploadLevel& level = texture.levels[texture.nextLevel];
+			size_t rowBytes = (size_t)level.width * 4;
+
+			if (level.format == TextureFormat::BC1)
+			{
+				// skompresowany poziom wysyłany w całości
+				GLExt::CompressedTexImage2D(GL_TEXTURE_2D, texture.nextLevel, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, level.width, level.height, 0,
+					(GLsizei)level.bytes, level.data);
+				budget = level.bytes >= budget ? 0 : budget - level.bytes;
+				texture.nextRow = level.height;
+			}
+			else if (texture.nextRow == 0)
+			{
+				glTexImage2D(GL_TEXTURE_2D, texture.nextLevel, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			}
+
+			if (texture.nextRow < level.height)
+			{
+				// co najmniej jeden wiersz na wywołanie, żeby duże tekstury też się posuwały
+				int rows = (int)std::max<size_t>(1, budget / rowBytes);
+				rows = std::min(rows, level.height - texture.nextRow);
+				glTexSubImage2D(GL_TEXTURE_2D, texture.nextLevel, 0, texture.nextRow, level.width, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+					level.data + (size_t)texture.nextRow * rowBytes);
+
+				size_t sent = rows * rowBytes;
+				budget = sent >= budget ? 0 : budget - sent;
+				texture.nextRow += rows;
+			}
+
+			if (texture.nextRow == level.height)
+			{
+				// poziom kompletny - od teraz to on jest najdokładniejszym używanym poziomem
+				if (texture.nextLevel == lastLevel)
+				{
+					account(texture, 0, texture.cpuBytes);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.sampler.minFilter);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture.sampler.magFilter);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture.sampler.wrap);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture.sampler.wrap);
+				}
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.nextLevel);
+				account(texture, texture.gpuBytes + level.bytes, texture.cpuBytes);
+
+				texture.nextLevel--;
+				texture.nextRow = 0;
+			}
+		}
+
+		if (texture.nextLevel < 0)
+		{
+			texture.ready = true;
+			account(texture, texture.gpuBytes, 0);
+			vector<UploadLevel>().swap(texture.levels);
+			vector<ImageLevel>().swap(texture.images);
+			texture.container.reset();
+			return true;
+		}
+		return false;
+	}
+
+	// Nowe rozmiary tekstury, z poprawką sumy countedTotal
+	static void account(Texture& texture, size_t gpu, size_t cpu)
+	{
+		if (texture.counted)
+		{
+			countedTotal = countedTotal - texture.gpuBytes - texture.cpuBytes + gpu + cpu;
+		}
+		texture.gpuBytes = gpu;
+		texture.cpuBytes = cpu;
+	}
+
+	static size_t levelBytes(const vector<UploadLevel>& levels)
+	{
+		size_t bytes = 0;
+		for (const UploadLevel& level : levels)
+		{
+			bytes += level.bytes;
+		}
+		return bytes;
+	}
+
+	// Podmiana wysłanej w całości przeładowanej zawartości. Nazwa uchwytu nie jest usuwana (glGenTextures
+	// mógłby ją zwrócić dla innej tekstury), tylko zwalniana jest jej pamięć
+	static void swapStaging(GLuint texture, Texture& state)
+	{
+		GLuint previous = resolve(texture);
+		if (previous == texture)
+		{
+			bind(texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		}
+		else
+		{
+			deleteObject(previous);
+		}
+		aliases[texture] = state.staging;
+		state.staging = 0;
+	}
+
+	static void deleteObject(GLuint name)
+	{
+		if (name == 0)
+		{
+			return;
+		}
+		glDeleteTextures(1, &name);
+		if (boundTexture == name)
+		{
+			boundTexture = 0; // usunięcie dowiązanej tekstury przywraca 0
+		}
+	}
+
+	// Szachownica 2x2 - szara w trakcie wczytywania, różowa po błędzie
+	static void uploadPlaceholder(GLuint texture, bool error)
+	{
+		uint8_t light = 200, dark = 120;
+		uint8_t pixels[16] =
+		{
+			light, light, light, 255,  dark, dark, dark, 255,
+			dark, dark, dark, 255,  light, light, light, 255
+		};
+		if (error)
+		{
+			for (int i = 0; i < 16; i += 4) { pixels[i + 1] = 0; pixels[i] = pixels[i + 2] = (i == 0 || i == 12) ? 255 : 0; }
+		}
+
+		bind(texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+};
+
+size_t TextureHandler::uploadBudget = 4 * 1024 * 1024;
+map<GLuint, shared_ptr<TextureHandler::Texture>> TextureHandler::textures;
+deque<GLuint> TextureHandler::uploads;
+vector<TextureHandler::Decoded> TextureHandler::decoded;
+mutex TextureHandler::decodedMutex;
+size_t TextureHandler::countedTotal = 0;
+GLuint TextureHandler::boundTexture = 0;
+map<GLuint, GLuint> TextureHandler::aliases;
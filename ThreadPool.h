@@ -0,0 +1,165 @@
+﻿#pragma once
+#include "includy.h"
+#include "Profiler.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+/**
+* @class ThreadPool
+* @brief Pula wątków roboczych do zadań wykonywanych poza wątkiem renderowania
+* (ładowanie zasobów, upraszczanie siatek, obliczenia równoległe)
+*/
+class ThreadPool
+{
+public:
+	// threads = 0 - liczba rdzeni pomniejszona o wątek renderowania
+	explicit ThreadPool(unsigned int threads = 0)
+	{
+		if (threads == 0)
+		{
+			unsigned int cores = thread::hardware_concurrency();
+			threads = cores > 1 ? cores - 1 : 1;
+		}
+
+		for (unsigned int i = 0; i < threads; i++)
+		{
+			workers.emplace_back([this, i]()
+			{
+				PROFILE_THREAD("Worker " + to_string(i + 1));
+				workerLoop();
+			});
+		}
+	}
+
+	~ThreadPool()
+	{
+		{
+			lock_guard<mutex> lock(queueMutex);
+			stopping = true;
+		}
+		queueCondition.notify_all();
+		for (thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	size_t size() const
+	{
+		return workers.size();
+	}
+
+	// Dodanie zadania do kolejki, wynik dostępny przez future
+	template<class F>
+	auto submit(F&& job) -> future<decltype(job())>
+	{
+		typedef decltype(job()) Result;
+		auto task = make_shared<packaged_task<Result()>>(std::forward<F>(job));
+		future<Result> result = task->get_future();
+		{
+			lock_guard<mutex> lock(queueMutex);
+			jobs.emplace_back([task]() { (*task)(); });
+		}
+		queueCondition.notify_one();
+		return result;
+	}
+
+	// Równoległa pętla po zakresie [0, count) dzielonym na kawałki po grain elementów.
+	// Wątek wywołujący też przetwarza kawałki, więc wywołanie z wnętrza zadania nie blokuje puli
+	void parallelFor(size_t count, const function<void(size_t begin, size_t end)>& body, size_t grain = 1)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		grain = std::max<size_t>(grain, 1);
+		size_t chunks = (count + grain - 1) / grain;
+		if (chunks == 1 || workers.empty())
+		{
+			body(0, count);
+			return;
+		}
+
+		struct Shared
+		{
+			atomic<size_t> next{ 0 };
+			atomic<size_t> done{ 0 };
+			mutex doneMutex;
+			condition_variable doneCondition;
+		};
+		auto shared = make_shared<Shared>();
+
+		auto run = [shared, chunks, count, grain, &body]()
+		{
+			size_t chunk;
+			while ((chunk = shared->next.fetch_add(1)) < chunks)
+			{
+				size_t begin = chunk * grain;
+				body(begin, std::min(begin + grain, count));
+				if (shared->done.fetch_add(1) + 1 == chunks)
+				{
+					lock_guard<mutex> lock(shared->doneMutex);
+					shared->doneCondition.notify_all();
+				}
+			}
+		};
+
+		size_t helpers = std::min(chunks - 1, workers.size());
+		{
+			lock_guard<mutex> lock(queueMutex);
+			for (size_t i = 0; i < helpers; i++)
+			{
+				jobs.emplace_back(run);
+			}
+		}
+		queueCondition.notify_all();
+
+		run();
+
+		unique_lock<mutex> lock(shared->doneMutex);
+		shared->doneCondition.wait(lock, [&]() { return shared->done.load() == chunks; });
+	}
+
+	// Wspólna pula silnika
+	static ThreadPool& shared()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+
+private:
+	vector<thread> workers;
+	deque<function<void()>> jobs;
+	mutex queueMutex;
+	condition_variable queueCondition;
+	bool stopping = false;
+
+	void workerLoop()
+	{
+		for (;;)
+		{
+			function<void()> job;
+			{
+				unique_lock<mutex> lock(queueMutex);
+				queueCondition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+				if (stopping && jobs.empty())
+				{
+					return;
+				}
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+			job();
+		}
+	}
+};
@@ -0,0 +1,260 @@
+﻿#pragma once
+#include "includy.h"
+#include "GLExt.h"
+#include "Profiler.h"
+#include <cstdint>
+#include <chrono>
+
+/**
+* @struct UniformRingStats
+* @brief Liczniki pierścienia z ostatniej klatki
+*/
+struct UniformRingStats
+{
+	size_t bytes = 0;          // zapisane w klatce (z wyrównaniem)
+	size_t allocations = 0;
+	size_t overflows = 0;      // przydziały, które się nie zmieściły
+	float waitMs = 0.0f;       // czekanie na GPU przed ponownym użyciem obszaru
+	bool persistent = false;   // trwałe mapowanie (GL_ARB_buffer_storage)
+};
+
+/**
+* @class UniformRing
+* @brief Pierścień danych uniformów i instancji dla shaderów. Bufor podzielony jest na FramesInFlight obszarów,
+* klatka zapisuje swój obszar kolejno i zamyka go fence'em; przed ponownym użyciem obszaru czekamy,
+* aż GPU skończy poprzednią klatkę. Obiekty adresują swoje dane przesunięciem w buforze (glBindBufferRange),
+* więc dane tysięcy obiektów trafiają do GPU jednym zapisem zamiast wywołania glUniform na obiekt.
+* Z GL_ARB_buffer_storage bufor mapowany jest raz na stałe, bez niego - niesynchronizowanym mapowaniem
+* zakresu do commit()
+*/
+class UniformRing
+{
+public:
+	static const int FramesInFlight = 3;
+	static size_t frameCapacity; // bajty na klatkę, przed pierwszym beginFrame
+
+	struct Allocation
+	{
+		size_t offset = 0;         // przesunięcie w buffer() dla glBindBufferRange
+		size_t size = 0;
+		uint8_t* data = nullptr;   // zapis do commit()
+
+		explicit operator bool() const
+		{
+			return data != nullptr;
+		}
+	};
+
+	static bool supported()
+	{
+		return GLExt::supportsUniformBuffers();
+	}
+
+	static void beginFrame()
+	{
+		PROFILE_ZONE("UniformRing::beginFrame");
+		if (!create())
+		{
+			return;
+		}
+
+		frame = UniformRingStats();
+		frame.persistent = persistent != nullptr;
+		region = (region + 1) % FramesInFlight;
+		if (fences[region])
+		{
+			// obszar używany FramesInFlight klatek temu - zwykle dawno gotowy
+			auto start = chrono::steady_clock::now();
+			while (GLExt::ClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+			{
+			}
+			GLExt::DeleteSync(fences[region]);
+			fences[region] = nullptr;
+			frame.waitMs = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+		}
+		cursor = regionStart();
+		framing = true;
+	}
+
+	// Miejsce na size bajtów wyrównane do GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT (puste, gdy obszar klatki jest pełny)
+	static Allocation allocate(size_t size)
+	{
+		Allocation result;
+		if (!framing)
+		{
+			return result;
+		}
+
+		size_t offset = (cursor + alignment - 1) / alignment * alignment;
+		if (offset + size > regionStart() + capacity)
+		{
+			frame.overflows++;
+			return result;
+		}
+
+		if (persistent)
+		{
+			result.data = persistent + offset;
+		}
+		else
+		{
+			if (!mapped)
+			{
+				// mapowanie reszty obszaru - fence gwarantuje, że GPU go już nie czyta
+				GLExt::BindBuffer(GL_UNIFORM_BUFFER, bufferName);
+				mappedStart = offset;
+				mapped = (uint8_t*)GLExt::MapBufferRange(GL_UNIFORM_BUFFER, (ptrdiff_t)offset, (ptrdiff_t)(regionStart() + capacity - offset),
+					GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+				GLExt::BindBuffer(GL_UNIFORM_BUFFER, 0);
+				if (!mapped)
+				{
+					return result;
+				}
+			}
+			result.data = mapped + (offset - mappedStart);
+		}
+
+		result.offset = offset;
+		result.size = size;
+		cursor = offset + size;
+		frame.bytes = cursor - regionStart();
+		frame.allocations++;
+		return result;
+	}
+
+	// Zapisane dane widoczne dla GPU - przed rysowaniem, które ich używa
+	static void commit()
+	{
+		if (mapped)
+		{
+			GLExt::BindBuffer(GL_UNIFORM_BUFFER, bufferName);
+			GLExt::UnmapBuffer(GL_UNIFORM_BUFFER);
+			GLExt::BindBuffer(GL_UNIFORM_BUFFER, 0);
+			mapped = nullptr;
+		}
+	}
+
+	static void endFrame()
+	{
+		if (!framing)
+		{
+			return;
+		}
+		commit();
+		fences[region] = GLExt::FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		framing = false;
+	}
+
+	static bool active()
+	{
+		return framing;
+	}
+
+	static GLuint buffer()
+	{
+		return bufferName;
+	}
+
+	static UniformRingStats stats()
+	{
+		return frame;
+	}
+
+	static void release()
+	{
+		commit();
+		for (GLsync& fence : fences)
+		{
+			if (fence)
+			{
+				GLExt::DeleteSync(fence);
+				fence = nullptr;
+			}
+		}
+		if (bufferName)
+		{
+			if (persistent)
+			{
+				GLExt::BindBuffer(GL_UNIFORM_BUFFER, bufferName);
+				GLExt::UnmapBuffer(GL_UNIFORM_BUFFER);
+				GLExt::BindBuffer(GL_UNIFORM_BUFFER, 0);
+			}
+			GLExt::DeleteBuffers(1, &bufferName);
+		}
+		bufferName = 0;
+		persistent = nullptr;
+		framing = false;
+	}
+
+private:
+	static GLuint bufferName;
+	static size_t capacity;       // obszaru jednej klatki
+	static size_t alignment;
+	static int region;
+	static size_t cursor;         // pozycja zapisu w całym buforze
+	static GLsync fences[FramesInFlight];
+	static uint8_t* persistent;   // trwałe mapowanie całego bufora
+	static uint8_t* mapped;       // mapowanie do commit() (bez buffer storage)
+	static size_t mappedStart;
+	static bool framing;
+	static UniformRingStats frame;
+
+	static size_t regionStart()
+	{
+		return (size_t)region * capacity;
+	}
+
+	static bool create()
+	{
+		if (bufferName)
+		{
+			return true;
+		}
+		if (!supported())
+		{
+			return false;
+		}
+
+		GLint align = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+		alignment = std::max<size_t>((size_t)align, 16);
+		capacity = (frameCapacity + alignment - 1) / alignment * alignment;
+		size_t total = capacity * FramesInFlight;
+
+		GLExt::GenBuffers(1, &bufferName);
+		GLExt::BindBuffer(GL_UNIFORM_BUFFER, bufferName);
+		if (GLExt::supportsBufferStorage())
+		{
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			GLExt::BufferStorage(GL_UNIFORM_BUFFER, (ptrdiff_t)total, nullptr, flags);
+			persistent = (uint8_t*)GLExt::MapBufferRange(GL_UNIFORM_BUFFER, 0, (ptrdiff_t)total, flags);
+			if (!persistent)
+			{
+				// niezmienny rozmiar bufora - zwykły bufor wymaga nowego obiektu
+				GLExt::DeleteBuffers(1, &bufferName);
+				GLExt::GenBuffers(1, &bufferName);
+				GLExt::BindBuffer(GL_UNIFORM_BUFFER, bufferName);
+			}
+		}
+		if (!persistent)
+		{
+			GLExt::BufferData(GL_UNIFORM_BUFFER, (ptrdiff_t)total, nullptr, GL_DYNAMIC_DRAW);
+		}
+		GLExt::BindBuffer(GL_UNIFORM_BUFFER, 0);
+		region = FramesInFlight - 1;
+		return true;
+	}
+};
+
+size_t UniformRing::frameCapacity = 2 * 1024 * 1024;
+GLuint UniformRing::bufferName = 0;
+size_t UniformRing::capacity = 0;
+size_t UniformRing::alignment = 256;
+int UniformRing::region = 0;
+size_t UniformRing::cursor = 0;
+GLsync UniformRing::fences[UniformRing::FramesInFlight] = {};
+uint8_t* UniformRing::persistent = nullptr;
+uint8_t* UniformRing::mapped = nullptr;
+size_t UniformRing::mappedStart = 0;
+bool UniformRing::framing = false;
+UniformRingStats UniformRing::frame;
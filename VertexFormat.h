@@ -0,0 +1,532 @@
+﻿#pragma once
+#include "includy.h"
+#include "Mesh.h"
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+
+/**
+* @enum VertexLayout
+* @brief Układy wierzchołków w pamięci
+* Float        - Vertex (44 bajty), bez kompresji
+* Quantized    - pozycja 16 bit, normalna 8 bit, kolor RGBA8, UV 16 bit (20 bajtów), rysowany przez fixed-function
+* QuantizedOct - jak wyżej, ale normalna w kodowaniu oktaedrycznym na 2 bajtach (16 bajtów), tylko do przechowywania -
+*                fixed-function nie zdekoduje normalnej, więc rysowana jest kopia zdekodowana na CPU (CompactMesh,
+*                MeshFile); sam MeshView rysuje taki układ wolno, wierzchołek po wierzchołku
+*/
+enum class VertexLayout
+{
+	Float,
+	Quantized,
+	QuantizedOct
+};
+
+struct QuantizedVertex
+{
+	int16_t position[4]; // xyz + wyrównanie do 8 bajtów
+	int8_t normal[4];    // xyz + wyrównanie
+	uint8_t color[4];
+	int16_t texCoord[2];
+};
+
+struct QuantizedOctVertex
+{
+	int16_t position[3];
+	int8_t normal[2];    // normalna zakodowana oktaedrycznie
+	uint8_t color[4];
+	int16_t texCoord[2];
+};
+
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex musi mieć 20 bajtów");
+static_assert(sizeof(QuantizedOctVertex) == 16, "QuantizedOctVertex musi mieć 16 bajtów");
+
+/**
+* @class VertexCodec
+* @brief Funkcje kodujące i dekodujące pojedyncze atrybuty
+*/
+class VertexCodec
+{
+public:
+	// [-1, 1] -> liczba całkowita ze znakiem o zakresie max
+	static int quantizeSnorm(float v, int max)
+	{
+		v = glm::clamp(v, -1.0f, 1.0f);
+		return (int)floor(v * max + 0.5f);
+	}
+
+	static float dequantizeSnorm(int q, int max)
+	{
+		return std::max((float)q / max, -1.0f);
+	}
+
+	// [0, 1] -> 0..255
+	static uint8_t quantizeUnorm8(float v)
+	{
+		return (uint8_t)(glm::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	// Kodowanie oktaedryczne - rzut na ośmiościan i rozłożenie dolnej połowy na rogi kwadratu
+	static glm::vec2 octEncode(const glm::vec3& n)
+	{
+		float sum = fabs(n.x) + fabs(n.y) + fabs(n.z);
+		glm::vec2 p = sum > 0.0f ? glm::vec2(n.x, n.y) / sum : glm::vec2(0.0f);
+		if (n.z < 0.0f)
+		{
+			p = glm::vec2((1.0f - fabs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+				(1.0f - fabs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+		}
+		return p;
+	}
+
+	static glm::vec3 octDecode(const glm::vec2& e)
+	{
+		glm::vec3 n(e.x, e.y, 1.0f - fabs(e.x) - fabs(e.y));
+		if (n.z < 0.0f)
+		{
+			float x = n.x, y = n.y;
+			n.x = (1.0f - fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			n.y = (1.0f - fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		}
+		return glm::normalize(n);
+	}
+
+	// Normalna oktaedryczna na 2 x 8 bitów; zaokrąglenie wybierane tak, by błąd kąta był najmniejszy
+	static void octEncode8(const glm::vec3& n, int8_t out[2])
+	{
+		glm::vec2 p = octEncode(n);
+		float bx = floor(p.x * 127.0f), by = floor(p.y * 127.0f);
+		float bestError = -2.0f;
+		for (int dx = 0; dx <= 1; dx++)
+		{
+			for (int dy = 0; dy <= 1; dy++)
+			{
+				glm::vec2 q(glm::clamp(bx + dx, -127.0f, 127.0f), glm::clamp(by + dy, -127.0f, 127.0f));
+				float error = glm::dot(octDecode(q / 127.0f), n);
+				if (error > bestError)
+				{
+					bestError = error;
+					out[0] = (int8_t)q.x;
+					out[1] = (int8_t)q.y;
+				}
+			}
+		}
+	}
+
+	static glm::vec3 octDecode8(const int8_t in[2])
+	{
+		return octDecode(glm::vec2(in[0], in[1]) / 127.0f);
+	}
+};
+
+/**
+* @struct MeshView
+* @brief Widok na dane siatki w dowolnym układzie, bez własnej pamięci.
+* Wskazuje na bufory CompactMesh albo bezpośrednio na zmapowany plik siatki (MeshFile)
+*/
+struct MeshView
+{
+	VertexLayout layout = VertexLayout::Float;
+	const uint8_t* vertexData = nullptr;
+	const uint8_t* indexData = nullptr;
+	const MeshLod* lods = nullptr;
+	size_t lodCount = 0;
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	bool shortIndices = false;
+	bool hasColors = true;
+	glm::vec3 center = glm::vec3(0.0f);
+	glm::vec3 scale = glm::vec3(1.0f);
+	glm::vec2 uvOffset = glm::vec2(0.0f);
+	glm::vec2 uvScale = glm::vec2(1.0f);
+
+	size_t stride() const
+	{
+		switch (layout)
+		{
+		case VertexLayout::Quantized: return sizeof(QuantizedVertex);
+		case VertexLayout::QuantizedOct: return sizeof(QuantizedOctVertex);
+		default: return sizeof(Vertex);
+		}
+	}
+
+	MeshLod lod(size_t level) const
+	{
+		if (lodCount == 0)
+		{
+			return { 0, (unsigned int)indexCount, 0.0f };
+		}
+		return lods[std::min(level, lodCount - 1)];
+	}
+
+	// Rozpakowanie wierzchołka do pełnej postaci
+	Vertex vertex(size_t i) const
+	{
+		Vertex v;
+		const uint8_t* in = vertexData + i * stride();
+		if (layout == VertexLayout::Float)
+		{
+			memcpy(&v, in, sizeof(Vertex));
+			return v;
+		}
+
+		const int16_t* position;
+		const uint8_t* color;
+		const int16_t* texCoord;
+		QuantizedVertex q;
+		QuantizedOctVertex o;
+		if (layout == VertexLayout::Quantized)
+		{
+			memcpy(&q, in, sizeof(q));
+			position = q.position; color = q.color; texCoord = q.texCoord;
+			v.normal = glm::normalize(glm::vec3(VertexCodec::dequantizeSnorm(q.normal[0], 127),
+				VertexCodec::dequantizeSnorm(q.normal[1], 127), VertexCodec::dequantizeSnorm(q.normal[2], 127)));
+		}
+		else
+		{
+			memcpy(&o, in, sizeof(o));
+			position = o.position; color = o.color; texCoord = o.texCoord;
+			v.normal = VertexCodec::octDecode8(o.normal);
+		}
+
+		v.position = center + glm::vec3(position[0], position[1], position[2]) * scale;
+		v.color = glm::vec3(color[0], color[1], color[2]) / 255.0f;
+		v.texCoord = uvOffset + glm::vec2(texCoord[0], texCoord[1]) * uvScale;
+		return v;
+	}
+
+	unsigned int index(size_t i) const
+	{
+		if (shortIndices)
+		{
+			return ((const uint16_t*)indexData)[i];
+		}
+		return ((const uint32_t*)indexData)[i];
+	}
+
+	// Rysowanie z tablic (Float i Quantized). QuantizedOct - awaryjnie z wierzchołków dekodowanych na CPU;
+	// właściciele danych (CompactMesh, MeshFile) rysują zamiast tego zapamiętaną kopię
+	void draw(size_t level = 0) const
+	{
+		if (indexCount == 0)
+		{
+			return;
+		}
+
+		MeshLod range = lod(level);
+		PerfCounters::add(PerfCounters::DrawCalls);
+		PerfCounters::add(PerfCounters::Triangles, range.indexCount / 3);
+		if (layout == VertexLayout::QuantizedOct)
+		{
+			drawDecoded(range);
+			return;
+		}
+		const GLsizei stride = (GLsizei)this->stride();
+		const uint8_t* base = vertexData;
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_NORMAL_ARRAY);
+
+		if (layout == VertexLayout::Float)
+		{
+			glVertexPointer(3, GL_FLOAT, stride, base + offsetof(Vertex, position));
+			glNormalPointer(GL_FLOAT, stride, base + offsetof(Vertex, normal));
+			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+			glTexCoordPointer(2, GL_FLOAT, stride, base + offsetof(Vertex, texCoord));
+			if (hasColors)
+			{
+				glEnableClientState(GL_COLOR_ARRAY);
+				glColorPointer(3, GL_FLOAT, stride, base + offsetof(Vertex, color));
+			}
+		}
+		else
+		{
+			// dekwantyzacja przez macierz modelu i tekstury, normalne (GL_BYTE) GL normalizuje sam
+			glPushAttrib(GL_ENABLE_BIT | GL_TRANSFORM_BIT);
+			glEnable(GL_NORMALIZE);
+			glMatrixMode(GL_TEXTURE);
+			glPushMatrix();
+			glTranslatef(uvOffset.x, uvOffset.y, 0.0f);
+			glScalef(uvScale.x, uvScale.y, 1.0f);
+			glMatrixMode(GL_MODELVIEW);
+			glPushMatrix();
+			glTranslatef(center.x, center.y, center.z);
+			glScalef(scale.x, scale.y, scale.z);
+
+			glVertexPointer(3, GL_SHORT, stride, base + offsetof(QuantizedVertex, position));
+			glNormalPointer(GL_BYTE, stride, base + offsetof(QuantizedVertex, normal));
+			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+			glTexCoordPointer(2, GL_SHORT, stride, base + offsetof(QuantizedVertex, texCoord));
+			if (hasColors)
+			{
+				glEnableClientState(GL_COLOR_ARRAY);
+				glColorPointer(4, GL_UNSIGNED_BYTE, stride, base + offsetof(QuantizedVertex, color));
+			}
+		}
+
+		size_t indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+		glDrawElements(GL_TRIANGLES, (GLsizei)range.indexCount, shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+			indexData + range.indexOffset * indexSize);
+
+		if (hasColors)
+		{
+			glDisableClientState(GL_COLOR_ARRAY);
+		}
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		if (layout != VertexLayout::Float)
+		{
+			glPopMatrix();
+			glMatrixMode(GL_TEXTURE);
+			glPopMatrix();
+			glMatrixMode(GL_MODELVIEW);
+			glPopAttrib();
+		}
+		glDisableClientState(GL_NORMAL_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+	}
+
+	// Trójkąty poziomu z wierzchołków zdekodowanych na CPU (normalnej oktaedrycznej nie zdekoduje fixed-function)
+	void drawDecoded(const MeshLod& range) const
+	{
+		glBegin(GL_TRIANGLES);
+		for (size_t i = range.indexOffset; i < (size_t)range.indexOffset + range.indexCount; i++)
+		{
+			Vertex v = vertex(index(i));
+			if (hasColors)
+			{
+				glColor3f(v.color.x, v.color.y, v.color.z);
+			}
+			glTexCoord2f(v.texCoord.x, v.texCoord.y);
+			glNormal3f(v.normal.x, v.normal.y, v.normal.z);
+			glVertex3f(v.position.x, v.position.y, v.position.z);
+		}
+		glEnd();
+	}
+};
+
+/**
+* @class CompactMesh
+* @brief Siatka w skompresowanym, przeplatanym układzie wierzchołków
+* Pozycje są zapisane względem środka prostopadłościanu otaczającego z jedną skalą dla wszystkich osi,
+* a UV względem zakresu UV siatki.
+* Przy rysowaniu dekwantyzację robi macierz modelu (glTranslate/glScale) i macierz tekstury,
+* więc sterownik dostaje liczby całkowite bez przeliczania na CPU. Indeksy są 16-bitowe,
+* jeżeli siatka ma do 65536 wierzchołków
+*/
+class CompactMesh
+{
+public:
+	VertexLayout layout = VertexLayout::Quantized;
+	vector<uint8_t> vertexData;
+	vector<uint8_t> indexData;
+	vector<MeshLod> lods;
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	bool shortIndices = false;
+	bool hasColors = true;
+
+	// dekwantyzacja: p = center + q * scale, uv = uvOffset + q * uvScale
+	glm::vec3 center = glm::vec3(0.0f);
+	glm::vec3 scale = glm::vec3(1.0f);
+	glm::vec2 uvOffset = glm::vec2(0.0f);
+	glm::vec2 uvScale = glm::vec2(1.0f);
+
+	// prostopadłościan otaczający pozycji sprzed kwantyzacji (przy jednej skali szerszy od niego jest sześcian kwantyzacji)
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+
+	size_t stride() const
+	{
+		return strideOf(layout);
+	}
+
+	static size_t strideOf(VertexLayout layout)
+	{
+		switch (layout)
+		{
+		case VertexLayout::Quantized: return sizeof(QuantizedVertex);
+		case VertexLayout::QuantizedOct: return sizeof(QuantizedOctVertex);
+		default: return sizeof(Vertex);
+		}
+	}
+
+	// Rozmiar danych w bajtach (wierzchołki + indeksy)
+	size_t memoryBytes() const
+	{
+		return vertexData.size() + indexData.size();
+	}
+
+	// Kompresja siatki do wybranego układu
+	static CompactMesh encode(const Mesh& mesh, VertexLayout layout)
+	{
+		CompactMesh result;
+		result.layout = layout;
+		result.vertexCount = mesh.vertices.size();
+		result.indexCount = mesh.indices.size();
+		result.lods = mesh.lods;
+		result.hasColors = mesh.hasColors;
+
+		glm::vec3 bmin(0.0f), bmax(0.0f);
+		glm::vec2 uvMin(0.0f), uvMax(0.0f);
+		if (!mesh.vertices.empty())
+		{
+			bmin = bmax = mesh.vertices[0].position;
+			uvMin = uvMax = mesh.vertices[0].texCoord;
+		}
+		for (const Vertex& v : mesh.vertices)
+		{
+			bmin = glm::min(bmin, v.position);
+			bmax = glm::max(bmax, v.position);
+			uvMin = glm::min(uvMin, v.texCoord);
+			uvMax = glm::max(uvMax, v.texCoord);
+		}
+
+		// jedna skala dla wszystkich osi (największa połowa rozmiaru) - glScalef nie zniekształca wtedy
+		// normalnych stałego potoku i oświetlenie jest takie samo jak z wierzchołków Float
+		glm::vec3 extent = (bmax - bmin) * 0.5f;
+		glm::vec3 half(std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-20f)));
+		result.center = (bmin + bmax) * 0.5f;
+		result.scale = half / 32767.0f;
+		result.boundsMin = bmin;
+		result.boundsMax = bmax;
+		result.uvOffset = uvMin;
+		result.uvScale = glm::max(uvMax - uvMin, glm::vec2(1e-20f)) / 32767.0f;
+
+		result.vertexData.resize(result.vertexCount * result.stride());
+		for (size_t i = 0; i < result.vertexCount; i++)
+		{
+			const Vertex& v = mesh.vertices[i];
+			uint8_t* out = &result.vertexData[i * result.stride()];
+
+			int16_t position[3], texCoord[2];
+			uint8_t color[4];
+			for (int k = 0; k < 3; k++)
+			{
+				position[k] = (int16_t)VertexCodec::quantizeSnorm((v.position[k] - result.center[k]) / half[k], 32767);
+				color[k] = VertexCodec::quantizeUnorm8(v.color[k]);
+			}
+			color[3] = 255;
+			for (int k = 0; k < 2; k++)
+			{
+				float range = uvMax[k] - uvMin[k];
+				texCoord[k] = (int16_t)(range > 0.0f ? (int)((v.texCoord[k] - uvMin[k]) / range * 32767.0f + 0.5f) : 0);
+			}
+
+			if (layout == VertexLayout::Quantized)
+			{
+				QuantizedVertex q;
+				memcpy(q.position, position, sizeof(position));
+				q.position[3] = 0;
+				for (int k = 0; k < 3; k++) q.normal[k] = (int8_t)VertexCodec::quantizeSnorm(v.normal[k], 127);
+				q.normal[3] = 0;
+				memcpy(q.color, color, sizeof(color));
+				memcpy(q.texCoord, texCoord, sizeof(texCoord));
+				memcpy(out, &q, sizeof(q));
+			}
+			else if (layout == VertexLayout::QuantizedOct)
+			{
+				QuantizedOctVertex q;
+				memcpy(q.position, position, sizeof(position));
+				VertexCodec::octEncode8(v.normal, q.normal);
+				memcpy(q.color, color, sizeof(color));
+				memcpy(q.texCoord, texCoord, sizeof(texCoord));
+				memcpy(out, &q, sizeof(q));
+			}
+			else
+			{
+				memcpy(out, &v, sizeof(Vertex));
+			}
+		}
+
+		result.shortIndices = result.vertexCount <= 65536;
+		if (result.shortIndices)
+		{
+			result.indexData.resize(result.indexCount * sizeof(uint16_t));
+			uint16_t* out = (uint16_t*)result.indexData.data();
+			for (size_t i = 0; i < result.indexCount; i++) out[i] = (uint16_t)mesh.indices[i];
+		}
+		else
+		{
+			result.indexData.resize(result.indexCount * sizeof(uint32_t));
+			memcpy(result.indexData.data(), mesh.indices.data(), result.indexData.size());
+		}
+
+		return result;
+	}
+
+	// Rozpakowanie całej siatki (narzędzia, testy, zmiana układu)
+	Mesh decode() const
+	{
+		Mesh mesh;
+		mesh.vertices.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			mesh.vertices[i] = vertex(i);
+		}
+		mesh.indices.resize(indexCount);
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			mesh.indices[i] = index(i);
+		}
+		mesh.lods = lods;
+		mesh.hasColors = hasColors;
+		mesh.computeBounds();
+		return mesh;
+	}
+
+	// Widok na dane siatki (bez kopiowania)
+	MeshView view() const
+	{
+		MeshView result;
+		result.layout = layout;
+		result.vertexData = vertexData.data();
+		result.indexData = indexData.data();
+		result.lods = lods.data();
+		result.lodCount = lods.size();
+		result.vertexCount = vertexCount;
+		result.indexCount = indexCount;
+		result.shortIndices = shortIndices;
+		result.hasColors = hasColors;
+		result.center = center;
+		result.scale = scale;
+		result.uvOffset = uvOffset;
+		result.uvScale = uvScale;
+		return result;
+	}
+
+	// Rozpakowanie wierzchołka do pełnej postaci
+	Vertex vertex(size_t i) const
+	{
+		return view().vertex(i);
+	}
+
+	unsigned int index(size_t i) const
+	{
+		return view().index(i);
+	}
+
+	// Rysowanie z tablic w skompresowanym układzie
+	void draw(size_t level = 0) const
+	{
+		if (layout == VertexLayout::QuantizedOct)
+		{
+			fixedFunctionCopy().draw(level);
+			return;
+		}
+		view().draw(level);
+	}
+
+private:
+	mutable unique_ptr<CompactMesh> fallback;
+
+	// Fixed-function nie zdekoduje normalnej oktaedrycznej - kopia w układzie Quantized tworzona przy pierwszym użyciu
+	const CompactMesh& fixedFunctionCopy() const
+	{
+		if (!fallback)
+		{
+			fallback.reset(new CompactMesh(encode(decode(), VertexLayout::Quantized)));
+		}
+		return *fallback;
+	}
+};
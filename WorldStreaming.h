@@ -0,0 +1,910 @@
+﻿#pragma once
+#include "includy.h"
+#include "Mesh.h"
+#include "MeshFile.h"
+#include "MeshImporter.h"
+#include "TextureCache.h"
+#include "AssetArchive.h"
+#include "ThreadPool.h"
+#include "LOD.h"
+#include "LightManager.h"
+#include "RenderQueue.h"
+#include "SpatialIndex.h"
+#include "Profiler.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <deque>
+#include <chrono>
+
+/**
+* @struct WorldStreamingOptions
+* @brief Ustawienia strumieniowania świata (odległości w jednostkach świata, w płaszczyźnie XZ)
+*/
+struct WorldStreamingOptions
+{
+	float loadRadius = 90.0f;
+	float unloadRadius = 120.0f;        // większy od loadRadius - komórka na granicy nie jest wczytywana co klatkę
+	size_t memoryBudget = 512 * 1024 * 1024; // siatki; tekstury ogranicza TextureCache::memoryBudget
+	int maxLoadsInFlight = 2;           // mało - kolejność wg priorytetu nadąża za ruchem kamery
+	float viewWeight = 0.5f;            // komórka na wprost kamery jest "bliżej" o tę część odległości
+};
+
+/**
+* @struct WorldStreamingStats
+* @brief Stan strumieniowania (do wyświetlenia / logów)
+*/
+struct WorldStreamingStats
+{
+	size_t cells = 0;
+	size_t loadedCells = 0;
+	size_t loadingCells = 0;
+	size_t residentBytes = 0;
+	size_t loads = 0;
+	size_t unloads = 0;
+	size_t evictions = 0; // wyładowania z powodu budżetu
+};
+
+/**
+* @class WorldStreamer
+* @brief Świat podzielony na komórki siatki XZ wczytywane w tle wokół kamery.
+* Plik świata:  "cell_size 64" oraz wiersze "cell <x> <z> <plik komórki>".
+* Plik komórki: wiersze "object <siatka .jmesh/.obj/.ply> <tekstura | @materiał | -> <x> <y> <z> [obrót Y w stopniach] [skala]",
+* materiały "material <nazwa> <otoczenie r g b> <rozproszenie r g b> <odbicie r g b> <połysk> <tekstura | ->"
+* oraz światła "light point <x y z> <r g b> <zasięg>", "light spot <x y z> <kierunek> <r g b> <zasięg> <kąt>",
+* "light directional <kierunek> <r g b>" - dodawane do LightManager na czas, gdy komórka jest wczytana.
+* Komórki w promieniu wczytywania są kolejkowane wg odległości i kierunku patrzenia, opis komórki i siatki
+* wczytywane są na puli wątków, tekstury przez TextureCache (dekodowanie w tle). Komórki poza promieniem
+* wyładowania są zwalniane, a po przekroczeniu budżetu pamięci zwalniane są komórki o najgorszym priorytecie
+*/
+class WorldStreamer
+{
+public:
+	static WorldStreamingOptions options;
+
+	// Wczytanie opisu świata (bez zawartości komórek)
+	static bool open(const string& path)
+	{
+		close();
+
+		string text;
+		if (!readText(path, text))
+		{
+			cout << "Nie udalo sie wczytac swiata " << path << "\n";
+			return false;
+		}
+
+		string directory = directoryOf(path);
+		istringstream in(text);
+		string line;
+		while (getline(in, line))
+		{
+			istringstream fields(line);
+			string keyword;
+			fields >> keyword;
+			if (keyword == "cell_size")
+			{
+				fields >> cellSize;
+			}
+			else if (keyword == "cell")
+			{
+				int x, z;
+				string file;
+				if (fields >> x >> z >> file)
+				{
+					Cell& cell = cells[make_pair(x, z)];
+					cell.x = x;
+					cell.z = z;
+					cell.path = directory + file;
+				}
+			}
+		}
+
+		if (cellSize <= 0.0f || cells.empty())
+		{
+			cout << "Pusty lub niepoprawny opis swiata " << path << "\n";
+			close();
+			return false;
+		}
+		cout << "Swiat " << path << ": " << cells.size() << " komorek po " << cellSize << "\n";
+		return true;
+	}
+
+	// Zwolnienie wszystkich komórek
+	static void close()
+	{
+		for (auto& entry : cells)
+		{
+			unload(entry.second);
+		}
+		cells.clear(); // wyniki odczytów w toku zostaną odrzucone w collectLoaded
+		changed();
+		cellSize = 0.0f;
+		counters = WorldStreamingStats();
+	}
+
+	static bool isOpen()
+	{
+		return !cells.empty();
+	}
+
+	// Wywoływane raz na klatkę na wątku renderowania
+	static void update(const glm::vec3& eye, const glm::vec3& front)
+	{
+		PROFILE_ZONE("WorldStreamer::update");
+		if (cells.empty())
+		{
+			return;
+		}
+
+		collectLoaded();
+
+		glm::vec2 forward(front.x, front.z);
+		float length = glm::length(forward);
+		forward = length > 1e-4f ? forward / length : glm::vec2(0.0f);
+
+		// zwolnienie dalekich komórek, anulowanie niepotrzebnych już odczytów
+		vector<Cell*> candidates;
+		for (auto& entry : cells)
+		{
+			Cell& cell = entry.second;
+			float distance = cellDistance(cell, eye);
+			cell.priority = priority(cell, eye, forward, distance);
+
+			if (cell.state != Cell::Unloaded && distance > options.unloadRadius)
+			{
+				unload(cell);
+				counters.unloads++;
+			}
+			else if (cell.state == Cell::Unloaded && distance <= options.loadRadius)
+			{
+				candidates.push_back(&cell);
+			}
+		}
+
+		sort(candidates.begin(), candidates.end(), [](const Cell* a, const Cell* b) { return a->priority < b->priority; });
+
+		for (Cell* cell : candidates)
+		{
+			if (inFlight >= options.maxLoadsInFlight || !makeRoom(cell->priority))
+			{
+				break;
+			}
+			startLoad(*cell);
+		}
+	}
+
+	// Dodanie obiektów wczytanych komórek do RenderQueue, poziom LOD obiektu wg błędu na ekranie
+	static void submit(const glm::vec3& eye)
+	{
+		for (auto& entry : cells)
+		{
+			Cell& cell = entry.second;
+			if (cell.state != Cell::Loaded)
+			{
+				continue;
+			}
+
+			for (Instance& instance : cell.instances)
+			{
+				RenderQueue::submit(drawItem(instance, eye));
+			}
+			PerfCounters::add(PerfCounters::VisibleObjects, (int64_t)cell.instances.size());
+		}
+	}
+
+	// Jak wyżej, ale tylko obiekty przecinające ostrosłup kamery - wyszukane w SpatialIndex
+	static void submit(const glm::vec3& eye, const Frustum& frustum)
+	{
+		PROFILE_ZONE("WorldStreamer::submit");
+		updateIndex();
+		int64_t visible = 0;
+		index.query(frustum, [&](uint32_t id)
+		{
+			RenderQueue::submit(drawItem(*indexed[id], eye));
+			visible++;
+		});
+		PerfCounters::add(PerfCounters::VisibleObjects, visible);
+		PerfCounters::add(PerfCounters::CulledObjects, (int64_t)index.size() - visible);
+	}
+
+	// Obiekty wczytanych komórek przecinające ostrosłup (np. rzucające cień w kaskadę), wyszukane w SpatialIndex.
+	// Poziom LOD jak przy submit - wg odległości od eye
+	static void queryCasters(const Frustum& frustum, const glm::vec3& eye, vector<DrawItem>& result)
+	{
+		updateIndex();
+		index.query(frustum, [&](uint32_t id) { result.push_back(drawItem(*indexed[id], eye)); });
+	}
+
+	static void queryCasters(const glm::vec3& low, const glm::vec3& high, const glm::vec3& eye, vector<DrawItem>& result)
+	{
+		updateIndex();
+		index.query(low, high, [&](uint32_t id) { result.push_back(drawItem(*indexed[id], eye)); });
+	}
+
+	// Prostopadłościan obejmujący wszystkie wczytane obiekty (false - brak obiektów)
+	static bool bounds(glm::vec3& low, glm::vec3& high)
+	{
+		updateIndex();
+		low = index.boundsMin();
+		high = index.boundsMax();
+		return !index.empty();
+	}
+
+	// Licznik zmian zbioru obiektów (wczytanie, zwolnienie, przeładowanie siatki) - do unieważniania map cieni
+	static uint64_t version()
+	{
+		return changes;
+	}
+
+	// Pliki wczytanych komórek i siatek (do obserwowania zmian)
+	static void files(vector<string>& result)
+	{
+		for (const auto& entry : cells)
+		{
+			if (entry.second.state == Cell::Loaded)
+			{
+				result.push_back(entry.second.path);
+			}
+		}
+		lock_guard<mutex> lock(meshMutex);
+		for (const auto& entry : meshes)
+		{
+			if (!entry.second.expired())
+			{
+				result.push_back(entry.first);
+			}
+		}
+	}
+
+	// Ponowne wczytanie zmienionego pliku komórki lub siatki w tle. Do czasu podmiany
+	// (applyReloads) rysowana jest stara zawartość, obiekty zachowują swoje siatki
+	static bool reloadFile(const string& path)
+	{
+		bool found = false;
+		for (auto& entry : cells)
+		{
+			Cell& cell = entry.second;
+			if (cell.path == path && cell.state == Cell::Loaded)
+			{
+				startLoad(cell);
+				found = true;
+			}
+		}
+
+		{
+			lock_guard<mutex> lock(meshMutex);
+			auto it = meshes.find(path);
+			if (it == meshes.end() || it->second.expired())
+			{
+				return found;
+			}
+		}
+
+		ThreadPool::shared().submit([path]()
+		{
+			PROFILE_ZONE("WorldStreamer::loadMesh");
+			shared_ptr<StreamedMesh> mesh = loadMesh(path);
+			if (mesh)
+			{
+				lock_guard<mutex> lock(loadedMutex);
+				reloadedMeshes.push_back(make_pair(path, mesh));
+			}
+		});
+		return true;
+	}
+
+	// Podmiana przeładowanych siatek na wątku renderowania, dopóki nie minie deadline
+	static void applyReloads(chrono::steady_clock::time_point deadline)
+	{
+		while (chrono::steady_clock::now() < deadline)
+		{
+			pair<string, shared_ptr<StreamedMesh>> reloaded;
+			{
+				lock_guard<mutex> lock(loadedMutex);
+				if (reloadedMeshes.empty())
+				{
+					return;
+				}
+				reloaded = std::move(reloadedMeshes.front());
+				reloadedMeshes.pop_front();
+			}
+
+			shared_ptr<StreamedMesh> mesh;
+			{
+				lock_guard<mutex> lock(meshMutex);
+				auto it = meshes.find(reloaded.first);
+				mesh = it == meshes.end() ? nullptr : it->second.lock();
+			}
+			if (!mesh)
+			{
+				continue; // siatka zwolniona w międzyczasie
+			}
+
+			// ten sam obiekt StreamedMesh - wskaźniki w obiektach komórek pozostają ważne
+			StreamedMesh& fresh = *reloaded.second;
+			mesh->file.swap(fresh.file);
+			mesh->mesh = std::move(fresh.mesh);
+			mesh->bytes = fresh.bytes;
+			for (auto& entry : cells)
+			{
+				for (Instance& instance : entry.second.instances)
+				{
+					if (instance.mesh == mesh)
+					{
+						instance.place(instance.transform, instance.scale);
+					}
+				}
+			}
+			changed();
+			cout << "Przeladowano siatke " << reloaded.first << "\n";
+		}
+	}
+
+	static WorldStreamingStats stats()
+	{
+		WorldStreamingStats result = counters;
+		result.cells = cells.size();
+		for (const auto& entry : cells)
+		{
+			result.loadedCells += entry.second.state == Cell::Loaded;
+			result.loadingCells += entry.second.state == Cell::Loading;
+		}
+		result.residentBytes = residentBytes();
+		return result;
+	}
+
+private:
+	/**
+	* Siatka wspólna dla wszystkich obiektów, które jej używają (również z różnych komórek)
+	*/
+	struct StreamedMesh
+	{
+		unique_ptr<MeshFile> file; // .jmesh - dane w zmapowanym pliku
+		Mesh mesh;                 // .obj / .ply
+		size_t bytes = 0;
+
+		glm::vec3 center() const
+		{
+			return file ? (file->boundsMin() + file->boundsMax()) * 0.5f : mesh.center();
+		}
+
+		float radius() const
+		{
+			return file ? glm::length(file->boundsMax() - file->boundsMin()) * 0.5f : mesh.radius();
+		}
+
+		size_t lodCount() const
+		{
+			return file ? file->lodCount() : mesh.lodCount();
+		}
+
+		float lodError(size_t level) const
+		{
+			if (file)
+			{
+				MeshView view = file->view();
+				return view.lodCount ? view.lods[std::min(level, (size_t)view.lodCount - 1)].error : 0.0f;
+			}
+			return mesh.lod(level).error;
+		}
+
+		void draw(size_t level) const
+		{
+			if (file) file->draw(level);
+			else mesh.draw(level);
+		}
+
+		static void drawLevel(const void* object, size_t level)
+		{
+			((const StreamedMesh*)object)->draw(level);
+		}
+	};
+
+	struct Instance
+	{
+		shared_ptr<StreamedMesh> mesh;
+		MaterialDesc materialDesc; // blok z rejestru pobierany na wątku renderowania
+		MaterialRef material;
+		glm::mat4 transform;
+		glm::vec3 center;
+		float radius;
+		float scale;
+
+		void place(const glm::mat4& matrix, float uniformScale)
+		{
+			transform = matrix;
+			scale = uniformScale;
+			center = glm::vec3(transform * glm::vec4(mesh->center(), 1.0f));
+			radius = mesh->radius() * scale;
+		}
+	};
+
+	struct Cell
+	{
+		enum State
+		{
+			Unloaded,
+			Loading,
+			Loaded
+		};
+
+		int x = 0, z = 0;
+		string path;
+		State state = Unloaded;
+		float priority = 0.0f;
+		vector<Instance> instances;
+		vector<LightId> lights;
+		shared_ptr<atomic<bool>> cancelled; // znacznik aktualnego odczytu
+	};
+
+	// Wynik odczytu komórki z wątku roboczego
+	struct LoadedCell
+	{
+		pair<int, int> key;
+		shared_ptr<atomic<bool>> cancelled;
+		vector<Instance> instances;
+		vector<LightDesc> lights;
+		bool ok = false;
+	};
+
+	static map<pair<int, int>, Cell> cells;
+	static float cellSize;
+	static int inFlight;
+	static WorldStreamingStats counters;
+
+	static mutex loadedMutex;
+	static vector<LoadedCell> loaded;
+
+	static mutex meshMutex;
+	static map<string, weak_ptr<StreamedMesh>> meshes;
+
+	// obiekty wczytanych komórek (prostopadłościany ich sfer), przebudowywane przy pierwszym zapytaniu po zmianie
+	static SpatialIndex index;
+	static vector<const Instance*> indexed; // identyfikator w indeksie -> obiekt
+	static bool indexDirty;
+	static uint64_t changes;
+	static deque<pair<string, shared_ptr<StreamedMesh>>> reloadedMeshes; // chronione loadedMutex
+
+	static float cellDistance(const Cell& cell, const glm::vec3& eye)
+	{
+		float minX = cell.x * cellSize, minZ = cell.z * cellSize;
+		float dx = std::max(std::max(minX - eye.x, eye.x - (minX + cellSize)), 0.0f);
+		float dz = std::max(std::max(minZ - eye.z, eye.z - (minZ + cellSize)), 0.0f);
+		return sqrt(dx * dx + dz * dz);
+	}
+
+	static float priority(const Cell& cell, const glm::vec3& eye, const glm::vec2& forward, float distance)
+	{
+		glm::vec2 center((cell.x + 0.5f) * cellSize, (cell.z + 0.5f) * cellSize);
+		glm::vec2 direction = center - glm::vec2(eye.x, eye.z);
+		float length = glm::length(direction);
+		float facing = length > 1e-4f ? std::max(0.0f, glm::dot(direction / length, forward)) : 1.0f;
+		return distance * (1.0f - options.viewWeight * facing);
+	}
+
+	// Zwolnienie komórek gorszych od kandydata, dopóki nie zmieści się w budżecie
+	static bool makeRoom(float candidatePriority)
+	{
+		while (residentBytes() >= options.memoryBudget)
+		{
+			Cell* worst = nullptr;
+			for (auto& entry : cells)
+			{
+				Cell& cell = entry.second;
+				if (cell.state == Cell::Loaded && (!worst || cell.priority > worst->priority))
+				{
+					worst = &cell;
+				}
+			}
+
+			if (!worst || worst->priority <= candidatePriority)
+			{
+				return false;
+			}
+			unload(*worst);
+			counters.evictions++;
+		}
+		return true;
+	}
+
+	static size_t residentBytes()
+	{
+		lock_guard<mutex> lock(meshMutex);
+		size_t bytes = 0;
+		for (auto it = meshes.begin(); it != meshes.end();)
+		{
+			shared_ptr<StreamedMesh> mesh = it->second.lock();
+			if (!mesh)
+			{
+				it = meshes.erase(it);
+				continue;
+			}
+			bytes += mesh->bytes;
+			++it;
+		}
+		return bytes;
+	}
+
+	// Wczytana komórka (przeładowanie) pozostaje rysowana do czasu przyjścia nowej zawartości
+	static void startLoad(Cell& cell)
+	{
+		if (cell.state == Cell::Unloaded)
+		{
+			cell.state = Cell::Loading;
+		}
+		if (cell.cancelled)
+		{
+			*cell.cancelled = true;
+		}
+		cell.cancelled = make_shared<atomic<bool>>(false);
+		inFlight++;
+		counters.loads++;
+
+		pair<int, int> key(cell.x, cell.z);
+		string path = cell.path;
+		shared_ptr<atomic<bool>> cancelled = cell.cancelled;
+		ThreadPool::shared().submit([key, path, cancelled]()
+		{
+			PROFILE_ZONE("WorldStreamer::loadCell");
+			LoadedCell result;
+			result.key = key;
+			result.cancelled = cancelled;
+			result.ok = loadCell(path, *cancelled, result);
+
+			lock_guard<mutex> lock(loadedMutex);
+			loaded.push_back(std::move(result));
+		});
+	}
+
+	static void unload(Cell& cell)
+	{
+		if (cell.cancelled)
+		{
+			*cell.cancelled = true;
+		}
+		cell.cancelled.reset();
+		if (!cell.instances.empty())
+		{
+			changed();
+		}
+		cell.instances.clear();
+		removeLights(cell);
+		cell.state = Cell::Unloaded;
+	}
+
+	static void changed()
+	{
+		indexDirty = true;
+		changes++;
+	}
+
+	static void updateIndex()
+	{
+		if (!indexDirty)
+		{
+			return;
+		}
+		PROFILE_ZONE("WorldStreamer::updateIndex");
+		indexDirty = false;
+
+		indexed.clear();
+		vector<SpatialIndex::Item> items;
+		for (const auto& entry : cells)
+		{
+			if (entry.second.state != Cell::Loaded)
+			{
+				continue;
+			}
+			for (const Instance& instance : entry.second.instances)
+			{
+				glm::vec3 extent(instance.radius);
+				items.push_back({ instance.center - extent, instance.center + extent, (uint32_t)indexed.size() });
+				indexed.push_back(&instance);
+			}
+		}
+		index.build(std::move(items));
+	}
+
+	static DrawItem drawItem(const Instance& instance, const glm::vec3& eye)
+	{
+		DrawItem item;
+		item.material = instance.material.get();
+		item.transform = instance.transform;
+		item.center = instance.center;
+		item.radius = instance.radius;
+		item.draw = &StreamedMesh::drawLevel;
+		item.object = instance.mesh.get();
+		item.level = selectLevel(*instance.mesh, instance.scale, glm::length(instance.center - eye));
+		return item;
+	}
+
+	// Przejęcie wyników z wątków roboczych (wątek renderowania)
+	static void collectLoaded()
+	{
+		vector<LoadedCell> results;
+		{
+			lock_guard<mutex> lock(loadedMutex);
+			results.swap(loaded);
+		}
+
+		for (LoadedCell& result : results)
+		{
+			inFlight--;
+			auto it = cells.find(result.key);
+			if (it == cells.end() || it->second.cancelled != result.cancelled || *result.cancelled)
+			{
+				continue; // komórka wyładowana w trakcie odczytu
+			}
+
+			Cell& cell = it->second;
+			if (!result.ok)
+			{
+				cout << "Nie udalo sie wczytac komorki " << cell.path << "\n";
+			}
+			cell.instances = std::move(result.instances);
+			for (Instance& instance : cell.instances)
+			{
+				instance.material = MaterialRegistry::get(instance.materialDesc);
+			}
+			removeLights(cell);
+			for (const LightDesc& light : result.lights)
+			{
+				cell.lights.push_back(LightManager::add(light));
+			}
+			cell.state = Cell::Loaded;
+			changed();
+		}
+	}
+
+	static void removeLights(Cell& cell)
+	{
+		for (LightId light : cell.lights)
+		{
+			LightManager::remove(light);
+		}
+		cell.lights.clear();
+	}
+
+	// Wątek roboczy: opis komórki, siatki jej obiektów i światła
+	static bool loadCell(const string& path, const atomic<bool>& cancelled, LoadedCell& result)
+	{
+		string text;
+		if (!readText(path, text))
+		{
+			return false;
+		}
+
+		string directory = directoryOf(path);
+		istringstream in(text);
+		string line;
+		bool ok = true;
+		map<string, MaterialDesc> materials;
+		while (getline(in, line) && !cancelled)
+		{
+			istringstream fields(line);
+			string keyword, meshPath, texturePath;
+			glm::vec3 position;
+			float yaw = 0.0f, scale = 1.0f;
+			fields >> keyword;
+			if (keyword == "light")
+			{
+				LightDesc light;
+				if (parseLight(fields, light))
+				{
+					result.lights.push_back(light);
+				}
+				else
+				{
+					ok = false;
+				}
+				continue;
+			}
+			if (keyword == "material")
+			{
+				string name, texture;
+				MaterialDesc material;
+				if (fields >> name >> material.ambient.x >> material.ambient.y >> material.ambient.z
+					>> material.diffuse.x >> material.diffuse.y >> material.diffuse.z
+					>> material.specular.x >> material.specular.y >> material.specular.z >> material.shininess >> texture)
+				{
+					if (texture != "-")
+					{
+						material.texture = directory + texture;
+					}
+					materials[name] = material;
+				}
+				else
+				{
+					ok = false;
+				}
+				continue;
+			}
+			if (keyword != "object")
+			{
+				continue;
+			}
+			if (!(fields >> meshPath >> texturePath >> position.x >> position.y >> position.z))
+			{
+				ok = false;
+				continue;
+			}
+			fields >> yaw >> scale;
+
+			Instance instance;
+			instance.mesh = acquireMesh(directory + meshPath);
+			if (!instance.mesh)
+			{
+				ok = false;
+				continue;
+			}
+			if (texturePath[0] == '@')
+			{
+				auto material = materials.find(texturePath.substr(1));
+				if (material == materials.end())
+				{
+					ok = false;
+				}
+				else
+				{
+					instance.materialDesc = material->second;
+				}
+			}
+			else if (texturePath != "-")
+			{
+				instance.materialDesc.texture = directory + texturePath;
+			}
+			instance.place(glm::translate(glm::mat4(1.0f), position) *
+				glm::rotate(glm::mat4(1.0f), glm::radians(yaw), glm::vec3(0.0f, 1.0f, 0.0f)) *
+				glm::scale(glm::mat4(1.0f), glm::vec3(scale)), scale);
+			result.instances.push_back(std::move(instance));
+		}
+		return ok;
+	}
+
+	static bool parseLight(istringstream& fields, LightDesc& light)
+	{
+		string type;
+		glm::vec3 position, direction, color;
+		float range = 0.0f, angle = 0.0f;
+		fields >> type;
+		if (type == "point" && fields >> position.x >> position.y >> position.z >> color.x >> color.y >> color.z >> range)
+		{
+			light = LightDesc::point(position, color, range);
+			return true;
+		}
+		if (type == "spot" && fields >> position.x >> position.y >> position.z >> direction.x >> direction.y >> direction.z
+			>> color.x >> color.y >> color.z >> range >> angle)
+		{
+			light = LightDesc::spot(position, direction, color, range, angle);
+			return true;
+		}
+		if (type == "directional" && fields >> direction.x >> direction.y >> direction.z >> color.x >> color.y >> color.z)
+		{
+			light = LightDesc::directional(direction, color);
+			return true;
+		}
+		return false;
+	}
+
+	// Siatka z pamięci, jeśli używa jej już inna komórka, w przeciwnym razie odczyt z pliku
+	static shared_ptr<StreamedMesh> acquireMesh(const string& path)
+	{
+		{
+			lock_guard<mutex> lock(meshMutex);
+			auto it = meshes.find(path);
+			if (it != meshes.end())
+			{
+				if (shared_ptr<StreamedMesh> mesh = it->second.lock())
+				{
+					return mesh;
+				}
+			}
+		}
+
+		shared_ptr<StreamedMesh> mesh = loadMesh(path);
+		if (!mesh)
+		{
+			return nullptr;
+		}
+
+		// dwie komórki mogły wczytać tę samą siatkę równocześnie - zostaje pierwsza
+		lock_guard<mutex> lock(meshMutex);
+		weak_ptr<StreamedMesh>& slot = meshes[path];
+		if (shared_ptr<StreamedMesh> existing = slot.lock())
+		{
+			return existing;
+		}
+		slot = mesh;
+		return mesh;
+	}
+
+	static shared_ptr<StreamedMesh> loadMesh(const string& path)
+	{
+		auto mesh = make_shared<StreamedMesh>();
+		size_t length = strlen(MeshFile::extension());
+		if (path.size() >= length && path.compare(path.size() - length, length, MeshFile::extension()) == 0)
+		{
+			mesh->file.reset(new MeshFile());
+			// verify() czyta cały plik - strony są już w pamięci, gdy wątek renderowania zacznie rysować
+			if (!mesh->file->open(path) || !mesh->file->verify())
+			{
+				cout << "Niepoprawna siatka " << path << "\n";
+				return nullptr;
+			}
+			mesh->bytes = (size_t)mesh->file->header().fileSize;
+		}
+		else
+		{
+			MeshImportOptions importOptions;
+			if (!MeshImporter::load(path, mesh->mesh, importOptions))
+			{
+				return nullptr;
+			}
+			mesh->bytes = mesh->mesh.vertices.size() * sizeof(Vertex) + mesh->mesh.indices.size() * sizeof(unsigned int);
+		}
+		return mesh;
+	}
+
+	static size_t selectLevel(const StreamedMesh& mesh, float scale, float distance)
+	{
+		for (size_t level = mesh.lodCount(); level-- > 1;)
+		{
+			if (LODSelector::pixelError(mesh.lodError(level) * scale, distance) <= LODSelector::maxPixelError)
+			{
+				return level;
+			}
+		}
+		return 0;
+	}
+
+	// Plik tekstowy z zamontowanego archiwum albo z dysku
+	static bool readText(const string& path, string& text)
+	{
+		if (const AssetArchive* archive = AssetArchive::locate(path))
+		{
+			vector<uint8_t> data;
+			if (!archive->read(path, data))
+			{
+				return false;
+			}
+			text.assign(data.begin(), data.end());
+			return true;
+		}
+
+		ifstream in(path, ios::binary);
+		if (!in)
+		{
+			return false;
+		}
+		ostringstream content;
+		content << in.rdbuf();
+		text = content.str();
+		return true;
+	}
+
+	static string directoryOf(const string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		return slash == string::npos ? string() : path.substr(0, slash + 1);
+	}
+};
+
+WorldStreamingOptions WorldStreamer::options;
+map<pair<int, int>, WorldStreamer::Cell> WorldStreamer::cells;
+float WorldStreamer::cellSize = 0.0f;
+int WorldStreamer::inFlight = 0;
+WorldStreamingStats WorldStreamer::counters;
+mutex WorldStreamer::loadedMutex;
+vector<WorldStreamer::LoadedCell> WorldStreamer::loaded;
+mutex WorldStreamer::meshMutex;
+map<string, weak_ptr<WorldStreamer::StreamedMesh>> WorldStreamer::meshes;
+deque<pair<string, shared_ptr<WorldStreamer::StreamedMesh>>> WorldStreamer::reloadedMeshes;
+SpatialIndex WorldStreamer::index;
+vector<const WorldStreamer::Instance*> WorldStreamer::indexed;
+bool WorldStreamer::indexDirty = false;
+uint64_t WorldStreamer::changes = 0;
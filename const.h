@@ -9,6 +9,9 @@ const int WINDOW_HEIGHT = 600;
 const float CAMERA_SPEED = 0.1f;
 const float MOUSE_SENSITIVITY = 0.1f;
 const float CUBE_ROTATION_SPEED = 1.0f;
+const float FIELD_OF_VIEW = 45.0f;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
 
 glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 5.0f);
 glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
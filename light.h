@@ -2,6 +2,7 @@
 #define LIGHT_H
 
 #include "includy.h"
+#include "LightManager.h"
 
 /**
 * @class Light
@@ -21,19 +22,27 @@ public:
 	void setupLight(GLenum lightID) 
 	{
 		glEnable(GL_LIGHTING);
-		glEnable(GL_LIGHT0);
+		glEnable(lightID);
 
 		// Set light position
 		GLfloat lightPosition[] = { position.x, position.y, position.z, 1.0f };
-		glLightfv(GL_LIGHT0, GL_POSITION, lightPosition);
+		glLightfv(lightID, GL_POSITION, lightPosition);
 
 		// Set light properties
 		GLfloat lightAmbient[] = { ambient.x, ambient.y, ambient.z, 1.0f };
 		GLfloat lightDiffuse[] = { diffuse.x, diffuse.y, diffuse.z, 1.0f };
 		GLfloat lightSpecular[] = { specular.x, specular.y, specular.z, 1.0f };
-		glLightfv(GL_LIGHT0, GL_AMBIENT, lightAmbient);
-		glLightfv(GL_LIGHT0, GL_DIFFUSE, lightDiffuse);
-		glLightfv(GL_LIGHT0, GL_SPECULAR, lightSpecular);
+		glLightfv(lightID, GL_AMBIENT, lightAmbient);
+		glLightfv(lightID, GL_DIFFUSE, lightDiffuse);
+		glLightfv(lightID, GL_SPECULAR, lightSpecular);
+	}
+
+	// Opis dla LightManager (wiato punktowe o zadanym zasigu)
+	LightDesc toDesc(float range) const
+	{
+		LightDesc desc = LightDesc::point(position, diffuse, range);
+		desc.ambient = ambient;
+		return desc;
 	}
 };
 
@@ -2,7 +2,10 @@
 #include "includy.h"
 
 #include "const.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
 #include "TextureHandler.h"
+#include "TextureAtlas.h"
 
 
 /**
@@ -17,6 +20,7 @@ public:
 	glm::vec3 scale;
 	glm::mat4 transform;
 	GLuint textureID; 
+	AtlasRegion atlasRegion; // region atlasu, gdy textureID to strona atlasu
 
 	CUBE()
 		: position(0.0f), rotation(0.0f), scale(1.0f), transform(glm::mat4(1.0f)), textureID(0) {}
@@ -51,68 +55,102 @@ public:
 		UpdateTransform();
 	}
 
-	// Funkcja rysujca szecian
+	// Tekstura z atlasu - szeciany z jednej strony nie zmieniaj dowizanej tekstury
+	void setTexture(const AtlasRegion& region)
+	{
+		atlasRegion = region;
+		textureID = region.texture;
+	}
+
+	// Funkcja rysujca szecian - siatka budowana raz i rysowana jednym wywoaniem
 	void draw() 
 	{
 		glEnable(GL_CULL_FACE); // Enable face culling
 		glCullFace(GL_BACK);    // Cull back faces
 		glFrontFace(GL_CCW);    // Set counter-clockwise winding as front faces
 
+		bool atlas = textureID != 0 && atlasRegion.valid();
+		if (textureID != 0)
+		{
+			glEnable(GL_TEXTURE_2D);
+			TextureHandler::bind(textureID);
+		}
+		if (atlas)
+		{
+			// UV siatki (0..1) przeliczane na region strony macierz tekstury
+			glMatrixMode(GL_TEXTURE);
+			glPushMatrix();
+			glTranslatef(atlasRegion.uvOffset.x, atlasRegion.uvOffset.y, 0.0f);
+			glScalef(atlasRegion.uvScale.x, atlasRegion.uvScale.y, 1.0f);
+			glMatrixMode(GL_MODELVIEW);
+		}
+
 		glPushMatrix();
 		glMultMatrixf(glm::value_ptr(transform));
-
-		glBegin(GL_QUADS);
-
-		//przednia ciana
-		glNormal3f(0.0f, 0.0f, 1.0f); // wektor normalny
-		glColor3f(1.0f, 0.0f, 0.0f);
-		glVertex3f(-0.5f, -0.5f, 0.5f);
-		glVertex3f(0.5f, -0.5f, 0.5f);
-		glVertex3f(0.5f, 0.5f, 0.5f);
-		glVertex3f(-0.5f, 0.5f, 0.5f);
-
-		//tylna ciana
-		glNormal3f(0.0f, 0.0f, -1.0f);
-		glColor3f(0.0f, 1.0f, 0.0f);
-		glVertex3f(-0.5f, -0.5f, -0.5f);
-		glVertex3f(-0.5f, 0.5f, -0.5f);
-		glVertex3f(0.5f, 0.5f, -0.5f);
-		glVertex3f(0.5f, -0.5f, -0.5f);
-
-		//grna ciana
-		glNormal3f(0.0f, 1.0f, 0.0f);
-		glColor3f(0.0f, 0.0f, 1.0f);
-		glVertex3f(-0.5f, 0.5f, -0.5f);
-		glVertex3f(-0.5f, 0.5f, 0.5f);
-		glVertex3f(0.5f, 0.5f, 0.5f);
-		glVertex3f(0.5f, 0.5f, -0.5f);
-
-		//spd
-		glNormal3f(0.0f, -1.0f, 0.0f);
-		glColor3f(1.0f, 1.0f, 0.0f);
-		glVertex3f(-0.5f, -0.5f, -0.5f);
-		glVertex3f(0.5f, -0.5f, -0.5f);
-		glVertex3f(0.5f, -0.5f, 0.5f);
-		glVertex3f(-0.5f, -0.5f, 0.5f);
-
-		//lewa ciana
-		glNormal3f(-1.0f, 0.0f, 0.0f);
-		glColor3f(1.0f, 0.0f, 1.0f);
-		glVertex3f(-0.5f, -0.5f, -0.5f);
-		glVertex3f(-0.5f, -0.5f, 0.5f);
-		glVertex3f(-0.5f, 0.5f, 0.5f);
-		glVertex3f(-0.5f, 0.5f, -0.5f);
-
-		//prawa ciana
-		glNormal3f(1.0f, 0.0f, 0.0f);
-		glColor3f(0.0f, 1.0f, 1.0f);
-		glVertex3f(0.5f, -0.5f, -0.5f);
-		glVertex3f(0.5f, 0.5f, -0.5f);
-		glVertex3f(0.5f, 0.5f, 0.5f);
-		glVertex3f(0.5f, -0.5f, 0.5f);
-
-		glEnd();
+		mesh().draw();
 		glPopMatrix();
+
+		if (atlas)
+		{
+			glMatrixMode(GL_TEXTURE);
+			glPopMatrix();
+			glMatrixMode(GL_MODELVIEW);
+		}
+		if (textureID != 0)
+		{
+			glDisable(GL_TEXTURE_2D);
+		}
+	}
+
+	// Wsplna siatka wszystkich szecianw
+	static const Mesh& mesh()
+	{
+		static Mesh cubeMesh = buildMesh();
+		return cubeMesh;
+	}
+
+private:
+	// 24 wierzchoki (osobne normalne i kolory cian), po dwa trjkty na cian
+	static Mesh buildMesh()
+	{
+		struct Face
+		{
+			glm::vec3 normal;
+			glm::vec3 color;
+			glm::vec3 corners[4];
+		};
+
+		const Face faces[6] =
+		{
+			//przednia ciana
+			{ glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), { glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(-0.5f, 0.5f, 0.5f) } },
+			//tylna ciana
+			{ glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f), { glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(-0.5f, 0.5f, -0.5f), glm::vec3(0.5f, 0.5f, -0.5f), glm::vec3(0.5f, -0.5f, -0.5f) } },
+			//grna ciana
+			{ glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), { glm::vec3(-0.5f, 0.5f, -0.5f), glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(0.5f, 0.5f, -0.5f) } },
+			//spd
+			{ glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f), { glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, 0.5f), glm::vec3(-0.5f, -0.5f, 0.5f) } },
+			//lewa ciana
+			{ glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 1.0f), { glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(-0.5f, 0.5f, 0.5f), glm::vec3(-0.5f, 0.5f, -0.5f) } },
+			//prawa ciana
+			{ glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 1.0f), { glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(0.5f, 0.5f, -0.5f), glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(0.5f, -0.5f, 0.5f) } }
+		};
+		const glm::vec2 uvs[4] = { glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 1.0f) };
+
+		Mesh result;
+		for (const Face& face : faces)
+		{
+			unsigned int base = (unsigned int)result.vertices.size();
+			for (int i = 0; i < 4; i++)
+			{
+				result.vertices.push_back({ face.corners[i], face.normal, face.color, uvs[i] });
+			}
+			result.indices.insert(result.indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+		}
+
+		result.computeBounds();
+		MeshOptimizer::optimize(result);
+		return result;
 	}
 };
 